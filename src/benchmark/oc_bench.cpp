@@ -0,0 +1,332 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * oc_bench - throughput benchmarks for the conversion paths used by the GUI
+ * pages (remux, transcode, cut, picture compression, GIF creation) on every
+ * enabled transcoder backend. Inputs are synthesized in-process from lavfi
+ * testsrc2/sine, so no media corpus is needed.
+ *
+ * Reported counters per case:
+ *   fps          frames processed per wall-clock second
+ *   realtime     media seconds processed per wall-clock second
+ *   peak_rss_mb  peak resident set size of the process so far
+ *   allocs       C++ heap allocations per iteration
+ *   output_kb    size of the produced file
+ *
+ * Environment:
+ *   OC_BENCH_DURATION  length of the synthesized clips in seconds (default 5)
+ */
+
+#include "../common/include/encode_parameter.h"
+#include "../common/include/process_parameter.h"
+#include "../engine/include/converter.h"
+#include "synthetic_media.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined(__linux__) || defined(__APPLE__)
+    #include <sys/resource.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// Count every C++ heap allocation made by the process
+static std::atomic<uint64_t> allocationCount{0};
+
+void *operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+enum class BenchOperation { Remux, Transcode, Cut, CompressPicture, CreateGif };
+
+struct BenchCase {
+    BenchOperation operation;
+    std::string transcoder;
+    int width;
+    int height;
+    std::string inputCodec; // encoder used to synthesize the input clip
+};
+
+// What one run of a case processes, used to derive the rate counters
+struct BenchWork {
+    double mediaSeconds;
+    int64_t frames;
+};
+
+const int kFrameRate = 25;
+
+const char *operation_name(BenchOperation op) {
+    switch (op) {
+    case BenchOperation::Remux:
+        return "Remux";
+    case BenchOperation::Transcode:
+        return "Transcode";
+    case BenchOperation::Cut:
+        return "Cut";
+    case BenchOperation::CompressPicture:
+        return "CompressPicture";
+    case BenchOperation::CreateGif:
+        return "CreateGif";
+    }
+    return "Unknown";
+}
+
+double peak_rss_mb() {
+#if defined(__linux__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0.0;
+    #if defined(__APPLE__)
+    return usage.ru_maxrss / (1024.0 * 1024.0); // bytes
+    #else
+    return usage.ru_maxrss / 1024.0; // kilobytes
+    #endif
+#else
+    return 0.0;
+#endif
+}
+
+fs::path bench_dir() {
+    static fs::path dir = fs::temp_directory_path() / "oc_bench";
+    return dir;
+}
+
+double clip_duration() {
+    static double duration = [] {
+        const char *env = std::getenv("OC_BENCH_DURATION");
+        double value = env ? std::atof(env) : 0.0;
+        return value > 0.0 ? value : 5.0;
+    }();
+    return duration;
+}
+
+std::string video_encoder() {
+    return has_encoder("libx264") ? "libx264" : "mpeg4";
+}
+
+bool is_picture(const BenchCase &c) {
+    return c.operation == BenchOperation::CompressPicture;
+}
+
+std::string resolution_name(const BenchCase &c) {
+    return std::to_string(c.width) + "x" + std::to_string(c.height);
+}
+
+// Synthesize (once) and return the input clip for a case
+std::string prepare_input(const BenchCase &c) {
+    static std::map<std::string, std::string> inputs;
+
+    std::string key = is_picture(c) ? "png" : c.inputCodec;
+    key += "_" + resolution_name(c);
+    auto it = inputs.find(key);
+    if (it != inputs.end())
+        return it->second;
+
+    fs::create_directories(bench_dir());
+    fs::path path = bench_dir() / ("input_" + key + (is_picture(c) ? ".png" : ".mp4"));
+    int ret = 0;
+    if (is_picture(c)) {
+        ret = synthesize_image(c.width, c.height, path.string());
+    } else {
+        SyntheticMediaSpec spec;
+        spec.width = c.width;
+        spec.height = c.height;
+        spec.frame_rate = kFrameRate;
+        spec.duration = clip_duration();
+        spec.video_codec = c.inputCodec;
+        ret = synthesize_media(spec, path.string());
+    }
+
+    std::string result = ret < 0 ? std::string() : path.string();
+    inputs[key] = result;
+    return result;
+}
+
+// Mirror the parameters the corresponding GUI page hands to the converter
+BenchWork configure(const BenchCase &c, EncodeParameter &param,
+                    std::string &outputExt) {
+    double duration = clip_duration();
+    BenchWork work = {duration, static_cast<int64_t>(duration * kFrameRate)};
+
+    switch (c.operation) {
+    case BenchOperation::Remux:
+        param.set_video_codec_name("copy");
+        param.set_audio_codec_name("copy");
+        outputExt = "mkv";
+        break;
+    case BenchOperation::Transcode:
+        param.set_video_codec_name(video_encoder());
+        param.set_video_bit_rate(2000000);
+        param.set_audio_codec_name("aac");
+        param.set_audio_bit_rate(128000);
+        outputExt = "mp4";
+        break;
+    case BenchOperation::Cut:
+        param.set_video_codec_name("copy");
+        param.set_audio_codec_name("copy");
+        param.set_start_time(duration * 0.2);
+        param.set_end_time(duration * 0.6);
+        work.mediaSeconds = duration * 0.4;
+        work.frames = static_cast<int64_t>(work.mediaSeconds * kFrameRate);
+        outputExt = "mp4";
+        break;
+    case BenchOperation::CompressPicture:
+        param.set_video_codec_name("mjpeg");
+        param.set_qscale(5);
+        param.set_pixel_format("yuvj444p");
+        work.mediaSeconds = 0.0;
+        work.frames = 1;
+        outputExt = "jpg";
+        break;
+    case BenchOperation::CreateGif:
+        param.set_video_codec_name("gif");
+        param.set_width(320);
+        param.set_height(c.height * 320 / c.width);
+        outputExt = "gif";
+        break;
+    }
+    return work;
+}
+
+void run_case(benchmark::State &state, const BenchCase &c) {
+    std::string input = prepare_input(c);
+    if (input.empty()) {
+        state.SkipWithError("Failed to synthesize input media");
+        return;
+    }
+
+    std::string name = std::string(operation_name(c.operation)) + "_" +
+                       c.transcoder + "_" + resolution_name(c);
+    uint64_t allocations = 0;
+    uintmax_t outputSize = 0;
+    BenchWork work = {0.0, 0};
+
+    for (auto _ : state) {
+        EncodeParameter encodeParam;
+        ProcessParameter processParam;
+        std::string outputExt;
+        work = configure(c, encodeParam, outputExt);
+        fs::path output = bench_dir() / ("output_" + name + "." + outputExt);
+
+        uint64_t before = allocationCount.load(std::memory_order_relaxed);
+        Converter converter(&processParam, &encodeParam);
+        if (!converter.set_transcoder(c.transcoder) ||
+            !converter.convert_format(input, output.string())) {
+            state.SkipWithError("Conversion failed");
+            break;
+        }
+        allocations += allocationCount.load(std::memory_order_relaxed) - before;
+
+        std::error_code ec;
+        outputSize = fs::file_size(output, ec);
+        fs::remove(output, ec);
+    }
+
+    double iterations = static_cast<double>(state.iterations());
+    state.counters["fps"] =
+        benchmark::Counter(work.frames * iterations, benchmark::Counter::kIsRate);
+    state.counters["realtime"] = benchmark::Counter(
+        work.mediaSeconds * iterations, benchmark::Counter::kIsRate);
+    state.counters["peak_rss_mb"] = peak_rss_mb();
+    state.counters["allocs"] = benchmark::Counter(
+        static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+    state.counters["output_kb"] = outputSize / 1024.0;
+}
+
+std::vector<std::string> enabled_transcoders() {
+    std::vector<std::string> names;
+#if defined(ENABLE_FFMPEG)
+    names.push_back("FFMPEG");
+#endif
+#if defined(ENABLE_FFTOOL)
+    names.push_back("FFTOOL");
+#endif
+#if defined(ENABLE_BMF)
+    names.push_back("BMF");
+#endif
+    return names;
+}
+
+void register_case(const BenchCase &c) {
+    std::string name = std::string(operation_name(c.operation)) + "/" +
+                       c.transcoder + "/";
+    if (!is_picture(c))
+        name += c.inputCodec + "/";
+    name += resolution_name(c);
+
+    benchmark::RegisterBenchmark(name.c_str(),
+                                 [c](benchmark::State &state) { run_case(state, c); })
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+}
+
+void register_benchmarks() {
+    const std::vector<std::pair<int, int>> resolutions = {
+        {640, 360}, {1280, 720}, {1920, 1080}};
+    const std::vector<std::string> inputCodecs = {video_encoder(), "mpeg4"};
+
+    for (const std::string &transcoder : enabled_transcoders()) {
+        for (const auto &res : resolutions) {
+            for (const std::string &codec : inputCodecs) {
+                register_case({BenchOperation::Remux, transcoder, res.first, res.second, codec});
+                register_case({BenchOperation::Transcode, transcoder, res.first, res.second, codec});
+                register_case({BenchOperation::Cut, transcoder, res.first, res.second, codec});
+                // identical input codecs would only register the same case twice
+                if (inputCodecs.front() == inputCodecs.back())
+                    break;
+            }
+            register_case({BenchOperation::CompressPicture, transcoder, res.first, res.second, ""});
+            register_case({BenchOperation::CreateGif, transcoder, res.first, res.second,
+                           inputCodecs.front()});
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    register_benchmarks();
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    std::error_code ec;
+    fs::remove_all(bench_dir(), ec);
+    return 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * oc_probe - cost of reading the stream parameters of a file, with the
+ * full avformat_find_stream_info() probe and with Info's fast probe, on a
+ * corpus of mixed containers. The corpus is synthesized in-process (mp4,
+ * mov, mkv, avi and MPEG-TS with the same video and AAC audio); files in
+ * OC_PROBE_CORPUS are probed as well, which is where slow network mounts
+ * and long TS/MKV captures show the difference.
+ *
+ * Reported counters per case:
+ *   kb_read   bytes read from the file per probe
+ *   complete  1 if the probe filled in every audio/video stream's codec
+ *             and size or sample rate, as Info::send_info() reports them
+ *
+ * Environment:
+ *   OC_PROBE_CORPUS  directory of additional media files to probe
+ */
+
+#include "../common/include/av_resource.h"
+#include "../common/include/info.h"
+#include "synthetic_media.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+fs::path bench_dir() {
+    static fs::path dir = fs::temp_directory_path() / "oc_probe";
+    return dir;
+}
+
+// Synthesized files, then the user's corpus, each as (name, path)
+std::vector<std::pair<std::string, std::string>> corpus() {
+    std::vector<std::pair<std::string, std::string>> files;
+
+    fs::create_directories(bench_dir());
+    SyntheticMediaSpec spec;
+    spec.video_codec = has_encoder("libx264") ? "libx264" : "mpeg4";
+    for (const char *ext : {"mp4", "mov", "mkv", "avi", "ts"}) {
+        fs::path path = bench_dir() / (std::string("input.") + ext);
+        if (synthesize_media(spec, path.string()) >= 0)
+            files.push_back({ext, path.string()});
+    }
+
+    const char *env = std::getenv("OC_PROBE_CORPUS");
+    std::error_code ec;
+    if (env && *env) {
+        for (const fs::directory_entry &entry : fs::directory_iterator(env, ec)) {
+            if (entry.is_regular_file(ec))
+                files.push_back({"corpus:" + entry.path().filename().string(),
+                                 entry.path().string()});
+        }
+    }
+    return files;
+}
+
+bool parameters_complete(AVFormatContext *fmtCtx) {
+    for (unsigned i = 0; i < fmtCtx->nb_streams; i++) {
+        AVCodecParameters *par = fmtCtx->streams[i]->codecpar;
+        if (par->codec_type == AVMEDIA_TYPE_VIDEO &&
+            (par->codec_id == AV_CODEC_ID_NONE || par->width <= 0))
+            return false;
+        if (par->codec_type == AVMEDIA_TYPE_AUDIO &&
+            (par->codec_id == AV_CODEC_ID_NONE || par->sample_rate <= 0))
+            return false;
+    }
+    return fmtCtx->nb_streams > 0;
+}
+
+void run_case(benchmark::State &state, const std::string &path, bool fastProbe) {
+    int64_t bytesRead = 0;
+    bool complete = false;
+
+    for (auto _ : state) {
+        AVFormatContext *raw = NULL;
+        int ret = Info::open_input(&raw, path.c_str(), fastProbe);
+        if (!raw || ret < 0) {
+            state.SkipWithError("Probing failed");
+            break;
+        }
+        AVInputFormatContextPtr fmtCtx(raw);
+        bytesRead = fmtCtx->pb ? fmtCtx->pb->bytes_read : 0;
+        complete = parameters_complete(fmtCtx.get());
+    }
+
+    state.counters["kb_read"] = bytesRead / 1024.0;
+    state.counters["complete"] = complete ? 1 : 0;
+}
+
+void register_benchmarks() {
+    av_log_set_level(AV_LOG_ERROR);
+    for (const auto &file : corpus()) {
+        for (bool fastProbe : {false, true}) {
+            std::string name = std::string(fastProbe ? "Fast" : "Full") + "/" + file.first;
+            std::string path = file.second;
+            benchmark::RegisterBenchmark(name.c_str(), [path, fastProbe](benchmark::State &state) {
+                run_case(state, path, fastProbe);
+            })->Unit(benchmark::kMicrosecond)->UseRealTime();
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    register_benchmarks();
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    std::error_code ec;
+    fs::remove_all(bench_dir(), ec);
+    return 0;
+}
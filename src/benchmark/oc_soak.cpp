@@ -0,0 +1,178 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * oc_soak - runs many small conversions in one process, the way a long
+ * batch or a watch-folder service does, and fails if the resident set
+ * keeps growing. Catches libav objects that leak once per job or per
+ * frame, which a single conversion never shows.
+ *
+ * The jobs cycle through remux, transcode and cut of a short synthesized
+ * clip on the FFmpeg backend. Resident memory is sampled once the warmup
+ * jobs have filled the allocator pools and again after the last job.
+ *
+ * Environment:
+ *   OC_SOAK_JOBS            number of conversions (default 10000)
+ *   OC_SOAK_WARMUP          jobs run before the baseline sample (default 100)
+ *   OC_SOAK_MAX_GROWTH_MB   allowed growth after warmup (default 16)
+ *
+ * Exit status is 0 when the growth stays within the limit, 1 otherwise.
+ */
+
+#include "../common/include/encode_parameter.h"
+#include "../common/include/process_parameter.h"
+#include "../engine/include/converter.h"
+#include "synthetic_media.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#if defined(__linux__)
+    #include <unistd.h>
+#elif defined(__APPLE__)
+    #include <mach/mach.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+enum class SoakOperation { Remux, Transcode, Cut };
+
+const double kClipDuration = 1.0;
+
+long env_long(const char *name, long fallback) {
+    const char *env = std::getenv(name);
+    long value = env ? std::atol(env) : 0;
+    return value > 0 ? value : fallback;
+}
+
+// Current (not peak) resident set size, a leak shows as steady growth
+double current_rss_mb() {
+#if defined(__linux__)
+    long pages = 0;
+    long resident = 0;
+    FILE *statm = std::fopen("/proc/self/statm", "r");
+    if (!statm)
+        return 0.0;
+    int n = std::fscanf(statm, "%ld %ld", &pages, &resident);
+    std::fclose(statm);
+    if (n != 2)
+        return 0.0;
+    return resident * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                  (task_info_t)&info, &count) != KERN_SUCCESS)
+        return 0.0;
+    return info.resident_size / (1024.0 * 1024.0);
+#else
+    return 0.0;
+#endif
+}
+
+void configure(SoakOperation op, EncodeParameter &param) {
+    switch (op) {
+    case SoakOperation::Remux:
+        param.set_video_codec_name("copy");
+        param.set_audio_codec_name("copy");
+        break;
+    case SoakOperation::Transcode:
+        param.set_video_codec_name("mpeg4");
+        param.set_video_bit_rate(500000);
+        param.set_audio_codec_name("aac");
+        param.set_audio_bit_rate(64000);
+        break;
+    case SoakOperation::Cut:
+        param.set_video_codec_name("copy");
+        param.set_audio_codec_name("copy");
+        param.set_start_time(kClipDuration * 0.2);
+        param.set_end_time(kClipDuration * 0.6);
+        break;
+    }
+}
+
+bool run_job(const std::string &input, const fs::path &output, long job) {
+    EncodeParameter encodeParam;
+    ProcessParameter processParam;
+    configure(static_cast<SoakOperation>(job % 3), encodeParam);
+
+    Converter converter(&processParam, &encodeParam);
+    bool ok = converter.set_transcoder("FFMPEG") &&
+              converter.convert_format(input, output.string());
+    std::error_code ec;
+    fs::remove(output, ec);
+    return ok;
+}
+
+} // namespace
+
+int main() {
+    long jobs = env_long("OC_SOAK_JOBS", 10000);
+    long warmup = env_long("OC_SOAK_WARMUP", 100);
+    double maxGrowth = env_long("OC_SOAK_MAX_GROWTH_MB", 16);
+    if (warmup >= jobs)
+        warmup = jobs / 10;
+
+    fs::path dir = fs::temp_directory_path() / "oc_soak";
+    fs::create_directories(dir);
+    fs::path input = dir / "input.mp4";
+    fs::path output = dir / "output.mp4";
+
+    SyntheticMediaSpec spec;
+    spec.width = 320;
+    spec.height = 240;
+    spec.duration = kClipDuration;
+    spec.video_codec = "mpeg4";
+    if (synthesize_media(spec, input.string()) < 0) {
+        std::cerr << "Failed to synthesize input media" << std::endl;
+        return 1;
+    }
+
+    double baseline = 0.0;
+    for (long job = 0; job < jobs; job++) {
+        if (job == warmup)
+            baseline = current_rss_mb();
+        if (!run_job(input.string(), output, job)) {
+            std::cerr << "Conversion " << job << " failed" << std::endl;
+            return 1;
+        }
+        if ((job + 1) % 1000 == 0)
+            std::cout << job + 1 << " jobs, rss " << current_rss_mb()
+                      << " MB" << std::endl;
+    }
+
+    double finalRss = current_rss_mb();
+    double growth = finalRss - baseline;
+    std::cout << "rss after warmup " << baseline << " MB, after " << jobs
+              << " jobs " << finalRss << " MB, growth " << growth << " MB"
+              << std::endl;
+
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+
+    if (growth > maxGrowth) {
+        std::cerr << "Resident memory grew by more than " << maxGrowth
+                  << " MB" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * oc_startup - cold-start latency of the OpenConverter executable. Every
+ * iteration spawns a fresh process and waits for it to exit, so the
+ * reported real time covers loading, static initialization and the work
+ * done before the first interaction.
+ *
+ *   CliHelp    `OpenConverter --help`
+ *   GuiLaunch  the GUI with OC_EXIT_AFTER_STARTUP set, which quits as soon
+ *              as the main window has been shown; runs on the offscreen
+ *              Qt platform unless QT_QPA_PLATFORM is set
+ *
+ * Reported counters per case:
+ *   child_cpu_ms  user + system CPU time of the child
+ *   peak_rss_mb   peak resident set size of the child
+ *
+ * Environment:
+ *   OC_STARTUP_BINARY  executable to launch (default: the OpenConverter
+ *                      built alongside this benchmark)
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fcntl.h>
+#include <spawn.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <vector>
+
+extern char **environ;
+
+namespace {
+
+std::string startup_binary() {
+    const char *env = std::getenv("OC_STARTUP_BINARY");
+    return env && *env ? env : OC_STARTUP_DEFAULT_BINARY;
+}
+
+struct LaunchResult {
+    bool ok;
+    double cpuMs;
+    double peakRssMb;
+};
+
+// Run the binary to completion with stdout/stderr discarded
+LaunchResult launch(const std::vector<std::string> &args,
+                    const std::vector<std::string> &extraEnv) {
+    LaunchResult result = {false, 0.0, 0.0};
+
+    std::vector<std::string> env(extraEnv);
+    for (char **e = environ; *e; ++e)
+        env.push_back(*e);
+
+    std::vector<char *> argv;
+    for (const std::string &a : args)
+        argv.push_back(const_cast<char *>(a.c_str()));
+    argv.push_back(nullptr);
+    std::vector<char *> envp;
+    for (const std::string &e : env)
+        envp.push_back(const_cast<char *>(e.c_str()));
+    envp.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    pid_t pid;
+    int ret = posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), envp.data());
+    posix_spawn_file_actions_destroy(&actions);
+    if (ret != 0)
+        return result;
+
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid)
+        return result;
+
+    result.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    result.cpuMs = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+                   (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+#if defined(__APPLE__)
+    result.peakRssMb = usage.ru_maxrss / (1024.0 * 1024.0); // bytes
+#else
+    result.peakRssMb = usage.ru_maxrss / 1024.0; // kilobytes
+#endif
+    return result;
+}
+
+void run_launches(benchmark::State &state, const std::vector<std::string> &args,
+                  const std::vector<std::string> &extraEnv) {
+    double cpuMs = 0.0;
+    double peakRssMb = 0.0;
+    for (auto _ : state) {
+        LaunchResult r = launch(args, extraEnv);
+        if (!r.ok) {
+            state.SkipWithError(("failed to run " + args.front()).c_str());
+            return;
+        }
+        cpuMs += r.cpuMs;
+        peakRssMb = std::max(peakRssMb, r.peakRssMb);
+    }
+    state.counters["child_cpu_ms"] =
+        benchmark::Counter(cpuMs, benchmark::Counter::kAvgIterations);
+    state.counters["peak_rss_mb"] = peakRssMb;
+}
+
+void BM_CliHelp(benchmark::State &state) {
+    run_launches(state, {startup_binary(), "--help"}, {});
+}
+
+#if defined(OC_STARTUP_GUI)
+void BM_GuiLaunch(benchmark::State &state) {
+    std::vector<std::string> env = {"OC_EXIT_AFTER_STARTUP=1"};
+    if (!std::getenv("QT_QPA_PLATFORM"))
+        env.push_back("QT_QPA_PLATFORM=offscreen");
+    run_launches(state, {startup_binary()}, env);
+}
+#endif
+
+} // namespace
+
+BENCHMARK(BM_CliHelp)->Unit(benchmark::kMillisecond)->UseRealTime();
+#if defined(OC_STARTUP_GUI)
+BENCHMARK(BM_GuiLaunch)->Unit(benchmark::kMillisecond)->UseRealTime();
+#endif
+
+BENCHMARK_MAIN();
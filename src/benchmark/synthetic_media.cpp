@@ -0,0 +1,355 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * This file is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "synthetic_media.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavfilter/avfilter.h>
+#include <libavfilter/buffersink.h>
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
+}
+
+#define SYNTH_SAMPLE_RATE 48000
+
+namespace {
+
+// One lavfi source graph feeding one encoder / output stream
+struct SourceStream {
+    AVFilterGraph *graph = NULL;
+    AVFilterContext *sink = NULL;
+    AVCodecContext *enc_ctx = NULL;
+    AVStream *stream = NULL;
+    AVFrame *frame = NULL;
+    int64_t next_pts = 0; // in encoder time base
+    bool finished = false;
+};
+
+void close_source(SourceStream *src) {
+    avfilter_graph_free(&src->graph);
+    avcodec_free_context(&src->enc_ctx);
+    av_frame_free(&src->frame);
+}
+
+int open_source_graph(const std::string &descr, bool audio, SourceStream *src) {
+    int ret = 0;
+    AVFilterInOut *inputs = avfilter_inout_alloc();
+    AVFilterInOut *outputs = NULL;
+
+    src->graph = avfilter_graph_alloc();
+    if (!inputs || !src->graph) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    if ((ret = avfilter_graph_create_filter(
+             &src->sink,
+             avfilter_get_by_name(audio ? "abuffersink" : "buffersink"), "out",
+             NULL, NULL, src->graph)) < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Cannot create buffer sink\n");
+        goto end;
+    }
+
+    // the last (unlabeled) output of the source chain is linked to the sink
+    inputs->name = av_strdup("out");
+    inputs->filter_ctx = src->sink;
+    inputs->pad_idx = 0;
+    inputs->next = NULL;
+
+    if ((ret = avfilter_graph_parse_ptr(src->graph, descr.c_str(), &inputs,
+                                        &outputs, NULL)) < 0)
+        goto end;
+
+    ret = avfilter_graph_config(src->graph, NULL);
+
+end:
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    return ret;
+}
+
+int add_stream(AVFormatContext *fmt_ctx, SourceStream *src) {
+    int ret = 0;
+    src->stream = avformat_new_stream(fmt_ctx, NULL);
+    if (!src->stream)
+        return AVERROR(ENOMEM);
+    if ((ret = avcodec_parameters_from_context(src->stream->codecpar,
+                                               src->enc_ctx)) < 0)
+        return ret;
+    src->stream->time_base = src->enc_ctx->time_base;
+
+    src->frame = av_frame_alloc();
+    if (!src->frame)
+        return AVERROR(ENOMEM);
+    return 0;
+}
+
+AVPixelFormat pick_pix_fmt(const AVCodec *codec, bool prefer_yuv420p) {
+    if (!codec->pix_fmts)
+        return AV_PIX_FMT_YUV420P;
+    if (prefer_yuv420p) {
+        for (const AVPixelFormat *p = codec->pix_fmts; *p != AV_PIX_FMT_NONE; p++) {
+            if (*p == AV_PIX_FMT_YUV420P)
+                return *p;
+        }
+    }
+    return codec->pix_fmts[0];
+}
+
+int open_video(const AVCodec *codec, int width, int height, int frame_rate,
+               double duration, bool prefer_yuv420p, AVFormatContext *fmt_ctx,
+               SourceStream *src) {
+    int ret = 0;
+    AVCodecContext *ctx = avcodec_alloc_context3(codec);
+    if (!ctx)
+        return AVERROR(ENOMEM);
+    src->enc_ctx = ctx;
+
+    ctx->width = width;
+    ctx->height = height;
+    ctx->pix_fmt = pick_pix_fmt(codec, prefer_yuv420p);
+    ctx->time_base = av_make_q(1, frame_rate);
+    ctx->framerate = av_make_q(frame_rate, 1);
+    // a keyframe every two seconds keeps cut/seek benchmarks realistic
+    ctx->gop_size = frame_rate * 2;
+    if (codec->id != AV_CODEC_ID_H264 && codec->id != AV_CODEC_ID_HEVC)
+        ctx->bit_rate = 2000000;
+    // keep input generation cheap, it is not what we measure
+    av_opt_set(ctx->priv_data, "preset", "ultrafast", 0);
+    if (fmt_ctx->oformat->flags & AVFMT_GLOBALHEADER)
+        ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    if ((ret = avcodec_open2(ctx, codec, NULL)) < 0)
+        return ret;
+    if ((ret = add_stream(fmt_ctx, src)) < 0)
+        return ret;
+
+    std::string descr = "testsrc2=size=" + std::to_string(width) + "x" +
+                        std::to_string(height) +
+                        ":rate=" + std::to_string(frame_rate) +
+                        ":duration=" + std::to_string(duration) +
+                        ",format=" + av_get_pix_fmt_name(ctx->pix_fmt);
+    return open_source_graph(descr, false, src);
+}
+
+int open_audio(const AVCodec *codec, double duration, AVFormatContext *fmt_ctx,
+               SourceStream *src) {
+    int ret = 0;
+    AVCodecContext *ctx = avcodec_alloc_context3(codec);
+    if (!ctx)
+        return AVERROR(ENOMEM);
+    src->enc_ctx = ctx;
+
+    ctx->sample_rate = SYNTH_SAMPLE_RATE;
+    av_channel_layout_default(&ctx->ch_layout, 2);
+    ctx->sample_fmt =
+        codec->sample_fmts ? codec->sample_fmts[0] : AV_SAMPLE_FMT_FLTP;
+    ctx->bit_rate = 128000;
+    ctx->time_base = av_make_q(1, SYNTH_SAMPLE_RATE);
+    if (fmt_ctx->oformat->flags & AVFMT_GLOBALHEADER)
+        ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    if ((ret = avcodec_open2(ctx, codec, NULL)) < 0)
+        return ret;
+    if ((ret = add_stream(fmt_ctx, src)) < 0)
+        return ret;
+
+    std::string descr = "sine=frequency=440:sample_rate=" +
+                        std::to_string(SYNTH_SAMPLE_RATE) +
+                        ":duration=" + std::to_string(duration) +
+                        ",aformat=sample_fmts=" +
+                        av_get_sample_fmt_name(ctx->sample_fmt) +
+                        ":channel_layouts=stereo";
+    if ((ret = open_source_graph(descr, true, src)) < 0)
+        return ret;
+
+    if (!(codec->capabilities & AV_CODEC_CAP_VARIABLE_FRAME_SIZE) &&
+        ctx->frame_size > 0)
+        av_buffersink_set_frame_size(src->sink, ctx->frame_size);
+    return 0;
+}
+
+int encode_write(AVFormatContext *fmt_ctx, SourceStream *src, AVFrame *frame) {
+    int ret = 0;
+    AVPacket *pkt = av_packet_alloc();
+    if (!pkt)
+        return AVERROR(ENOMEM);
+
+    if ((ret = avcodec_send_frame(src->enc_ctx, frame)) < 0)
+        goto end;
+
+    while (ret >= 0) {
+        if ((ret = avcodec_receive_packet(src->enc_ctx, pkt)) == AVERROR(EAGAIN) ||
+            ret == AVERROR_EOF) {
+            ret = 0;
+            break;
+        } else if (ret < 0) {
+            break;
+        }
+        pkt->stream_index = src->stream->index;
+        av_packet_rescale_ts(pkt, src->enc_ctx->time_base, src->stream->time_base);
+        ret = av_interleaved_write_frame(fmt_ctx, pkt);
+    }
+
+end:
+    av_packet_free(&pkt);
+    return ret;
+}
+
+// Pull one frame out of the source graph and push it through the encoder
+int pull_and_encode(AVFormatContext *fmt_ctx, SourceStream *src) {
+    int ret = av_buffersink_get_frame(src->sink, src->frame);
+    if (ret == AVERROR_EOF) {
+        src->finished = true;
+        return encode_write(fmt_ctx, src, NULL);
+    }
+    if (ret == AVERROR(EAGAIN))
+        return 0;
+    if (ret < 0)
+        return ret;
+
+    src->frame->pts = av_rescale_q(src->frame->pts,
+                                   av_buffersink_get_time_base(src->sink),
+                                   src->enc_ctx->time_base);
+    src->next_pts = src->frame->pts +
+                    (src->frame->nb_samples > 0 ? src->frame->nb_samples : 1);
+    src->frame->pict_type = AV_PICTURE_TYPE_NONE;
+
+    ret = encode_write(fmt_ctx, src, src->frame);
+    av_frame_unref(src->frame);
+    return ret;
+}
+
+int render(AVFormatContext *fmt_ctx, const std::string &output_path,
+           SourceStream *video, SourceStream *audio) {
+    int ret = 0;
+    if (!(fmt_ctx->oformat->flags & AVFMT_NOFILE) &&
+        (ret = avio_open(&fmt_ctx->pb, output_path.c_str(), AVIO_FLAG_WRITE)) < 0)
+        return ret;
+    if ((ret = avformat_write_header(fmt_ctx, NULL)) < 0)
+        return ret;
+
+    // interleave both sources by timestamp so the muxer never has to buffer
+    while (!video->finished || (audio && !audio->finished)) {
+        SourceStream *next = video;
+        if (audio && !audio->finished &&
+            (video->finished ||
+             av_compare_ts(audio->next_pts, audio->enc_ctx->time_base,
+                           video->next_pts, video->enc_ctx->time_base) < 0))
+            next = audio;
+        if ((ret = pull_and_encode(fmt_ctx, next)) < 0)
+            return ret;
+    }
+
+    return av_write_trailer(fmt_ctx);
+}
+
+void close_output(AVFormatContext *fmt_ctx) {
+    if (!fmt_ctx)
+        return;
+    if (!(fmt_ctx->oformat->flags & AVFMT_NOFILE))
+        avio_closep(&fmt_ctx->pb);
+    avformat_free_context(fmt_ctx);
+}
+
+} // namespace
+
+int synthesize_media(const SyntheticMediaSpec &spec,
+                     const std::string &output_path) {
+    AVFormatContext *fmt_ctx = NULL;
+    SourceStream video;
+    SourceStream audio;
+    bool has_audio = !spec.audio_codec.empty();
+    const AVCodec *video_codec = NULL;
+    const AVCodec *audio_codec = NULL;
+
+    int ret = avformat_alloc_output_context2(&fmt_ctx, NULL, NULL,
+                                             output_path.c_str());
+    if (!fmt_ctx)
+        return ret < 0 ? ret : AVERROR(ENOMEM);
+
+    video_codec = avcodec_find_encoder_by_name(spec.video_codec.c_str());
+    if (!video_codec) {
+        av_log(NULL, AV_LOG_WARNING, "Encoder %s not available, using mpeg4\n",
+               spec.video_codec.c_str());
+        video_codec = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+    }
+    if (!video_codec) {
+        ret = AVERROR_ENCODER_NOT_FOUND;
+        goto end;
+    }
+    if ((ret = open_video(video_codec, spec.width, spec.height, spec.frame_rate,
+                          spec.duration, true, fmt_ctx, &video)) < 0)
+        goto end;
+
+    if (has_audio) {
+        audio_codec = avcodec_find_encoder_by_name(spec.audio_codec.c_str());
+        if (!audio_codec) {
+            ret = AVERROR_ENCODER_NOT_FOUND;
+            goto end;
+        }
+        if ((ret = open_audio(audio_codec, spec.duration, fmt_ctx, &audio)) < 0)
+            goto end;
+    }
+
+    ret = render(fmt_ctx, output_path, &video, has_audio ? &audio : NULL);
+
+end:
+    if (ret < 0)
+        av_log(NULL, AV_LOG_ERROR, "Failed to synthesize %s\n",
+               output_path.c_str());
+    close_source(&video);
+    close_source(&audio);
+    close_output(fmt_ctx);
+    return ret;
+}
+
+int synthesize_image(int width, int height, const std::string &output_path) {
+    AVFormatContext *fmt_ctx = NULL;
+    SourceStream video;
+    const AVCodec *codec = NULL;
+
+    int ret = avformat_alloc_output_context2(&fmt_ctx, NULL, NULL,
+                                             output_path.c_str());
+    if (!fmt_ctx)
+        return ret < 0 ? ret : AVERROR(ENOMEM);
+
+    codec = avcodec_find_encoder(av_guess_codec(fmt_ctx->oformat, NULL,
+                                                output_path.c_str(), NULL,
+                                                AVMEDIA_TYPE_VIDEO));
+    if (!codec) {
+        ret = AVERROR_ENCODER_NOT_FOUND;
+        goto end;
+    }
+    if ((ret = open_video(codec, width, height, 1, 1.0, false, fmt_ctx,
+                          &video)) < 0)
+        goto end;
+
+    ret = render(fmt_ctx, output_path, &video, NULL);
+
+end:
+    if (ret < 0)
+        av_log(NULL, AV_LOG_ERROR, "Failed to synthesize %s\n",
+               output_path.c_str());
+    close_source(&video);
+    close_output(fmt_ctx);
+    return ret;
+}
+
+bool has_encoder(const std::string &name) {
+    return avcodec_find_encoder_by_name(name.c_str()) != NULL;
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * This file is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef SYNTHETIC_MEDIA_H
+#define SYNTHETIC_MEDIA_H
+
+#include <string>
+
+// Description of a synthetic clip rendered from lavfi testsrc2/sine sources
+struct SyntheticMediaSpec {
+    int width = 1280;
+    int height = 720;
+    int frame_rate = 25;
+    double duration = 5.0; // in seconds
+
+    std::string video_codec = "libx264";
+    std::string audio_codec = "aac"; // empty to produce a video-only file
+};
+
+/*
+ * Render testsrc2 (and sine, if an audio codec is set) through libavfilter
+ * and encode the result into output_path. The container is guessed from the
+ * file extension. Returns 0 on success or a negative AVERROR code.
+ */
+int synthesize_media(const SyntheticMediaSpec &spec,
+                     const std::string &output_path);
+
+/* Render a single testsrc2 frame and store it as a still image (png/jpg). */
+int synthesize_image(int width, int height, const std::string &output_path);
+
+/* Check whether the linked libavcodec provides the named encoder. */
+bool has_encoder(const std::string &name);
+
+#endif // SYNTHETIC_MEDIA_H
@@ -99,6 +99,9 @@ private:
 
     // Batch mode helper
     BatchModeHelper *batchModeHelper;
+
+    // Python environment found, no need to probe again
+    bool pythonReady;
 };
 
 #endif // AI_PROCESSING_PAGE_H
@@ -21,6 +21,19 @@
 #include <QString>
 #include <QDateTime>
 #include "encode_parameter.h"
+#include "../../engine/include/converter.h"
+
+/**
+ * @brief Resources a job is expected to use, filled in by BatchScheduler
+ */
+struct BatchItemCost {
+    bool probed = false;
+    double mediaSeconds = 0.0;  // Length of the converted range
+    int width = 0;
+    int height = 0;
+    int cores = 1;              // CPU cores the job keeps busy
+    qint64 memoryMB = 256;      // Peak resident memory
+};
 
 /**
  * @brief Status of a batch item
@@ -50,6 +63,7 @@ public:
     ~BatchItem();
 
     // Getters
+    qint64 GetId() const;
     QString GetInputPath() const;
     QString GetOutputPath() const;
     BatchItemStatus GetStatus() const;
@@ -61,32 +75,61 @@ public:
     QDateTime GetStartedTime() const;
     QDateTime GetFinishedTime() const;
     double GetProgress() const;
+    double GetPredictedSeconds() const;
+    double GetRemainingSeconds() const;
+    bool IsEstimated() const;
+    int GetPriority() const;
+    BatchItemCost GetCost() const;
+    // Shape of the input, valid once GetCost().probed is set
+    JobProfile GetProfile() const;
 
     // Setters
+    void SetId(qint64 id);
     void SetInputPath(const QString &path);
     void SetOutputPath(const QString &path);
     void SetStatus(BatchItemStatus status);
     void SetErrorMessage(const QString &message);
     void SetEncodeParameter(EncodeParameter *param);
+    // Like SetEncodeParameter(), but the item deletes the parameters
+    void SetOwnedEncodeParameter(EncodeParameter *param);
     void SetTranscoderName(const QString &name);
     void SetProgress(double progress);
+    void SetPredictedSeconds(double seconds);
+    void SetRemainingSeconds(double seconds);
+    void ResetEstimate();
+    void SetPriority(int priority);
+    void SetCost(const BatchItemCost &cost);
+    void SetProfile(const JobProfile &profile);
+    void SetCreatedTime(const QDateTime &time);
+    void SetStartedTime(const QDateTime &time);
+    void SetFinishedTime(const QDateTime &time);
 
     // Status management
     void MarkAsProcessing();
     void MarkAsFinished();
     void MarkAsFailed(const QString &errorMessage);
+    // Back to the queue, e.g. after the run was stopped
+    void MarkAsWaiting();
 
 private:
+    qint64 id;  // Stable across restarts, assigned by BatchQueue, 0 if unset
     QString inputPath;
     QString outputPath;
     BatchItemStatus status;
     QString errorMessage;
     EncodeParameter *encodeParameter;
+    bool ownsEncodeParameter;
     QString transcoderName;  // Transcoder to use (e.g., "FFMPEG", "BMF", "FFTOOL")
     QDateTime createdTime;
     QDateTime startedTime;
     QDateTime finishedTime;
     double progress;  // 0.0 to 100.0
+    double predictedSeconds;  // Expected duration from history, < 0 if unknown
+    double remainingSeconds;  // Live estimate while processing, < 0 if unknown
+    bool estimated;           // Whether a prediction has been attempted
+    int priority;             // Higher runs first, 0 by default
+    BatchItemCost cost;
+    JobProfile profile;       // Kept so a prediction never probes again
 };
 
 #endif // BATCH_ITEM_H
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BATCH_JOURNAL_H
+#define BATCH_JOURNAL_H
+
+#include <QFile>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include "batch_item.h"
+
+/**
+ * @brief Append-only on-disk journal of the batch queue
+ *
+ * Every change to the queue is appended as one JSON object per line:
+ *   {"op":"add","item":{...}}          item with its encode parameters
+ *   {"op":"status","id":N,...}         status, error and timestamps
+ *   {"op":"priority","id":N,"priority":P}
+ *   {"op":"remove","id":N}
+ *   {"op":"clear"}
+ *
+ * Load() replays the records; a line torn by a crash is skipped. Items
+ * that were Processing when the application stopped are put back to
+ * Waiting. Compact() rewrites the journal as one "add" record per item
+ * and atomically replaces the old file, so the journal stays
+ * proportional to the queue.
+ *
+ * Not thread-safe, BatchQueue calls it while holding its mutex.
+ */
+class BatchJournal {
+public:
+    explicit BatchJournal(const QString &path);
+    ~BatchJournal();
+
+    // <data dir>/OpenConverter/batch_queue.jsonl
+    static QString DefaultPath();
+
+    QString GetPath() const;
+
+    /**
+     * @brief Replay the journal
+     * @return Restored items in queue order, owned by the caller
+     */
+    QList<BatchItem*> Load();
+
+    /**
+     * @brief Replace the journal with a snapshot of the given items
+     * @return true if the snapshot was written
+     */
+    bool Compact(const QList<BatchItem*> &items);
+
+    void RecordAdded(BatchItem *item);
+    void RecordStatus(BatchItem *item);
+    void RecordPriority(BatchItem *item);
+    void RecordRemoved(BatchItem *item);
+    void RecordCleared();
+
+    // Records written since the last compaction
+    int GetRecordCount() const;
+
+    static QJsonObject ItemToJson(BatchItem *item);
+    static BatchItem* ItemFromJson(const QJsonObject &object);
+    static QJsonObject EncodeParameterToJson(EncodeParameter *param);
+    static EncodeParameter* EncodeParameterFromJson(const QJsonObject &object);
+
+private:
+    bool Append(const QJsonObject &record);
+    bool OpenForAppend();
+
+    QString path;
+    QFile file;
+    int recordCount;
+};
+
+#endif // BATCH_JOURNAL_H
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BATCH_MANIFEST_H
+#define BATCH_MANIFEST_H
+
+#include <QFile>
+#include <QHash>
+#include <QJsonObject>
+#include <QString>
+#include "batch_item.h"
+
+/**
+ * @brief Record of finished batch outputs, used to skip up-to-date items
+ *
+ * For every successfully converted item one JSON line is appended:
+ *   {"output":..., "input":..., "inputSize":N, "inputMtime":T,
+ *    "inputHash":H, "params":P, "outputSize":N, "outputMtime":T}
+ * inputHash is a fast content hash (size plus the first and last 64 KiB),
+ * params a hash of the transcoder and the encode parameters. The last
+ * record of an output wins; Load() compacts the file once it holds many
+ * superseded records.
+ *
+ * An item is up to date when its output still has the recorded size and
+ * mtime, the encode parameters are unchanged and the input has the same
+ * size and mtime. If only the input's mtime differs (e.g. the file was
+ * copied or touched) the content hash decides, so stat() alone answers
+ * for the usual unchanged file. A touched file whose content matched gets
+ * its new mtime recorded, so it is not hashed again on the next run.
+ *
+ * Not thread-safe, BatchRunner uses it on the main thread. The check
+ * itself is a static function of a record and the file system, so it can
+ * run on a worker thread.
+ */
+class BatchManifest {
+public:
+    explicit BatchManifest(const QString &path);
+    ~BatchManifest();
+
+    // <data dir>/OpenConverter/batch_manifest.jsonl
+    static QString DefaultPath();
+
+    QString GetPath() const;
+    int GetEntryCount() const;
+
+    void Load();
+
+    // Record of an output, empty if it was never converted
+    QJsonObject GetRecord(const QString &outputPath) const;
+
+    /**
+     * @brief Whether the output described by record is still current
+     * @param touchedMtime Receives the input's new mtime if only the mtime
+     *        changed and the content hash matched, -1 otherwise
+     *
+     * Thread-safe, touches only the file system.
+     */
+    static bool IsUpToDate(const QJsonObject &record, const QString &inputPath,
+                           const QString &outputPath, const QString &paramsHash,
+                           double *touchedMtime);
+
+    // The input was touched but kept its content, e.g. after a copy
+    void UpdateInputMtime(const QString &outputPath, double mtime);
+
+    // Call after the item converted successfully
+    void Record(BatchItem *item);
+
+    // Size plus MD5 of the first and last 64 KiB, empty if unreadable
+    static QString FastHash(const QString &path);
+    static QString ParamsHash(BatchItem *item);
+    static QString ParamsHash(const QString &transcoderName, EncodeParameter *param);
+
+private:
+    bool Append(const QJsonObject &record);
+    void Compact();
+
+    QString path;
+    QFile file;
+    QHash<QString, QJsonObject> entries;  // Absolute output path to record
+    int recordCount;                      // Lines in the file
+};
+
+#endif // BATCH_MANIFEST_H
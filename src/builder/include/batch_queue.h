@@ -19,10 +19,16 @@
 #define BATCH_QUEUE_H
 
 #include <QObject>
+#include <QHash>
 #include <QList>
 #include <QMutex>
+#include <QSet>
+#include <map>
+#include <utility>
 #include "batch_item.h"
 
+class BatchJournal;
+
 /**
  * @brief Singleton class to manage batch processing queue
  *
@@ -30,6 +36,19 @@
  * It provides thread-safe access to the queue and emits signals
  * when items are added, removed, or their status changes.
  *
+ * Status counts, item indices and the waiting and processing items are
+ * kept indexed, so the next waiting item is O(log n) and the waiting
+ * and processing lists cost nothing for finished items, even in queues
+ * with tens of thousands of them. The remaining time of the queue is a
+ * running sum as well. Status changes must be reported through
+ * NotifyItemStatusChanged(), and changed predictions or live estimates
+ * through NotifyItemEstimateChanged(), to keep them in sync. The batch
+ * AddItems()/RemoveItems() calls emit a single signal per batch.
+ *
+ * Once EnableJournal() has been called every change is appended to a
+ * BatchJournal on disk, so the queue survives quitting or a crash.
+ * Priority changes must go through SetItemPriority() to be recorded.
+ *
  * Usage:
  *   BatchQueue *queue = BatchQueue::Instance();
  *   queue->AddItem(item);
@@ -46,8 +65,19 @@ public:
     void AddItem(BatchItem *item);
     void AddItems(const QList<BatchItem*> &items);
     void RemoveItem(int index);
+    void RemoveItems(const QList<int> &indices);
     void Clear();
 
+    /**
+     * @brief Restore the queue from its journal and record changes to it
+     * @param path Journal file, BatchJournal::DefaultPath() if empty
+     * @return Number of restored items
+     *
+     * Items that were processing when the application stopped are put
+     * back to waiting. Call once at startup, before items are added.
+     */
+    int EnableJournal(const QString &path = QString());
+
     // Queue access
     int GetCount() const;
     int GetWaitingCount() const;
@@ -55,8 +85,17 @@ public:
     int GetFinishedCount() const;
     int GetFailedCount() const;
     BatchItem* GetItem(int index) const;
+    // nullptr once the item was removed
+    BatchItem* GetItemById(qint64 id) const;
     QList<BatchItem*> GetAllItems() const;
+    // Waiting items by priority, then in queue order
     BatchItem* GetNextWaitingItem() const;
+    QList<BatchItem*> GetWaitingItems() const;
+    QList<BatchItem*> GetWaitingItems(int priority) const;  // In queue order
+    QList<BatchItem*> GetProcessingItems() const;
+    // Predictions of the waiting items plus live estimates of the
+    // processing ones; unknownCount receives the items without one
+    double GetRemainingSeconds(int *unknownCount) const;
 
     // Queue state
     bool IsEmpty() const;
@@ -67,10 +106,14 @@ public:
     int GetItemIndex(BatchItem *item) const;
     void NotifyItemStatusChanged(int index, BatchItemStatus status);
     void NotifyItemProgressChanged(int index, double progress);
+    void NotifyItemEstimateChanged(int index);
+    void SetItemPriority(int index, int priority);
 
 signals:
     void ItemAdded(int index);
+    void ItemsAdded(int firstIndex, int count);
     void ItemRemoved(int index);
+    void ItemsRemoved();
     void ItemStatusChanged(int index, BatchItemStatus status);
     void ItemProgressChanged(int index, double progress);
     void QueueCleared();
@@ -85,7 +128,32 @@ private:
     static BatchQueue *instance;
     static QMutex instanceMutex;
 
+    // Callers hold queueMutex
+    void AppendItem(BatchItem *item);
+    void TakeItem(int index);
+    void IndexStatus(BatchItem *item, BatchItemStatus status);
+    void UnindexStatus(BatchItem *item, BatchItemStatus status);
+    void CountEstimate(BatchItem *item, BatchItemStatus status);
+    void UncountEstimate(BatchItem *item);
+    void ReindexFrom(int first);
+    int CountOf(BatchItemStatus status) const;
+    void CompactJournalIfNeeded();
+
     QList<BatchItem*> items;
+    QHash<BatchItem*, int> itemIndex;
+    QHash<qint64, BatchItem*> itemsById;
+    QHash<BatchItem*, BatchItemStatus> itemStatus;  // Status as last notified
+    int statusCount[4] = {0, 0, 0, 0};               // Indexed by BatchItemStatus
+    // Keyed by (-priority, id); ids grow in queue order
+    std::map<std::pair<int, qint64>, BatchItem*> waitingItems;
+    QSet<BatchItem*> processingItems;
+    // Estimate each waiting or processing item adds to remainingSeconds,
+    // < 0 if it counts as unknown
+    QHash<BatchItem*, double> countedEstimates;
+    double remainingSeconds = 0.0;
+    int unknownEstimates = 0;
+    BatchJournal *journal = nullptr;
+    qint64 nextId = 1;
     mutable QMutex queueMutex;
 };
 
@@ -19,32 +19,49 @@
 #define BATCH_QUEUE_DIALOG_H
 
 #include <QDialog>
-#include <QTableWidget>
+#include <QTableView>
 #include <QPushButton>
 #include <QLabel>
 #include <QProgressBar>
+#include <QSpinBox>
+#include <QCheckBox>
 #include "batch_item.h"
 #include "batch_queue.h"
-#include "../../common/include/process_parameter.h"
+#include "batch_queue_model.h"
+#include "batch_runner.h"
+#include "batch_scheduler.h"
+#include "folder_watcher.h"
 
 /**
  * @brief Dialog to display and manage the batch processing queue
  *
  * Shows a table with columns:
  * - Status (icon + text: Waiting, Processing, Finished, Failed)
- * - Input File (full path)
- * - Output File (full path)
+ * - Input File (file name, full path in the tooltip)
+ * - Output File (file name, full path in the tooltip)
  * - Progress (percentage for processing items)
+ * - ETA (predicted from the throughput history before an item starts,
+ *   refined with the live rate while it runs)
+ * - Priority (higher runs first)
  *
  * Features:
  * - Real-time updates as items are processed
  * - Remove selected items
  * - Clear finished/failed items
  * - Clear all items
- * - Start/Stop batch processing
+ * - Start/Stop batch processing, running several items at once within
+ *   the core and memory budgets of the BatchScheduler; Stop cancels the
+ *   running items and puts them back in the queue
+ * - Cancel selected running items, and abort items that stall for
+ *   longer than the stall timeout
+ * - Raise/lower the priority of selected items, shortest job first
+ * - Skip items whose output is up to date (see BatchManifest)
  * - Summary statistics (total, waiting, processing, finished, failed)
+ *   and the estimated time to finish the whole queue
+ * - Watch folders: files dropped into them are queued and started
+ *   right away (see FolderWatcher)
  */
-class BatchQueueDialog : public QDialog, public ProcessObserver {
+class BatchQueueDialog : public QDialog {
     Q_OBJECT
 
 public:
@@ -56,47 +73,55 @@ public:
 
 private slots:
     void OnItemAdded(int index);
+    void OnItemsAdded(int firstIndex, int count);
     void OnItemRemoved(int index);
-    void OnItemStatusChanged(int index, BatchItemStatus status);
-    void OnItemProgressChanged(int index, double progress);
     void OnQueueCleared();
+    void UpdateStatistics();
 
     void OnStartClicked();
     void OnStopClicked();
+    void OnCancelSelectedClicked();
     void OnRemoveSelectedClicked();
     void OnClearFinishedClicked();
     void OnClearAllClicked();
     void OnCloseClicked();
+    void OnRaisePriorityClicked();
+    void OnLowerPriorityClicked();
+    void OnWatchFolderClicked();
+    void OnWatchedItemEnqueued(BatchItem *item);
 
-    void OnConversionFinished(bool success);
-    void ProcessNextItem();
-
-    // ProcessObserver interface
-    void on_process_update(double progress) override;
-    void on_time_update(double timeRequired) override;
+    void OnItemProbed(BatchItem *item);
+    void OnAllFinished();
 
 private:
     void SetupUI();
-    void UpdateStatistics();
-    void AddItemToTable(BatchItem *item, int row);
-    void UpdateItemInTable(int row, BatchItem *item);
-    QString GetStatusIcon(BatchItemStatus status) const;
-    QColor GetStatusColor(BatchItemStatus status) const;
+    void AdjustSelectedPriority(int delta);
 
     // UI Components
-    QTableWidget *queueTable;
+    QTableView *queueTable;
+    BatchQueueModel *queueModel;
     QLabel *statisticsLabel;
     QPushButton *startButton;
     QPushButton *stopButton;
+    QPushButton *cancelSelectedButton;
     QPushButton *removeSelectedButton;
     QPushButton *clearFinishedButton;
     QPushButton *clearAllButton;
     QPushButton *closeButton;
+    QPushButton *raisePriorityButton;
+    QPushButton *lowerPriorityButton;
+    QPushButton *watchFolderButton;
+    QSpinBox *maxCoresSpinBox;
+    QSpinBox *maxMemorySpinBox;
+    QCheckBox *shortestJobFirstCheckBox;
+    QCheckBox *skipUpToDateCheckBox;
+    QSpinBox *stallTimeoutSpinBox;
 
     BatchQueue *batchQueue;
-
-    bool isProcessing;
-    int currentItemIndex;
+    BatchScheduler *scheduler;
+    BatchRunner *runner;
+    FolderWatcher *folderWatcher;
+    BatchManifest *manifest;
 };
 
 #endif // BATCH_QUEUE_DIALOG_H
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BATCH_QUEUE_MODEL_H
+#define BATCH_QUEUE_MODEL_H
+
+#include <QAbstractTableModel>
+#include <QColor>
+#include <QTimer>
+#include "batch_item.h"
+#include "batch_queue.h"
+
+/**
+ * @brief Table model exposing the BatchQueue to a QTableView
+ *
+ * Rows are read straight from the queue, nothing is copied per item.
+ * Status and progress signals only mark rows dirty; dirty rows are
+ * repainted with a single dataChanged() at most every FLUSH_INTERVAL_MS,
+ * so a fast stream of progress updates costs one repaint per interval
+ * regardless of the queue size.
+ */
+class BatchQueueModel : public QAbstractTableModel {
+    Q_OBJECT
+
+public:
+    enum Column {
+        StatusColumn,
+        InputColumn,
+        OutputColumn,
+        ProgressColumn,
+        EtaColumn,
+        PriorityColumn,
+        ColumnCount
+    };
+
+    explicit BatchQueueModel(BatchQueue *queue, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role = Qt::DisplayRole) const override;
+
+    // Re-read the whole queue (after removals or clearing)
+    void Reload();
+
+    // Schedule a repaint of the row at the next flush
+    void MarkRowDirty(int row);
+
+    static QString FormatDuration(double seconds);
+
+signals:
+    // Emitted after dirty rows were repainted
+    void RowsFlushed();
+
+private slots:
+    void OnItemAdded(int index);
+    void OnItemsAdded(int firstIndex, int count);
+    void OnItemChanged(int index);
+    void FlushDirtyRows();
+
+private:
+    static constexpr int FLUSH_INTERVAL_MS = 100;
+
+    QString GetStatusIcon(BatchItemStatus status) const;
+    QColor GetStatusColor(BatchItemStatus status) const;
+    QString GetProgressText(BatchItem *item) const;
+    QString GetEtaText(BatchItem *item) const;
+
+    BatchQueue *batchQueue;
+    int rows;
+    int dirtyFirst;
+    int dirtyLast;
+    QTimer *flushTimer;
+};
+
+#endif // BATCH_QUEUE_MODEL_H
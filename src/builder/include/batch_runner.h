@@ -0,0 +1,130 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+#include <QHash>
+#include <QObject>
+#include <QThreadPool>
+#include <memory>
+#include "../../common/include/process_parameter.h"
+#include "batch_item.h"
+#include "batch_manifest.h"
+#include "batch_queue.h"
+#include "batch_scheduler.h"
+
+/**
+ * @brief Runs BatchQueue items, several at a time
+ *
+ * Jobs convert on a pool of long-lived worker threads, each with its own
+ * Converter and ProcessParameter, so progress is reported per item and
+ * no thread is created per job. Whenever a job starts or finishes the
+ * runner asks the BatchScheduler for the next admissible item and keeps
+ * starting items until the scheduler says the budgets are used up.
+ *
+ * Running jobs are cancelled cooperatively: Stop() and CancelItem() set
+ * the job's cancel flag, which the transcoder polls in its read loop and
+ * in its I/O interrupt callback. A job that reports no progress for the
+ * stall timeout is aborted the same way by its own watchdog and fails.
+ *
+ * With a BatchManifest set, an item whose output is still current for its
+ * input and encode parameters finishes without converting, and every
+ * converted item is recorded, so re-runs only convert what changed. The
+ * check runs on a worker thread when the run starts; nothing is probed or
+ * dispatched until its results are back.
+ *
+ * Usage:
+ *   BatchRunner *runner = new BatchRunner(queue, scheduler, this);
+ *   connect(runner, &BatchRunner::AllFinished, ...);
+ *   runner->Start();
+ */
+class BatchRunner : public QObject {
+    Q_OBJECT
+
+public:
+    BatchRunner(BatchQueue *queue, BatchScheduler *scheduler, QObject *parent = nullptr);
+    ~BatchRunner() override;
+
+    void Start();
+    // Stop starting new items and cancel the running ones, which go back
+    // to Waiting
+    void Stop();
+    // Cancel one running item, it fails as cancelled
+    void CancelItem(BatchItem *item);
+    bool IsRunning() const;
+    int GetRunningCount() const;
+
+    // Seconds without progress before a job is aborted, 0 disables
+    void SetStallTimeout(int seconds);
+    int GetStallTimeout() const;
+
+    static const int DEFAULT_STALL_TIMEOUT = 120;
+
+    // Skip up-to-date items; nullptr (the default) converts everything.
+    // Not owned.
+    void SetManifest(BatchManifest *manifest);
+    int GetSkippedCount() const;
+
+signals:
+    void ItemFinished(BatchItem *item, bool success);
+    // Emitted once no item is waiting or running after Start()
+    void AllFinished();
+
+private:
+    friend class BatchJobObserver;
+    friend class BatchJob;
+
+    struct RunningJob {
+        int cores;
+        qint64 memoryMB;
+        std::shared_ptr<ProcessParameter> processParam;
+        bool requeue;  // stopped with the run, not cancelled by itself
+    };
+
+    struct UpToDateItem {
+        qint64 itemId;
+        QString outputPath;
+        double touchedMtime;  // New input mtime to record, < 0 if unchanged
+    };
+
+    // Returns true while the check runs, Start() continues in
+    // OnUpToDateChecked()
+    bool SkipUpToDateItems();
+    void OnUpToDateChecked(const QList<UpToDateItem> &upToDate);
+    void Dispatch();
+    void StartJob(BatchItem *item);
+    void OnJobProgress(BatchItem *item, double progress);
+    void OnJobTimeRequired(BatchItem *item, double seconds);
+    // jobKey: the throughput history shape the job was recorded under
+    void OnJobFinished(BatchItem *item, bool success, const std::string &jobKey);
+
+    BatchQueue *batchQueue;
+    BatchScheduler *scheduler;
+    bool running;
+    int stallTimeout;
+    BatchManifest *manifest;
+    int skippedCount;
+    bool checkingUpToDate;
+    QHash<BatchItem*, RunningJob> runningJobs;
+    int coresInUse;
+    qint64 memoryInUseMB;
+    // Never expire; waits for running jobs when the runner is destroyed
+    QThreadPool workers;
+};
+
+#endif // BATCH_RUNNER_H
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BATCH_SCHEDULER_H
+#define BATCH_SCHEDULER_H
+
+#include <QObject>
+#include <QSet>
+#include <QtGlobal>
+#include "batch_item.h"
+#include "batch_queue.h"
+#include "../../engine/include/converter.h"
+
+/**
+ * @brief Decides which waiting BatchItem may start next
+ *
+ * Every waiting item is probed once in the background (duration,
+ * resolution, predicted run time) and given a CPU and memory cost. The
+ * probed JobProfile stays on the item; when a finished job extends the
+ * throughput history, only the items of its shape are predicted again,
+ * from that profile and without touching their inputs. Items
+ * are ranked by priority, then either in queue order or shortest job
+ * first. The top ranked item is admitted only while the running jobs
+ * leave enough of the core and memory budgets for it; lower ranked items
+ * never overtake it, so large jobs cannot starve. A job that exceeds the
+ * budgets on its own, or whose probe has not finished yet, still runs
+ * once nothing else is running.
+ *
+ * Budgets and the ordering are stored in QSettings.
+ */
+class BatchScheduler : public QObject {
+    Q_OBJECT
+
+public:
+    explicit BatchScheduler(BatchQueue *queue, QObject *parent = nullptr);
+
+    // Budgets and ordering
+    int GetMaxCores() const;
+    void SetMaxCores(int cores);
+    qint64 GetMaxMemoryMB() const;
+    void SetMaxMemoryMB(qint64 memoryMB);
+    bool IsShortestJobFirst() const;
+    void SetShortestJobFirst(bool enabled);
+
+    // Probe waiting items that have no cost yet, off the UI thread
+    void ProbeWaitingItems();
+
+    // Re-predict the probed waiting items of a shape whose history a
+    // finished job just extended
+    void RefreshEstimates(const std::string &jobKey);
+
+    /**
+     * @brief Get the next item to start
+     * @param coresInUse Cores held by the running jobs
+     * @param memoryInUseMB Memory held by the running jobs
+     * @param runningCount Number of running jobs
+     * @return The item to start, or nullptr if it has to wait
+     */
+    BatchItem* NextAdmissible(int coresInUse, qint64 memoryInUseMB, int runningCount) const;
+
+    // Expected resource usage of a probed job
+    static BatchItemCost EstimateCost(const JobProfile &job, EncodeParameter *encodeParam);
+
+    static int GetSystemCores();
+    static qint64 GetSystemMemoryMB();
+
+signals:
+    void ItemProbed(BatchItem *item);
+    // A probed item's prediction changed
+    void EstimateChanged(BatchItem *item);
+
+private:
+    // By id: the item may have been removed, and its memory reused, while
+    // it was probed
+    void OnItemProbed(qint64 itemId, const JobProfile &profile, const BatchItemCost &cost,
+                      double predictedSeconds);
+    // Expected run time used for shortest job first
+    double GetExpectedSeconds(BatchItem *item) const;
+    bool RanksBefore(BatchItem *a, BatchItem *b) const;
+
+    BatchQueue *batchQueue;
+    int maxCores;
+    qint64 maxMemoryMB;
+    bool shortestJobFirst;
+    QSet<qint64> probingItems;
+};
+
+#endif // BATCH_SCHEDULER_H
@@ -22,6 +22,7 @@
 #include "file_selector_widget.h"
 #include "batch_output_widget.h"
 #include "batch_mode_helper.h"
+#include "converter_runner.h"
 #include "resolution_widget.h"
 #include "pixel_format_widget.h"
 #include "quality_widget.h"
@@ -32,7 +33,6 @@
 #include <QSpinBox>
 #include <QVBoxLayout>
 
-class Converter;
 class EncodeParameter;
 class ProcessParameter;
 
@@ -81,10 +81,8 @@ private:
     // UI Components - Action Section
     QPushButton *convertButton;
 
-    // Backend
-    EncodeParameter *encodeParameter;
-    ProcessParameter *processParameter;
-    Converter *converter;
+    // Conversion runner
+    ConverterRunner *converterRunner;
 
     // Batch mode helper
     BatchModeHelper *batchModeHelper;
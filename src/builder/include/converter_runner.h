@@ -18,7 +18,6 @@
 #ifndef CONVERTER_RUNNER_H
 #define CONVERTER_RUNNER_H
 
-#include "../../common/include/process_observer.h"
 #include <QLabel>
 #include <QObject>
 #include <QProgressBar>
@@ -36,7 +35,7 @@ class ProcessParameter;
  * - Input validation
  * - Progress bar management
  * - Button state management
- * - Thread-based conversion execution
+ * - Conversion on the shared JobExecutor, off the GUI thread
  * - Completion handling with success/error messages
  *
  * Usage:
@@ -54,7 +53,7 @@ class ProcessParameter;
  * runner->RunConversion(inputPath, outputPath, encodeParam, processParam);
  * @endcode
  */
-class ConverterRunner : public QObject, public ProcessObserver {
+class ConverterRunner : public QObject {
     Q_OBJECT
 
 public:
@@ -85,7 +84,7 @@ public:
     ~ConverterRunner() override;
 
     /**
-     * @brief Run conversion in a separate thread
+     * @brief Submit the conversion to the JobExecutor
      * @param inputPath Input file path
      * @param outputPath Output file path
      * @param encodeParam Encoding parameters (ownership transferred to runner)
@@ -111,9 +110,9 @@ public:
      */
     void SetCompletionHandler(std::function<void(bool)> handler);
 
-    // ProcessObserver interface
-    void on_process_update(double progress) override;
-    void on_time_update(double timeRequired) override;
+    // Cancel the running conversion, it finishes as failed
+    void Cancel();
+    bool IsRunning() const;
 
 signals:
     /**
@@ -123,6 +122,9 @@ signals:
     void ConversionFinished(bool success);
 
 private:
+    void OnJobProgress(int jobId, double progress);
+    void OnJobTimeRequired(int jobId, double seconds);
+    void OnJobFinished(int jobId, bool success);
     void ShowProgressUI();
     void HideProgressUI();
     void SetButtonRunning();
@@ -138,6 +140,7 @@ private:
     QString successMessage;
     QString errorTitle;
     QString errorMessage;
+    int jobId;  // -1 when idle
 
     std::function<bool()> customValidator;
     std::function<void(bool)> customCompletionHandler;
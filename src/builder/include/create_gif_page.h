@@ -22,6 +22,7 @@
 #include "file_selector_widget.h"
 #include "batch_output_widget.h"
 #include "batch_mode_helper.h"
+#include "converter_runner.h"
 #include "resolution_widget.h"
 #include <QComboBox>
 #include <QGroupBox>
@@ -30,7 +31,6 @@
 #include <QSpinBox>
 #include <QVBoxLayout>
 
-class Converter;
 class EncodeParameter;
 class ProcessParameter;
 
@@ -77,10 +77,8 @@ private:
     // UI Components - Action Section
     QPushButton *convertButton;
 
-    // Backend
-    EncodeParameter *encodeParameter;
-    ProcessParameter *processParameter;
-    Converter *converter;
+    // Conversion runner
+    ConverterRunner *converterRunner;
 
     // Batch mode helper
     BatchModeHelper *batchModeHelper;
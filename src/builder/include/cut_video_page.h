@@ -23,6 +23,8 @@
 #include "file_selector_widget.h"
 #include "progress_widget.h"
 #include "simple_video_player.h"
+#include "thumbnail_strip.h"
+#include "waveform_widget.h"
 #include <QGroupBox>
 #include <QLabel>
 #include <QProgressBar>
@@ -90,6 +92,8 @@ private:
     SimpleVideoPlayer *videoPlayer;
     QPushButton *playPauseButton;
     QSlider *timelineSlider;
+    ThumbnailStrip *thumbnailStrip;
+    WaveformWidget *waveformWidget;
     QLabel *currentTimeLabel;
     QLabel *endTimeDisplayLabel;
     bool isSliderPressed;
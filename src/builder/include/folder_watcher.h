@@ -0,0 +1,119 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FOLDER_WATCHER_H
+#define FOLDER_WATCHER_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include "batch_item.h"
+#include "batch_queue.h"
+
+class QFileSystemWatcher;
+class QSocketNotifier;
+class QTimer;
+
+/**
+ * @brief Hot folders: files dropped into a watched folder are queued
+ *
+ * On Linux the folders are watched with inotify for IN_CLOSE_WRITE and
+ * IN_MOVED_TO, so a file is seen as soon as its writer closes it or it is
+ * moved in. Elsewhere QFileSystemWatcher reports directory changes and the
+ * new names are picked out. Either way a file is only queued once its size
+ * and modification time have stayed unchanged for the debounce interval,
+ * which covers writers that close and reopen files or copy in chunks.
+ *
+ * Each folder may contain a preset file, .openconverter-preset, with the
+ * conversion to apply (JSON, "param" uses the BatchJournal fields):
+ *   {"format":"mkv","outputDir":"converted","transcoder":"FFMPEG",
+ *    "priority":0,"param":{"videoCodec":"libx264","audioCodec":"aac"}}
+ * outputDir is relative to the folder (default "converted") and must not
+ * be the folder itself; format defaults to "mp4". The preset is reread
+ * when it changes.
+ *
+ * Hidden files and partial downloads (.part, .tmp, .crdownload, ...) are
+ * ignored. Files already in a folder when it is added are not queued.
+ */
+class FolderWatcher : public QObject {
+    Q_OBJECT
+
+public:
+    explicit FolderWatcher(BatchQueue *queue, QObject *parent = nullptr);
+    ~FolderWatcher();
+
+    bool AddFolder(const QString &path);
+    void RemoveFolder(const QString &path);
+    QStringList GetFolders() const;
+    bool IsWatching() const;
+
+    // Quiet time before a new file is queued, 1000 ms by default
+    void SetDebounceMs(int ms);
+
+    static const char *PRESET_FILE_NAME;
+
+signals:
+    void ItemEnqueued(BatchItem *item);
+
+private slots:
+    void OnInotifyReadable();
+    void OnDirectoryChanged(const QString &folder);
+    void CheckPending();
+
+private:
+    struct FolderPreset {
+        QString outputDir;
+        QString format;
+        QString transcoder;
+        int priority = 0;
+        QJsonObject param;
+    };
+
+    struct PendingFile {
+        QString folder;
+        qint64 size = -1;
+        QDateTime modified;
+        qint64 lastChangeMs = 0;
+    };
+
+    void NoteFile(const QString &folder, const QString &fileName);
+    void Enqueue(const QString &path, const PendingFile &file);
+    bool IsCandidate(const QString &fileName) const;
+    static FolderPreset LoadPreset(const QString &folder);
+    static QSet<QString> ListFiles(const QString &folder);
+
+    BatchQueue *batchQueue;
+    QHash<QString, FolderPreset> presets;  // Watched folders
+    QHash<QString, PendingFile> pending;   // Files waiting to settle
+    QTimer *checkTimer;
+    int debounceMs;
+
+    // inotify on Linux
+    int inotifyFd;
+    QSocketNotifier *notifier;
+    QHash<int, QString> watchFolders;  // Watch descriptor to folder
+
+    // Fallback elsewhere
+    QFileSystemWatcher *fsWatcher;
+    QHash<QString, QSet<QString>> knownFiles;
+};
+
+#endif // FOLDER_WATCHER_H
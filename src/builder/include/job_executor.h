@@ -0,0 +1,94 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef JOB_EXECUTOR_H
+#define JOB_EXECUTOR_H
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <memory>
+
+class EncodeParameter;
+class ProcessParameter;
+
+/**
+ * @brief Shared executor for single-file conversions
+ *
+ * Every page submits its conversion here instead of converting on the GUI
+ * thread. Jobs run on a thread pool of half the cores (at least two), so
+ * jobs from different pages overlap without oversubscribing the machine;
+ * further jobs wait in the pool's queue.
+ *
+ * Submit() returns a job id. Progress, time estimates and completion are
+ * emitted on the GUI thread tagged with that id. Cancel() sets the job's
+ * cancel flag, which the transcoder polls in its read loop; a job that is
+ * still queued finishes as failed without converting.
+ *
+ * Usage:
+ *   JobExecutor *executor = JobExecutor::Instance();
+ *   connect(executor, &JobExecutor::JobFinished, ...);
+ *   int id = executor->Submit(input, output, encodeParam, processParam);
+ */
+class JobExecutor : public QObject {
+    Q_OBJECT
+
+public:
+    // Singleton access
+    static JobExecutor* Instance();
+
+    /**
+     * @brief Queue a conversion
+     * @param encodeParam Encoding parameters (ownership transferred)
+     * @param processParam Process parameters (ownership transferred)
+     * @return Job id, passed back in the signals
+     */
+    int Submit(const QString &inputPath,
+               const QString &outputPath,
+               EncodeParameter *encodeParam,
+               ProcessParameter *processParam,
+               const QString &transcoderName = "FFMPEG");
+
+    void Cancel(int jobId);
+    void CancelAll();
+    bool IsRunning(int jobId) const;
+    // Jobs submitted and not finished yet, queued ones included
+    int GetJobCount() const;
+
+signals:
+    void JobProgress(int jobId, double progress);
+    void JobTimeRequired(int jobId, double seconds);
+    void JobFinished(int jobId, bool success);
+
+private:
+    friend class ConversionJob;
+
+    JobExecutor();
+    void OnJobFinished(int jobId, bool success);
+
+    static JobExecutor *instance;
+    static QMutex instanceMutex;
+
+    QThreadPool pool;
+    int nextJobId;
+    // Keeps each job's cancel flag reachable, GUI thread only
+    QHash<int, std::shared_ptr<ProcessParameter>> jobs;
+};
+
+#endif // JOB_EXECUTOR_H
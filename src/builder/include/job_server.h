@@ -0,0 +1,102 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef JOB_SERVER_H
+#define JOB_SERVER_H
+
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include "batch_item.h"
+#include "batch_queue.h"
+#include "batch_runner.h"
+#include "batch_scheduler.h"
+
+class QLocalServer;
+class QLocalSocket;
+
+/**
+ * @brief Long-running job server behind "OpenConverter --serve"
+ *
+ * Listens on a local socket (a Unix domain socket, a named pipe on
+ * Windows) and runs the submitted jobs through BatchQueue, BatchScheduler
+ * and BatchRunner in this one process, so a short job does not pay for
+ * process startup, codec registration or, with BMF, starting Python.
+ * BatchRunner keeps a pool of worker threads that stay up across jobs;
+ * each job still builds its own Converter and transcoder, since those
+ * hold the per-file demuxer, codec and filter state.
+ *
+ * Clients send one JSON object per line:
+ *   {"op":"submit","input":"in.mp4","output":"out.mkv",
+ *    "transcoder":"FFMPEG","priority":0,"param":{...}}
+ *   {"op":"cancel","id":N}
+ *   {"op":"status"}
+ * "param" uses the BatchJournal encode parameter fields.
+ *
+ * The server answers on the same connection, one JSON object per line:
+ *   {"event":"accepted","id":N}
+ *   {"event":"progress","id":N,"progress":P,"remaining":S}
+ *   {"event":"finished","id":N,"success":B,"error":"..."}
+ *   {"event":"status","waiting":W,"processing":P,"running":R}
+ *   {"event":"error","message":"..."}
+ * Progress and finish events go to the connection that submitted the job.
+ * Finished jobs are dropped from the queue.
+ */
+class JobServer : public QObject {
+    Q_OBJECT
+
+public:
+    explicit JobServer(QObject *parent = nullptr);
+    ~JobServer();
+
+    /**
+     * @brief Start listening
+     * @param name Socket name, DEFAULT_NAME if empty
+     * @return true if the server is listening
+     */
+    bool Listen(const QString &name = QString());
+    QString GetServerPath() const;
+    QString GetErrorString() const;
+
+    static const char *DEFAULT_NAME;
+
+private slots:
+    void OnNewConnection();
+    void OnReadyRead();
+    void OnDisconnected();
+    void OnItemProgressChanged(int index, double progress);
+    void OnItemFinished(BatchItem *item, bool success);
+
+private:
+    void HandleRequest(QLocalSocket *socket, const QJsonObject &request);
+    void Submit(QLocalSocket *socket, const QJsonObject &request);
+    void Cancel(QLocalSocket *socket, const QJsonObject &request);
+    void SendStatus(QLocalSocket *socket);
+    void Send(QLocalSocket *socket, const QJsonObject &event);
+    void SendError(QLocalSocket *socket, const QString &message);
+
+    QLocalServer *server;
+    BatchQueue *batchQueue;
+    BatchScheduler *scheduler;
+    BatchRunner *runner;
+    QHash<qint64, QPointer<QLocalSocket>> submitters;  // Job id to client
+    QHash<qint64, int> lastPercent;                    // Throttles progress events
+};
+
+#endif // JOB_SERVER_H
@@ -46,6 +46,7 @@
 #include <QSettings>
 #include <QTranslator>
 #include <QUrl>
+#include <functional>
 
 #include "../../common/include/encode_parameter.h"
 #include "../../common/include/info.h"
@@ -111,7 +112,10 @@ private:
 
     // Navigation and page management
     QButtonGroup *navButtonGroup;
+    // Pages are built on first navigation; nullptr until then
     QList<BasePage *> pages;
+    QList<std::function<BasePage *()>> pageFactories;
+    int currentPageIndex;
     QList<QPushButton *> navButtons;
     QLabel *labelCommonSection;
     QLabel *labelAdvancedSection;
@@ -128,6 +132,7 @@ private:
     // Page management methods
     void SetupNavigationButtons();
     void InitializePages();
+    BasePage *GetPage(int pageIndex);
     void SwitchToPage(int pageIndex);
 
 public:
@@ -32,7 +32,8 @@
 #include <QHBoxLayout>
 #include <QMessageBox>
 
-AIProcessingPage::AIProcessingPage(QWidget *parent) : BasePage(parent), converterRunner(nullptr) {
+AIProcessingPage::AIProcessingPage(QWidget *parent)
+    : BasePage(parent), converterRunner(nullptr), pythonReady(false) {
     SetupUI();
 }
 
@@ -47,32 +48,36 @@ void AIProcessingPage::OnPageActivated() {
     // Check if Python is installed for AI Processing
     // In Debug mode, skip installation dialog (assume developer has configured environment)
 #if defined(NDEBUG) || defined(__linux__)
-    // Release mode: check Python and offer installation
-    PythonManager pythonManager;
-
-    // Check status: embedded Python, system Python, or not installed
-    if (pythonManager.GetStatus() != PythonManager::Status::Installed) {
-        // Python not available (neither embedded nor system)
-        // Show installation dialog
-        QMessageBox::StandardButton reply = QMessageBox::question(
-            this,
-            tr("Python Required"),
-            tr("AI Processing requires Python 3.9 and additional packages.\n\n"
-               "Would you like to download and install them now?\n"
-               "(Download size: ~550 MB, completely isolated from system Python)"),
-            QMessageBox::Yes | QMessageBox::No
-        );
-
-        if (reply == QMessageBox::Yes) {
-            PythonInstallDialog dialog(this);
-            if (dialog.exec() != QDialog::Accepted) {
-                // User cancelled installation
-                QMessageBox::information(
-                    this,
-                    tr("AI Processing Unavailable"),
-                    tr("AI Processing features require Python to be installed.\n\n"
-                       "You can install it later by returning to this page.")
-                );
+    // Release mode: check Python and offer installation. The probe starts
+    // a Python process, so it runs only until Python has been found
+    if (!pythonReady) {
+        PythonManager pythonManager;
+
+        // Check status: embedded Python, system Python, or not installed
+        pythonReady = pythonManager.GetStatus() == PythonManager::Status::Installed;
+        if (!pythonReady) {
+            // Python not available (neither embedded nor system)
+            // Show installation dialog
+            QMessageBox::StandardButton reply = QMessageBox::question(
+                this,
+                tr("Python Required"),
+                tr("AI Processing requires Python 3.9 and additional packages.\n\n"
+                   "Would you like to download and install them now?\n"
+                   "(Download size: ~550 MB, completely isolated from system Python)"),
+                QMessageBox::Yes | QMessageBox::No
+            );
+
+            if (reply == QMessageBox::Yes) {
+                PythonInstallDialog dialog(this);
+                if (dialog.exec() != QDialog::Accepted) {
+                    // User cancelled installation
+                    QMessageBox::information(
+                        this,
+                        tr("AI Processing Unavailable"),
+                        tr("AI Processing features require Python to be installed.\n\n"
+                           "You can install it later by returning to this page.")
+                    );
+                }
             }
         }
     }
@@ -18,23 +18,42 @@
 #include "../include/batch_item.h"
 
 BatchItem::BatchItem()
-    : status(BatchItemStatus::Waiting),
+    : id(0),
+      status(BatchItemStatus::Waiting),
       encodeParameter(nullptr),
-      progress(0.0) {
+      ownsEncodeParameter(false),
+      progress(0.0),
+      predictedSeconds(-1.0),
+      remainingSeconds(-1.0),
+      estimated(false),
+      priority(0) {
     createdTime = QDateTime::currentDateTime();
 }
 
 BatchItem::BatchItem(const QString &inputPath, const QString &outputPath)
-    : inputPath(inputPath),
+    : id(0),
+      inputPath(inputPath),
       outputPath(outputPath),
       status(BatchItemStatus::Waiting),
       encodeParameter(nullptr),
-      progress(0.0) {
+      ownsEncodeParameter(false),
+      progress(0.0),
+      predictedSeconds(-1.0),
+      remainingSeconds(-1.0),
+      estimated(false),
+      priority(0) {
     createdTime = QDateTime::currentDateTime();
 }
 
 BatchItem::~BatchItem() {
-    // Note: encodeParameter is managed externally, don't delete here
+    // Note: encodeParameter is managed externally unless the item owns it
+    if (ownsEncodeParameter) {
+        delete encodeParameter;
+    }
+}
+
+qint64 BatchItem::GetId() const {
+    return id;
 }
 
 QString BatchItem::GetInputPath() const {
@@ -92,6 +111,34 @@ double BatchItem::GetProgress() const {
     return progress;
 }
 
+double BatchItem::GetPredictedSeconds() const {
+    return predictedSeconds;
+}
+
+double BatchItem::GetRemainingSeconds() const {
+    return remainingSeconds;
+}
+
+bool BatchItem::IsEstimated() const {
+    return estimated;
+}
+
+int BatchItem::GetPriority() const {
+    return priority;
+}
+
+BatchItemCost BatchItem::GetCost() const {
+    return cost;
+}
+
+JobProfile BatchItem::GetProfile() const {
+    return profile;
+}
+
+void BatchItem::SetId(qint64 newId) {
+    id = newId;
+}
+
 void BatchItem::SetInputPath(const QString &path) {
     inputPath = path;
 }
@@ -109,7 +156,16 @@ void BatchItem::SetErrorMessage(const QString &message) {
 }
 
 void BatchItem::SetEncodeParameter(EncodeParameter *param) {
+    if (ownsEncodeParameter && param != encodeParameter) {
+        delete encodeParameter;
+    }
     encodeParameter = param;
+    ownsEncodeParameter = false;
+}
+
+void BatchItem::SetOwnedEncodeParameter(EncodeParameter *param) {
+    SetEncodeParameter(param);
+    ownsEncodeParameter = true;
 }
 
 void BatchItem::SetTranscoderName(const QString &name) {
@@ -120,20 +176,68 @@ void BatchItem::SetProgress(double newProgress) {
     progress = newProgress;
 }
 
+void BatchItem::SetPredictedSeconds(double seconds) {
+    predictedSeconds = seconds;
+    estimated = true;
+}
+
+void BatchItem::SetRemainingSeconds(double seconds) {
+    remainingSeconds = seconds;
+}
+
+void BatchItem::ResetEstimate() {
+    predictedSeconds = -1.0;
+    estimated = false;
+}
+
+void BatchItem::SetPriority(int newPriority) {
+    priority = newPriority;
+}
+
+void BatchItem::SetCost(const BatchItemCost &newCost) {
+    cost = newCost;
+}
+
+void BatchItem::SetProfile(const JobProfile &newProfile) {
+    profile = newProfile;
+}
+
+void BatchItem::SetCreatedTime(const QDateTime &time) {
+    createdTime = time;
+}
+
+void BatchItem::SetStartedTime(const QDateTime &time) {
+    startedTime = time;
+}
+
+void BatchItem::SetFinishedTime(const QDateTime &time) {
+    finishedTime = time;
+}
+
 void BatchItem::MarkAsProcessing() {
     status = BatchItemStatus::Processing;
     startedTime = QDateTime::currentDateTime();
     progress = 0.0;
+    remainingSeconds = predictedSeconds;
 }
 
 void BatchItem::MarkAsFinished() {
     status = BatchItemStatus::Finished;
     finishedTime = QDateTime::currentDateTime();
     progress = 100.0;
+    remainingSeconds = 0.0;
 }
 
 void BatchItem::MarkAsFailed(const QString &errorMsg) {
     status = BatchItemStatus::Failed;
     finishedTime = QDateTime::currentDateTime();
     errorMessage = errorMsg;
+    remainingSeconds = -1.0;
+}
+
+void BatchItem::MarkAsWaiting() {
+    status = BatchItemStatus::Waiting;
+    startedTime = QDateTime();
+    progress = 0.0;
+    remainingSeconds = predictedSeconds;
 }
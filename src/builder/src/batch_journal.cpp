@@ -0,0 +1,321 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/batch_journal.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <iostream>
+
+namespace {
+
+double ToMsecs(const QDateTime &time) {
+    return time.isValid() ? static_cast<double>(time.toMSecsSinceEpoch()) : 0.0;
+}
+
+QDateTime FromMsecs(qint64 msecs) {
+    return msecs > 0 ? QDateTime::fromMSecsSinceEpoch(msecs) : QDateTime();
+}
+
+BatchItemStatus StatusFromString(const QString &status) {
+    if (status == "Processing") return BatchItemStatus::Processing;
+    if (status == "Finished") return BatchItemStatus::Finished;
+    if (status == "Failed") return BatchItemStatus::Failed;
+    return BatchItemStatus::Waiting;
+}
+
+void ApplyStatus(BatchItem *item, const QJsonObject &object) {
+    item->SetStatus(StatusFromString(object.value("status").toString()));
+    item->SetErrorMessage(object.value("error").toString());
+    item->SetStartedTime(FromMsecs(static_cast<qint64>(object.value("started").toDouble())));
+    item->SetFinishedTime(FromMsecs(static_cast<qint64>(object.value("finished").toDouble())));
+}
+
+} // namespace
+
+BatchJournal::BatchJournal(const QString &path)
+    : path(path),
+      recordCount(0) {
+}
+
+BatchJournal::~BatchJournal() {
+    file.close();
+}
+
+QString BatchJournal::DefaultPath() {
+    QString env = qEnvironmentVariable("OC_BATCH_JOURNAL");
+    if (!env.isEmpty()) {
+        return env;
+    }
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation);
+    if (dir.isEmpty()) {
+        dir = QDir::tempPath();
+    }
+    return dir + "/OpenConverter/batch_queue.jsonl";
+}
+
+QString BatchJournal::GetPath() const {
+    return path;
+}
+
+int BatchJournal::GetRecordCount() const {
+    return recordCount;
+}
+
+QList<BatchItem*> BatchJournal::Load() {
+    QList<BatchItem*> items;
+    QFile input(path);
+    if (!input.open(QIODevice::ReadOnly)) {
+        return items;
+    }
+
+    QHash<qint64, BatchItem*> byId;
+    QList<qint64> order;
+    int skipped = 0;
+    while (!input.atEnd()) {
+        QByteArray line = input.readLine().trimmed();
+        if (line.isEmpty()) continue;
+
+        QJsonParseError error;
+        QJsonDocument document = QJsonDocument::fromJson(line, &error);
+        if (error.error != QJsonParseError::NoError || !document.isObject()) {
+            skipped++;  // Torn write
+            continue;
+        }
+        QJsonObject record = document.object();
+        QString op = record.value("op").toString();
+        qint64 id = static_cast<qint64>(record.value("id").toDouble());
+
+        if (op == "add") {
+            BatchItem *item = ItemFromJson(record.value("item").toObject());
+            if (!item) continue;
+            if (byId.contains(item->GetId())) {
+                delete byId.take(item->GetId());
+                order.removeOne(item->GetId());
+            }
+            byId.insert(item->GetId(), item);
+            order.append(item->GetId());
+        } else if (op == "status") {
+            if (BatchItem *item = byId.value(id)) ApplyStatus(item, record);
+        } else if (op == "priority") {
+            if (BatchItem *item = byId.value(id)) item->SetPriority(record.value("priority").toInt());
+        } else if (op == "remove") {
+            delete byId.take(id);
+            order.removeOne(id);
+        } else if (op == "clear") {
+            qDeleteAll(byId);
+            byId.clear();
+            order.clear();
+        }
+    }
+    if (skipped > 0) {
+        std::cout << "Batch journal: skipped " << skipped << " unreadable record(s)" << std::endl;
+    }
+
+    for (qint64 id : order) {
+        BatchItem *item = byId.value(id);
+        // The application stopped while this item ran, run it again
+        if (item->GetStatus() == BatchItemStatus::Processing) {
+            item->SetStatus(BatchItemStatus::Waiting);
+            item->SetStartedTime(QDateTime());
+            item->SetProgress(0.0);
+        }
+        items.append(item);
+    }
+    return items;
+}
+
+bool BatchJournal::Compact(const QList<BatchItem*> &items) {
+    file.close();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSaveFile output(path);
+    if (!output.open(QIODevice::WriteOnly)) {
+        std::cout << "Batch journal: cannot write " << path.toStdString() << std::endl;
+        OpenForAppend();
+        return false;
+    }
+    for (BatchItem *item : items) {
+        QJsonObject record;
+        record.insert("op", "add");
+        record.insert("item", ItemToJson(item));
+        output.write(QJsonDocument(record).toJson(QJsonDocument::Compact));
+        output.write("\n");
+    }
+    // Atomically replaces the old journal
+    bool committed = output.commit();
+    recordCount = 0;
+    return OpenForAppend() && committed;
+}
+
+bool BatchJournal::OpenForAppend() {
+    if (file.isOpen()) {
+        return true;
+    }
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    file.setFileName(path);
+    return file.open(QIODevice::WriteOnly | QIODevice::Append);
+}
+
+bool BatchJournal::Append(const QJsonObject &record) {
+    if (!OpenForAppend()) {
+        return false;
+    }
+    QByteArray line = QJsonDocument(record).toJson(QJsonDocument::Compact);
+    line.append('\n');
+    // One write per record and an unbuffered flush, so a crash loses at
+    // most the record being written
+    bool written = file.write(line) == line.size() && file.flush();
+    recordCount++;
+    return written;
+}
+
+void BatchJournal::RecordAdded(BatchItem *item) {
+    QJsonObject record;
+    record.insert("op", "add");
+    record.insert("item", ItemToJson(item));
+    Append(record);
+}
+
+void BatchJournal::RecordStatus(BatchItem *item) {
+    QJsonObject record;
+    record.insert("op", "status");
+    record.insert("id", static_cast<double>(item->GetId()));
+    record.insert("status", item->GetStatusString());
+    if (!item->GetErrorMessage().isEmpty()) {
+        record.insert("error", item->GetErrorMessage());
+    }
+    record.insert("started", ToMsecs(item->GetStartedTime()));
+    record.insert("finished", ToMsecs(item->GetFinishedTime()));
+    Append(record);
+}
+
+void BatchJournal::RecordPriority(BatchItem *item) {
+    QJsonObject record;
+    record.insert("op", "priority");
+    record.insert("id", static_cast<double>(item->GetId()));
+    record.insert("priority", item->GetPriority());
+    Append(record);
+}
+
+void BatchJournal::RecordRemoved(BatchItem *item) {
+    QJsonObject record;
+    record.insert("op", "remove");
+    record.insert("id", static_cast<double>(item->GetId()));
+    Append(record);
+}
+
+void BatchJournal::RecordCleared() {
+    QJsonObject record;
+    record.insert("op", "clear");
+    Append(record);
+}
+
+QJsonObject BatchJournal::ItemToJson(BatchItem *item) {
+    QJsonObject object;
+    object.insert("id", static_cast<double>(item->GetId()));
+    object.insert("input", item->GetInputPath());
+    object.insert("output", item->GetOutputPath());
+    object.insert("transcoder", item->GetTranscoderName());
+    object.insert("status", item->GetStatusString());
+    if (!item->GetErrorMessage().isEmpty()) {
+        object.insert("error", item->GetErrorMessage());
+    }
+    object.insert("created", ToMsecs(item->GetCreatedTime()));
+    object.insert("started", ToMsecs(item->GetStartedTime()));
+    object.insert("finished", ToMsecs(item->GetFinishedTime()));
+    object.insert("priority", item->GetPriority());
+    if (item->GetEncodeParameter()) {
+        object.insert("param", EncodeParameterToJson(item->GetEncodeParameter()));
+    }
+    return object;
+}
+
+BatchItem* BatchJournal::ItemFromJson(const QJsonObject &object) {
+    qint64 id = static_cast<qint64>(object.value("id").toDouble());
+    if (id <= 0 || !object.contains("input")) {
+        return nullptr;
+    }
+    BatchItem *item = new BatchItem(object.value("input").toString(), object.value("output").toString());
+    item->SetId(id);
+    item->SetTranscoderName(object.value("transcoder").toString());
+    item->SetCreatedTime(FromMsecs(static_cast<qint64>(object.value("created").toDouble())));
+    item->SetPriority(object.value("priority").toInt());
+    ApplyStatus(item, object);
+    if (object.contains("param")) {
+        item->SetOwnedEncodeParameter(EncodeParameterFromJson(object.value("param").toObject()));
+    }
+    return item;
+}
+
+QJsonObject BatchJournal::EncodeParameterToJson(EncodeParameter *param) {
+    QJsonObject object;
+    object.insert("videoCodec", QString::fromStdString(param->get_video_codec_name()));
+    object.insert("videoBitRate", static_cast<double>(param->get_video_bit_rate()));
+    object.insert("pixelFormat", QString::fromStdString(param->get_pixel_format()));
+    object.insert("width", param->get_width());
+    object.insert("height", param->get_height());
+    object.insert("audioCodec", QString::fromStdString(param->get_audio_codec_name()));
+    object.insert("audioBitRate", static_cast<double>(param->get_audio_bit_rate()));
+    object.insert("qscale", param->get_qscale());
+    object.insert("preset", QString::fromStdString(param->get_preset()));
+    object.insert("startTime", param->get_start_time());
+    object.insert("endTime", param->get_end_time());
+    object.insert("algoMode", static_cast<int>(param->get_algo_mode()));
+    object.insert("upscaleFactor", param->get_upscale_factor());
+    object.insert("checkpointInterval", param->get_checkpoint_interval());
+    return object;
+}
+
+EncodeParameter* BatchJournal::EncodeParameterFromJson(const QJsonObject &object) {
+    EncodeParameter *param = new EncodeParameter();
+    // Only set what differs from the defaults, the setters mark the
+    // parameters as available
+    EncodeParameter defaults;
+    QString videoCodec = object.value("videoCodec").toString();
+    if (!videoCodec.isEmpty()) param->set_video_codec_name(videoCodec.toStdString());
+    int64_t videoBitRate = static_cast<int64_t>(object.value("videoBitRate").toDouble());
+    if (videoBitRate != defaults.get_video_bit_rate()) param->set_video_bit_rate(videoBitRate);
+    QString pixelFormat = object.value("pixelFormat").toString();
+    if (!pixelFormat.isEmpty()) param->set_pixel_format(pixelFormat.toStdString());
+    int width = object.value("width").toInt();
+    if (width != defaults.get_width()) param->set_width(static_cast<uint16_t>(width));
+    int height = object.value("height").toInt();
+    if (height != defaults.get_height()) param->set_height(static_cast<uint16_t>(height));
+    QString audioCodec = object.value("audioCodec").toString();
+    if (!audioCodec.isEmpty()) param->set_audio_codec_name(audioCodec.toStdString());
+    int64_t audioBitRate = static_cast<int64_t>(object.value("audioBitRate").toDouble());
+    if (audioBitRate != defaults.get_audio_bit_rate()) param->set_audio_bit_rate(audioBitRate);
+    int qscale = object.value("qscale").toInt(-1);
+    if (qscale != defaults.get_qscale()) param->set_qscale(qscale);
+    QString preset = object.value("preset").toString();
+    if (!preset.isEmpty()) param->set_preset(preset.toStdString());
+    double startTime = object.value("startTime").toDouble(-1.0);
+    if (startTime != defaults.get_start_time()) param->set_start_time(startTime);
+    double endTime = object.value("endTime").toDouble(-1.0);
+    if (endTime != defaults.get_end_time()) param->set_end_time(endTime);
+    AlgoMode algoMode = static_cast<AlgoMode>(object.value("algoMode").toInt());
+    if (algoMode != defaults.get_algo_mode()) param->set_algo_mode(algoMode);
+    int upscaleFactor = object.value("upscaleFactor").toInt(defaults.get_upscale_factor());
+    if (upscaleFactor != defaults.get_upscale_factor()) param->set_upscale_factor(upscaleFactor);
+    double checkpointInterval = object.value("checkpointInterval").toDouble();
+    if (checkpointInterval > 0.0) param->set_checkpoint_interval(checkpointInterval);
+    return param;
+}
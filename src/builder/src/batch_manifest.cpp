@@ -0,0 +1,235 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/batch_manifest.h"
+#include "../include/batch_journal.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <iostream>
+
+namespace {
+
+const qint64 HASH_CHUNK = 64 * 1024;
+
+double MtimeOf(const QFileInfo &info) {
+    return static_cast<double>(info.lastModified().toMSecsSinceEpoch());
+}
+
+QString KeyOf(const QString &outputPath) {
+    return QFileInfo(outputPath).absoluteFilePath();
+}
+
+} // namespace
+
+BatchManifest::BatchManifest(const QString &path)
+    : path(path),
+      recordCount(0) {
+}
+
+BatchManifest::~BatchManifest() {
+    file.close();
+}
+
+QString BatchManifest::DefaultPath() {
+    QString env = qEnvironmentVariable("OC_BATCH_MANIFEST");
+    if (!env.isEmpty()) {
+        return env;
+    }
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation);
+    if (dir.isEmpty()) {
+        dir = QDir::tempPath();
+    }
+    return dir + "/OpenConverter/batch_manifest.jsonl";
+}
+
+QString BatchManifest::GetPath() const {
+    return path;
+}
+
+int BatchManifest::GetEntryCount() const {
+    return entries.size();
+}
+
+void BatchManifest::Load() {
+    file.close();
+    entries.clear();
+    recordCount = 0;
+
+    QFile input(path);
+    if (input.open(QIODevice::ReadOnly)) {
+        while (!input.atEnd()) {
+            QByteArray line = input.readLine().trimmed();
+            if (line.isEmpty()) continue;
+            recordCount++;
+
+            QJsonDocument document = QJsonDocument::fromJson(line);
+            if (!document.isObject()) continue;  // Torn write
+            QJsonObject record = document.object();
+            QString output = record.value("output").toString();
+            if (!output.isEmpty()) {
+                entries.insert(output, record);
+            }
+        }
+    }
+
+    // Re-runs append a record per output, drop the superseded ones
+    if (recordCount > 2 * entries.size() + 1000) {
+        Compact();
+    }
+}
+
+QJsonObject BatchManifest::GetRecord(const QString &outputPath) const {
+    return entries.value(KeyOf(outputPath));
+}
+
+bool BatchManifest::IsUpToDate(const QJsonObject &record, const QString &inputPath,
+                               const QString &outputPath, const QString &paramsHash,
+                               double *touchedMtime) {
+    if (touchedMtime) {
+        *touchedMtime = -1.0;
+    }
+    if (record.isEmpty() || record.value("params").toString() != paramsHash) {
+        return false;
+    }
+
+    QFileInfo output(outputPath);
+    if (!output.isFile() ||
+        output.size() != static_cast<qint64>(record.value("outputSize").toDouble()) ||
+        MtimeOf(output) != record.value("outputMtime").toDouble()) {
+        return false;
+    }
+
+    QFileInfo input(inputPath);
+    if (!input.isFile() ||
+        input.size() != static_cast<qint64>(record.value("inputSize").toDouble()) ||
+        input.absoluteFilePath() != record.value("input").toString()) {
+        return false;
+    }
+    double mtime = MtimeOf(input);
+    if (mtime == record.value("inputMtime").toDouble()) {
+        return true;
+    }
+    // Touched or copied, the content decides
+    if (FastHash(inputPath) != record.value("inputHash").toString()) {
+        return false;
+    }
+    if (touchedMtime) {
+        *touchedMtime = mtime;
+    }
+    return true;
+}
+
+void BatchManifest::UpdateInputMtime(const QString &outputPath, double mtime) {
+    auto it = entries.find(KeyOf(outputPath));
+    if (it == entries.end()) {
+        return;
+    }
+    it.value().insert("inputMtime", mtime);
+    Append(it.value());
+}
+
+void BatchManifest::Record(BatchItem *item) {
+    QFileInfo input(item->GetInputPath());
+    QFileInfo output(item->GetOutputPath());
+    if (!input.isFile() || !output.isFile()) {
+        return;
+    }
+
+    QJsonObject record;
+    record.insert("output", output.absoluteFilePath());
+    record.insert("input", input.absoluteFilePath());
+    record.insert("inputSize", static_cast<double>(input.size()));
+    record.insert("inputMtime", MtimeOf(input));
+    record.insert("inputHash", FastHash(input.absoluteFilePath()));
+    record.insert("params", ParamsHash(item));
+    record.insert("outputSize", static_cast<double>(output.size()));
+    record.insert("outputMtime", MtimeOf(output));
+
+    entries.insert(output.absoluteFilePath(), record);
+    Append(record);
+}
+
+QString BatchManifest::FastHash(const QString &path) {
+    QFile input(path);
+    if (!input.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    qint64 size = input.size();
+    hash.addData(QByteArray::number(size));
+    hash.addData(input.read(HASH_CHUNK));
+    if (size > 2 * HASH_CHUNK) {
+        input.seek(size - HASH_CHUNK);
+        hash.addData(input.read(HASH_CHUNK));
+    } else if (size > HASH_CHUNK) {
+        hash.addData(input.readAll());
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+QString BatchManifest::ParamsHash(BatchItem *item) {
+    return ParamsHash(item->GetTranscoderName(), item->GetEncodeParameter());
+}
+
+QString BatchManifest::ParamsHash(const QString &transcoderName, EncodeParameter *param) {
+    QJsonObject object;
+    object.insert("transcoder", transcoderName);
+    if (param) {
+        object.insert("param", BatchJournal::EncodeParameterToJson(param));
+    }
+    // QJsonObject keys are sorted, so the text is stable
+    QByteArray text = QJsonDocument(object).toJson(QJsonDocument::Compact);
+    return QString::fromLatin1(QCryptographicHash::hash(text, QCryptographicHash::Md5).toHex());
+}
+
+bool BatchManifest::Append(const QJsonObject &record) {
+    if (!file.isOpen()) {
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        file.setFileName(path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            return false;
+        }
+    }
+    QByteArray line = QJsonDocument(record).toJson(QJsonDocument::Compact);
+    line.append('\n');
+    recordCount++;
+    return file.write(line) == line.size() && file.flush();
+}
+
+void BatchManifest::Compact() {
+    file.close();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSaveFile output(path);
+    if (!output.open(QIODevice::WriteOnly)) {
+        std::cout << "Batch manifest: cannot write " << path.toStdString() << std::endl;
+        return;
+    }
+    for (const QJsonObject &record : entries) {
+        output.write(QJsonDocument(record).toJson(QJsonDocument::Compact));
+        output.write("\n");
+    }
+    // Atomically replaces the old manifest
+    if (output.commit()) {
+        recordCount = entries.size();
+    }
+}
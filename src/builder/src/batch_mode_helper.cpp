@@ -18,6 +18,7 @@
 #include "../include/batch_mode_helper.h"
 #include "../include/batch_queue.h"
 #include "../include/transcoder_helper.h"
+#include "../../common/include/codec_capabilities.h"
 #include <QMessageBox>
 
 BatchModeHelper::BatchModeHelper(FileSelectorWidget *inputFileSelector,
@@ -74,6 +75,21 @@ bool BatchModeHelper::AddToQueue(const QString &outputFormat) {
     QWidget *parentWidget = qobject_cast<QWidget*>(parent());
     QString transcoderName = TranscoderHelper::GetCurrentTranscoderName(parentWidget);
 
+    // Reject settings this FFmpeg build cannot encode before queueing
+    // anything; every item shares the settings and the output format
+    EncodeParameter *checkParam = encodeParameterCreator();
+    std::string error;
+    bool valid = CodecCapabilities::shared().validate(
+        checkParam, batchOutputWidget->GenerateOutputPath(inputFiles.first(), outputFormat).toStdString(),
+        error);
+    delete checkParam;
+    if (!valid) {
+        QMessageBox::critical(parentWidget, QObject::tr("Error"),
+                              QObject::tr("These settings cannot be used: %1")
+                                  .arg(QString::fromStdString(error)));
+        return false;
+    }
+
     // Create batch items
     QList<BatchItem*> items;
     for (const QString &inputFile : inputFiles) {
@@ -16,6 +16,9 @@
  */
 
 #include "../include/batch_queue.h"
+#include "../include/batch_journal.h"
+#include <algorithm>
+#include <iostream>
 
 BatchQueue *BatchQueue::instance = nullptr;
 QMutex BatchQueue::instanceMutex;
@@ -24,6 +27,9 @@ BatchQueue::BatchQueue() : QObject(nullptr) {
 }
 
 BatchQueue::~BatchQueue() {
+    // Keep the journal, the queue is restored on the next start
+    delete journal;
+    journal = nullptr;
     Clear();
 }
 
@@ -37,12 +43,140 @@ BatchQueue* BatchQueue::Instance() {
     return instance;
 }
 
+void BatchQueue::AppendItem(BatchItem *item) {
+    if (item->GetId() <= 0) {
+        item->SetId(nextId++);
+    } else {
+        nextId = qMax(nextId, item->GetId() + 1);
+    }
+    if (journal) {
+        journal->RecordAdded(item);
+    }
+    itemIndex.insert(item, items.size());
+    itemsById.insert(item->GetId(), item);
+    items.append(item);
+    BatchItemStatus status = item->GetStatus();
+    itemStatus.insert(item, status);
+    statusCount[static_cast<int>(status)]++;
+    IndexStatus(item, status);
+}
+
+void BatchQueue::TakeItem(int index) {
+    BatchItem *item = items.takeAt(index);
+    if (journal) {
+        journal->RecordRemoved(item);
+    }
+    BatchItemStatus status = itemStatus.take(item);
+    statusCount[static_cast<int>(status)]--;
+    UnindexStatus(item, status);
+    itemIndex.remove(item);
+    itemsById.remove(item->GetId());
+    delete item;
+}
+
+void BatchQueue::IndexStatus(BatchItem *item, BatchItemStatus status) {
+    if (status == BatchItemStatus::Waiting) {
+        waitingItems.emplace(std::make_pair(-item->GetPriority(), item->GetId()), item);
+    } else if (status == BatchItemStatus::Processing) {
+        processingItems.insert(item);
+    }
+    CountEstimate(item, status);
+}
+
+void BatchQueue::UnindexStatus(BatchItem *item, BatchItemStatus status) {
+    if (status == BatchItemStatus::Waiting) {
+        waitingItems.erase(std::make_pair(-item->GetPriority(), item->GetId()));
+    } else if (status == BatchItemStatus::Processing) {
+        processingItems.remove(item);
+    }
+    UncountEstimate(item);
+}
+
+void BatchQueue::CountEstimate(BatchItem *item, BatchItemStatus status) {
+    double seconds;
+    if (status == BatchItemStatus::Waiting) {
+        seconds = item->GetPredictedSeconds();
+    } else if (status == BatchItemStatus::Processing) {
+        seconds = item->GetRemainingSeconds();
+    } else {
+        return;
+    }
+    countedEstimates.insert(item, seconds);
+    if (seconds >= 0) {
+        remainingSeconds += seconds;
+    } else {
+        unknownEstimates++;
+    }
+}
+
+void BatchQueue::UncountEstimate(BatchItem *item) {
+    auto it = countedEstimates.find(item);
+    if (it == countedEstimates.end()) {
+        return;
+    }
+    if (it.value() >= 0) {
+        remainingSeconds -= it.value();
+    } else {
+        unknownEstimates--;
+    }
+    countedEstimates.erase(it);
+    // Drop the rounding error the additions and subtractions left behind
+    if (countedEstimates.isEmpty()) {
+        remainingSeconds = 0.0;
+    }
+}
+
+void BatchQueue::ReindexFrom(int first) {
+    for (int i = first; i < items.size(); ++i) {
+        itemIndex[items.at(i)] = i;
+    }
+}
+
+int BatchQueue::CountOf(BatchItemStatus status) const {
+    QMutexLocker locker(&queueMutex);
+    return statusCount[static_cast<int>(status)];
+}
+
+void BatchQueue::CompactJournalIfNeeded() {
+    // Rewrite once the history outweighs the snapshot
+    if (journal && journal->GetRecordCount() > 2 * items.size() + 1000) {
+        journal->Compact(items);
+    }
+}
+
+int BatchQueue::EnableJournal(const QString &path) {
+    QList<BatchItem*> restored;
+    {
+        QMutexLocker locker(&queueMutex);
+        if (journal) {
+            return 0;
+        }
+        BatchJournal *loaded = new BatchJournal(path.isEmpty() ? BatchJournal::DefaultPath() : path);
+        restored = loaded->Load();
+
+        // Append before the journal is attached, the items are already in it
+        int firstIndex = items.size();
+        for (BatchItem *item : restored) {
+            AppendItem(item);
+        }
+        journal = loaded;
+        journal->Compact(items);
+        if (!restored.isEmpty()) {
+            std::cout << "Restored " << restored.size() << " batch item(s) from "
+                      << journal->GetPath().toStdString() << std::endl;
+            emit ItemsAdded(firstIndex, restored.size());
+        }
+    }
+    return restored.size();
+}
+
 void BatchQueue::AddItem(BatchItem *item) {
     if (!item) return;
 
     QMutexLocker locker(&queueMutex);
-    items.append(item);
+    AppendItem(item);
     int index = items.size() - 1;
+    CompactJournalIfNeeded();
     emit ItemAdded(index);
 }
 
@@ -50,28 +184,66 @@ void BatchQueue::AddItems(const QList<BatchItem*> &newItems) {
     if (newItems.isEmpty()) return;
 
     QMutexLocker locker(&queueMutex);
+    int firstIndex = items.size();
+    items.reserve(items.size() + newItems.size());
     for (BatchItem *item : newItems) {
         if (item) {
-            items.append(item);
-            int index = items.size() - 1;
-            emit ItemAdded(index);
+            AppendItem(item);
         }
     }
+    CompactJournalIfNeeded();
+    if (items.size() > firstIndex) {
+        emit ItemsAdded(firstIndex, items.size() - firstIndex);
+    }
 }
 
 void BatchQueue::RemoveItem(int index) {
     QMutexLocker locker(&queueMutex);
     if (index >= 0 && index < items.size()) {
-        BatchItem *item = items.takeAt(index);
-        delete item;
+        TakeItem(index);
+        ReindexFrom(index);
+        CompactJournalIfNeeded();
         emit ItemRemoved(index);
     }
 }
 
+void BatchQueue::RemoveItems(const QList<int> &indices) {
+    // Remove from highest index to lowest to avoid index shifting
+    QList<int> sorted = indices;
+    std::sort(sorted.begin(), sorted.end(), std::greater<int>());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    QMutexLocker locker(&queueMutex);
+    int lowest = -1;
+    for (int index : sorted) {
+        if (index >= 0 && index < items.size()) {
+            TakeItem(index);
+            lowest = index;
+        }
+    }
+    if (lowest >= 0) {
+        ReindexFrom(lowest);
+        CompactJournalIfNeeded();
+        emit ItemsRemoved();
+    }
+}
+
 void BatchQueue::Clear() {
     QMutexLocker locker(&queueMutex);
+    if (journal) {
+        journal->RecordCleared();
+    }
     qDeleteAll(items);
     items.clear();
+    itemIndex.clear();
+    itemsById.clear();
+    itemStatus.clear();
+    std::fill(std::begin(statusCount), std::end(statusCount), 0);
+    waitingItems.clear();
+    processingItems.clear();
+    countedEstimates.clear();
+    remainingSeconds = 0.0;
+    unknownEstimates = 0;
     emit QueueCleared();
 }
 
@@ -81,47 +253,19 @@ int BatchQueue::GetCount() const {
 }
 
 int BatchQueue::GetWaitingCount() const {
-    QMutexLocker locker(&queueMutex);
-    int count = 0;
-    for (const BatchItem *item : items) {
-        if (item->GetStatus() == BatchItemStatus::Waiting) {
-            count++;
-        }
-    }
-    return count;
+    return CountOf(BatchItemStatus::Waiting);
 }
 
 int BatchQueue::GetProcessingCount() const {
-    QMutexLocker locker(&queueMutex);
-    int count = 0;
-    for (const BatchItem *item : items) {
-        if (item->GetStatus() == BatchItemStatus::Processing) {
-            count++;
-        }
-    }
-    return count;
+    return CountOf(BatchItemStatus::Processing);
 }
 
 int BatchQueue::GetFinishedCount() const {
-    QMutexLocker locker(&queueMutex);
-    int count = 0;
-    for (const BatchItem *item : items) {
-        if (item->GetStatus() == BatchItemStatus::Finished) {
-            count++;
-        }
-    }
-    return count;
+    return CountOf(BatchItemStatus::Finished);
 }
 
 int BatchQueue::GetFailedCount() const {
-    QMutexLocker locker(&queueMutex);
-    int count = 0;
-    for (const BatchItem *item : items) {
-        if (item->GetStatus() == BatchItemStatus::Failed) {
-            count++;
-        }
-    }
-    return count;
+    return CountOf(BatchItemStatus::Failed);
 }
 
 BatchItem* BatchQueue::GetItem(int index) const {
@@ -132,6 +276,11 @@ BatchItem* BatchQueue::GetItem(int index) const {
     return nullptr;
 }
 
+BatchItem* BatchQueue::GetItemById(qint64 id) const {
+    QMutexLocker locker(&queueMutex);
+    return itemsById.value(id, nullptr);
+}
+
 QList<BatchItem*> BatchQueue::GetAllItems() const {
     QMutexLocker locker(&queueMutex);
     return items;
@@ -139,12 +288,40 @@ QList<BatchItem*> BatchQueue::GetAllItems() const {
 
 BatchItem* BatchQueue::GetNextWaitingItem() const {
     QMutexLocker locker(&queueMutex);
-    for (BatchItem *item : items) {
-        if (item->GetStatus() == BatchItemStatus::Waiting) {
-            return item;
-        }
+    return waitingItems.empty() ? nullptr : waitingItems.begin()->second;
+}
+
+QList<BatchItem*> BatchQueue::GetWaitingItems() const {
+    QMutexLocker locker(&queueMutex);
+    QList<BatchItem*> result;
+    result.reserve(static_cast<int>(waitingItems.size()));
+    for (const auto &entry : waitingItems) {
+        result.append(entry.second);
     }
-    return nullptr;
+    return result;
+}
+
+QList<BatchItem*> BatchQueue::GetWaitingItems(int priority) const {
+    QMutexLocker locker(&queueMutex);
+    QList<BatchItem*> result;
+    auto it = waitingItems.lower_bound(std::make_pair(-priority, qint64(0)));
+    for (; it != waitingItems.end() && it->first.first == -priority; ++it) {
+        result.append(it->second);
+    }
+    return result;
+}
+
+QList<BatchItem*> BatchQueue::GetProcessingItems() const {
+    QMutexLocker locker(&queueMutex);
+    return processingItems.values();
+}
+
+double BatchQueue::GetRemainingSeconds(int *unknownCount) const {
+    QMutexLocker locker(&queueMutex);
+    if (unknownCount) {
+        *unknownCount = unknownEstimates;
+    }
+    return qMax(0.0, remainingSeconds);
 }
 
 bool BatchQueue::IsEmpty() const {
@@ -162,13 +339,61 @@ bool BatchQueue::IsProcessing() const {
 
 int BatchQueue::GetItemIndex(BatchItem *item) const {
     QMutexLocker locker(&queueMutex);
-    return items.indexOf(item);
+    return itemIndex.value(item, -1);
 }
 
 void BatchQueue::NotifyItemStatusChanged(int index, BatchItemStatus status) {
+    {
+        QMutexLocker locker(&queueMutex);
+        if (index >= 0 && index < items.size()) {
+            BatchItem *item = items.at(index);
+            BatchItemStatus previous = itemStatus.value(item);
+            if (previous != status) {
+                statusCount[static_cast<int>(previous)]--;
+                statusCount[static_cast<int>(status)]++;
+                itemStatus[item] = status;
+                UnindexStatus(item, previous);
+                IndexStatus(item, status);
+                if (journal) {
+                    journal->RecordStatus(item);
+                    CompactJournalIfNeeded();
+                }
+            }
+        }
+    }
     emit ItemStatusChanged(index, status);
 }
 
 void BatchQueue::NotifyItemProgressChanged(int index, double progress) {
     emit ItemProgressChanged(index, progress);
 }
+
+void BatchQueue::NotifyItemEstimateChanged(int index) {
+    QMutexLocker locker(&queueMutex);
+    if (index < 0 || index >= items.size()) {
+        return;
+    }
+    BatchItem *item = items.at(index);
+    UncountEstimate(item);
+    CountEstimate(item, itemStatus.value(item));
+}
+
+void BatchQueue::SetItemPriority(int index, int priority) {
+    QMutexLocker locker(&queueMutex);
+    if (index < 0 || index >= items.size()) {
+        return;
+    }
+    BatchItem *item = items.at(index);
+    if (item->GetPriority() == priority) {
+        return;
+    }
+    // The waiting index is keyed by priority
+    BatchItemStatus status = itemStatus.value(item);
+    UnindexStatus(item, status);
+    item->SetPriority(priority);
+    IndexStatus(item, status);
+    if (journal) {
+        journal->RecordPriority(item);
+        CompactJournalIfNeeded();
+    }
+}
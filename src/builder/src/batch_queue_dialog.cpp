@@ -16,21 +16,25 @@
  */
 
 #include "../include/batch_queue_dialog.h"
-#include "../../engine/include/converter.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QHeaderView>
+#include <QItemSelectionModel>
 #include <QMessageBox>
+#include <QFileDialog>
 #include <QFileInfo>
 #include <QDebug>
-#include <QThread>
-#include <QMetaObject>
+#include <climits>
 
 BatchQueueDialog::BatchQueueDialog(QWidget *parent)
-    : QDialog(parent),
-      isProcessing(false),
-      currentItemIndex(-1) {
+    : QDialog(parent) {
     batchQueue = BatchQueue::Instance();
+    scheduler = new BatchScheduler(batchQueue, this);
+    runner = new BatchRunner(batchQueue, scheduler, this);
+    folderWatcher = new FolderWatcher(batchQueue, this);
+    manifest = new BatchManifest(BatchManifest::DefaultPath());
+    manifest->Load();
+    runner->SetManifest(manifest);
 
     SetupUI();
     RefreshQueue();
@@ -38,13 +42,24 @@ BatchQueueDialog::BatchQueueDialog(QWidget *parent)
     // Connect to batch queue signals with Qt::QueuedConnection to avoid deadlocks
     // (signals are emitted while mutex is locked, slots may need to lock mutex again)
     connect(batchQueue, &BatchQueue::ItemAdded, this, &BatchQueueDialog::OnItemAdded, Qt::QueuedConnection);
+    connect(batchQueue, &BatchQueue::ItemsAdded, this, &BatchQueueDialog::OnItemsAdded, Qt::QueuedConnection);
     connect(batchQueue, &BatchQueue::ItemRemoved, this, &BatchQueueDialog::OnItemRemoved, Qt::QueuedConnection);
-    connect(batchQueue, &BatchQueue::ItemStatusChanged, this, &BatchQueueDialog::OnItemStatusChanged, Qt::QueuedConnection);
-    connect(batchQueue, &BatchQueue::ItemProgressChanged, this, &BatchQueueDialog::OnItemProgressChanged, Qt::QueuedConnection);
+    connect(batchQueue, &BatchQueue::ItemsRemoved, this, &BatchQueueDialog::OnQueueCleared, Qt::QueuedConnection);
     connect(batchQueue, &BatchQueue::QueueCleared, this, &BatchQueueDialog::OnQueueCleared, Qt::QueuedConnection);
+
+    // Status and progress repaints are coalesced by the model, the
+    // statistics follow its flushes
+    connect(queueModel, &BatchQueueModel::RowsFlushed, this, &BatchQueueDialog::UpdateStatistics);
+
+    connect(scheduler, &BatchScheduler::ItemProbed, this, &BatchQueueDialog::OnItemProbed);
+    connect(scheduler, &BatchScheduler::EstimateChanged, this, &BatchQueueDialog::OnItemProbed);
+    connect(runner, &BatchRunner::AllFinished, this, &BatchQueueDialog::OnAllFinished);
+    connect(folderWatcher, &FolderWatcher::ItemEnqueued, this, &BatchQueueDialog::OnWatchedItemEnqueued);
 }
 
 BatchQueueDialog::~BatchQueueDialog() {
+    runner->SetManifest(nullptr);
+    delete manifest;
 }
 
 void BatchQueueDialog::SetupUI() {
@@ -59,36 +74,96 @@ void BatchQueueDialog::SetupUI() {
     mainLayout->addWidget(statisticsLabel);
 
     // Queue table
-    queueTable = new QTableWidget(this);
-    queueTable->setColumnCount(4);
-    queueTable->setHorizontalHeaderLabels({tr("Status"), tr("Input File"), tr("Output File"), tr("Progress")});
+    queueModel = new BatchQueueModel(batchQueue, this);
+    queueTable = new QTableView(this);
+    queueTable->setModel(queueModel);
     queueTable->setSelectionBehavior(QAbstractItemView::SelectRows);
     queueTable->setSelectionMode(QAbstractItemView::ExtendedSelection);
     queueTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    queueTable->setWordWrap(false);
     queueTable->horizontalHeader()->setStretchLastSection(false);
-    queueTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
-    queueTable->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
-    queueTable->horizontalHeader()->setSectionResizeMode(2, QHeaderView::Stretch);
-    queueTable->horizontalHeader()->setSectionResizeMode(3, QHeaderView::ResizeToContents);
+    // Fixed sizes: ResizeToContents would measure every row of large queues
+    queueTable->horizontalHeader()->setSectionResizeMode(BatchQueueModel::StatusColumn, QHeaderView::Interactive);
+    queueTable->horizontalHeader()->setSectionResizeMode(BatchQueueModel::InputColumn, QHeaderView::Stretch);
+    queueTable->horizontalHeader()->setSectionResizeMode(BatchQueueModel::OutputColumn, QHeaderView::Stretch);
+    queueTable->horizontalHeader()->setSectionResizeMode(BatchQueueModel::ProgressColumn, QHeaderView::Interactive);
+    queueTable->horizontalHeader()->setSectionResizeMode(BatchQueueModel::EtaColumn, QHeaderView::Interactive);
+    queueTable->horizontalHeader()->setSectionResizeMode(BatchQueueModel::PriorityColumn, QHeaderView::Interactive);
+    queueTable->setColumnWidth(BatchQueueModel::StatusColumn, 120);
+    queueTable->setColumnWidth(BatchQueueModel::ProgressColumn, 80);
+    queueTable->setColumnWidth(BatchQueueModel::EtaColumn, 80);
+    queueTable->setColumnWidth(BatchQueueModel::PriorityColumn, 60);
     queueTable->verticalHeader()->setVisible(false);
+    queueTable->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
     mainLayout->addWidget(queueTable);
 
+    // Scheduler row
+    QHBoxLayout *schedulerLayout = new QHBoxLayout();
+    maxCoresSpinBox = new QSpinBox(this);
+    maxCoresSpinBox->setRange(1, BatchScheduler::GetSystemCores());
+    maxCoresSpinBox->setValue(qMin(scheduler->GetMaxCores(), BatchScheduler::GetSystemCores()));
+    maxCoresSpinBox->setToolTip(tr("Cores the running items may use together"));
+    maxMemorySpinBox = new QSpinBox(this);
+    maxMemorySpinBox->setRange(256, static_cast<int>(qMin<qint64>(BatchScheduler::GetSystemMemoryMB(), INT_MAX)));
+    maxMemorySpinBox->setSingleStep(256);
+    maxMemorySpinBox->setSuffix(tr(" MB"));
+    maxMemorySpinBox->setValue(static_cast<int>(qMin<qint64>(scheduler->GetMaxMemoryMB(), INT_MAX)));
+    maxMemorySpinBox->setToolTip(tr("Memory the running items may use together"));
+    shortestJobFirstCheckBox = new QCheckBox(tr("Shortest job first"), this);
+    shortestJobFirstCheckBox->setChecked(scheduler->IsShortestJobFirst());
+    skipUpToDateCheckBox = new QCheckBox(tr("Skip up-to-date"), this);
+    skipUpToDateCheckBox->setChecked(true);
+    skipUpToDateCheckBox->setToolTip(tr("Do not convert items whose output was already produced "
+                                        "from the same input and settings"));
+    stallTimeoutSpinBox = new QSpinBox(this);
+    stallTimeoutSpinBox->setRange(0, 3600);
+    stallTimeoutSpinBox->setSuffix(tr(" s"));
+    stallTimeoutSpinBox->setSpecialValueText(tr("Off"));
+    stallTimeoutSpinBox->setValue(runner->GetStallTimeout());
+    stallTimeoutSpinBox->setToolTip(tr("Abort an item that makes no progress for this long"));
+    raisePriorityButton = new QPushButton(tr("Priority +"), this);
+    lowerPriorityButton = new QPushButton(tr("Priority -"), this);
+
+    schedulerLayout->addWidget(new QLabel(tr("Max cores:"), this));
+    schedulerLayout->addWidget(maxCoresSpinBox);
+    schedulerLayout->addSpacing(10);
+    schedulerLayout->addWidget(new QLabel(tr("Memory:"), this));
+    schedulerLayout->addWidget(maxMemorySpinBox);
+    schedulerLayout->addSpacing(10);
+    schedulerLayout->addWidget(shortestJobFirstCheckBox);
+    schedulerLayout->addSpacing(10);
+    schedulerLayout->addWidget(skipUpToDateCheckBox);
+    schedulerLayout->addSpacing(10);
+    schedulerLayout->addWidget(new QLabel(tr("Stall timeout:"), this));
+    schedulerLayout->addWidget(stallTimeoutSpinBox);
+    schedulerLayout->addStretch();
+    schedulerLayout->addWidget(raisePriorityButton);
+    schedulerLayout->addWidget(lowerPriorityButton);
+
+    mainLayout->addLayout(schedulerLayout);
+
     // Button row
     QHBoxLayout *buttonLayout = new QHBoxLayout();
     startButton = new QPushButton(tr("▶ Start"), this);
     stopButton = new QPushButton(tr("⏹ Stop"), this);
     stopButton->setEnabled(false);
+    cancelSelectedButton = new QPushButton(tr("Cancel Selected"), this);
     removeSelectedButton = new QPushButton(tr("Remove Selected"), this);
     clearFinishedButton = new QPushButton(tr("Clear Finished"), this);
     clearAllButton = new QPushButton(tr("Clear All"), this);
+    watchFolderButton = new QPushButton(tr("Watch Folder..."), this);
+    watchFolderButton->setToolTip(tr("Queue and convert files as they are dropped into a folder"));
     closeButton = new QPushButton(tr("Close"), this);
 
     buttonLayout->addWidget(startButton);
     buttonLayout->addWidget(stopButton);
+    buttonLayout->addWidget(cancelSelectedButton);
     buttonLayout->addSpacing(20);
     buttonLayout->addWidget(removeSelectedButton);
     buttonLayout->addWidget(clearFinishedButton);
     buttonLayout->addWidget(clearAllButton);
+    buttonLayout->addSpacing(20);
+    buttonLayout->addWidget(watchFolderButton);
     buttonLayout->addStretch();
     buttonLayout->addWidget(closeButton);
 
@@ -97,22 +172,32 @@ void BatchQueueDialog::SetupUI() {
     // Connect button signals
     connect(startButton, &QPushButton::clicked, this, &BatchQueueDialog::OnStartClicked);
     connect(stopButton, &QPushButton::clicked, this, &BatchQueueDialog::OnStopClicked);
+    connect(cancelSelectedButton, &QPushButton::clicked, this, &BatchQueueDialog::OnCancelSelectedClicked);
     connect(removeSelectedButton, &QPushButton::clicked, this, &BatchQueueDialog::OnRemoveSelectedClicked);
     connect(clearFinishedButton, &QPushButton::clicked, this, &BatchQueueDialog::OnClearFinishedClicked);
     connect(clearAllButton, &QPushButton::clicked, this, &BatchQueueDialog::OnClearAllClicked);
     connect(closeButton, &QPushButton::clicked, this, &BatchQueueDialog::OnCloseClicked);
+    connect(watchFolderButton, &QPushButton::clicked, this, &BatchQueueDialog::OnWatchFolderClicked);
+    connect(raisePriorityButton, &QPushButton::clicked, this, &BatchQueueDialog::OnRaisePriorityClicked);
+    connect(lowerPriorityButton, &QPushButton::clicked, this, &BatchQueueDialog::OnLowerPriorityClicked);
+    connect(maxCoresSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), scheduler, &BatchScheduler::SetMaxCores);
+    connect(maxMemorySpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](int value) {
+        scheduler->SetMaxMemoryMB(value);
+    });
+    connect(shortestJobFirstCheckBox, &QCheckBox::toggled, scheduler, &BatchScheduler::SetShortestJobFirst);
+    connect(skipUpToDateCheckBox, &QCheckBox::toggled, this, [this](bool checked) {
+        runner->SetManifest(checked ? manifest : nullptr);
+    });
+    connect(stallTimeoutSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](int value) {
+        runner->SetStallTimeout(value);
+    });
 }
 
 void BatchQueueDialog::RefreshQueue() {
-    queueTable->setRowCount(0);
-
-    QList<BatchItem*> items = batchQueue->GetAllItems();
-    for (int i = 0; i < items.size(); ++i) {
-        queueTable->insertRow(i);
-        AddItemToTable(items[i], i);
-    }
+    queueModel->Reload();
 
     UpdateStatistics();
+    scheduler->ProbeWaitingItems();
 }
 
 void BatchQueueDialog::UpdateStatistics() {
@@ -124,163 +209,86 @@ void BatchQueueDialog::UpdateStatistics() {
 
     QString stats = tr("Total: %1 | Waiting: %2 | Processing: %3 | Finished: %4 | Failed: %5")
                     .arg(total).arg(waiting).arg(processing).arg(finished).arg(failed);
-    statisticsLabel->setText(stats);
-}
-
-void BatchQueueDialog::AddItemToTable(BatchItem *item, int row) {
-    if (!item) return;
-
-    // Status column
-    QTableWidgetItem *statusItem = new QTableWidgetItem(GetStatusIcon(item->GetStatus()) + " " + item->GetStatusString());
-    statusItem->setForeground(GetStatusColor(item->GetStatus()));
-    queueTable->setItem(row, 0, statusItem);
-
-    // Input file column
-    QFileInfo inputInfo(item->GetInputPath());
-    QTableWidgetItem *inputItem = new QTableWidgetItem(inputInfo.fileName());
-    inputItem->setToolTip(item->GetInputPath());
-    queueTable->setItem(row, 1, inputItem);
-
-    // Output file column
-    QFileInfo outputInfo(item->GetOutputPath());
-    QTableWidgetItem *outputItem = new QTableWidgetItem(outputInfo.fileName());
-    outputItem->setToolTip(item->GetOutputPath());
-    queueTable->setItem(row, 2, outputItem);
-
-    // Progress column
-    QString progressText;
-    if (item->GetStatus() == BatchItemStatus::Processing) {
-        progressText = QString::number(static_cast<int>(item->GetProgress())) + "%";
-    } else if (item->GetStatus() == BatchItemStatus::Finished) {
-        progressText = "100%";
-    } else if (item->GetStatus() == BatchItemStatus::Failed) {
-        progressText = "Failed";
-    } else {
-        progressText = "-";
-    }
-    QTableWidgetItem *progressItem = new QTableWidgetItem(progressText);
-    queueTable->setItem(row, 3, progressItem);
-}
 
-void BatchQueueDialog::UpdateItemInTable(int row, BatchItem *item) {
-    if (!item || row < 0 || row >= queueTable->rowCount()) return;
-
-    // Update status
-    queueTable->item(row, 0)->setText(GetStatusIcon(item->GetStatus()) + " " + item->GetStatusString());
-    queueTable->item(row, 0)->setForeground(GetStatusColor(item->GetStatus()));
-
-    // Update progress
-    QString progressText;
-    if (item->GetStatus() == BatchItemStatus::Processing) {
-        progressText = QString::number(static_cast<int>(item->GetProgress())) + "%";
-    } else if (item->GetStatus() == BatchItemStatus::Finished) {
-        progressText = "100%";
-    } else if (item->GetStatus() == BatchItemStatus::Failed) {
-        progressText = "Failed";
-    } else {
-        progressText = "-";
+    // Whole-queue ETA from per-item predictions and live estimates, kept
+    // as a running sum by the queue
+    int unknown = 0;
+    double remaining = batchQueue->GetRemainingSeconds(&unknown);
+    if (waiting + processing > 0 && unknown < waiting + processing) {
+        stats += tr(" | ETA: %1").arg(BatchQueueModel::FormatDuration(remaining));
+        if (unknown > 0) {
+            stats += tr(" (+%1 unknown)").arg(unknown);
+        }
     }
-    queueTable->item(row, 3)->setText(progressText);
+    statisticsLabel->setText(stats);
 }
 
-QString BatchQueueDialog::GetStatusIcon(BatchItemStatus status) const {
-    switch (status) {
-        case BatchItemStatus::Waiting:
-            return "⏳";
-        case BatchItemStatus::Processing:
-            return "▶";
-        case BatchItemStatus::Finished:
-            return "✓";
-        case BatchItemStatus::Failed:
-            return "✗";
-        default:
-            return "?";
-    }
+void BatchQueueDialog::OnItemProbed(BatchItem *item) {
+    queueModel->MarkRowDirty(batchQueue->GetItemIndex(item));
 }
 
-QColor BatchQueueDialog::GetStatusColor(BatchItemStatus status) const {
-    switch (status) {
-        case BatchItemStatus::Waiting:
-            return QColor(128, 128, 128);  // Gray
-        case BatchItemStatus::Processing:
-            return QColor(0, 122, 204);    // Blue
-        case BatchItemStatus::Finished:
-            return QColor(0, 128, 0);      // Green
-        case BatchItemStatus::Failed:
-            return QColor(204, 0, 0);      // Red
-        default:
-            return QColor(0, 0, 0);        // Black
-    }
+void BatchQueueDialog::OnItemAdded(int index) {
+    Q_UNUSED(index);
+    UpdateStatistics();
+    scheduler->ProbeWaitingItems();
 }
 
-void BatchQueueDialog::OnItemAdded(int index) {
-    RefreshQueue();
+void BatchQueueDialog::OnItemsAdded(int firstIndex, int count) {
+    Q_UNUSED(firstIndex);
+    Q_UNUSED(count);
+    UpdateStatistics();
+    scheduler->ProbeWaitingItems();
 }
 
 void BatchQueueDialog::OnItemRemoved(int index) {
-    RefreshQueue();
+    Q_UNUSED(index);
+    UpdateStatistics();
 }
 
-void BatchQueueDialog::OnItemStatusChanged(int index, BatchItemStatus status) {
-    BatchItem *item = batchQueue->GetItem(index);
-    if (item && index < queueTable->rowCount()) {
-        UpdateItemInTable(index, item);
-        UpdateStatistics();
-    }
+void BatchQueueDialog::OnQueueCleared() {
+    UpdateStatistics();
 }
 
-void BatchQueueDialog::OnItemProgressChanged(int index, double progress) {
-    BatchItem *item = batchQueue->GetItem(index);
-    if (item && index < queueTable->rowCount()) {
-        UpdateItemInTable(index, item);
+void BatchQueueDialog::OnCancelSelectedClicked() {
+    for (const QModelIndex &index : queueTable->selectionModel()->selectedRows()) {
+        BatchItem *item = batchQueue->GetItem(index.row());
+        if (item && item->GetStatus() == BatchItemStatus::Processing) {
+            runner->CancelItem(item);
+        }
     }
 }
 
-void BatchQueueDialog::OnQueueCleared() {
-    RefreshQueue();
-}
-
 void BatchQueueDialog::OnRemoveSelectedClicked() {
-    QList<QTableWidgetItem*> selectedItems = queueTable->selectedItems();
-    if (selectedItems.isEmpty()) {
+    QModelIndexList selectedRows = queueTable->selectionModel()->selectedRows();
+    if (selectedRows.isEmpty()) {
         return;
     }
 
-    // Get unique row indices
-    QSet<int> rows;
-    for (QTableWidgetItem *item : selectedItems) {
-        rows.insert(item->row());
-    }
-
     // Check if any selected item is currently processing
-    QList<BatchItem*> allItems = batchQueue->GetAllItems();
-    for (int row : rows) {
-        if (row >= 0 && row < allItems.size()) {
-            if (allItems[row]->GetStatus() == BatchItemStatus::Processing) {
-                QMessageBox::warning(this, tr("Cannot Remove"),
-                                   tr("Cannot remove items that are currently being processed."));
-                return;
-            }
+    QList<int> rows;
+    for (const QModelIndex &index : selectedRows) {
+        BatchItem *item = batchQueue->GetItem(index.row());
+        if (item && item->GetStatus() == BatchItemStatus::Processing) {
+            QMessageBox::warning(this, tr("Cannot Remove"),
+                               tr("Cannot remove items that are currently being processed."));
+            return;
         }
+        rows.append(index.row());
     }
 
-    // Remove from highest index to lowest to avoid index shifting
-    QList<int> rowList = rows.values();
-    std::sort(rowList.begin(), rowList.end(), std::greater<int>());
-
-    for (int row : rowList) {
-        batchQueue->RemoveItem(row);
-    }
+    batchQueue->RemoveItems(rows);
 }
 
 void BatchQueueDialog::OnClearFinishedClicked() {
     QList<BatchItem*> items = batchQueue->GetAllItems();
-    for (int i = items.size() - 1; i >= 0; --i) {
+    QList<int> rows;
+    for (int i = 0; i < items.size(); ++i) {
         BatchItemStatus status = items[i]->GetStatus();
         if (status == BatchItemStatus::Finished || status == BatchItemStatus::Failed) {
-            batchQueue->RemoveItem(i);
+            rows.append(i);
         }
     }
+    batchQueue->RemoveItems(rows);
 }
 
 void BatchQueueDialog::OnClearAllClicked() {
@@ -306,6 +314,24 @@ void BatchQueueDialog::OnCloseClicked() {
     close();
 }
 
+void BatchQueueDialog::OnRaisePriorityClicked() {
+    AdjustSelectedPriority(1);
+}
+
+void BatchQueueDialog::OnLowerPriorityClicked() {
+    AdjustSelectedPriority(-1);
+}
+
+void BatchQueueDialog::AdjustSelectedPriority(int delta) {
+    for (const QModelIndex &index : queueTable->selectionModel()->selectedRows()) {
+        BatchItem *item = batchQueue->GetItem(index.row());
+        if (item) {
+            batchQueue->SetItemPriority(index.row(), item->GetPriority() + delta);
+            queueModel->MarkRowDirty(index.row());
+        }
+    }
+}
+
 void BatchQueueDialog::OnStartClicked() {
     if (!batchQueue->HasWaitingItems()) {
         QMessageBox::information(this, tr("No Items"),
@@ -313,134 +339,65 @@ void BatchQueueDialog::OnStartClicked() {
         return;
     }
 
-    isProcessing = true;
     startButton->setEnabled(false);
     stopButton->setEnabled(true);
 
-    ProcessNextItem();
+    runner->Start();
 }
 
 void BatchQueueDialog::OnStopClicked() {
     QMessageBox::StandardButton reply = QMessageBox::question(
         this,
         tr("Stop Processing"),
-        tr("Are you sure you want to stop batch processing?"),
+        tr("Are you sure you want to stop batch processing?\n"
+           "Running items are cancelled and put back in the queue."),
         QMessageBox::Yes | QMessageBox::No
     );
 
     if (reply == QMessageBox::Yes) {
-        isProcessing = false;
+        runner->Stop();
         startButton->setEnabled(true);
         stopButton->setEnabled(false);
     }
 }
 
-void BatchQueueDialog::ProcessNextItem() {
-    if (!isProcessing) {
+void BatchQueueDialog::OnWatchFolderClicked() {
+    QString folder = QFileDialog::getExistingDirectory(this, tr("Watch Folder"));
+    if (folder.isEmpty()) {
         return;
     }
-
-    // Get next waiting item
-    BatchItem *item = batchQueue->GetNextWaitingItem();
-    if (!item) {
-        isProcessing = false;
-        startButton->setEnabled(true);
-        stopButton->setEnabled(false);
-
-        QMessageBox::information(this, tr("Batch Processing Complete"),
-                               tr("All items have been processed!"));
+    if (!folderWatcher->AddFolder(folder)) {
+        QMessageBox::warning(this, tr("Watch Folder"),
+                             tr("Cannot watch %1.").arg(folder));
         return;
     }
+    watchFolderButton->setText(tr("Watch Folder... (%1)").arg(folderWatcher->GetFolders().size()));
+    watchFolderButton->setToolTip(tr("Watching:\n%1\n\nSettings are read from %2 in each folder")
+                                  .arg(folderWatcher->GetFolders().join("\n"),
+                                       FolderWatcher::PRESET_FILE_NAME));
+}
 
-    currentItemIndex = batchQueue->GetItemIndex(item);
+void BatchQueueDialog::OnWatchedItemEnqueued(BatchItem *item) {
+    Q_UNUSED(item);
+    // Dropped files start without waiting for the Start button
+    startButton->setEnabled(false);
+    stopButton->setEnabled(true);
+    runner->Start();
+}
 
-    // Mark as processing
-    item->MarkAsProcessing();
-    batchQueue->NotifyItemStatusChanged(currentItemIndex, BatchItemStatus::Processing);
+void BatchQueueDialog::OnAllFinished() {
+    startButton->setEnabled(true);
+    stopButton->setEnabled(false);
 
-    // Get encode parameters
-    EncodeParameter *encodeParam = item->GetEncodeParameter();
-    if (!encodeParam) {
-        item->MarkAsFailed("No encode parameters");
-        batchQueue->NotifyItemStatusChanged(currentItemIndex, BatchItemStatus::Failed);
-        ProcessNextItem();  // Try next item
+    // Watched folders keep producing items, no point in announcing it
+    if (folderWatcher->IsWatching()) {
         return;
     }
 
-    // Create process parameter and add this dialog as observer
-    ProcessParameter *processParam = new ProcessParameter();
-    processParam->add_observer(this);
-
-    // Start conversion in separate thread
-    QString inputPath = item->GetInputPath();
-    QString outputPath = item->GetOutputPath();
-    QString transcoderName = item->GetTranscoderName();
-
-    QThread *thread = QThread::create([this, inputPath, outputPath, encodeParam, processParam, transcoderName]() {
-        bool success = false;
-
-        try {
-            Converter converter(processParam, encodeParam);
-            converter.set_transcoder(transcoderName.toStdString());
-            success = converter.convert_format(inputPath.toStdString(), outputPath.toStdString());
-        } catch (...) {
-            success = false;
-        }
-
-        // Remove observer and clean up
-        processParam->remove_observer(this);
-        delete processParam;
-
-        // Notify on main thread
-        QMetaObject::invokeMethod(this, [this, success]() {
-            OnConversionFinished(success);
-        }, Qt::QueuedConnection);
-    });
-
-    connect(thread, &QThread::finished, thread, &QThread::deleteLater);
-    thread->start();
-}
-
-void BatchQueueDialog::OnConversionFinished(bool success) {
-    if (currentItemIndex >= 0) {
-        BatchItem *item = batchQueue->GetItem(currentItemIndex);
-        if (item) {
-            if (success) {
-                item->SetProgress(100.0);
-                item->MarkAsFinished();
-                batchQueue->NotifyItemStatusChanged(currentItemIndex, BatchItemStatus::Finished);
-            } else {
-                item->MarkAsFailed("Conversion failed");
-                batchQueue->NotifyItemStatusChanged(currentItemIndex, BatchItemStatus::Failed);
-            }
-        }
+    QString message = tr("All items have been processed!");
+    if (runner->GetSkippedCount() > 0) {
+        message += "\n" + tr("%1 item(s) were skipped because their output is up to date.")
+                           .arg(runner->GetSkippedCount());
     }
-
-    currentItemIndex = -1;
-
-    // Process next item
-    ProcessNextItem();
-}
-
-void BatchQueueDialog::on_process_update(double progress) {
-    if (currentItemIndex >= 0) {
-        BatchItem *item = batchQueue->GetItem(currentItemIndex);
-        if (item) {
-            // Update on main thread
-            QMetaObject::invokeMethod(this, [this, progress]() {
-                if (currentItemIndex >= 0) {
-                    BatchItem *item = batchQueue->GetItem(currentItemIndex);
-                    if (item) {
-                        item->SetProgress(progress);
-                        batchQueue->NotifyItemProgressChanged(currentItemIndex, progress);
-                    }
-                }
-            }, Qt::QueuedConnection);
-        }
-    }
-}
-
-void BatchQueueDialog::on_time_update(double timeRequired) {
-    // Not used for now
-    Q_UNUSED(timeRequired);
+    QMessageBox::information(this, tr("Batch Processing Complete"), message);
 }
@@ -0,0 +1,230 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/batch_queue_model.h"
+#include <QFileInfo>
+
+BatchQueueModel::BatchQueueModel(BatchQueue *queue, QObject *parent)
+    : QAbstractTableModel(parent),
+      batchQueue(queue),
+      rows(queue->GetCount()),
+      dirtyFirst(-1),
+      dirtyLast(-1) {
+    flushTimer = new QTimer(this);
+    flushTimer->setSingleShot(true);
+    flushTimer->setInterval(FLUSH_INTERVAL_MS);
+    connect(flushTimer, &QTimer::timeout, this, &BatchQueueModel::FlushDirtyRows);
+
+    // Queued: the queue emits while holding its mutex
+    connect(batchQueue, &BatchQueue::ItemAdded, this, &BatchQueueModel::OnItemAdded, Qt::QueuedConnection);
+    connect(batchQueue, &BatchQueue::ItemsAdded, this, &BatchQueueModel::OnItemsAdded, Qt::QueuedConnection);
+    connect(batchQueue, &BatchQueue::ItemRemoved, this, &BatchQueueModel::Reload, Qt::QueuedConnection);
+    connect(batchQueue, &BatchQueue::ItemsRemoved, this, &BatchQueueModel::Reload, Qt::QueuedConnection);
+    connect(batchQueue, &BatchQueue::QueueCleared, this, &BatchQueueModel::Reload, Qt::QueuedConnection);
+    connect(batchQueue, &BatchQueue::ItemStatusChanged, this, &BatchQueueModel::OnItemChanged, Qt::QueuedConnection);
+    connect(batchQueue, &BatchQueue::ItemProgressChanged, this, &BatchQueueModel::OnItemChanged, Qt::QueuedConnection);
+}
+
+int BatchQueueModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : rows;
+}
+
+int BatchQueueModel::columnCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant BatchQueueModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid()) return QVariant();
+
+    // The view may lag behind the queue by one queued signal
+    BatchItem *item = batchQueue->GetItem(index.row());
+    if (!item) return QVariant();
+
+    if (role == Qt::DisplayRole) {
+        switch (index.column()) {
+            case StatusColumn:
+                return GetStatusIcon(item->GetStatus()) + " " + item->GetStatusString();
+            case InputColumn:
+                return QFileInfo(item->GetInputPath()).fileName();
+            case OutputColumn:
+                return QFileInfo(item->GetOutputPath()).fileName();
+            case ProgressColumn:
+                return GetProgressText(item);
+            case EtaColumn:
+                return GetEtaText(item);
+            case PriorityColumn:
+                return item->GetPriority();
+            default:
+                return QVariant();
+        }
+    } else if (role == Qt::ToolTipRole) {
+        if (index.column() == InputColumn) return item->GetInputPath();
+        if (index.column() == OutputColumn) return item->GetOutputPath();
+        if (index.column() == StatusColumn && !item->GetErrorMessage().isEmpty()) {
+            return item->GetErrorMessage();
+        }
+    } else if (role == Qt::ForegroundRole && index.column() == StatusColumn) {
+        return GetStatusColor(item->GetStatus());
+    }
+    return QVariant();
+}
+
+QVariant BatchQueueModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    switch (section) {
+        case StatusColumn:
+            return tr("Status");
+        case InputColumn:
+            return tr("Input File");
+        case OutputColumn:
+            return tr("Output File");
+        case ProgressColumn:
+            return tr("Progress");
+        case EtaColumn:
+            return tr("ETA");
+        case PriorityColumn:
+            return tr("Priority");
+        default:
+            return QVariant();
+    }
+}
+
+void BatchQueueModel::Reload() {
+    beginResetModel();
+    rows = batchQueue->GetCount();
+    dirtyFirst = dirtyLast = -1;
+    endResetModel();
+    emit RowsFlushed();
+}
+
+void BatchQueueModel::MarkRowDirty(int row) {
+    if (row < 0 || row >= rows) return;
+
+    dirtyFirst = dirtyFirst < 0 ? row : qMin(dirtyFirst, row);
+    dirtyLast = qMax(dirtyLast, row);
+    if (!flushTimer->isActive()) {
+        flushTimer->start();
+    }
+}
+
+void BatchQueueModel::OnItemAdded(int index) {
+    OnItemsAdded(index, 1);
+}
+
+void BatchQueueModel::OnItemsAdded(int firstIndex, int count) {
+    if (count <= 0) return;
+    if (firstIndex != rows) {
+        // Out of step with the queue, re-read everything
+        Reload();
+        return;
+    }
+    beginInsertRows(QModelIndex(), firstIndex, firstIndex + count - 1);
+    rows += count;
+    endInsertRows();
+    emit RowsFlushed();
+}
+
+void BatchQueueModel::OnItemChanged(int index) {
+    MarkRowDirty(index);
+}
+
+void BatchQueueModel::FlushDirtyRows() {
+    if (dirtyFirst >= 0) {
+        int last = qMin(dirtyLast, rows - 1);
+        if (dirtyFirst <= last) {
+            emit dataChanged(index(dirtyFirst, 0), index(last, ColumnCount - 1));
+        }
+        dirtyFirst = dirtyLast = -1;
+    }
+    emit RowsFlushed();
+}
+
+QString BatchQueueModel::GetProgressText(BatchItem *item) const {
+    switch (item->GetStatus()) {
+        case BatchItemStatus::Processing:
+            return QString::number(static_cast<int>(item->GetProgress())) + "%";
+        case BatchItemStatus::Finished:
+            return "100%";
+        case BatchItemStatus::Failed:
+            return "Failed";
+        default:
+            return "-";
+    }
+}
+
+QString BatchQueueModel::GetEtaText(BatchItem *item) const {
+    switch (item->GetStatus()) {
+        case BatchItemStatus::Waiting:
+            if (item->GetPredictedSeconds() >= 0) {
+                return "~" + FormatDuration(item->GetPredictedSeconds());
+            }
+            return item->IsEstimated() ? "-" : "...";
+        case BatchItemStatus::Processing:
+            if (item->GetRemainingSeconds() >= 0) {
+                return FormatDuration(item->GetRemainingSeconds());
+            }
+            return "-";
+        case BatchItemStatus::Finished:
+            // Show the time the item actually took
+            return FormatDuration(item->GetStartedTime().secsTo(item->GetFinishedTime()));
+        default:
+            return "-";
+    }
+}
+
+QString BatchQueueModel::FormatDuration(double seconds) {
+    qint64 total = static_cast<qint64>(seconds + 0.5);
+    qint64 hours = total / 3600;
+    qint64 minutes = (total % 3600) / 60;
+    qint64 secs = total % 60;
+    if (hours > 0) {
+        return QString("%1:%2:%3").arg(hours).arg(minutes, 2, 10, QChar('0')).arg(secs, 2, 10, QChar('0'));
+    }
+    return QString("%1:%2").arg(minutes).arg(secs, 2, 10, QChar('0'));
+}
+
+QString BatchQueueModel::GetStatusIcon(BatchItemStatus status) const {
+    switch (status) {
+        case BatchItemStatus::Waiting:
+            return "⏳";
+        case BatchItemStatus::Processing:
+            return "▶";
+        case BatchItemStatus::Finished:
+            return "✓";
+        case BatchItemStatus::Failed:
+            return "✗";
+        default:
+            return "?";
+    }
+}
+
+QColor BatchQueueModel::GetStatusColor(BatchItemStatus status) const {
+    switch (status) {
+        case BatchItemStatus::Waiting:
+            return QColor(128, 128, 128);  // Gray
+        case BatchItemStatus::Processing:
+            return QColor(0, 122, 204);    // Blue
+        case BatchItemStatus::Finished:
+            return QColor(0, 128, 0);      // Green
+        case BatchItemStatus::Failed:
+            return QColor(204, 0, 0);      // Red
+        default:
+            return QColor(0, 0, 0);        // Black
+    }
+}
@@ -0,0 +1,383 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/batch_runner.h"
+#include "../../common/include/process_parameter.h"
+#include "../../engine/include/converter.h"
+#include <QMetaObject>
+#include <QPointer>
+#include <QRunnable>
+#include <QThread>
+
+// Forwards the progress of one job to the runner on the main thread
+class BatchJobObserver : public ProcessObserver {
+public:
+    BatchJobObserver(BatchRunner *runner, BatchItem *item)
+        : runner(runner), item(item) {}
+
+    void on_process_update(double progress) override {
+        QPointer<BatchRunner> target = runner;
+        BatchItem *jobItem = item;
+        QMetaObject::invokeMethod(runner, [target, jobItem, progress]() {
+            if (target) target->OnJobProgress(jobItem, progress);
+        }, Qt::QueuedConnection);
+    }
+
+    void on_time_update(double timeRequired) override {
+        QPointer<BatchRunner> target = runner;
+        BatchItem *jobItem = item;
+        QMetaObject::invokeMethod(runner, [target, jobItem, timeRequired]() {
+            if (target) target->OnJobTimeRequired(jobItem, timeRequired);
+        }, Qt::QueuedConnection);
+    }
+
+private:
+    BatchRunner *runner;
+    BatchItem *item;
+};
+
+// One conversion on a pool worker. The Converter and transcoder are per
+// job, the worker thread and the process-wide codec state are reused
+class BatchJob : public QRunnable {
+public:
+    BatchJob(BatchRunner *runner, BatchItem *item, EncodeParameter *encodeParam,
+             std::shared_ptr<ProcessParameter> processParam,
+             BatchJobObserver *observer)
+        : runner(runner), item(item), encodeParam(encodeParam),
+          processParam(processParam), observer(observer), probed(false) {}
+
+    void run() override {
+        bool success = false;
+        std::string jobKey;
+
+        try {
+            Converter converter(processParam.get(), encodeParam);
+            converter.set_transcoder(transcoderName.toStdString());
+            if (probed) {
+                converter.set_probed_input(profile);
+            }
+            success = converter.convert_format(inputPath.toStdString(), outputPath.toStdString());
+            jobKey = converter.get_job_key();
+        } catch (...) {
+            success = false;
+        }
+
+        // Remove observer and clean up
+        processParam->remove_observer(observer);
+        delete observer;
+
+        // Notify on main thread
+        QPointer<BatchRunner> target = runner;
+        BatchItem *jobItem = item;
+        if (target) {
+            QMetaObject::invokeMethod(target, [target, jobItem, success, jobKey]() {
+                if (target) target->OnJobFinished(jobItem, success, jobKey);
+            }, Qt::QueuedConnection);
+        }
+    }
+
+    QString inputPath;
+    QString outputPath;
+    QString transcoderName;
+    bool probed;
+    JobProfile profile;
+
+private:
+    BatchRunner *runner;
+    BatchItem *item;
+    EncodeParameter *encodeParam;  // Owned by the item
+    std::shared_ptr<ProcessParameter> processParam;
+    BatchJobObserver *observer;
+};
+
+BatchRunner::BatchRunner(BatchQueue *queue, BatchScheduler *scheduler, QObject *parent)
+    : QObject(parent),
+      batchQueue(queue),
+      scheduler(scheduler),
+      running(false),
+      stallTimeout(DEFAULT_STALL_TIMEOUT),
+      manifest(nullptr),
+      skippedCount(0),
+      checkingUpToDate(false),
+      coresInUse(0),
+      memoryInUseMB(0) {
+    // Workers stay up between jobs and batches. BMF runs Python/numpy,
+    // which needs more than the default stack (512KB on macOS); the
+    // threads are shared, so every job gets 8 MB
+    workers.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+    workers.setExpiryTimeout(-1);
+    workers.setStackSize(8 * 1024 * 1024);
+
+    // An item held back until its cost was known may start now
+    connect(scheduler, &BatchScheduler::ItemProbed, this, [this]() { Dispatch(); });
+}
+
+BatchRunner::~BatchRunner() {
+    // The workers are joined with the pool; don't wait for whole conversions
+    Stop();
+    workers.waitForDone();
+}
+
+void BatchRunner::Start() {
+    if (!running) {
+        skippedCount = 0;
+    }
+    running = true;
+    if (SkipUpToDateItems()) {
+        return;
+    }
+    scheduler->ProbeWaitingItems();
+    Dispatch();
+}
+
+bool BatchRunner::SkipUpToDateItems() {
+    if (!manifest || checkingUpToDate) {
+        return checkingUpToDate;
+    }
+    // One pass before dispatching, so skipped items are neither probed nor
+    // ranked. Only items with a record need the file system, and that part
+    // runs off the UI thread: an unchanged input costs two stat() calls,
+    // a touched one a hash read.
+    struct Candidate {
+        qint64 itemId;
+        QString inputPath;
+        QString outputPath;
+        QString transcoderName;
+        EncodeParameter encodeParameter;
+        QJsonObject record;
+    };
+    QList<Candidate> candidates;
+    for (BatchItem *item : batchQueue->GetWaitingItems()) {
+        QJsonObject record = manifest->GetRecord(item->GetOutputPath());
+        if (record.isEmpty() || !item->GetEncodeParameter()) {
+            continue;
+        }
+        candidates.append({item->GetId(), item->GetInputPath(), item->GetOutputPath(),
+                           item->GetTranscoderName(), *item->GetEncodeParameter(), record});
+    }
+    if (candidates.isEmpty()) {
+        return false;
+    }
+
+    checkingUpToDate = true;
+    QPointer<BatchRunner> self = this;
+    QThread *thread = QThread::create([self, candidates]() {
+        QList<UpToDateItem> upToDate;
+        for (const Candidate &candidate : candidates) {
+            EncodeParameter encodeParam = candidate.encodeParameter;
+            QString paramsHash = BatchManifest::ParamsHash(candidate.transcoderName, &encodeParam);
+            double touchedMtime = -1.0;
+            if (BatchManifest::IsUpToDate(candidate.record, candidate.inputPath,
+                                          candidate.outputPath, paramsHash, &touchedMtime)) {
+                upToDate.append({candidate.itemId, candidate.outputPath, touchedMtime});
+            }
+        }
+        if (self) {
+            QMetaObject::invokeMethod(self, [self, upToDate]() {
+                if (self) self->OnUpToDateChecked(upToDate);
+            }, Qt::QueuedConnection);
+        }
+    });
+    connect(thread, &QThread::finished, thread, &QThread::deleteLater);
+    thread->start(QThread::LowPriority);
+    return true;
+}
+
+void BatchRunner::OnUpToDateChecked(const QList<UpToDateItem> &upToDate) {
+    checkingUpToDate = false;
+    for (const UpToDateItem &result : upToDate) {
+        // The next run need not hash the touched input again
+        if (manifest && result.touchedMtime >= 0) {
+            manifest->UpdateInputMtime(result.outputPath, result.touchedMtime);
+        }
+        // The item may have been removed or changed meanwhile
+        BatchItem *item = batchQueue->GetItemById(result.itemId);
+        if (!item || item->GetStatus() != BatchItemStatus::Waiting ||
+            item->GetOutputPath() != result.outputPath) {
+            continue;
+        }
+        item->MarkAsFinished();
+        item->SetErrorMessage(tr("Skipped, output is up to date"));
+        batchQueue->NotifyItemStatusChanged(batchQueue->GetItemIndex(item), BatchItemStatus::Finished);
+        skippedCount++;
+        emit ItemFinished(item, true);
+    }
+
+    if (running) {
+        scheduler->ProbeWaitingItems();
+        Dispatch();
+    }
+}
+
+void BatchRunner::Stop() {
+    running = false;
+    for (auto it = runningJobs.begin(); it != runningJobs.end(); ++it) {
+        it->requeue = true;
+        it->processParam->request_cancel();
+    }
+}
+
+void BatchRunner::CancelItem(BatchItem *item) {
+    auto it = runningJobs.find(item);
+    if (it != runningJobs.end()) {
+        it->processParam->request_cancel();
+    }
+}
+
+bool BatchRunner::IsRunning() const {
+    return running;
+}
+
+int BatchRunner::GetRunningCount() const {
+    return runningJobs.size();
+}
+
+void BatchRunner::SetStallTimeout(int seconds) {
+    stallTimeout = qMax(0, seconds);
+}
+
+int BatchRunner::GetStallTimeout() const {
+    return stallTimeout;
+}
+
+void BatchRunner::SetManifest(BatchManifest *manifest) {
+    this->manifest = manifest;
+}
+
+int BatchRunner::GetSkippedCount() const {
+    return skippedCount;
+}
+
+void BatchRunner::Dispatch() {
+    // Items may still turn out to be up to date
+    if (checkingUpToDate) {
+        return;
+    }
+    while (running) {
+        BatchItem *item = scheduler->NextAdmissible(coresInUse, memoryInUseMB, runningJobs.size());
+        if (!item) {
+            break;
+        }
+        StartJob(item);
+    }
+
+    if (running && runningJobs.isEmpty() && !batchQueue->HasWaitingItems()) {
+        running = false;
+        emit AllFinished();
+    }
+}
+
+void BatchRunner::StartJob(BatchItem *item) {
+    int index = batchQueue->GetItemIndex(item);
+
+    // Mark as processing
+    item->MarkAsProcessing();
+    batchQueue->NotifyItemStatusChanged(index, BatchItemStatus::Processing);
+
+    // Get encode parameters
+    EncodeParameter *encodeParam = item->GetEncodeParameter();
+    if (!encodeParam) {
+        item->MarkAsFailed("No encode parameters");
+        batchQueue->NotifyItemStatusChanged(index, BatchItemStatus::Failed);
+        emit ItemFinished(item, false);
+        return;
+    }
+
+    // Each job reports through its own process parameter, which also
+    // carries its cancel flag; the runner keeps it alive to cancel the job
+    std::shared_ptr<ProcessParameter> processParam = std::make_shared<ProcessParameter>();
+    processParam->set_stall_timeout(stallTimeout);
+    BatchJobObserver *observer = new BatchJobObserver(this, item);
+    processParam->add_observer(observer);
+
+    // Hold the codecs to the cores the scheduler reserved for the job
+    BatchItemCost cost = item->GetCost();
+    encodeParam->set_thread_count(cost.probed ? cost.cores : 0);
+    runningJobs.insert(item, {cost.cores, cost.memoryMB, processParam, false});
+    coresInUse += cost.cores;
+    memoryInUseMB += cost.memoryMB;
+
+    // Run the conversion on one of the runner's long-lived workers
+    BatchJob *job = new BatchJob(this, item, encodeParam, processParam, observer);
+    job->inputPath = item->GetInputPath();
+    job->outputPath = item->GetOutputPath();
+    job->transcoderName = item->GetTranscoderName();
+    // The scheduler probed the input already
+    job->probed = cost.probed;
+    job->profile = item->GetProfile();
+    job->setAutoDelete(true);
+
+    // The scheduler limits concurrency, the pool only must not queue
+    if (workers.maxThreadCount() < runningJobs.size()) {
+        workers.setMaxThreadCount(runningJobs.size());
+    }
+    workers.start(job);
+}
+
+void BatchRunner::OnJobProgress(BatchItem *item, double progress) {
+    if (!runningJobs.contains(item)) return;
+
+    item->SetProgress(progress);
+    batchQueue->NotifyItemProgressChanged(batchQueue->GetItemIndex(item), progress);
+}
+
+void BatchRunner::OnJobTimeRequired(BatchItem *item, double seconds) {
+    if (!runningJobs.contains(item)) return;
+
+    item->SetRemainingSeconds(seconds);
+    int index = batchQueue->GetItemIndex(item);
+    batchQueue->NotifyItemEstimateChanged(index);
+    batchQueue->NotifyItemProgressChanged(index, item->GetProgress());
+}
+
+void BatchRunner::OnJobFinished(BatchItem *item, bool success, const std::string &jobKey) {
+    RunningJob job = runningJobs.take(item);
+    coresInUse -= job.cores;
+    memoryInUseMB -= job.memoryMB;
+
+    int index = batchQueue->GetItemIndex(item);
+    if (index >= 0) {
+        if (success) {
+            item->SetProgress(100.0);
+            item->MarkAsFinished();
+            if (manifest) {
+                manifest->Record(item);
+            }
+            batchQueue->NotifyItemStatusChanged(index, BatchItemStatus::Finished);
+        } else if (job.requeue) {
+            item->MarkAsWaiting();
+            batchQueue->NotifyItemStatusChanged(index, BatchItemStatus::Waiting);
+        } else if (job.processParam->is_cancel_requested()) {
+            item->MarkAsFailed("Cancelled");
+            batchQueue->NotifyItemStatusChanged(index, BatchItemStatus::Failed);
+        } else if (job.processParam->is_stalled()) {
+            item->MarkAsFailed(QString("No progress for %1 s").arg(stallTimeout));
+            batchQueue->NotifyItemStatusChanged(index, BatchItemStatus::Failed);
+        } else {
+            item->MarkAsFailed("Conversion failed");
+            batchQueue->NotifyItemStatusChanged(index, BatchItemStatus::Failed);
+        }
+    }
+    emit ItemFinished(item, success);
+
+    // A finished job extended the throughput history of its shape
+    if (success) {
+        scheduler->RefreshEstimates(jobKey);
+    }
+
+    Dispatch();
+}
@@ -0,0 +1,265 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/batch_scheduler.h"
+#include <QMetaObject>
+#include <QPointer>
+#include <QSettings>
+#include <QThread>
+#include <cmath>
+#include <limits>
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
+
+BatchScheduler::BatchScheduler(BatchQueue *queue, QObject *parent)
+    : QObject(parent),
+      batchQueue(queue) {
+    QSettings settings("OpenConverter", "OpenConverter");
+    maxCores = settings.value("Scheduler/MaxCores", GetSystemCores()).toInt();
+    maxMemoryMB = settings.value("Scheduler/MaxMemoryMB", GetSystemMemoryMB() / 2).toLongLong();
+    shortestJobFirst = settings.value("Scheduler/ShortestJobFirst", false).toBool();
+}
+
+int BatchScheduler::GetMaxCores() const {
+    return maxCores;
+}
+
+void BatchScheduler::SetMaxCores(int cores) {
+    maxCores = qMax(1, cores);
+    QSettings("OpenConverter", "OpenConverter").setValue("Scheduler/MaxCores", maxCores);
+}
+
+qint64 BatchScheduler::GetMaxMemoryMB() const {
+    return maxMemoryMB;
+}
+
+void BatchScheduler::SetMaxMemoryMB(qint64 memoryMB) {
+    maxMemoryMB = qMax<qint64>(256, memoryMB);
+    QSettings("OpenConverter", "OpenConverter").setValue("Scheduler/MaxMemoryMB", maxMemoryMB);
+}
+
+bool BatchScheduler::IsShortestJobFirst() const {
+    return shortestJobFirst;
+}
+
+void BatchScheduler::SetShortestJobFirst(bool enabled) {
+    shortestJobFirst = enabled;
+    QSettings("OpenConverter", "OpenConverter").setValue("Scheduler/ShortestJobFirst", enabled);
+}
+
+int BatchScheduler::GetSystemCores() {
+    return qMax(1, QThread::idealThreadCount());
+}
+
+qint64 BatchScheduler::GetSystemMemoryMB() {
+#if defined(_WIN32)
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status)) {
+        return static_cast<qint64>(status.ullTotalPhys / (1024 * 1024));
+    }
+#elif defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && pageSize > 0) {
+        return static_cast<qint64>(pages) * pageSize / (1024 * 1024);
+    }
+#endif
+    return 8192;  // Unknown, assume 8 GB
+}
+
+BatchItemCost BatchScheduler::EstimateCost(const JobProfile &job, EncodeParameter *encodeParam) {
+    BatchItemCost cost;
+    cost.probed = true;
+    cost.mediaSeconds = job.mediaSeconds;
+    cost.width = encodeParam->get_width() > 0 ? encodeParam->get_width() : job.width;
+    cost.height = encodeParam->get_height() > 0 ? encodeParam->get_height() : job.height;
+
+    QString videoCodec = QString::fromStdString(encodeParam->get_video_codec_name());
+    double pixels = qMax(static_cast<double>(job.width) * job.height,
+                         static_cast<double>(cost.width) * cost.height);
+
+    // Stream copies and audio-only jobs are I/O bound
+    if (videoCodec == "copy" || pixels <= 0) {
+        cost.cores = 1;
+        cost.memoryMB = 128;
+        return cost;
+    }
+
+    // HEVC/AV1/VP9 encoders need roughly twice the work and keep more
+    // frames in flight than H.264 for the same picture size
+    bool heavyCodec = videoCodec.contains("265") || videoCodec.contains("hevc") ||
+                      videoCodec.contains("av1") || videoCodec.contains("aom") ||
+                      videoCodec.contains("vp9");
+    double codecWeight = heavyCodec ? 2.0 : 1.0;
+    int bufferedFrames = heavyCodec ? 80 : 50;
+
+    // About one core per 720p worth of pixels, more for heavy codecs
+    double cores = pixels / (1280.0 * 720.0) * codecWeight;
+    cost.cores = qBound(1, static_cast<int>(std::ceil(cores)), GetSystemCores());
+
+    // Decoder and encoder reference/lookahead frames in 8-bit 4:2:0
+    double frameBytes = pixels * 1.5;
+    cost.memoryMB = 128 + static_cast<qint64>(frameBytes * bufferedFrames / (1024 * 1024));
+
+    // AI upscaling runs a neural network on every frame
+    if (encodeParam->get_algo_mode() == AlgoMode::Upscale) {
+        cost.cores = GetSystemCores();
+        cost.memoryMB += 2048;
+    }
+    return cost;
+}
+
+void BatchScheduler::ProbeWaitingItems() {
+    // Collect the jobs on the UI thread; the probing happens off it
+    struct ProbeJob {
+        qint64 itemId;
+        std::string inputPath;
+        std::string transcoderName;
+        EncodeParameter encodeParameter;
+    };
+    QList<ProbeJob> jobs;
+    for (BatchItem *item : batchQueue->GetWaitingItems()) {
+        if (item->IsEstimated() || !item->GetEncodeParameter() ||
+            probingItems.contains(item->GetId())) {
+            continue;
+        }
+        probingItems.insert(item->GetId());
+        jobs.append({item->GetId(), item->GetInputPath().toStdString(),
+                     item->GetTranscoderName().toStdString(),
+                     *item->GetEncodeParameter()});
+    }
+    if (jobs.isEmpty()) {
+        return;
+    }
+
+    // The scheduler may be destroyed while the thread runs
+    QPointer<BatchScheduler> self = this;
+    QThread *thread = QThread::create([self, jobs]() {
+        for (const ProbeJob &job : jobs) {
+            EncodeParameter encodeParam = job.encodeParameter;
+            JobProfile profile = Converter::probe_job(job.inputPath, &encodeParam);
+            BatchItemCost cost = EstimateCost(profile, &encodeParam);
+            double seconds = Converter::predict_seconds(profile, &encodeParam,
+                                                        job.transcoderName);
+            qint64 itemId = job.itemId;
+            if (!self) {
+                return;
+            }
+            QMetaObject::invokeMethod(self, [self, itemId, profile, cost, seconds]() {
+                if (self) self->OnItemProbed(itemId, profile, cost, seconds);
+            }, Qt::QueuedConnection);
+        }
+    });
+    connect(thread, &QThread::finished, thread, &QThread::deleteLater);
+    thread->start(QThread::LowPriority);
+}
+
+void BatchScheduler::OnItemProbed(qint64 itemId, const JobProfile &profile,
+                                  const BatchItemCost &cost, double predictedSeconds) {
+    probingItems.remove(itemId);
+
+    // The item may have been removed from the queue while it was probed
+    BatchItem *item = batchQueue->GetItemById(itemId);
+    if (!item) {
+        return;
+    }
+    item->SetProfile(profile);
+    item->SetCost(cost);
+    item->SetPredictedSeconds(predictedSeconds);
+    batchQueue->NotifyItemEstimateChanged(batchQueue->GetItemIndex(item));
+    emit ItemProbed(item);
+}
+
+void BatchScheduler::RefreshEstimates(const std::string &jobKey) {
+    if (jobKey.empty()) {
+        return;
+    }
+    // A history lookup per item of the shape; the inputs are not opened
+    for (BatchItem *item : batchQueue->GetWaitingItems()) {
+        if (!item->GetCost().probed || !item->GetEncodeParameter()) {
+            continue;
+        }
+        JobProfile profile = item->GetProfile();
+        if (profile.jobKey != jobKey) {
+            continue;
+        }
+        double seconds = Converter::predict_seconds(profile, item->GetEncodeParameter(),
+                                                    item->GetTranscoderName().toStdString());
+        if (seconds == item->GetPredictedSeconds()) {
+            continue;
+        }
+        item->SetPredictedSeconds(seconds);
+        batchQueue->NotifyItemEstimateChanged(batchQueue->GetItemIndex(item));
+        emit EstimateChanged(item);
+    }
+}
+
+double BatchScheduler::GetExpectedSeconds(BatchItem *item) const {
+    if (item->GetPredictedSeconds() >= 0) {
+        return item->GetPredictedSeconds();
+    }
+    BatchItemCost cost = item->GetCost();
+    if (!cost.probed) {
+        return std::numeric_limits<double>::infinity();
+    }
+    // No history: assume realtime speed at 1080p, scaled by pixel count
+    double pixels = static_cast<double>(cost.width) * cost.height;
+    return cost.mediaSeconds * qMax(pixels / (1920.0 * 1080.0), 0.1);
+}
+
+bool BatchScheduler::RanksBefore(BatchItem *a, BatchItem *b) const {
+    if (a->GetPriority() != b->GetPriority()) {
+        return a->GetPriority() > b->GetPriority();
+    }
+    if (shortestJobFirst) {
+        return GetExpectedSeconds(a) < GetExpectedSeconds(b);
+    }
+    return false;  // Keep queue order
+}
+
+BatchItem* BatchScheduler::NextAdmissible(int coresInUse, qint64 memoryInUseMB,
+                                          int runningCount) const {
+    // The queue indexes waiting items by priority, then queue order; only
+    // shortest job first has to look at the rest of the top priority
+    BatchItem *top = batchQueue->GetNextWaitingItem();
+    if (top && shortestJobFirst) {
+        for (BatchItem *item : batchQueue->GetWaitingItems(top->GetPriority())) {
+            if (RanksBefore(item, top)) {
+                top = item;
+            }
+        }
+    }
+    if (!top || runningCount == 0) {
+        return top;
+    }
+
+    // An unprobed job would run on every core, wait for its cost; the
+    // runner dispatches again on ItemProbed
+    BatchItemCost cost = top->GetCost();
+    if (!cost.probed) {
+        return nullptr;
+    }
+    if (coresInUse + cost.cores > maxCores || memoryInUseMB + cost.memoryMB > maxMemoryMB) {
+        return nullptr;
+    }
+    return top;
+}
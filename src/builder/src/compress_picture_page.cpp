@@ -21,25 +21,17 @@
 #include "../include/transcoder_helper.h"
 #include "../../common/include/encode_parameter.h"
 #include "../../common/include/process_parameter.h"
-#include "../../engine/include/converter.h"
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QGridLayout>
 #include <QHBoxLayout>
 #include <QMessageBox>
 
-CompressPicturePage::CompressPicturePage(QWidget *parent) : BasePage(parent) {
-    encodeParameter = new EncodeParameter();
-    processParameter = new ProcessParameter();
-    converter = new Converter(processParameter, encodeParameter);
-
+CompressPicturePage::CompressPicturePage(QWidget *parent) : BasePage(parent), converterRunner(nullptr) {
     SetupUI();
 }
 
 CompressPicturePage::~CompressPicturePage() {
-    delete converter;
-    delete encodeParameter;
-    delete processParameter;
 }
 
 QString CompressPicturePage::GetPageTitle() const {
@@ -128,6 +120,15 @@ void CompressPicturePage::SetupUI() {
     connect(convertButton, &QPushButton::clicked, this, &CompressPicturePage::OnConvertClicked);
     mainLayout->addWidget(convertButton);
 
+    // Create conversion runner
+    converterRunner = new ConverterRunner(
+        nullptr, nullptr, convertButton,
+        tr("Converting..."), tr("Convert"),
+        tr("Success"), tr("Image compressed successfully!"),
+        tr("Error"), tr("Failed to compress image."),
+        this
+    );
+
     // Create batch mode helper
     batchModeHelper = new BatchModeHelper(
         inputFileSelector, batchOutputWidget, convertButton,
@@ -214,40 +215,15 @@ void CompressPicturePage::OnConvertClicked() {
         return;
     }
 
-    // Get encode parameters
-    EncodeParameter *tempParam = CreateEncodeParameter();
-    encodeParameter->set_qscale(tempParam->get_qscale());
-    if (tempParam->get_pixel_format() != "")
-        encodeParameter->set_pixel_format(tempParam->get_pixel_format());
-    if (tempParam->get_width() > 0)
-        encodeParameter->set_width(tempParam->get_width());
-    if (tempParam->get_height() > 0)
-        encodeParameter->set_height(tempParam->get_height());
-    delete tempParam;
+    EncodeParameter *encodeParam = CreateEncodeParameter();
+    ProcessParameter *processParam = new ProcessParameter();
 
     // Get current transcoder from main window
     QString transcoderName = TranscoderHelper::GetCurrentTranscoderName(this);
 
-    // Set transcoder
-    if (!converter->set_transcoder(transcoderName.toStdString())) {
-        QMessageBox::critical(this, "Error", "Failed to initialize transcoder.");
-        return;
-    }
-
-    // Perform conversion
-    convertButton->setEnabled(false);
-    convertButton->setText(tr("Converting..."));
-
-    bool result = converter->convert_format(inputPath.toStdString(), outputPath.toStdString());
-
-    convertButton->setEnabled(true);
-    convertButton->setText(tr("Convert"));
-
-    if (result) {
-        QMessageBox::information(this, "Success", "Image compressed successfully!");
-    } else {
-        QMessageBox::critical(this, "Error", "Failed to compress image.");
-    }
+    // Runs on the shared JobExecutor; the runner handles the button and
+    // message boxes
+    converterRunner->RunConversion(inputPath, outputPath, encodeParam, processParam, transcoderName);
 }
 
 void CompressPicturePage::OnFormatChanged(const QString &format) {
@@ -16,12 +16,11 @@
  */
 
 #include "../include/converter_runner.h"
+#include "../include/job_executor.h"
+#include "../../common/include/codec_capabilities.h"
 #include "../../common/include/encode_parameter.h"
 #include "../../common/include/process_parameter.h"
-#include "../../engine/include/converter.h"
 #include <QMessageBox>
-#include <QMetaObject>
-#include <QThread>
 
 ConverterRunner::ConverterRunner(QProgressBar *progressBar,
                                  QLabel *progressLabel,
@@ -43,11 +42,18 @@ ConverterRunner::ConverterRunner(QProgressBar *progressBar,
       successMessage(successMessage),
       errorTitle(errorTitle),
       errorMessage(errorMessage),
+      jobId(-1),
       customValidator(nullptr),
       customCompletionHandler(nullptr) {
+    JobExecutor *executor = JobExecutor::Instance();
+    connect(executor, &JobExecutor::JobProgress, this, &ConverterRunner::OnJobProgress);
+    connect(executor, &JobExecutor::JobTimeRequired, this, &ConverterRunner::OnJobTimeRequired);
+    connect(executor, &JobExecutor::JobFinished, this, &ConverterRunner::OnJobFinished);
 }
 
 ConverterRunner::~ConverterRunner() {
+    // Nobody is left to report to
+    Cancel();
 }
 
 bool ConverterRunner::RunConversion(const QString &inputPath,
@@ -72,57 +78,34 @@ bool ConverterRunner::RunConversion(const QString &inputPath,
         return false;
     }
 
-    // Register this runner as observer for progress updates
-    processParam->add_observer(this);
+    // Reject settings this FFmpeg build cannot encode up front, instead of
+    // failing after the input has been opened
+    std::string error;
+    if (!CodecCapabilities::shared().validate(encodeParam, outputPath.toStdString(), error)) {
+        QMessageBox::critical(qobject_cast<QWidget *>(parent()), errorTitle,
+                              QString("%1\n\n%2").arg(errorMessage, QString::fromStdString(error)));
+        delete encodeParam;
+        delete processParam;
+        return false;
+    }
 
     // Show progress UI
     ShowProgressUI();
     SetButtonRunning();
 
-    // Run conversion in a separate thread
-    QThread *thread = QThread::create([this, inputPath, outputPath, encodeParam, processParam, transcoderName]() {
-        // Create converter
-        Converter *converter = new Converter(processParam, encodeParam);
-        converter->set_transcoder(transcoderName.toStdString());
-
-        // Perform conversion
-        bool success = converter->convert_format(inputPath.toStdString(), outputPath.toStdString());
-
-        // Clean up converter
-        delete converter;
-
-        // Emit signal to notify completion (will be handled on main thread)
-        QMetaObject::invokeMethod(this, [this, success]() {
-            HideProgressUI();
-            SetButtonIdle();
-
-            // Call custom completion handler if set
-            if (customCompletionHandler) {
-                customCompletionHandler(success);
-            }
-
-            // Show completion message
-            ShowCompletionMessage(success);
-
-            // Emit signal
-            emit ConversionFinished(success);
-        }, Qt::QueuedConnection);
-
-        // Clean up parameters
-        delete encodeParam;
-        delete processParam;
-    });
+    jobId = JobExecutor::Instance()->Submit(inputPath, outputPath, encodeParam,
+                                            processParam, transcoderName);
+    return true;
+}
 
-    // Set larger stack size for BMF operations (Python/numpy needs more stack)
-    // Default is 512KB on macOS, increase to 8MB for AI processing
-    if (transcoderName == "BMF") {
-        thread->setStackSize(8 * 1024 * 1024);  // 8 MB
+void ConverterRunner::Cancel() {
+    if (jobId >= 0) {
+        JobExecutor::Instance()->Cancel(jobId);
     }
+}
 
-    connect(thread, &QThread::finished, thread, &QThread::deleteLater);
-    thread->start();
-
-    return true;
+bool ConverterRunner::IsRunning() const {
+    return jobId >= 0;
 }
 
 void ConverterRunner::SetValidator(std::function<bool()> validator) {
@@ -133,26 +116,43 @@ void ConverterRunner::SetCompletionHandler(std::function<void(bool)> handler) {
     customCompletionHandler = handler;
 }
 
-void ConverterRunner::on_process_update(double progress) {
-    // Use QMetaObject::invokeMethod to ensure UI updates happen on the main thread
-    QMetaObject::invokeMethod(this, [this, progress]() {
-        if (progressBar) {
-            progressBar->setValue(static_cast<int>(progress));
-        }
-    }, Qt::QueuedConnection);
+void ConverterRunner::OnJobProgress(int jobId, double progress) {
+    if (jobId != this->jobId) return;
+
+    if (progressBar) {
+        progressBar->setValue(static_cast<int>(progress));
+    }
 }
 
-void ConverterRunner::on_time_update(double timeRequired) {
-    // Use QMetaObject::invokeMethod to ensure UI updates happen on the main thread
-    QMetaObject::invokeMethod(this, [this, timeRequired]() {
-        if (progressLabel) {
-            int minutes = static_cast<int>(timeRequired) / 60;
-            int seconds = static_cast<int>(timeRequired) % 60;
-            progressLabel->setText(QString("Estimated time remaining: %1:%2")
-                                   .arg(minutes)
-                                   .arg(seconds, 2, 10, QChar('0')));
-        }
-    }, Qt::QueuedConnection);
+void ConverterRunner::OnJobTimeRequired(int jobId, double seconds) {
+    if (jobId != this->jobId) return;
+
+    if (progressLabel) {
+        int minutes = static_cast<int>(seconds) / 60;
+        int remainder = static_cast<int>(seconds) % 60;
+        progressLabel->setText(QString("Estimated time remaining: %1:%2")
+                               .arg(minutes)
+                               .arg(remainder, 2, 10, QChar('0')));
+    }
+}
+
+void ConverterRunner::OnJobFinished(int jobId, bool success) {
+    if (jobId != this->jobId) return;
+    this->jobId = -1;
+
+    HideProgressUI();
+    SetButtonIdle();
+
+    // Call custom completion handler if set
+    if (customCompletionHandler) {
+        customCompletionHandler(success);
+    }
+
+    // Show completion message
+    ShowCompletionMessage(success);
+
+    // Emit signal
+    emit ConversionFinished(success);
 }
 
 void ConverterRunner::ShowProgressUI() {
@@ -21,25 +21,17 @@
 #include "../include/transcoder_helper.h"
 #include "../../common/include/encode_parameter.h"
 #include "../../common/include/process_parameter.h"
-#include "../../engine/include/converter.h"
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QGridLayout>
 #include <QHBoxLayout>
 #include <QMessageBox>
 
-CreateGifPage::CreateGifPage(QWidget *parent) : BasePage(parent) {
-    encodeParameter = new EncodeParameter();
-    processParameter = new ProcessParameter();
-    converter = new Converter(processParameter, encodeParameter);
-
+CreateGifPage::CreateGifPage(QWidget *parent) : BasePage(parent), converterRunner(nullptr) {
     SetupUI();
 }
 
 CreateGifPage::~CreateGifPage() {
-    delete converter;
-    delete encodeParameter;
-    delete processParameter;
 }
 
 QString CreateGifPage::GetPageTitle() const {
@@ -119,6 +111,15 @@ void CreateGifPage::SetupUI() {
     connect(convertButton, &QPushButton::clicked, this, &CreateGifPage::OnConvertClicked);
     mainLayout->addWidget(convertButton);
 
+    // Create conversion runner
+    converterRunner = new ConverterRunner(
+        nullptr, nullptr, convertButton,
+        tr("Creating GIF..."), tr("Create GIF"),
+        tr("Success"), tr("GIF created successfully!"),
+        tr("Error"), tr("Failed to create GIF."),
+        this
+    );
+
     // Create batch mode helper
     batchModeHelper = new BatchModeHelper(
         inputFileSelector, batchOutputWidget, convertButton,
@@ -199,37 +200,15 @@ void CreateGifPage::OnConvertClicked() {
         return;
     }
 
-    // Get encode parameters
-    EncodeParameter *tempParam = CreateEncodeParameter();
-    if (tempParam->get_width() > 0)
-        encodeParameter->set_width(tempParam->get_width());
-    if (tempParam->get_height() > 0)
-        encodeParameter->set_height(tempParam->get_height());
-    delete tempParam;
+    EncodeParameter *encodeParam = CreateEncodeParameter();
+    ProcessParameter *processParam = new ProcessParameter();
 
     // Get current transcoder from main window
     QString transcoderName = TranscoderHelper::GetCurrentTranscoderName(this);
 
-    // Set transcoder
-    if (!converter->set_transcoder(transcoderName.toStdString())) {
-        QMessageBox::critical(this, "Error", "Failed to initialize transcoder.");
-        return;
-    }
-
-    // Perform conversion
-    convertButton->setEnabled(false);
-    convertButton->setText(tr("Creating GIF..."));
-
-    bool result = converter->convert_format(inputPath.toStdString(), outputPath.toStdString());
-
-    convertButton->setEnabled(true);
-    convertButton->setText(tr("Create GIF"));
-
-    if (result) {
-        QMessageBox::information(this, "Success", "GIF created successfully!");
-    } else {
-        QMessageBox::critical(this, "Error", "Failed to create GIF.");
-    }
+    // Runs on the shared JobExecutor; the runner handles the button and
+    // message boxes
+    converterRunner->RunConversion(inputPath, outputPath, encodeParam, processParam, transcoderName);
 }
 
 void CreateGifPage::OnFpsChanged(int value) {
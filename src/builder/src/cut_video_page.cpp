@@ -35,7 +35,7 @@ extern "C" {
 }
 
 CutVideoPage::CutVideoPage(QWidget *parent)
-    : BasePage(parent), converterRunner(nullptr), videoDuration(0), startTime(0), endTime(0), isSliderPressed(false) {
+    : BasePage(parent), videoPlayer(nullptr), thumbnailStrip(nullptr), waveformWidget(nullptr), converterRunner(nullptr), videoDuration(0), startTime(0), endTime(0), isSliderPressed(false) {
     SetupUI();
 }
 
@@ -107,6 +107,7 @@ void CutVideoPage::SetupUI() {
     videoPlayer->setMinimumHeight(300);
     connect(videoPlayer, &SimpleVideoPlayer::PositionChanged, this, &CutVideoPage::OnVideoPlayerPositionChanged);
     connect(videoPlayer, &SimpleVideoPlayer::DurationChanged, this, &CutVideoPage::OnVideoPlayerDurationChanged);
+    connect(videoPlayer, &SimpleVideoPlayer::KeyframeIndexReady, this, &CutVideoPage::UpdateDurationLabel);
 
     playerLayout->addWidget(videoPlayer);
 
@@ -137,6 +138,17 @@ void CutVideoPage::SetupUI() {
     controlsLayout->addWidget(endTimeDisplayLabel);
 
     playerLayout->addLayout(controlsLayout);
+
+    // Keyframe thumbnails across the timeline, click or drag to seek
+    thumbnailStrip = new ThumbnailStrip(playerGroupBox);
+    connect(thumbnailStrip, &ThumbnailStrip::PositionClicked, videoPlayer, &SimpleVideoPlayer::Seek);
+    playerLayout->addWidget(thumbnailStrip);
+
+    // Audio waveform for cutting on sound, hidden for files without audio
+    waveformWidget = new WaveformWidget(playerGroupBox);
+    connect(waveformWidget, &WaveformWidget::PositionClicked, videoPlayer, &SimpleVideoPlayer::Seek);
+    playerLayout->addWidget(waveformWidget);
+
     mainLayout->addWidget(playerGroupBox);
 
     // Time Selection Section
@@ -278,6 +290,8 @@ void CutVideoPage::LoadVideo(const QString &filePath) {
             qint64 durationMs = (fmtCtx->duration * 1000) / AV_TIME_BASE;
             videoDuration = durationMs;
             timelineSlider->setRange(0, durationMs);
+            thumbnailStrip->SetDuration(durationMs);
+            waveformWidget->SetDuration(durationMs);
             endTimeDisplayLabel->setText(FormatTime(durationMs));
 
             // Set default end time to video duration
@@ -296,12 +310,16 @@ void CutVideoPage::LoadVideo(const QString &filePath) {
     // The first frame decode is now deferred via QTimer::singleSho
     if (videoPlayer->LoadVideo(filePath)) {
         // Video loaded successfully
+        thumbnailStrip->LoadVideo(filePath);
+        waveformWidget->LoadAudio(filePath);
         playPauseButton->setEnabled(true);
         setStartButton->setEnabled(true);
         setEndButton->setEnabled(true);
         timelineSlider->setEnabled(true);
         cutButton->setEnabled(true);
     } else {
+        thumbnailStrip->Clear();
+        waveformWidget->Clear();
         QMessageBox::warning(this, tr("Error"), tr("Failed to load video file."));
     }
 }
@@ -321,11 +339,15 @@ void CutVideoPage::OnVideoPlayerPositionChanged(qint64 position) {
         timelineSlider->setValue(position);
     }
     currentTimeLabel->setText(FormatTime(position));
+    thumbnailStrip->SetPosition(position);
+    waveformWidget->SetPosition(position);
 }
 
 void CutVideoPage::OnVideoPlayerDurationChanged(qint64 duration) {
     videoDuration = duration;
     timelineSlider->setRange(0, duration);
+    thumbnailStrip->SetDuration(duration);
+    waveformWidget->SetDuration(duration);
     endTimeDisplayLabel->setText(FormatTime(duration));
 
     // Set default end time to video duration
@@ -351,6 +373,9 @@ void CutVideoPage::OnTimelineSliderReleased() {
 
 void CutVideoPage::OnTimelineSliderMoved(int position) {
     currentTimeLabel->setText(FormatTime(position));
+    // Scrub while dragging; the player coalesces seeks that arrive faster
+    // than it decodes
+    videoPlayer->Seek(position);
 }
 
 void CutVideoPage::OnStartTimeChanged(const QTime &time) {
@@ -382,11 +407,22 @@ void CutVideoPage::OnSetEndClicked() {
 void CutVideoPage::UpdateDurationLabel() {
     // Update total duration value
     totalDurationValueLabel->setText(FormatTime(videoDuration));
+    if (thumbnailStrip && waveformWidget) {
+        thumbnailStrip->SetSelection(startTime, endTime);
+        waveformWidget->SetSelection(startTime, endTime);
+    }
 
     // Update cut duration value
     if (endTime > startTime) {
         qint64 duration = endTime - startTime;
-        cutDurationValueLabel->setText(FormatTime(duration));
+        QString text = FormatTime(duration);
+
+        // Stream copy cuts start at the keyframe before the start time
+        qint64 keyframe = videoPlayer ? videoPlayer->KeyframeAtOrBefore(startTime) : -1;
+        if (keyframe >= 0 && keyframe < startTime) {
+            text += tr(" (starts at keyframe %1)").arg(FormatTime(keyframe));
+        }
+        cutDurationValueLabel->setText(text);
     } else {
         cutDurationValueLabel->setText(tr("Invalid (end time must be after start time)"));
     }
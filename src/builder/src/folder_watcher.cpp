@@ -0,0 +1,319 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/folder_watcher.h"
+#include "../include/batch_journal.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QJsonDocument>
+#include <QSocketNotifier>
+#include <QTimer>
+
+#if defined(Q_OS_LINUX)
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+const char *FolderWatcher::PRESET_FILE_NAME = ".openconverter-preset";
+
+FolderWatcher::FolderWatcher(BatchQueue *queue, QObject *parent)
+    : QObject(parent),
+      batchQueue(queue),
+      checkTimer(new QTimer(this)),
+      debounceMs(1000),
+      inotifyFd(-1),
+      notifier(nullptr),
+      fsWatcher(nullptr) {
+    checkTimer->setInterval(250);
+    connect(checkTimer, &QTimer::timeout, this, &FolderWatcher::CheckPending);
+
+#if defined(Q_OS_LINUX)
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd >= 0) {
+        notifier = new QSocketNotifier(inotifyFd, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, &FolderWatcher::OnInotifyReadable);
+    } else {
+        qWarning() << "inotify unavailable, falling back to QFileSystemWatcher";
+    }
+#endif
+    if (inotifyFd < 0) {
+        fsWatcher = new QFileSystemWatcher(this);
+        connect(fsWatcher, &QFileSystemWatcher::directoryChanged, this, &FolderWatcher::OnDirectoryChanged);
+    }
+}
+
+FolderWatcher::~FolderWatcher() {
+#if defined(Q_OS_LINUX)
+    if (inotifyFd >= 0) {
+        // Closing the descriptor drops every watch
+        delete notifier;
+        close(inotifyFd);
+    }
+#endif
+}
+
+bool FolderWatcher::AddFolder(const QString &path) {
+    QString folder = QFileInfo(path).absoluteFilePath();
+    if (!QFileInfo(folder).isDir()) {
+        qWarning() << "Not a folder:" << folder;
+        return false;
+    }
+    if (presets.contains(folder)) {
+        return true;
+    }
+
+#if defined(Q_OS_LINUX)
+    if (inotifyFd >= 0) {
+        QByteArray native = QFile::encodeName(folder);
+        int wd = inotify_add_watch(inotifyFd, native.constData(),
+                                   IN_CLOSE_WRITE | IN_MOVED_TO | IN_MODIFY |
+                                   IN_DELETE_SELF | IN_MOVE_SELF);
+        if (wd < 0) {
+            qWarning() << "Cannot watch" << folder;
+            return false;
+        }
+        watchFolders.insert(wd, folder);
+    }
+#endif
+    if (fsWatcher) {
+        if (!fsWatcher->addPath(folder)) {
+            qWarning() << "Cannot watch" << folder;
+            return false;
+        }
+        knownFiles.insert(folder, ListFiles(folder));
+    }
+
+    presets.insert(folder, LoadPreset(folder));
+    return true;
+}
+
+void FolderWatcher::RemoveFolder(const QString &path) {
+    QString folder = QFileInfo(path).absoluteFilePath();
+    presets.remove(folder);
+#if defined(Q_OS_LINUX)
+    for (auto it = watchFolders.begin(); it != watchFolders.end(); ++it) {
+        if (it.value() == folder) {
+            inotify_rm_watch(inotifyFd, it.key());
+            watchFolders.erase(it);
+            break;
+        }
+    }
+#endif
+    if (fsWatcher) {
+        fsWatcher->removePath(folder);
+        knownFiles.remove(folder);
+    }
+    for (auto it = pending.begin(); it != pending.end();) {
+        if (it->folder == folder) {
+            it = pending.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+QStringList FolderWatcher::GetFolders() const {
+    return presets.keys();
+}
+
+bool FolderWatcher::IsWatching() const {
+    return !presets.isEmpty();
+}
+
+void FolderWatcher::SetDebounceMs(int ms) {
+    debounceMs = qMax(0, ms);
+}
+
+void FolderWatcher::OnInotifyReadable() {
+#if defined(Q_OS_LINUX)
+    alignas(struct inotify_event) char buffer[16 * 1024];
+    for (;;) {
+        ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;  // EAGAIN: drained
+        }
+        for (char *p = buffer; p < buffer + length;) {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + event->len;
+
+            QString folder = watchFolders.value(event->wd);
+            if (folder.isEmpty()) {
+                continue;
+            }
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                qWarning() << "Watched folder went away:" << folder;
+                RemoveFolder(folder);
+                continue;
+            }
+            if (event->len == 0 || (event->mask & IN_ISDIR)) {
+                continue;
+            }
+
+            QString fileName = QFile::decodeName(event->name);
+            if (event->mask & IN_MODIFY) {
+                // Still being written, only postpone a file already seen
+                auto it = pending.find(QDir(folder).filePath(fileName));
+                if (it != pending.end()) {
+                    it->lastChangeMs = QDateTime::currentMSecsSinceEpoch();
+                }
+                continue;
+            }
+            NoteFile(folder, fileName);
+        }
+    }
+#endif
+}
+
+void FolderWatcher::OnDirectoryChanged(const QString &folder) {
+    if (!presets.contains(folder)) {
+        return;
+    }
+    QSet<QString> files = ListFiles(folder);
+    QSet<QString> &known = knownFiles[folder];
+    for (const QString &fileName : files) {
+        if (!known.contains(fileName)) {
+            NoteFile(folder, fileName);
+        }
+    }
+    // Files still being written are refreshed by the debounce check
+    known = files;
+}
+
+void FolderWatcher::NoteFile(const QString &folder, const QString &fileName) {
+    if (fileName == PRESET_FILE_NAME) {
+        presets[folder] = LoadPreset(folder);
+        return;
+    }
+    if (!IsCandidate(fileName)) {
+        return;
+    }
+
+    // Queued after one quiet interval if nothing changes in between
+    QString path = QDir(folder).filePath(fileName);
+    QFileInfo info(path);
+    PendingFile &file = pending[path];
+    file.folder = folder;
+    file.size = info.size();
+    file.modified = info.lastModified();
+    file.lastChangeMs = QDateTime::currentMSecsSinceEpoch();
+    if (!checkTimer->isActive()) {
+        checkTimer->start();
+    }
+}
+
+void FolderWatcher::CheckPending() {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (auto it = pending.begin(); it != pending.end();) {
+        if (now - it->lastChangeMs < debounceMs) {
+            ++it;
+            continue;
+        }
+
+        QFileInfo info(it.key());
+        if (!info.isFile()) {
+            it = pending.erase(it);
+            continue;
+        }
+        // Queue only once size and time have settled over a full interval
+        if (info.size() != it->size || info.lastModified() != it->modified) {
+            it->size = info.size();
+            it->modified = info.lastModified();
+            it->lastChangeMs = now;
+            ++it;
+            continue;
+        }
+
+        PendingFile file = it.value();
+        QString path = it.key();
+        it = pending.erase(it);
+        Enqueue(path, file);
+    }
+    if (pending.isEmpty()) {
+        checkTimer->stop();
+    }
+}
+
+void FolderWatcher::Enqueue(const QString &path, const PendingFile &file) {
+    auto presetIt = presets.constFind(file.folder);
+    if (presetIt == presets.constEnd()) {
+        return;
+    }
+    const FolderPreset &preset = presetIt.value();
+
+    QDir outputDir(QDir(file.folder).filePath(preset.outputDir));
+    if (!outputDir.exists() && !outputDir.mkpath(".")) {
+        qWarning() << "Cannot create output folder" << outputDir.path();
+        return;
+    }
+    QString outputPath = outputDir.filePath(QFileInfo(path).completeBaseName() + "." + preset.format);
+
+    BatchItem *item = new BatchItem(path, outputPath);
+    item->SetTranscoderName(preset.transcoder);
+    item->SetOwnedEncodeParameter(BatchJournal::EncodeParameterFromJson(preset.param));
+    item->SetPriority(preset.priority);
+    batchQueue->AddItem(item);
+    emit ItemEnqueued(item);
+}
+
+bool FolderWatcher::IsCandidate(const QString &fileName) const {
+    static const QStringList partialSuffixes = {
+        "part", "partial", "tmp", "temp", "crdownload", "download", "!qb"
+    };
+    if (fileName.startsWith('.') || fileName.endsWith('~')) {
+        return false;
+    }
+    return !partialSuffixes.contains(QFileInfo(fileName).suffix().toLower());
+}
+
+FolderWatcher::FolderPreset FolderWatcher::LoadPreset(const QString &folder) {
+    FolderPreset preset;
+    QJsonObject object;
+    QFile file(QDir(folder).filePath(PRESET_FILE_NAME));
+    if (file.open(QIODevice::ReadOnly)) {
+        QJsonParseError parseError;
+        QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+        if (parseError.error == QJsonParseError::NoError && document.isObject()) {
+            object = document.object();
+        } else {
+            qWarning() << "Ignoring invalid preset" << file.fileName() << parseError.errorString();
+        }
+    }
+
+    preset.outputDir = object.value("outputDir").toString("converted");
+    // Outputs written into the watched folder would be queued again
+    if (QDir::cleanPath(QDir(folder).filePath(preset.outputDir)) == QDir::cleanPath(folder)) {
+        qWarning() << "outputDir of" << folder << "is the folder itself, using converted/";
+        preset.outputDir = "converted";
+    }
+    preset.format = object.value("format").toString("mp4");
+    preset.transcoder = object.value("transcoder").toString("FFMPEG").toUpper();
+    preset.priority = object.value("priority").toInt();
+    preset.param = object.value("param").toObject();
+    return preset;
+}
+
+QSet<QString> FolderWatcher::ListFiles(const QString &folder) {
+    QSet<QString> files;
+    for (const QString &name : QDir(folder).entryList(QDir::Files | QDir::Hidden)) {
+        files.insert(name);
+    }
+    return files;
+}
@@ -25,6 +25,8 @@
 
 InfoViewPage::InfoViewPage(QWidget *parent) : BasePage(parent) {
     info = new Info();
+    // Codec names and sizes are in the headers of most files
+    info->set_fast_probe(true);
     SetupUI();
 }
 
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/job_executor.h"
+#include "../../common/include/encode_parameter.h"
+#include "../../common/include/process_parameter.h"
+#include "../../engine/include/converter.h"
+#include <QMetaObject>
+#include <QPointer>
+#include <QRunnable>
+#include <QThread>
+
+JobExecutor *JobExecutor::instance = nullptr;
+QMutex JobExecutor::instanceMutex;
+
+// Forwards the progress of one job to the executor on the main thread
+class JobObserver : public ProcessObserver {
+public:
+    JobObserver(JobExecutor *executor, int jobId)
+        : executor(executor), jobId(jobId) {}
+
+    void on_process_update(double progress) override {
+        QPointer<JobExecutor> target = executor;
+        int id = jobId;
+        QMetaObject::invokeMethod(executor, [target, id, progress]() {
+            if (target) emit target->JobProgress(id, progress);
+        }, Qt::QueuedConnection);
+    }
+
+    void on_time_update(double timeRequired) override {
+        QPointer<JobExecutor> target = executor;
+        int id = jobId;
+        QMetaObject::invokeMethod(executor, [target, id, timeRequired]() {
+            if (target) emit target->JobTimeRequired(id, timeRequired);
+        }, Qt::QueuedConnection);
+    }
+
+private:
+    JobExecutor *executor;
+    int jobId;
+};
+
+// One conversion on a pool thread; owns the encode parameters
+class ConversionJob : public QRunnable {
+public:
+    ConversionJob(JobExecutor *executor, int jobId,
+                  const QString &inputPath, const QString &outputPath,
+                  EncodeParameter *encodeParam,
+                  std::shared_ptr<ProcessParameter> processParam,
+                  const QString &transcoderName)
+        : executor(executor), jobId(jobId),
+          inputPath(inputPath), outputPath(outputPath),
+          encodeParam(encodeParam), processParam(processParam),
+          transcoderName(transcoderName) {}
+
+    ~ConversionJob() override {
+        delete encodeParam;
+    }
+
+    void run() override {
+        bool success = false;
+
+        // Cancelled while still queued
+        if (!processParam->is_cancel_requested()) {
+            JobObserver observer(executor, jobId);
+            processParam->add_observer(&observer);
+            try {
+                Converter converter(processParam.get(), encodeParam);
+                if (converter.set_transcoder(transcoderName.toStdString())) {
+                    success = converter.convert_format(inputPath.toStdString(),
+                                                       outputPath.toStdString());
+                }
+            } catch (...) {
+                success = false;
+            }
+            processParam->remove_observer(&observer);
+        }
+
+        QPointer<JobExecutor> target = executor;
+        int id = jobId;
+        QMetaObject::invokeMethod(executor, [target, id, success]() {
+            if (target) target->OnJobFinished(id, success);
+        }, Qt::QueuedConnection);
+    }
+
+private:
+    JobExecutor *executor;
+    int jobId;
+    QString inputPath;
+    QString outputPath;
+    EncodeParameter *encodeParam;
+    std::shared_ptr<ProcessParameter> processParam;
+    QString transcoderName;
+};
+
+JobExecutor::JobExecutor() : QObject(nullptr), nextJobId(1) {
+    pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount() / 2));
+    // BMF runs Python/numpy, which needs more than the default stack
+    // (512KB on macOS); pool threads are shared, so every job gets 8 MB
+    pool.setStackSize(8 * 1024 * 1024);
+}
+
+JobExecutor* JobExecutor::Instance() {
+    if (instance == nullptr) {
+        QMutexLocker locker(&instanceMutex);
+        if (instance == nullptr) {
+            instance = new JobExecutor();
+        }
+    }
+    return instance;
+}
+
+int JobExecutor::Submit(const QString &inputPath,
+                        const QString &outputPath,
+                        EncodeParameter *encodeParam,
+                        ProcessParameter *processParam,
+                        const QString &transcoderName) {
+    int jobId = nextJobId++;
+    std::shared_ptr<ProcessParameter> process(processParam);
+    jobs.insert(jobId, process);
+
+    ConversionJob *job = new ConversionJob(this, jobId, inputPath, outputPath,
+                                           encodeParam, process, transcoderName);
+    job->setAutoDelete(true);
+    pool.start(job);
+    return jobId;
+}
+
+void JobExecutor::Cancel(int jobId) {
+    auto it = jobs.find(jobId);
+    if (it != jobs.end()) {
+        (*it)->request_cancel();
+    }
+}
+
+void JobExecutor::CancelAll() {
+    for (auto it = jobs.begin(); it != jobs.end(); ++it) {
+        (*it)->request_cancel();
+    }
+}
+
+bool JobExecutor::IsRunning(int jobId) const {
+    return jobs.contains(jobId);
+}
+
+int JobExecutor::GetJobCount() const {
+    return jobs.size();
+}
+
+void JobExecutor::OnJobFinished(int jobId, bool success) {
+    jobs.remove(jobId);
+    emit JobFinished(jobId, success);
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/job_server.h"
+#include "../include/batch_journal.h"
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+
+const char *JobServer::DEFAULT_NAME = "openconverter";
+
+JobServer::JobServer(QObject *parent)
+    : QObject(parent),
+      server(new QLocalServer(this)),
+      batchQueue(BatchQueue::Instance()) {
+    scheduler = new BatchScheduler(batchQueue, this);
+    runner = new BatchRunner(batchQueue, scheduler, this);
+
+    // Other users must not submit jobs that write as this user
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+
+    connect(server, &QLocalServer::newConnection, this, &JobServer::OnNewConnection);
+    connect(batchQueue, &BatchQueue::ItemProgressChanged, this, &JobServer::OnItemProgressChanged);
+    connect(runner, &BatchRunner::ItemFinished, this, &JobServer::OnItemFinished);
+}
+
+JobServer::~JobServer() {
+    runner->Stop();
+}
+
+bool JobServer::Listen(const QString &name) {
+    QString socketName = name.isEmpty() ? QString(DEFAULT_NAME) : name;
+    // A socket file left behind by a crashed server would make listen() fail
+    QLocalServer::removeServer(socketName);
+    return server->listen(socketName);
+}
+
+QString JobServer::GetServerPath() const {
+    return server->fullServerName();
+}
+
+QString JobServer::GetErrorString() const {
+    return server->errorString();
+}
+
+void JobServer::OnNewConnection() {
+    while (QLocalSocket *socket = server->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::readyRead, this, &JobServer::OnReadyRead);
+        connect(socket, &QLocalSocket::disconnected, this, &JobServer::OnDisconnected);
+    }
+}
+
+void JobServer::OnReadyRead() {
+    QLocalSocket *socket = qobject_cast<QLocalSocket*>(sender());
+    if (!socket) return;
+
+    while (socket->canReadLine()) {
+        QByteArray line = socket->readLine().trimmed();
+        if (line.isEmpty()) continue;
+
+        QJsonParseError parseError;
+        QJsonDocument document = QJsonDocument::fromJson(line, &parseError);
+        if (parseError.error != QJsonParseError::NoError || !document.isObject()) {
+            SendError(socket, "Invalid JSON request");
+            continue;
+        }
+        HandleRequest(socket, document.object());
+    }
+}
+
+void JobServer::OnDisconnected() {
+    QLocalSocket *socket = qobject_cast<QLocalSocket*>(sender());
+    if (!socket) return;
+    // Jobs keep running, their events are dropped
+    socket->deleteLater();
+}
+
+void JobServer::HandleRequest(QLocalSocket *socket, const QJsonObject &request) {
+    QString op = request.value("op").toString();
+    if (op == "submit") {
+        Submit(socket, request);
+    } else if (op == "cancel") {
+        Cancel(socket, request);
+    } else if (op == "status") {
+        SendStatus(socket);
+    } else {
+        SendError(socket, QString("Unknown op '%1'").arg(op));
+    }
+}
+
+void JobServer::Submit(QLocalSocket *socket, const QJsonObject &request) {
+    QString inputPath = request.value("input").toString();
+    QString outputPath = request.value("output").toString();
+    if (inputPath.isEmpty() || outputPath.isEmpty()) {
+        SendError(socket, "Input and output must be specified");
+        return;
+    }
+    if (!QFileInfo(inputPath).isFile()) {
+        SendError(socket, QString("Input file not found: %1").arg(inputPath));
+        return;
+    }
+
+    BatchItem *item = new BatchItem(inputPath, outputPath);
+    item->SetTranscoderName(request.value("transcoder").toString("FFMPEG").toUpper());
+    item->SetOwnedEncodeParameter(
+        BatchJournal::EncodeParameterFromJson(request.value("param").toObject()));
+    item->SetPriority(request.value("priority").toInt());
+    batchQueue->AddItem(item);
+
+    qint64 id = item->GetId();
+    submitters.insert(id, socket);
+    Send(socket, QJsonObject{{"event", "accepted"}, {"id", id}});
+
+    // Probes the new item and starts it if the budgets allow
+    runner->Start();
+}
+
+void JobServer::Cancel(QLocalSocket *socket, const QJsonObject &request) {
+    qint64 id = static_cast<qint64>(request.value("id").toDouble());
+    for (BatchItem *item : batchQueue->GetAllItems()) {
+        if (item->GetId() != id) continue;
+
+        if (item->GetStatus() == BatchItemStatus::Processing) {
+            // Reported through OnItemFinished once the job has stopped
+            runner->CancelItem(item);
+        } else {
+            submitters.remove(id);
+            lastPercent.remove(id);
+            batchQueue->RemoveItem(batchQueue->GetItemIndex(item));
+            Send(socket, QJsonObject{{"event", "finished"}, {"id", id},
+                                     {"success", false}, {"error", "Cancelled"}});
+        }
+        return;
+    }
+    SendError(socket, QString("No job with id %1").arg(id));
+}
+
+void JobServer::SendStatus(QLocalSocket *socket) {
+    QJsonObject event;
+    event.insert("event", "status");
+    event.insert("waiting", batchQueue->GetWaitingCount());
+    event.insert("processing", batchQueue->GetProcessingCount());
+    event.insert("running", runner->IsRunning());
+    Send(socket, event);
+}
+
+void JobServer::OnItemProgressChanged(int index, double progress) {
+    BatchItem *item = batchQueue->GetItem(index);
+    if (!item) return;
+
+    qint64 id = item->GetId();
+    QPointer<QLocalSocket> socket = submitters.value(id);
+    if (!socket) return;
+
+    // One event per percent is plenty for a remote client
+    int percent = static_cast<int>(progress);
+    auto last = lastPercent.find(id);
+    if (last != lastPercent.end() && last.value() == percent) return;
+    lastPercent.insert(id, percent);
+
+    QJsonObject event;
+    event.insert("event", "progress");
+    event.insert("id", id);
+    event.insert("progress", progress);
+    event.insert("remaining", item->GetRemainingSeconds());
+    Send(socket, event);
+}
+
+void JobServer::OnItemFinished(BatchItem *item, bool success) {
+    // Put back to waiting by Stop(), it runs again on the next Start()
+    if (item->GetStatus() == BatchItemStatus::Waiting) return;
+
+    qint64 id = item->GetId();
+    QPointer<QLocalSocket> socket = submitters.take(id);
+    lastPercent.remove(id);
+
+    QJsonObject event;
+    event.insert("event", "finished");
+    event.insert("id", id);
+    event.insert("success", success);
+    if (!success) {
+        event.insert("error", item->GetErrorMessage());
+    }
+    if (socket) {
+        Send(socket, event);
+    }
+
+    // Keep the queue bounded over the server's lifetime
+    int index = batchQueue->GetItemIndex(item);
+    if (index >= 0) {
+        batchQueue->RemoveItem(index);
+    }
+}
+
+void JobServer::Send(QLocalSocket *socket, const QJsonObject &event) {
+    if (!socket || socket->state() != QLocalSocket::ConnectedState) return;
+    socket->write(QJsonDocument(event).toJson(QJsonDocument::Compact));
+    socket->write("\n");
+}
+
+void JobServer::SendError(QLocalSocket *socket, const QString &message) {
+    Send(socket, QJsonObject{{"event", "error"}, {"message", message}});
+}
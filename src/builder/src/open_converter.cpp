@@ -43,6 +43,7 @@
 #include <QUrl>
 #include <QVBoxLayout>
 
+#include "../../common/include/codec_capabilities.h"
 #include "../../common/include/encode_parameter.h"
 #include "../../common/include/info.h"
 #include "../../common/include/process_observer.h"
@@ -90,6 +91,14 @@ OpenConverter::OpenConverter(QWidget *parent)
 
     // Initialize batch queue dialog
     batchQueueDialog = nullptr;
+    currentPageIndex = -1;
+
+    // Bring back the queue of the previous session
+    BatchQueue::Instance()->EnableJournal();
+
+    // Enumerate the FFmpeg encoders and muxers while the window comes up,
+    // the codec and format selectors offer only what is built in
+    CodecCapabilities::preload();
 
 #ifdef ENABLE_FFMPEG
     QAction *act_ffmpeg = new QAction(tr("FFMPEG"), this);
@@ -109,6 +118,11 @@ OpenConverter::OpenConverter(QWidget *parent)
     transcoderActions.append(act_fftool);
 #endif
 
+    // Let the converter choose a backend for every job
+    QAction *act_auto = new QAction(tr("AUTO"), this);
+    act_auto->setObjectName("AUTO");
+    transcoderActions.append(act_auto);
+
     for (QAction* a : qAsConst(transcoderActions)) {
         if (a) ui->menuTranscoder->addAction(a);
     }
@@ -183,10 +197,9 @@ void OpenConverter::dropEvent(QDropEvent *event) {
         QString filePath = url.toLocalFile();
 
         // Get current page and handle file drop
-        int currentIndex = ui->stackedWidget->currentIndex();
-        if (currentIndex >= 0 && currentIndex < pages.size()) {
+        if (currentPageIndex >= 0 && currentPageIndex < pages.size()) {
             // If it's the InfoViewPage, handle the drop
-            InfoViewPage *infoPage = qobject_cast<InfoViewPage *>(pages[currentIndex]);
+            InfoViewPage *infoPage = qobject_cast<InfoViewPage *>(pages[currentPageIndex]);
             if (infoPage) {
                 infoPage->HandleFileDrop(filePath);
             }
@@ -201,6 +214,9 @@ void OpenConverter::SlotTranscoderChanged(QAction *action) {
     if (0 != action) {
         std::string transcoderName = action->objectName().toStdString();
         bool isValid = false;
+        if (transcoderName == "AUTO") {
+            isValid = converter->set_transcoder(transcoderName);
+        }
 #ifdef ENABLE_FFMPEG
         if (transcoderName == "FFMPEG") {
             converter->set_transcoder(transcoderName);
@@ -408,43 +424,56 @@ void OpenConverter::SetupNavigationButtons() {
 }
 
 void OpenConverter::InitializePages() {
-    // Create pages for each navigation item
+    // Register a factory for each navigation item; a page and its widgets
+    // are only built when it is first shown, which keeps startup short
     // Common section
-    pages.append(new InfoViewPage(this));
-    pages.append(new CompressPicturePage(this));
-    pages.append(new ExtractAudioPage(this));
-    pages.append(new CutVideoPage(this));
-    pages.append(new CreateGifPage(this));
+    pageFactories.append([this]() -> BasePage * { return new InfoViewPage(this); });
+    pageFactories.append([this]() -> BasePage * { return new CompressPicturePage(this); });
+    pageFactories.append([this]() -> BasePage * { return new ExtractAudioPage(this); });
+    pageFactories.append([this]() -> BasePage * { return new CutVideoPage(this); });
+    pageFactories.append([this]() -> BasePage * { return new CreateGifPage(this); });
     // Advanced section
-    pages.append(new RemuxPage(this));
-    pages.append(new TranscodePage(this));
+    pageFactories.append([this]() -> BasePage * { return new RemuxPage(this); });
+    pageFactories.append([this]() -> BasePage * { return new TranscodePage(this); });
 #if defined(ENABLE_BMF) && defined(ENABLE_GUI)
-    pages.append(new AIProcessingPage(this));
+    pageFactories.append([this]() -> BasePage * { return new AIProcessingPage(this); });
 #endif
 
-    // Add all pages to the stacked widget
-    for (BasePage *page : pages) {
-        ui->stackedWidget->addWidget(page);
+    for (int i = 0; i < pageFactories.size(); ++i) {
+        pages.append(nullptr);
     }
 }
 
-void OpenConverter::SwitchToPage(int pageIndex) {
+BasePage *OpenConverter::GetPage(int pageIndex) {
     if (pageIndex < 0 || pageIndex >= pages.size()) {
+        return nullptr;
+    }
+
+    if (!pages[pageIndex]) {
+        pages[pageIndex] = pageFactories[pageIndex]();
+        ui->stackedWidget->addWidget(pages[pageIndex]);
+    }
+    return pages[pageIndex];
+}
+
+void OpenConverter::SwitchToPage(int pageIndex) {
+    BasePage *page = GetPage(pageIndex);
+    if (!page) {
         return;
     }
 
     // Deactivate current page
-    int currentIndex = ui->stackedWidget->currentIndex();
-    if (currentIndex >= 0 && currentIndex < pages.size()) {
-        pages[currentIndex]->OnPageDeactivated();
+    if (currentPageIndex >= 0 && currentPageIndex < pages.size() && pages[currentPageIndex]) {
+        pages[currentPageIndex]->OnPageDeactivated();
     }
 
     // Switch to new page
-    ui->stackedWidget->setCurrentIndex(pageIndex);
-    pages[pageIndex]->OnPageActivated();
+    currentPageIndex = pageIndex;
+    ui->stackedWidget->setCurrentWidget(page);
+    page->OnPageActivated();
 
     // Update window title
-    setWindowTitle(QString("OpenConverter - %1").arg(pages[pageIndex]->GetPageTitle()));
+    setWindowTitle(QString("OpenConverter - %1").arg(page->GetPageTitle()));
 }
 
 SharedData* OpenConverter::GetSharedData() const {
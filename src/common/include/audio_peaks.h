@@ -0,0 +1,61 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AUDIOPEAKS_H
+#define AUDIOPEAKS_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+ * Waveform overview of the audio of a file: the minimum, maximum and RMS
+ * sample value of each of a fixed number of equal time buckets.
+ *
+ * The file is streamed once. Every other stream is discarded in the
+ * demuxer, only the best audio stream is decoded, and each decoded frame
+ * is folded into its buckets as it arrives, so memory stays at one frame
+ * whatever the length of the file. Samples are reduced in fixed-width
+ * lanes that the compiler turns into SIMD min/max/multiply-add.
+ */
+class AudioPeaks {
+public:
+    struct Bucket {
+        float min = 0.0f;  // -1..1
+        float max = 0.0f;
+        float rms = 0.0f;
+    };
+
+    // Called now and then with the buckets finished so far, [0, filled)
+    using ProgressCallback = std::function<void(const std::vector<Bucket> &buckets, int filled)>;
+
+    /*
+     * Fill bucketCount buckets spanning the file's duration. Returns false
+     * if the file has no decodable audio stream or the scan was cancelled.
+     */
+    static bool compute(const std::string &path, int bucketCount, std::vector<Bucket> &buckets,
+                        const ProgressCallback &progress = nullptr,
+                        const std::atomic<bool> *cancel = nullptr);
+
+    // Fold count samples into min, max and the sum of squares
+    static void reduce(const float *samples, size_t count, float &min, float &max,
+                       double &sumSquares);
+};
+
+#endif // AUDIOPEAKS_H
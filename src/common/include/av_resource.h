@@ -0,0 +1,76 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * This file is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef AV_RESOURCE_H
+#define AV_RESOURCE_H
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavfilter/avfilter.h>
+#include <libavformat/avformat.h>
+#include <libavutil/frame.h>
+};
+
+#include <memory>
+
+/*
+ * unique_ptr owners for libav objects, each deleter calls the matching
+ * libav free function. Functions that allocate through an out parameter
+ * (avformat_open_input) fill a raw pointer that is handed to the owner
+ * right after:
+ *
+ *   AVFormatContext *raw = NULL;
+ *   if (avformat_open_input(&raw, path, NULL, NULL) < 0)
+ *       return;
+ *   AVInputFormatContextPtr fmtCtx(raw);
+ */
+
+struct AVInputFormatContextDeleter {
+    void operator()(AVFormatContext *ctx) const { avformat_close_input(&ctx); }
+};
+
+// Output contexts also own their AVIOContext unless the muxer has no file
+struct AVOutputFormatContextDeleter {
+    void operator()(AVFormatContext *ctx) const {
+        if (ctx->oformat && !(ctx->oformat->flags & AVFMT_NOFILE))
+            avio_closep(&ctx->pb);
+        avformat_free_context(ctx);
+    }
+};
+
+struct AVCodecContextDeleter {
+    void operator()(AVCodecContext *ctx) const { avcodec_free_context(&ctx); }
+};
+
+struct AVPacketDeleter {
+    void operator()(AVPacket *pkt) const { av_packet_free(&pkt); }
+};
+
+struct AVFrameDeleter {
+    void operator()(AVFrame *frame) const { av_frame_free(&frame); }
+};
+
+struct AVFilterGraphDeleter {
+    void operator()(AVFilterGraph *graph) const { avfilter_graph_free(&graph); }
+};
+
+using AVInputFormatContextPtr = std::unique_ptr<AVFormatContext, AVInputFormatContextDeleter>;
+using AVOutputFormatContextPtr = std::unique_ptr<AVFormatContext, AVOutputFormatContextDeleter>;
+using AVCodecContextPtr = std::unique_ptr<AVCodecContext, AVCodecContextDeleter>;
+using AVPacketPtr = std::unique_ptr<AVPacket, AVPacketDeleter>;
+using AVFramePtr = std::unique_ptr<AVFrame, AVFrameDeleter>;
+using AVFilterGraphPtr = std::unique_ptr<AVFilterGraph, AVFilterGraphDeleter>;
+
+#endif // AV_RESOURCE_H
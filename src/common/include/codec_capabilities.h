@@ -0,0 +1,93 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CODECCAPABILITIES_H
+#define CODECCAPABILITIES_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavutil/avutil.h>
+}
+
+class EncodeParameter;
+
+// One encoder compiled into libavcodec
+struct EncoderCapability {
+    std::string name;                        // e.g. "libx264"
+    AVMediaType type;
+    std::vector<std::string> pixelFormats;   // empty if any is accepted
+    std::vector<std::string> sampleFormats;  // empty if any is accepted
+    std::vector<int> sampleRates;            // empty if any is accepted
+    bool experimental;
+};
+
+// One muxer compiled into libavformat
+struct MuxerCapability {
+    std::string name;                     // e.g. "mp4"
+    std::vector<std::string> extensions;  // e.g. "mp4", "m4a"
+    std::string defaultVideoCodec;        // encoder for "auto", may be empty
+    std::string defaultAudioCodec;
+};
+
+/*
+ * Encoders and muxers of the linked FFmpeg, enumerated once per process.
+ *
+ * The GUI offers only what is actually built in, and every job is checked
+ * with validate() before the input is opened, so a missing encoder or an
+ * unsupported pixel format fails at once with a readable message instead
+ * of deep inside the transcoder.
+ *
+ * shared() builds the table on first use; preload() does that on a
+ * background thread at startup. Immutable once built, so it can be read
+ * from any thread.
+ */
+class CodecCapabilities {
+public:
+    static const CodecCapabilities &shared();
+
+    // Build the shared table on a background thread
+    static void preload();
+
+    const EncoderCapability *find_encoder(const std::string &name) const;
+    bool has_encoder(const std::string &name, AVMediaType type) const;
+    // Encoder names of one media type, sorted
+    std::vector<std::string> encoder_names(AVMediaType type) const;
+
+    const MuxerCapability *find_muxer(const std::string &name) const;
+    // Muxer chosen for an output file name or bare extension ("mkv"),
+    // NULL if FFmpeg has none
+    const MuxerCapability *muxer_for_file(const std::string &fileName) const;
+
+    /*
+     * Check the encoders, pixel format and output container of a job
+     * against the table. "copy" and empty ("auto") codec names always
+     * pass. Returns false and sets error if the job cannot run.
+     */
+    bool validate(EncodeParameter *encodeParameter, const std::string &dst,
+                  std::string &error) const;
+
+private:
+    CodecCapabilities();
+
+    std::map<std::string, EncoderCapability> encoders;
+    std::map<std::string, MuxerCapability> muxers;
+};
+
+#endif // CODECCAPABILITIES_H
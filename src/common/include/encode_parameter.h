@@ -51,6 +51,16 @@ private:
 
     int upscaleFactor;
 
+    double checkpointInterval;  // in seconds, 0 disables checkpointing
+
+    int threadCount;  // 0 lets the codecs decide
+
+    std::string distributeDir;  // spool shared with other nodes, empty to encode locally
+
+    bool segmentWindowSet;
+    int64_t segmentBegin;  // AV_TIME_BASE, absolute input time
+    int64_t segmentEnd;
+
 public:
     EncodeParameter();
     ~EncodeParameter();
@@ -108,6 +118,33 @@ public:
     int get_upscale_factor();
 
     void set_upscale_factor(int uf);
+
+    double get_checkpoint_interval();
+
+    void set_checkpoint_interval(double seconds);
+
+    // Cap on the codec threads of a job, set from the batch scheduler's
+    // core budget; not an encode setting, so it leaves available unset
+    int get_thread_count();
+
+    void set_thread_count(int threads);
+
+    // Encode the checkpoint segments as spool jobs in this directory, so
+    // nodes sharing it encode them in parallel; the audio and the join
+    // stay on this node
+    std::string get_distribute_dir();
+
+    void set_distribute_dir(std::string dir);
+
+    // Segment job of a distributed encode: only video frames in
+    // [begin, end) (AV_TIME_BASE, absolute) are converted, without audio
+    bool has_segment_window();
+
+    int64_t get_segment_begin();
+
+    int64_t get_segment_end();
+
+    void set_segment_window(int64_t begin, int64_t end);
 };
 
 #endif // ENCODEPARAMETER_H
@@ -29,6 +29,9 @@ extern "C" {
 
 // store some info of video and audio
 typedef struct QuickInfo {
+    // container
+    double duration; // in seconds, 0 if unknown
+
     // video
     int videoIdx;
     int width;
@@ -68,13 +71,8 @@ public:
 private:
     void print_error(const char *msg, int ret);
 
-    AVFormatContext *avCtx;
-
-    const AVCodec *audioCodec;
-
-    AVCodecContext *audioCtx;
-
     QuickInfo *quickInfo;
+    bool fastProbe;
 
     char errorMsg[128];
 public:
@@ -84,6 +82,27 @@ public:
     QuickInfo *get_quick_info();
     // send the info to front-end
     void send_info(char *src);
+    // probe with open_input()'s fast mode, off by default
+    void set_fast_probe(bool enabled);
+
+    // Bytes a fast probe reads at most before falling back to a full one
+    static const int64_t FAST_PROBE_SIZE = 256 * 1024;
+
+    /*
+     * Open src and fill in the parameters of its streams. The full mode
+     * runs avformat_find_stream_info() with the libav defaults. The fast
+     * mode stops at the container headers when they already carry the
+     * codec, size, rate and sample/pixel format of every audio and video
+     * stream, otherwise probes at most FAST_PROBE_SIZE bytes and half a
+     * second, and only reopens src for a full probe if that still leaves
+     * one of these missing (e.g. a TS with a late audio stream).
+     *
+     * Returns 0 or a negative AVERROR. *fmtCtx is NULL if src could not
+     * be opened and stays open, owned by the caller, when only the
+     * probing failed.
+     */
+    static int open_input(AVFormatContext **fmtCtx, const char *src,
+                          bool fastProbe);
 };
 
 #endif // INFO_H
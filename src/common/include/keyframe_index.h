@@ -0,0 +1,100 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef KEYFRAMEINDEX_H
+#define KEYFRAMEINDEX_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/rational.h>
+}
+
+/*
+ * Keyframe positions of the video stream of one file.
+ *
+ * Built by a packet-only scan (no decoding, the other streams discarded)
+ * and cached on disk, keyed by the file's path, size and modification
+ * time, so a file is scanned once. With the index a seek goes straight
+ * to the keyframe that starts the target's GOP and only the frames
+ * between it and the target are decoded.
+ *
+ * The cache lives in the per-user cache directory unless the
+ * OC_KEYFRAME_INDEX_DIR environment variable points elsewhere.
+ *
+ * Immutable once built, so one index can be shared between threads.
+ */
+class KeyframeIndex {
+public:
+    struct Keyframe {
+        int64_t pts;  // stream time base
+        int64_t pos;  // byte offset, -1 if the demuxer does not know it
+    };
+
+    // Cached index, or scan the file and cache the result. NULL if the
+    // file has no video stream, cannot be read or the scan was cancelled.
+    static std::shared_ptr<const KeyframeIndex>
+    load(const std::string &path, const std::atomic<bool> *cancel = nullptr);
+
+    // Cached index only, never scans; NULL if the file was not indexed
+    static std::shared_ptr<const KeyframeIndex> find(const std::string &path);
+
+    // Scan without touching the cache
+    static std::shared_ptr<const KeyframeIndex>
+    scan(const std::string &path, const std::atomic<bool> *cancel = nullptr);
+
+    static std::string cache_dir();
+
+    int get_stream_index() const { return streamIndex; }
+    AVRational get_time_base() const { return timeBase; }
+    int64_t get_packet_count() const { return packetCount; }
+    const std::vector<Keyframe> &get_keyframes() const { return keyframes; }
+
+    // Last keyframe at or before time (AV_TIME_BASE), NULL if none
+    const Keyframe *at_or_before(int64_t time) const;
+
+    // Keyframe pts in AV_TIME_BASE
+    int64_t time_of(const Keyframe &keyframe) const;
+
+    /*
+     * Seek fmtCtx, opened on the indexed file, to the keyframe at or
+     * before time (AV_TIME_BASE). Returns the keyframe's time, or
+     * AV_NOPTS_VALUE if the index has none there or the seek failed.
+     */
+    int64_t seek(AVFormatContext *fmtCtx, int64_t time) const;
+
+private:
+    KeyframeIndex() = default;
+
+    static std::string identity(const std::string &path);
+    static std::string cache_path(const std::string &identity);
+    static std::shared_ptr<const KeyframeIndex> read(const std::string &file,
+                                                     const std::string &identity);
+    bool write(const std::string &file, const std::string &identity) const;
+
+    int streamIndex = -1;
+    AVRational timeBase = {1, AV_TIME_BASE};
+    int64_t packetCount = 0;
+    std::vector<Keyframe> keyframes;  // sorted by pts
+};
+
+#endif // KEYFRAMEINDEX_H
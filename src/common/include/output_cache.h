@@ -0,0 +1,91 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OUTPUTCACHE_H
+#define OUTPUTCACHE_H
+
+#include "encode_parameter.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+/*
+ * Content-addressed store of conversion results, shared by every job that
+ * uses the same cache directory.
+ *
+ * The key hashes the input's bytes (so renamed or copied sources hit),
+ * every encode setting, the output container, the backend and the libav
+ * versions. A hit is delivered by reflink where the filesystem supports
+ * it, else by hard link, else by copy. Stored objects are read-only; an
+ * existing output is unlinked before it is replaced, so a shared inode is
+ * never rewritten in place.
+ *
+ * The store is bounded: once an insert takes it over the bound, the least
+ * recently used objects are evicted until it fits. Use is recorded in a
+ * KEY.EXT.used stamp next to each object, replaced on every store and
+ * hit; the object itself is never touched, since a hard-linked output
+ * shares its mtime and may belong to another user. The size is scanned
+ * once per process and then counted along, a full scan only happens to
+ * evict.
+ *
+ * Disabled unless configured with --cache DIR or the OC_OUTPUT_CACHE
+ * environment variable (OC_OUTPUT_CACHE_MB sets the bound, default
+ * 20480).
+ */
+class OutputCache {
+public:
+    OutputCache(const std::string &cacheDir, uint64_t maxBytes);
+
+    // process-wide cache, NULL when disabled
+    static OutputCache *shared();
+    static void configure_shared(const std::string &cacheDir, uint64_t maxBytes);
+
+    // "" if the input cannot be read
+    std::string key(const std::string &src, const std::string &dst,
+                    const std::string &transcoderName,
+                    EncodeParameter *encodeParameter);
+
+    // Deliver a cached result to dst, false on a miss
+    bool fetch(const std::string &key, const std::string &dst);
+
+    // Add a finished output and evict down to the bound
+    void store(const std::string &key, const std::string &dst);
+
+    uint64_t get_max_bytes();
+
+    // Unlink dst if it is a hard link to a cached object, so the next
+    // conversion writes a new file instead of the shared, read-only inode
+    static void detach(const std::string &dst);
+
+    // 128-bit MurmurHash3 of the whole file, hex
+    static std::string hash_file(const std::string &path);
+
+private:
+    std::string object_path(const std::string &key, const std::string &dst);
+    void mark_used(const std::string &object);
+    void evict();
+    // Bytes in the store, with every stamp's last use as a side effect
+    uint64_t scan();
+
+    std::string dir;
+    uint64_t maxBytes;
+    uint64_t totalBytes = 0;
+    bool scanned = false;
+    std::mutex mutex;
+};
+
+#endif // OUTPUTCACHE_H
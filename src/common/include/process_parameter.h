@@ -19,12 +19,14 @@
 #define PROCESSPARAMETER_H
 
 #include "process_observer.h"
+#include <atomic>
 #include <memory>
 #include <vector>
 
 class ProcessParameter {
 public:
     ProcessParameter();
+    ProcessParameter(const ProcessParameter &other);
     ~ProcessParameter();
 
     void set_process_number(int64_t frameNumber, int64_t frameTotalNumnber);
@@ -34,6 +36,21 @@ public:
     double get_time_required();
     ProcessParameter get_process_parmeter();
 
+    // Cooperative cancellation: the transcoder polls should_stop() and
+    // aborts the job. Safe to call from any thread.
+    void request_cancel();
+    bool is_cancel_requested() const;
+
+    // Watchdog: a job that reports no progress for this long counts as
+    // stalled and stops like a cancelled one. 0 disables it.
+    void set_stall_timeout(double seconds);
+    double get_stall_timeout() const;
+    // Mark the job as alive, called with every progress report
+    void touch();
+    bool is_stalled() const;
+
+    bool should_stop() const;
+
     // Observer management
     void add_observer(ProcessObserver* observer);
     void remove_observer(ProcessObserver* observer);
@@ -43,6 +60,10 @@ private:
     double timeRequired;
     std::vector<ProcessObserver*> observers;
 
+    std::atomic<bool> cancelRequested;
+    std::atomic<int64_t> stallTimeoutMs;
+    std::atomic<int64_t> lastActivityMs;  // steady clock
+
     void notify_process_update(double progress);
     void notify_time_update(double timeRequired);
 };
@@ -24,12 +24,21 @@ extern "C" {
 
 #define OC_INVALID_STREAM_IDX -1
 
+/*
+ * Owns every libav object it points to: the format context (an opened
+ * input, or an output with its AVIOContext), the codec contexts, the
+ * packet and the frame are released by the destructor. The streams and
+ * codecs belong to those and are not freed separately.
+ */
 class StreamContext {
 
 public:
     StreamContext();
     ~StreamContext();
 
+    StreamContext(const StreamContext &) = delete;
+    StreamContext &operator=(const StreamContext &) = delete;
+
     AVFormatContext *fmtCtx;
     const char *filename;
 
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STREAMPLAN_H
+#define STREAMPLAN_H
+
+#include <string>
+
+class EncodeParameter;
+
+/*
+ * Per-stream copy-or-encode decision for one job.
+ *
+ * A stream whose codec is left to "auto" is copied when the output
+ * container accepts the source codec (avformat_query_codec()) and none of
+ * the requested settings (size, pixel format, bit rate, quality, preset,
+ * cut range, segmenting, upscaling) would change it; otherwise it is
+ * encoded with the container's default encoder. An explicit codec or
+ * "copy" is always kept.
+ *
+ * build() probes the input with Info's fast mode, so for most files it
+ * reads the container headers only.
+ */
+class StreamPlan {
+public:
+    enum class Action {
+        Drop,    // no such input stream, or the container takes none
+        Copy,
+        Encode,
+    };
+
+    struct Stream {
+        Action action = Action::Drop;
+        std::string sourceCodec;  // decoder name, empty without a stream
+        std::string targetCodec;  // encoder name, "copy" when copied
+        std::string reason;
+    };
+
+    // Probe src and decide for the video and audio stream the transcoders
+    // convert. Returns false and sets error if src cannot be read or dst
+    // has no muxer.
+    static bool build(const std::string &src, const std::string &dst,
+                      EncodeParameter *encodeParameter, StreamPlan &plan,
+                      std::string &error);
+
+    // Set the "auto" codecs the plan copies to "copy". Returns true if
+    // anything was changed.
+    bool apply(EncodeParameter *encodeParameter) const;
+
+    // One line per stream, e.g. "video: copy h264 (mp4 takes h264 as is)"
+    std::string describe() const;
+
+    std::string container;  // muxer name
+    Stream video;
+    Stream audio;
+};
+
+#endif // STREAMPLAN_H
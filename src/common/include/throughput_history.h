@@ -0,0 +1,104 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef THROUGHPUTHISTORY_H
+#define THROUGHPUTHISTORY_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+// One finished job, as measured by the Converter
+struct ThroughputSample {
+    std::string transcoder;  // FFMPEG, FFTOOL, BMF
+    std::string jobKey;      // see ThroughputHistory::job_key()
+    double mediaSeconds;     // length of the processed media
+    double elapsedSeconds;   // wall-clock time of the job
+    int64_t frames;          // video frames processed, 0 for audio-only jobs
+};
+
+/*
+ * Locally recorded conversion speed per transcoder and job shape.
+ *
+ * Samples are appended to a plain text file (one tab separated sample per
+ * line) so concurrent jobs and crashes never lose more than the line being
+ * written. When the file grows too long it is rewritten with one aggregated
+ * line per job key and transcoder, merged from what every process wrote;
+ * appends and compactions hold a lock on "<file>.lock".
+ *
+ * The file lives in the per-user data directory unless the
+ * OC_THROUGHPUT_HISTORY environment variable points elsewhere.
+ */
+class ThroughputHistory {
+public:
+    explicit ThroughputHistory(const std::string &historyPath);
+
+    // process-wide history stored at default_path()
+    static ThroughputHistory &shared();
+    static std::string default_path();
+
+    // "<operation>/<video codec>/<preset>/<height bucket>",
+    // e.g. "encode/libx264/medium/1080"
+    static std::string job_key(const std::string &operation,
+                               const std::string &videoCodec,
+                               const std::string &preset, int height);
+
+    void record(const ThroughputSample &sample);
+
+    // media seconds processed per wall-clock second, or -1 if never measured
+    double get_speed(const std::string &jobKey, const std::string &transcoder);
+
+    // frames processed per wall-clock second, or -1 if never measured
+    double get_fps(const std::string &jobKey, const std::string &transcoder);
+
+    int get_sample_count(const std::string &jobKey,
+                         const std::string &transcoder);
+
+    /*
+     * Predict the wall-clock seconds a job of the given shape takes. Falls
+     * back to the same shape on another transcoder, then to the nearest
+     * resolution bucket scaled by pixel count. Returns -1 without any
+     * usable history.
+     */
+    double predict_seconds(const std::string &jobKey,
+                           const std::string &transcoder, double mediaSeconds);
+
+private:
+    struct Entry {
+        double mediaSeconds = 0.0;
+        double elapsedSeconds = 0.0;
+        int64_t frames = 0;
+        int samples = 0;
+    };
+
+    void load();
+    // Samples in the file added to into, returns the lines read
+    size_t read_file(std::map<std::string, Entry> &into);
+    static void add(std::map<std::string, Entry> &into,
+                    const ThroughputSample &sample, int samples);
+    // Caller holds the file lock
+    void compact();
+    double speed_of(const std::string &jobKey, const std::string &transcoder);
+
+    std::string path;
+    std::map<std::string, Entry> entries; // "<jobKey>\t<transcoder>"
+    size_t lineCount = 0;
+    std::mutex mutex;
+};
+
+#endif // THROUGHPUTHISTORY_H
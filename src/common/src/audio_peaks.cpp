@@ -0,0 +1,253 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/audio_peaks.h"
+#include "../include/av_resource.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/samplefmt.h>
+}
+
+namespace {
+
+// Independent accumulators per reduction step; eight floats fill an AVX
+// register, two SSE/NEON registers
+const size_t LANES = 8;
+
+// Buckets are published after each this many finished ones (of 100)
+const int PUBLISH_PERCENT = 2;
+
+struct Accumulator {
+    float min = FLT_MAX;
+    float max = -FLT_MAX;
+    double sumSquares = 0.0;
+    int64_t count = 0;
+};
+
+AudioPeaks::Bucket finish(const Accumulator &acc) {
+    AudioPeaks::Bucket bucket;
+    if (acc.count > 0) {
+        bucket.min = acc.min;
+        bucket.max = acc.max;
+        bucket.rms = static_cast<float>(std::sqrt(acc.sumSquares / acc.count));
+    }
+    return bucket;
+}
+
+template <typename T>
+const float *scale_to_float(const uint8_t *data, size_t count, float offset, float scale,
+                            std::vector<float> &scratch) {
+    const T *in = reinterpret_cast<const T *>(data);
+    scratch.resize(count);
+    float *out = scratch.data();
+    for (size_t i = 0; i < count; i++)
+        out[i] = (static_cast<float>(in[i]) - offset) * scale;
+    return out;
+}
+
+// One plane of samples as floats in -1..1; float input is used in place
+const float *to_float(const uint8_t *data, AVSampleFormat packed, size_t count,
+                      std::vector<float> &scratch) {
+    switch (packed) {
+    case AV_SAMPLE_FMT_FLT:
+        return reinterpret_cast<const float *>(data);
+    case AV_SAMPLE_FMT_DBL:
+        return scale_to_float<double>(data, count, 0.0f, 1.0f, scratch);
+    case AV_SAMPLE_FMT_S16:
+        return scale_to_float<int16_t>(data, count, 0.0f, 1.0f / 32768.0f, scratch);
+    case AV_SAMPLE_FMT_S32:
+        return scale_to_float<int32_t>(data, count, 0.0f, 1.0f / 2147483648.0f, scratch);
+    case AV_SAMPLE_FMT_S64:
+        return scale_to_float<int64_t>(data, count, 0.0f, 1.0f / 9223372036854775808.0f, scratch);
+    case AV_SAMPLE_FMT_U8:
+        return scale_to_float<uint8_t>(data, count, 128.0f, 1.0f / 128.0f, scratch);
+    default:
+        return nullptr;
+    }
+}
+
+} // namespace
+
+void AudioPeaks::reduce(const float *samples, size_t count, float &min, float &max,
+                        double &sumSquares) {
+    float laneMin[LANES], laneMax[LANES], laneSquares[LANES];
+    for (size_t k = 0; k < LANES; k++) {
+        laneMin[k] = min;
+        laneMax[k] = max;
+        laneSquares[k] = 0.0f;
+    }
+
+    // No dependency between lanes, so each step is one vector min, max
+    // and multiply-add
+    size_t i = 0;
+    for (; i + LANES <= count; i += LANES) {
+        for (size_t k = 0; k < LANES; k++) {
+            float v = samples[i + k];
+            laneMin[k] = v < laneMin[k] ? v : laneMin[k];
+            laneMax[k] = v > laneMax[k] ? v : laneMax[k];
+            laneSquares[k] += v * v;
+        }
+    }
+
+    float squares = 0.0f;
+    for (size_t k = 0; k < LANES; k++) {
+        min = std::min(min, laneMin[k]);
+        max = std::max(max, laneMax[k]);
+        squares += laneSquares[k];
+    }
+    for (; i < count; i++) {
+        float v = samples[i];
+        min = std::min(min, v);
+        max = std::max(max, v);
+        squares += v * v;
+    }
+    // one frame at most per call, the float sum stays exact enough
+    sumSquares += squares;
+}
+
+bool AudioPeaks::compute(const std::string &path, int bucketCount, std::vector<Bucket> &buckets,
+                         const ProgressCallback &progress, const std::atomic<bool> *cancel) {
+    buckets.assign(std::max(bucketCount, 0), Bucket());
+    if (bucketCount <= 0)
+        return false;
+
+    AVFormatContext *raw = NULL;
+    if (avformat_open_input(&raw, path.c_str(), NULL, NULL) < 0)
+        return false;
+    AVInputFormatContextPtr fmtCtx(raw);
+    if (avformat_find_stream_info(fmtCtx.get(), NULL) < 0)
+        return false;
+
+    const AVCodec *codec = NULL;
+    int audio_idx = av_find_best_stream(fmtCtx.get(), AVMEDIA_TYPE_AUDIO, -1, -1, &codec, 0);
+    if (audio_idx < 0 || !codec)
+        return false;
+    AVStream *stream = fmtCtx->streams[audio_idx];
+    // the demuxer skips the video payload instead of handing it over
+    for (unsigned i = 0; i < fmtCtx->nb_streams; i++)
+        fmtCtx->streams[i]->discard =
+            static_cast<int>(i) == audio_idx ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+
+    int64_t duration = fmtCtx->duration;
+    int64_t start = fmtCtx->start_time != AV_NOPTS_VALUE ? fmtCtx->start_time : 0;
+    if (duration == AV_NOPTS_VALUE || duration <= 0)
+        return false;
+
+    AVCodecContextPtr codecCtx(avcodec_alloc_context3(codec));
+    if (!codecCtx || avcodec_parameters_to_context(codecCtx.get(), stream->codecpar) < 0 ||
+        avcodec_open2(codecCtx.get(), codec, NULL) < 0)
+        return false;
+    int sample_rate = codecCtx->sample_rate;
+    if (sample_rate <= 0)
+        return false;
+
+    AVPacketPtr pkt(av_packet_alloc());
+    AVFramePtr frame(av_frame_alloc());
+    if (!pkt || !frame)
+        return false;
+
+    double samplesPerBucket = static_cast<double>(duration) / AV_TIME_BASE * sample_rate / bucketCount;
+    std::vector<Accumulator> acc(bucketCount);
+    std::vector<float> scratch;
+    int64_t position = INT64_MIN;  // of the next frame, in samples from the start
+    int finished = 0;
+    int published = 0;
+    int publishStep = std::max(1, bucketCount * PUBLISH_PERCENT / 100);
+
+    auto fold = [&](AVFrame *frame) {
+        if (position == INT64_MIN) {
+            int64_t pts = frame->best_effort_timestamp;
+            position = pts == AV_NOPTS_VALUE
+                           ? 0
+                           : av_rescale_q(pts, stream->time_base, AVRational{1, sample_rate}) -
+                                 av_rescale(start, sample_rate, AV_TIME_BASE);
+        }
+
+        AVSampleFormat format = static_cast<AVSampleFormat>(frame->format);
+        AVSampleFormat packed = av_get_packed_sample_fmt(format);
+        bool planar = av_sample_fmt_is_planar(format);
+        int channels = std::max(frame->ch_layout.nb_channels, 1);
+        int planes = planar ? channels : 1;
+        size_t stride = planar ? 1 : channels;
+        int64_t count = frame->nb_samples;
+
+        for (int p = 0; p < planes; p++) {
+            const float *samples = to_float(frame->extended_data[p], packed, count * stride, scratch);
+            if (!samples)
+                break;
+            // split the frame at bucket boundaries, priming samples before
+            // the start are dropped
+            int64_t offset = std::max<int64_t>(0, -position);
+            while (offset < count) {
+                int64_t at = position + offset;
+                int bucket = static_cast<int>(at / samplesPerBucket);
+                if (bucket >= bucketCount)
+                    break;
+                int64_t next = static_cast<int64_t>(std::ceil((bucket + 1) * samplesPerBucket));
+                int64_t end = std::min(count, std::max(next - position, offset + 1));
+                Accumulator &a = acc[bucket];
+                reduce(samples + offset * stride, (end - offset) * stride, a.min, a.max, a.sumSquares);
+                a.count += (end - offset) * stride;
+                offset = end;
+            }
+        }
+        position += count;
+
+        // buckets behind the decode position are final
+        int done = std::min(bucketCount, static_cast<int>(std::max<int64_t>(0, position) / samplesPerBucket));
+        for (; finished < done; finished++)
+            buckets[finished] = finish(acc[finished]);
+        if (progress && finished - published >= publishStep) {
+            progress(buckets, finished);
+            published = finished;
+        }
+    };
+
+    while (av_read_frame(fmtCtx.get(), pkt.get()) >= 0) {
+        if (cancel && cancel->load()) {
+            av_packet_unref(pkt.get());
+            return false;
+        }
+        if (pkt->stream_index == audio_idx && avcodec_send_packet(codecCtx.get(), pkt.get()) >= 0) {
+            while (avcodec_receive_frame(codecCtx.get(), frame.get()) == 0) {
+                fold(frame.get());
+                av_frame_unref(frame.get());
+            }
+        }
+        av_packet_unref(pkt.get());
+    }
+
+    // the frames the decoder still holds
+    avcodec_send_packet(codecCtx.get(), NULL);
+    while (avcodec_receive_frame(codecCtx.get(), frame.get()) == 0) {
+        fold(frame.get());
+        av_frame_unref(frame.get());
+    }
+
+    for (; finished < bucketCount; finished++)
+        buckets[finished] = finish(acc[finished]);
+    if (progress)
+        progress(buckets, bucketCount);
+    return true;
+}
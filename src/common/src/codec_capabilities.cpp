@@ -0,0 +1,169 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/codec_capabilities.h"
+#include "../include/encode_parameter.h"
+
+#include <algorithm>
+#include <sstream>
+#include <thread>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/pixdesc.h>
+#include <libavutil/samplefmt.h>
+}
+
+CodecCapabilities::CodecCapabilities() {
+    void *opaque = NULL;
+    const AVCodec *codec;
+    while ((codec = av_codec_iterate(&opaque))) {
+        if (!av_codec_is_encoder(codec) ||
+            (codec->type != AVMEDIA_TYPE_VIDEO && codec->type != AVMEDIA_TYPE_AUDIO))
+            continue;
+
+        EncoderCapability encoder;
+        encoder.name = codec->name;
+        encoder.type = codec->type;
+        encoder.experimental = codec->capabilities & AV_CODEC_CAP_EXPERIMENTAL;
+        if (codec->pix_fmts) {
+            for (const AVPixelFormat *p = codec->pix_fmts; *p != AV_PIX_FMT_NONE; p++) {
+                if (const char *name = av_get_pix_fmt_name(*p))
+                    encoder.pixelFormats.push_back(name);
+            }
+        }
+        if (codec->sample_fmts) {
+            for (const AVSampleFormat *s = codec->sample_fmts; *s != AV_SAMPLE_FMT_NONE; s++) {
+                if (const char *name = av_get_sample_fmt_name(*s))
+                    encoder.sampleFormats.push_back(name);
+            }
+        }
+        if (codec->supported_samplerates) {
+            for (const int *r = codec->supported_samplerates; *r; r++)
+                encoder.sampleRates.push_back(*r);
+        }
+        encoders.emplace(encoder.name, encoder);
+    }
+
+    opaque = NULL;
+    const AVOutputFormat *format;
+    while ((format = av_muxer_iterate(&opaque))) {
+        MuxerCapability muxer;
+        muxer.name = format->name;
+        if (format->extensions) {
+            std::stringstream extensions(format->extensions);
+            std::string extension;
+            while (std::getline(extensions, extension, ','))
+                muxer.extensions.push_back(extension);
+        }
+        if (const AVCodec *video = avcodec_find_encoder(format->video_codec))
+            muxer.defaultVideoCodec = video->name;
+        if (const AVCodec *audio = avcodec_find_encoder(format->audio_codec))
+            muxer.defaultAudioCodec = audio->name;
+        muxers.emplace(muxer.name, muxer);
+    }
+}
+
+const CodecCapabilities &CodecCapabilities::shared() {
+    static CodecCapabilities capabilities;
+    return capabilities;
+}
+
+void CodecCapabilities::preload() {
+    // Static initialization is thread-safe, a caller that comes first
+    // waits for this thread instead of enumerating twice
+    std::thread([] { shared(); }).detach();
+}
+
+const EncoderCapability *CodecCapabilities::find_encoder(const std::string &name) const {
+    auto it = encoders.find(name);
+    return it == encoders.end() ? NULL : &it->second;
+}
+
+bool CodecCapabilities::has_encoder(const std::string &name, AVMediaType type) const {
+    const EncoderCapability *encoder = find_encoder(name);
+    return encoder && encoder->type == type;
+}
+
+std::vector<std::string> CodecCapabilities::encoder_names(AVMediaType type) const {
+    std::vector<std::string> names;
+    for (const auto &entry : encoders) {
+        if (entry.second.type == type)
+            names.push_back(entry.first);
+    }
+    return names;
+}
+
+const MuxerCapability *CodecCapabilities::find_muxer(const std::string &name) const {
+    auto it = muxers.find(name);
+    return it == muxers.end() ? NULL : &it->second;
+}
+
+const MuxerCapability *CodecCapabilities::muxer_for_file(const std::string &fileName) const {
+    // Same lookup as avformat_alloc_output_context2() in the transcoders
+    std::string name = fileName.find('.') == std::string::npos ? "file." + fileName : fileName;
+    const AVOutputFormat *format = av_guess_format(NULL, name.c_str(), NULL);
+    return format ? find_muxer(format->name) : NULL;
+}
+
+bool CodecCapabilities::validate(EncodeParameter *encodeParameter, const std::string &dst,
+                                 std::string &error) const {
+    if (!dst.empty() && !muxer_for_file(dst)) {
+        error = "no muxer for the output file " + dst;
+        return false;
+    }
+
+    std::string videoCodec = encodeParameter->get_video_codec_name();
+    if (!videoCodec.empty() && videoCodec != "copy" &&
+        !has_encoder(videoCodec, AVMEDIA_TYPE_VIDEO)) {
+        error = "video encoder " + videoCodec + " is not available in this FFmpeg build";
+        return false;
+    }
+
+    std::string audioCodec = encodeParameter->get_audio_codec_name();
+    if (!audioCodec.empty() && audioCodec != "copy" &&
+        !has_encoder(audioCodec, AVMEDIA_TYPE_AUDIO)) {
+        error = "audio encoder " + audioCodec + " is not available in this FFmpeg build";
+        return false;
+    }
+
+    std::string pixelFormat = encodeParameter->get_pixel_format();
+    if (!pixelFormat.empty() && videoCodec != "copy") {
+        if (av_get_pix_fmt(pixelFormat.c_str()) == AV_PIX_FMT_NONE) {
+            error = "unknown pixel format " + pixelFormat;
+            return false;
+        }
+        // "auto" picks the encoder the way the transcoders do; image2
+        // chooses it by extension rather than using its default
+        if (videoCodec.empty() && !dst.empty()) {
+            const AVOutputFormat *format = av_guess_format(NULL, dst.c_str(), NULL);
+            AVCodecID id = av_guess_codec(format, NULL, dst.c_str(), NULL, AVMEDIA_TYPE_VIDEO);
+            if (const AVCodec *codec = avcodec_find_encoder(id))
+                videoCodec = codec->name;
+        }
+        const EncoderCapability *encoder = find_encoder(videoCodec);
+        if (encoder && !encoder->pixelFormats.empty() &&
+            std::find(encoder->pixelFormats.begin(), encoder->pixelFormats.end(),
+                      pixelFormat) == encoder->pixelFormats.end()) {
+            error = "encoder " + videoCodec + " does not support pixel format " + pixelFormat;
+            return false;
+        }
+    }
+
+    return true;
+}
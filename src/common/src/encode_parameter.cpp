@@ -37,6 +37,14 @@ EncodeParameter::EncodeParameter() {
     algoMode = AlgoMode::None;
     upscaleFactor = 2;
 
+    checkpointInterval = 0.0;
+
+    threadCount = 0;
+
+    segmentWindowSet = false;
+    segmentBegin = 0;
+    segmentEnd = 0;
+
     available = false;
 }
 
@@ -148,4 +156,35 @@ void EncodeParameter::set_upscale_factor(int uf) {
 
 int EncodeParameter::get_upscale_factor() { return upscaleFactor; }
 
+void EncodeParameter::set_checkpoint_interval(double seconds) {
+    checkpointInterval = seconds > 0.0 ? seconds : 0.0;
+    available = true;
+}
+
+double EncodeParameter::get_checkpoint_interval() { return checkpointInterval; }
+
+void EncodeParameter::set_thread_count(int threads) {
+    threadCount = threads > 0 ? threads : 0;
+}
+
+int EncodeParameter::get_thread_count() { return threadCount; }
+
+void EncodeParameter::set_distribute_dir(std::string dir) {
+    distributeDir = dir;
+}
+
+std::string EncodeParameter::get_distribute_dir() { return distributeDir; }
+
+void EncodeParameter::set_segment_window(int64_t begin, int64_t end) {
+    segmentWindowSet = true;
+    segmentBegin = begin;
+    segmentEnd = end;
+}
+
+bool EncodeParameter::has_segment_window() { return segmentWindowSet; }
+
+int64_t EncodeParameter::get_segment_begin() { return segmentBegin; }
+
+int64_t EncodeParameter::get_segment_end() { return segmentEnd; }
+
 EncodeParameter::~EncodeParameter() {}
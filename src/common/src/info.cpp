@@ -14,17 +14,43 @@
  */
 
 #include "../include/info.h"
+#include "../include/av_resource.h"
+
+namespace {
+
+const int64_t FAST_ANALYZE_DURATION = AV_TIME_BASE / 2;
+
+// Whether every audio and video stream has what send_info() reports
+bool streams_complete(AVFormatContext *fmtCtx) {
+    if (fmtCtx->nb_streams == 0)
+        return false;
+    for (unsigned i = 0; i < fmtCtx->nb_streams; i++) {
+        AVCodecParameters *par = fmtCtx->streams[i]->codecpar;
+        if (par->codec_type == AVMEDIA_TYPE_VIDEO) {
+            if (par->codec_id == AV_CODEC_ID_NONE || par->width <= 0 ||
+                par->height <= 0 || par->format < 0)
+                return false;
+        } else if (par->codec_type == AVMEDIA_TYPE_AUDIO) {
+            if (par->codec_id == AV_CODEC_ID_NONE || par->sample_rate <= 0 ||
+                par->ch_layout.nb_channels <= 0 || par->format < 0)
+                return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
 
 Info::Info() {
-    avCtx = NULL;
-    audioCodec = NULL;
-    audioCtx = NULL;
     quickInfo = new QuickInfo();
+    fastProbe = false;
     init();
 }
 
 void Info::init() {
     // Init QuickInfo
+    quickInfo->duration = 0;
+
     quickInfo->videoIdx = -1;
     quickInfo->width = 0;
     quickInfo->height = 0;
@@ -52,87 +78,107 @@ void Info::print_error(const char *msg, int ret) {
 
 QuickInfo *Info::get_quick_info() { return quickInfo; }
 
+void Info::set_fast_probe(bool enabled) { fastProbe = enabled; }
+
+int Info::open_input(AVFormatContext **fmtCtx, const char *src,
+                     bool fastProbe) {
+    int ret = 0;
+    if (fastProbe) {
+        // The limits also bound the stream info probing below
+        AVDictionary *options = NULL;
+        av_dict_set_int(&options, "probesize", FAST_PROBE_SIZE, 0);
+        av_dict_set_int(&options, "analyzeduration", FAST_ANALYZE_DURATION, 0);
+        ret = avformat_open_input(fmtCtx, src, NULL, &options);
+        av_dict_free(&options);
+        if (ret < 0)
+            return ret;
+        if (streams_complete(*fmtCtx))
+            return 0;
+        ret = avformat_find_stream_info(*fmtCtx, NULL);
+        if (ret >= 0 && streams_complete(*fmtCtx))
+            return 0;
+        av_log(*fmtCtx, AV_LOG_DEBUG,
+               "fast probe left stream parameters unset, probing fully\n");
+        avformat_close_input(fmtCtx);
+    }
+
+    ret = avformat_open_input(fmtCtx, src, NULL, NULL);
+    if (ret < 0)
+        return ret;
+    return avformat_find_stream_info(*fmtCtx, NULL);
+}
+
 void Info::send_info(char *src) {
     init();
     int ret = 0;
     av_log_set_level(AV_LOG_DEBUG);
-    ret = avformat_open_input(&avCtx, src, NULL, NULL);
-    if (ret < 0) {
+    AVFormatContext *raw = NULL;
+    ret = open_input(&raw, src, fastProbe);
+    if (!raw) {
         print_error("open failed", ret);
-        goto end;
+        return;
     }
-    ret = avformat_find_stream_info(avCtx, NULL);
+    // Closed on every return below
+    AVInputFormatContextPtr avCtx(raw);
     if (ret < 0) {
         print_error("find stream info failed", ret);
     }
+    if (avCtx->duration != AV_NOPTS_VALUE && avCtx->duration > 0)
+        quickInfo->duration = avCtx->duration / (double)AV_TIME_BASE;
     // find the video and audio stream from container
     quickInfo->videoIdx =
-        av_find_best_stream(avCtx, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+        av_find_best_stream(avCtx.get(), AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
     quickInfo->audioIdx =
-        av_find_best_stream(avCtx, AVMEDIA_TYPE_AUDIO, -1, -1, NULL, 0);
+        av_find_best_stream(avCtx.get(), AVMEDIA_TYPE_AUDIO, -1, -1, NULL, 0);
 
     if (quickInfo->videoIdx >= 0) {
-        quickInfo->height =
-            avCtx->streams[quickInfo->videoIdx]->codecpar->height;
-        quickInfo->width = avCtx->streams[quickInfo->videoIdx]->codecpar->width;
+        AVStream *videoStream = avCtx->streams[quickInfo->videoIdx];
+        quickInfo->height = videoStream->codecpar->height;
+        quickInfo->width = videoStream->codecpar->width;
 
-        if (avCtx->streams[quickInfo->videoIdx]->codecpar->color_space != AVCOL_SPC_UNSPECIFIED) {
-            quickInfo->colorSpace = av_color_space_name(
-                avCtx->streams[quickInfo->videoIdx]->codecpar->color_space);
+        if (videoStream->codecpar->color_space != AVCOL_SPC_UNSPECIFIED) {
+            quickInfo->colorSpace =
+                av_color_space_name(videoStream->codecpar->color_space);
         }
-        if (avCtx->streams[quickInfo->videoIdx]->codecpar->codec_id != AV_CODEC_ID_NONE)
-            quickInfo->videoCodec = avcodec_get_name(
-                avCtx->streams[quickInfo->videoIdx]->codecpar->codec_id);
+        if (videoStream->codecpar->codec_id != AV_CODEC_ID_NONE)
+            quickInfo->videoCodec =
+                avcodec_get_name(videoStream->codecpar->codec_id);
         // Get pixel format
-        AVPixelFormat pix_fmt = (AVPixelFormat)avCtx->streams[quickInfo->videoIdx]->codecpar->format;
+        AVPixelFormat pix_fmt = (AVPixelFormat)videoStream->codecpar->format;
         if (pix_fmt != AV_PIX_FMT_NONE) {
             const char *pix_fmt_name = av_get_pix_fmt_name(pix_fmt);
             if (pix_fmt_name)
                 quickInfo->pixelFormat = pix_fmt_name;
         }
-        quickInfo->videoBitRate =
-            avCtx->streams[quickInfo->videoIdx]->codecpar->bit_rate;
-        quickInfo->frameRate =
-            avCtx->streams[quickInfo->videoIdx]->r_frame_rate.num /
-            avCtx->streams[quickInfo->videoIdx]->r_frame_rate.den;
+        quickInfo->videoBitRate = videoStream->codecpar->bit_rate;
+        // Only the full probe guesses r_frame_rate, the headers give the
+        // average
+        AVRational frameRate = videoStream->r_frame_rate;
+        if (frameRate.num <= 0 || frameRate.den <= 0)
+            frameRate = videoStream->avg_frame_rate;
+        if (frameRate.den > 0)
+            quickInfo->frameRate = frameRate.num / frameRate.den;
 
     } else {
-        av_log(avCtx, AV_LOG_ERROR, "There is no video stream!\n");
-        // goto end;
+        av_log(avCtx.get(), AV_LOG_ERROR, "There is no video stream!\n");
     }
 
     if (quickInfo->audioIdx < 0) {
-        av_log(avCtx, AV_LOG_ERROR, "There is no audio stream!\n");
-        goto end;
-    }
-
-    audioCtx = avcodec_alloc_context3(NULL);
-    if (!audioCtx) {
-        av_log(audioCtx, AV_LOG_ERROR,
-               "Could not allocate audio codec context\n");
-        goto end;
-    }
-    // Open the audio codec
-    if (avcodec_parameters_to_context(
-            audioCtx, avCtx->streams[quickInfo->audioIdx]->codecpar) < 0) {
-        av_log(avCtx, AV_LOG_ERROR, "Failed to initialize codec context\n");
-        goto end;
+        av_log(avCtx.get(), AV_LOG_ERROR, "There is no audio stream!\n");
+        return;
     }
 
-    quickInfo->audioCodec = avcodec_get_name(
-        avCtx->streams[quickInfo->audioIdx]->codecpar->codec_id);
-    quickInfo->audioBitRate =
-        avCtx->streams[quickInfo->audioIdx]->codecpar->bit_rate;
-    quickInfo->channels =
-        avCtx->streams[quickInfo->audioIdx]->codecpar->ch_layout.nb_channels;
-    quickInfo->sampleFmt = av_get_sample_fmt_name(audioCtx->sample_fmt);
-    quickInfo->sampleRate =
-        avCtx->streams[quickInfo->audioIdx]->codecpar->sample_rate;
-
-end:
-    avformat_close_input(&avCtx);
-
-    avcodec_free_context(&audioCtx);
+    // The stream parameters carry everything reported here, no codec
+    // context is needed
+    AVCodecParameters *audioPar = avCtx->streams[quickInfo->audioIdx]->codecpar;
+    quickInfo->audioCodec = avcodec_get_name(audioPar->codec_id);
+    quickInfo->audioBitRate = audioPar->bit_rate;
+    quickInfo->channels = audioPar->ch_layout.nb_channels;
+    const char *sampleFmtName =
+        av_get_sample_fmt_name((AVSampleFormat)audioPar->format);
+    if (sampleFmtName)
+        quickInfo->sampleFmt = sampleFmtName;
+    quickInfo->sampleRate = audioPar->sample_rate;
 }
 
 Info::~Info() {
@@ -0,0 +1,290 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/keyframe_index.h"
+#include "../include/av_resource.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+extern "C" {
+#include <libavutil/mathematics.h>
+#include <libavutil/mem.h>
+#include <libavutil/murmur3.h>
+}
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Bump when the file layout changes
+const char *INDEX_HEADER = "oc-keyframe-index 1";
+
+// Indexes of recently opened files, so the player, the cut page and the
+// transcoder share one copy
+const size_t MEMORY_ENTRIES = 32;
+std::map<std::string, std::shared_ptr<const KeyframeIndex>> memoryCache;
+std::mutex memoryMutex;
+
+void remember(const std::string &identity, const std::shared_ptr<const KeyframeIndex> &index) {
+    std::lock_guard<std::mutex> lock(memoryMutex);
+    if (memoryCache.size() >= MEMORY_ENTRIES)
+        memoryCache.clear();
+    memoryCache[identity] = index;
+}
+
+std::shared_ptr<const KeyframeIndex> recall(const std::string &identity) {
+    std::lock_guard<std::mutex> lock(memoryMutex);
+    auto it = memoryCache.find(identity);
+    return it != memoryCache.end() ? it->second : nullptr;
+}
+
+// Two processes indexing the same file must not share a temporary file
+std::string unique_suffix() {
+    static std::atomic<unsigned> counter(0);
+    std::ostringstream suffix;
+    suffix << ".tmp." << std::hex
+           << std::chrono::steady_clock::now().time_since_epoch().count() << "."
+           << counter++;
+    return suffix.str();
+}
+
+} // namespace
+
+std::shared_ptr<const KeyframeIndex> KeyframeIndex::load(const std::string &path,
+                                                         const std::atomic<bool> *cancel) {
+    std::string id = identity(path);
+    if (id.empty())
+        return nullptr;
+    if (auto index = find(path))
+        return index;
+
+    std::shared_ptr<const KeyframeIndex> index = scan(path, cancel);
+    if (!index)
+        return nullptr;
+    // a failed write only costs a rescan next time
+    index->write(cache_path(id), id);
+    remember(id, index);
+    return index;
+}
+
+std::shared_ptr<const KeyframeIndex> KeyframeIndex::find(const std::string &path) {
+    std::string id = identity(path);
+    if (id.empty())
+        return nullptr;
+    if (auto index = recall(id))
+        return index;
+
+    std::shared_ptr<const KeyframeIndex> index = read(cache_path(id), id);
+    if (index)
+        remember(id, index);
+    return index;
+}
+
+std::shared_ptr<const KeyframeIndex> KeyframeIndex::scan(const std::string &path,
+                                                         const std::atomic<bool> *cancel) {
+    AVFormatContext *raw = NULL;
+    if (avformat_open_input(&raw, path.c_str(), NULL, NULL) < 0)
+        return nullptr;
+    AVInputFormatContextPtr fmtCtx(raw);
+    if (avformat_find_stream_info(fmtCtx.get(), NULL) < 0)
+        return nullptr;
+    int video_idx = av_find_best_stream(fmtCtx.get(), AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (video_idx < 0)
+        return nullptr;
+
+    // the demuxer skips the payload of discarded streams
+    for (unsigned i = 0; i < fmtCtx->nb_streams; i++)
+        fmtCtx->streams[i]->discard =
+            static_cast<int>(i) == video_idx ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+
+    AVPacketPtr pkt(av_packet_alloc());
+    if (!pkt)
+        return nullptr;
+
+    std::shared_ptr<KeyframeIndex> index(new KeyframeIndex);
+    index->streamIndex = video_idx;
+    index->timeBase = fmtCtx->streams[video_idx]->time_base;
+    while (av_read_frame(fmtCtx.get(), pkt.get()) >= 0) {
+        if (cancel && cancel->load()) {
+            av_packet_unref(pkt.get());
+            return nullptr;
+        }
+        if (pkt->stream_index == video_idx) {
+            index->packetCount++;
+            int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+            if ((pkt->flags & AV_PKT_FLAG_KEY) && ts != AV_NOPTS_VALUE)
+                index->keyframes.push_back({ts, pkt->pos});
+        }
+        av_packet_unref(pkt.get());
+    }
+
+    std::vector<Keyframe> &keyframes = index->keyframes;
+    std::sort(keyframes.begin(), keyframes.end(),
+              [](const Keyframe &a, const Keyframe &b) { return a.pts < b.pts; });
+    keyframes.erase(std::unique(keyframes.begin(), keyframes.end(),
+                                [](const Keyframe &a, const Keyframe &b) { return a.pts == b.pts; }),
+                    keyframes.end());
+    return index;
+}
+
+std::string KeyframeIndex::cache_dir() {
+    if (const char *env = std::getenv("OC_KEYFRAME_INDEX_DIR"))
+        return env;
+
+    fs::path dir;
+#if defined(_WIN32)
+    if (const char *localAppData = std::getenv("LOCALAPPDATA"))
+        dir = fs::path(localAppData) / "OpenConverter";
+#elif defined(__APPLE__)
+    if (const char *home = std::getenv("HOME"))
+        dir = fs::path(home) / "Library" / "Caches" / "OpenConverter";
+#else
+    if (const char *cacheHome = std::getenv("XDG_CACHE_HOME"))
+        dir = fs::path(cacheHome) / "OpenConverter";
+    else if (const char *home = std::getenv("HOME"))
+        dir = fs::path(home) / ".cache" / "OpenConverter";
+#endif
+    if (dir.empty())
+        dir = fs::temp_directory_path() / "OpenConverter";
+    return (dir / "keyframes").string();
+}
+
+const KeyframeIndex::Keyframe *KeyframeIndex::at_or_before(int64_t time) const {
+    // compared in the units time_of() returns, so a keyframe time handed
+    // back by the index finds that same keyframe
+    auto it = std::upper_bound(keyframes.begin(), keyframes.end(), time,
+                               [this](int64_t value, const Keyframe &k) { return value < time_of(k); });
+    if (it == keyframes.begin())
+        return nullptr;
+    return &*(it - 1);
+}
+
+int64_t KeyframeIndex::time_of(const Keyframe &keyframe) const {
+    return av_rescale_q(keyframe.pts, timeBase, AVRational{1, AV_TIME_BASE});
+}
+
+int64_t KeyframeIndex::seek(AVFormatContext *fmtCtx, int64_t time) const {
+    const Keyframe *keyframe = at_or_before(time);
+    if (!keyframe || streamIndex >= static_cast<int>(fmtCtx->nb_streams))
+        return AV_NOPTS_VALUE;
+    // the exact keyframe pts, the backward flag covers demuxers that
+    // only seek approximately
+    if (av_seek_frame(fmtCtx, streamIndex, keyframe->pts, AVSEEK_FLAG_BACKWARD) < 0)
+        return AV_NOPTS_VALUE;
+    return time_of(*keyframe);
+}
+
+std::string KeyframeIndex::identity(const std::string &path) {
+    std::error_code ec;
+    fs::path absolute = fs::absolute(path, ec);
+    if (ec)
+        return "";
+    uintmax_t size = fs::file_size(absolute, ec);
+    if (ec)
+        return "";
+    fs::file_time_type mtime = fs::last_write_time(absolute, ec);
+    if (ec)
+        return "";
+
+    std::ostringstream id;
+    id << absolute.string() << '|' << size << '|'
+       << std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+    return id.str();
+}
+
+std::string KeyframeIndex::cache_path(const std::string &identity) {
+    AVMurMur3 *ctx = av_murmur3_alloc();
+    if (!ctx)
+        return "";
+    uint8_t digest[16];
+    av_murmur3_init(ctx);
+    av_murmur3_update(ctx, reinterpret_cast<const uint8_t *>(identity.data()), identity.size());
+    av_murmur3_final(ctx, digest);
+    av_free(ctx);
+
+    char hex[33];
+    for (int i = 0; i < 16; i++)
+        std::snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+    return (fs::path(cache_dir()) / (std::string(hex) + ".idx")).string();
+}
+
+std::shared_ptr<const KeyframeIndex> KeyframeIndex::read(const std::string &file,
+                                                         const std::string &identity) {
+    if (file.empty())
+        return nullptr;
+    std::ifstream in(file);
+    std::string header, storedIdentity;
+    if (!std::getline(in, header) || header != INDEX_HEADER ||
+        !std::getline(in, storedIdentity) || storedIdentity != identity)
+        return nullptr;
+
+    std::shared_ptr<KeyframeIndex> index(new KeyframeIndex);
+    size_t count = 0;
+    if (!(in >> index->streamIndex >> index->timeBase.num >> index->timeBase.den
+             >> index->packetCount >> count) ||
+        index->streamIndex < 0 || index->timeBase.num <= 0 || index->timeBase.den <= 0)
+        return nullptr;
+
+    index->keyframes.reserve(count);
+    Keyframe keyframe;
+    while (index->keyframes.size() < count && in >> keyframe.pts >> keyframe.pos)
+        index->keyframes.push_back(keyframe);
+    // a file cut short by a crash is scanned again
+    if (index->keyframes.size() != count)
+        return nullptr;
+    return index;
+}
+
+bool KeyframeIndex::write(const std::string &file, const std::string &identity) const {
+    if (file.empty())
+        return false;
+    std::error_code ec;
+    fs::create_directories(fs::path(file).parent_path(), ec);
+
+    // written aside and renamed, readers never see a partial index
+    std::string tmp = file + unique_suffix();
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out)
+            return false;
+        out << INDEX_HEADER << '\n' << identity << '\n'
+            << streamIndex << ' ' << timeBase.num << ' ' << timeBase.den << ' '
+            << packetCount << ' ' << keyframes.size() << '\n';
+        for (const Keyframe &keyframe : keyframes)
+            out << keyframe.pts << ' ' << keyframe.pos << '\n';
+        if (!out.flush()) {
+            out.close();
+            fs::remove(tmp, ec);
+            return false;
+        }
+    }
+    fs::rename(tmp, file, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
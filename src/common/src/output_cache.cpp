@@ -0,0 +1,356 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/output_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/avutil.h>
+#include <libavutil/mem.h>
+#include <libavutil/murmur3.h>
+}
+
+#if defined(__linux__)
+    #include <fcntl.h>
+    #include <linux/fs.h>
+    #include <sys/ioctl.h>
+    #include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::unique_ptr<OutputCache> sharedCache;
+std::once_flag sharedFromEnvironment;
+std::mutex sharedMutex;
+
+// Bump when the transcoders change what they write for the same settings
+const char *CACHE_FORMAT = "1";
+
+// Recency stamp next to each object
+const char *USED_EXT = ".used";
+
+// Copy-on-write clone, only on filesystems that support it (Btrfs, XFS)
+bool reflink(const fs::path &from, const fs::path &to) {
+#if defined(__linux__) && defined(FICLONE)
+    int in = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0)
+        return false;
+    int out = open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (out < 0) {
+        close(in);
+        return false;
+    }
+    bool ok = ioctl(out, FICLONE, in) == 0;
+    close(in);
+    close(out);
+    if (!ok)
+        unlink(to.c_str());
+    return ok;
+#else
+    (void)from;
+    (void)to;
+    return false;
+#endif
+}
+
+enum class Materialized { Failed, NewFile, Linked };
+
+// Reflink, hard link or copy from to to, which must not exist
+Materialized materialize(const fs::path &from, const fs::path &to, bool allowLink) {
+    std::error_code ec;
+    if (reflink(from, to))
+        return Materialized::NewFile;
+    if (allowLink) {
+        fs::create_hard_link(from, to, ec);
+        if (!ec)
+            return Materialized::Linked;
+    }
+    fs::copy_file(from, to, ec);
+    return ec ? Materialized::Failed : Materialized::NewFile;
+}
+
+std::string unique_suffix() {
+    static std::atomic<unsigned> counter(0);
+    std::ostringstream suffix;
+    suffix << ".tmp." << std::hex
+           << std::chrono::steady_clock::now().time_since_epoch().count() << "."
+           << counter++;
+    return suffix.str();
+}
+
+} // namespace
+
+OutputCache::OutputCache(const std::string &cacheDir, uint64_t maxBytes)
+    : dir(cacheDir), maxBytes(maxBytes) {}
+
+OutputCache *OutputCache::shared() {
+    std::call_once(sharedFromEnvironment, [] {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        const char *env = std::getenv("OC_OUTPUT_CACHE");
+        if (sharedCache || !env || !*env)
+            return;
+        const char *mb = std::getenv("OC_OUTPUT_CACHE_MB");
+        uint64_t maxMB = mb ? std::strtoull(mb, NULL, 10) : 0;
+        sharedCache.reset(new OutputCache(env, (maxMB ? maxMB : 20480) << 20));
+    });
+    std::lock_guard<std::mutex> lock(sharedMutex);
+    return sharedCache.get();
+}
+
+void OutputCache::configure_shared(const std::string &cacheDir, uint64_t maxBytes) {
+    std::lock_guard<std::mutex> lock(sharedMutex);
+    sharedCache.reset(cacheDir.empty() ? nullptr : new OutputCache(cacheDir, maxBytes));
+}
+
+uint64_t OutputCache::get_max_bytes() { return maxBytes; }
+
+std::string OutputCache::hash_file(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return std::string();
+
+    AVMurMur3 *murmur = av_murmur3_alloc();
+    if (!murmur)
+        return std::string();
+    av_murmur3_init(murmur);
+    std::vector<char> buffer(1 << 20);
+    while (file) {
+        file.read(buffer.data(), buffer.size());
+        if (file.gcount() > 0)
+            av_murmur3_update(murmur, reinterpret_cast<const uint8_t *>(buffer.data()),
+                              static_cast<size_t>(file.gcount()));
+    }
+    uint8_t digest[16];
+    av_murmur3_final(murmur, digest);
+    av_free(murmur);
+
+    char hex[33];
+    for (int i = 0; i < 16; i++)
+        snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+    return hex;
+}
+
+std::string OutputCache::key(const std::string &src, const std::string &dst,
+                             const std::string &transcoderName,
+                             EncodeParameter *param) {
+    std::string content = hash_file(src);
+    if (content.empty())
+        return std::string();
+
+    // Canonical form of everything the output bytes depend on; the
+    // thread count and the checkpoint/distribution settings do not change
+    // the result
+    std::ostringstream canonical;
+    canonical << CACHE_FORMAT << '\n'
+              << content << '\n'
+              << fs::path(dst).extension().string() << '\n'
+              << transcoderName << '\n'
+              << av_version_info() << '|' << avcodec_version() << '|'
+              << avformat_version() << '\n'
+              << param->get_video_codec_name() << '\n'
+              << param->get_video_bit_rate() << '\n'
+              << param->get_pixel_format() << '\n'
+              << param->get_width() << 'x' << param->get_height() << '\n'
+              << param->get_audio_codec_name() << '\n'
+              << param->get_audio_bit_rate() << '\n'
+              << param->get_qscale() << '\n'
+              << param->get_preset() << '\n'
+              << param->get_start_time() << '\n'
+              << param->get_end_time() << '\n'
+              << static_cast<int>(param->get_algo_mode()) << '\n'
+              << param->get_upscale_factor() << '\n';
+    if (param->has_segment_window())
+        canonical << param->get_segment_begin() << '-' << param->get_segment_end() << '\n';
+
+    std::string text = canonical.str();
+    AVMurMur3 *murmur = av_murmur3_alloc();
+    if (!murmur)
+        return std::string();
+    av_murmur3_init(murmur);
+    av_murmur3_update(murmur, reinterpret_cast<const uint8_t *>(text.data()), text.size());
+    uint8_t digest[16];
+    av_murmur3_final(murmur, digest);
+    av_free(murmur);
+
+    char hex[33];
+    for (int i = 0; i < 16; i++)
+        snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+    return hex;
+}
+
+std::string OutputCache::object_path(const std::string &key, const std::string &dst) {
+    // Two-level fan-out keeps directories small
+    return (fs::path(dir) / key.substr(0, 2) /
+            (key + fs::path(dst).extension().string()))
+        .string();
+}
+
+bool OutputCache::fetch(const std::string &key, const std::string &dst) {
+    if (key.empty())
+        return false;
+    fs::path object = object_path(key, dst);
+    std::error_code ec;
+    if (!fs::is_regular_file(object, ec))
+        return false;
+
+    // Deliver next to dst and rename, dst is never half written
+    fs::path tmp = dst + unique_suffix();
+    Materialized how = materialize(object, tmp, true);
+    if (how == Materialized::Failed)
+        return false;
+    // A hard link stays read-only like the object it shares, a clone or
+    // copy is the caller's own file
+    if (how == Materialized::NewFile)
+        fs::permissions(tmp, fs::perms::owner_write, fs::perm_options::add, ec);
+    fs::remove(dst, ec);
+    fs::rename(tmp, dst, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+
+    mark_used(object.string());
+    return true;
+}
+
+void OutputCache::detach(const std::string &dst) {
+    // Objects are read-only, an output written by a transcoder is not
+    std::error_code ec;
+    fs::file_status status = fs::status(dst, ec);
+    if (ec || !fs::is_regular_file(status) ||
+        (status.permissions() & fs::perms::owner_write) != fs::perms::none)
+        return;
+    if (fs::hard_link_count(dst, ec) > 1 && !ec)
+        fs::remove(dst, ec);
+}
+
+void OutputCache::mark_used(const std::string &object) {
+    // A new file renamed over the stamp: needs only write access to the
+    // directory, unlike setting the mtime of a file of another user
+    std::error_code ec;
+    fs::path stamp = object + USED_EXT;
+    fs::path tmp = stamp.string() + unique_suffix();
+    std::ofstream(tmp).close();
+    fs::rename(tmp, stamp, ec);
+    if (ec)
+        fs::remove(tmp, ec);
+}
+
+void OutputCache::store(const std::string &key, const std::string &dst) {
+    if (key.empty())
+        return;
+    std::error_code ec;
+    fs::path object = object_path(key, dst);
+    if (fs::exists(object, ec))
+        return;
+    fs::create_directories(object.parent_path(), ec);
+
+    // A copy, not a link: the caller may still edit its output
+    fs::path tmp = object.string() + unique_suffix();
+    if (materialize(dst, tmp, false) == Materialized::Failed)
+        return;
+    fs::permissions(tmp, fs::perms::owner_read | fs::perms::group_read | fs::perms::others_read,
+                    fs::perm_options::replace, ec);
+    fs::rename(tmp, object, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return;
+    }
+    mark_used(object.string());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!scanned) {
+        // Includes the new object
+        totalBytes = scan();
+        scanned = true;
+    } else {
+        totalBytes += fs::file_size(object, ec);
+    }
+    // Other processes add to the store too; the count is exact again
+    // after every eviction
+    if (totalBytes > maxBytes)
+        evict();
+}
+
+uint64_t OutputCache::scan() {
+    uint64_t total = 0;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(dir, ec), end; !ec && it != end;
+         it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        if (it->is_regular_file(ec) && name.find(".tmp.") == std::string::npos &&
+            it->path().extension() != USED_EXT)
+            total += it->file_size(ec);
+    }
+    return total;
+}
+
+void OutputCache::evict() {
+    struct Object {
+        fs::path path;
+        fs::file_time_type used;
+        uint64_t size;
+    };
+    std::vector<Object> objects;
+    uint64_t total = 0;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(dir, ec), end; !ec && it != end;
+         it.increment(ec)) {
+        // Skip objects other processes are still writing, and the stamps
+        if (!it->is_regular_file(ec) ||
+            it->path().filename().string().find(".tmp.") != std::string::npos ||
+            it->path().extension() == USED_EXT)
+            continue;
+        // An object without a stamp (stored by an older version) counts
+        // from its own mtime
+        std::error_code stampError;
+        fs::file_time_type used =
+            fs::last_write_time(it->path().string() + USED_EXT, stampError);
+        if (stampError)
+            used = it->last_write_time(ec);
+        Object object = {it->path(), used, it->file_size(ec)};
+        total += object.size;
+        objects.push_back(object);
+    }
+
+    std::sort(objects.begin(), objects.end(),
+              [](const Object &a, const Object &b) { return a.used < b.used; });
+    for (const Object &object : objects) {
+        if (total <= maxBytes)
+            break;
+        // Other processes may have removed it already
+        if (fs::remove(object.path, ec))
+            total -= object.size;
+        fs::remove(object.path.string() + USED_EXT, ec);
+    }
+    totalBytes = total;
+}
@@ -17,13 +17,34 @@
 
 #include "../include/process_parameter.h"
 #include <algorithm>
+#include <chrono>
 
-ProcessParameter::ProcessParameter() : processNumber(0), timeRequired(0.0) {}
+namespace {
+
+int64_t steady_now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace
+
+ProcessParameter::ProcessParameter()
+    : processNumber(0), timeRequired(0.0), cancelRequested(false),
+      stallTimeoutMs(0), lastActivityMs(steady_now_ms()) {}
+
+ProcessParameter::ProcessParameter(const ProcessParameter &other)
+    : processNumber(other.processNumber), timeRequired(other.timeRequired),
+      observers(other.observers),
+      cancelRequested(other.cancelRequested.load()),
+      stallTimeoutMs(other.stallTimeoutMs.load()),
+      lastActivityMs(other.lastActivityMs.load()) {}
 
 ProcessParameter::~ProcessParameter() = default;
 
 void ProcessParameter::set_process_number(int64_t frameNumber,
                                           int64_t frameTotalNumnber) {
+    touch();
     if (frameTotalNumnber > 0) {
         double progress =
             static_cast<double>(frameNumber) / frameTotalNumnber * 100.0;
@@ -33,6 +54,7 @@ void ProcessParameter::set_process_number(int64_t frameNumber,
 }
 
 void ProcessParameter::set_process_number(int64_t processNumber) {
+    touch();
     this->processNumber = processNumber;
     notify_process_update(static_cast<double>(processNumber));
 }
@@ -50,6 +72,30 @@ double ProcessParameter::get_time_required() { return timeRequired; }
 
 ProcessParameter ProcessParameter::get_process_parmeter() { return *this; }
 
+void ProcessParameter::request_cancel() { cancelRequested = true; }
+
+bool ProcessParameter::is_cancel_requested() const { return cancelRequested; }
+
+void ProcessParameter::set_stall_timeout(double seconds) {
+    stallTimeoutMs = seconds > 0 ? static_cast<int64_t>(seconds * 1000.0) : 0;
+    touch();
+}
+
+double ProcessParameter::get_stall_timeout() const {
+    return stallTimeoutMs / 1000.0;
+}
+
+void ProcessParameter::touch() { lastActivityMs = steady_now_ms(); }
+
+bool ProcessParameter::is_stalled() const {
+    int64_t timeout = stallTimeoutMs;
+    return timeout > 0 && steady_now_ms() - lastActivityMs > timeout;
+}
+
+bool ProcessParameter::should_stop() const {
+    return cancelRequested || is_stalled();
+}
+
 void ProcessParameter::add_observer(ProcessObserver* observer) {
     if (observer) {
         observers.push_back(observer);
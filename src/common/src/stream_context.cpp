@@ -14,6 +14,7 @@
  */
 
 #include "../include/stream_context.h"
+#include "../include/av_resource.h"
 
 StreamContext::StreamContext() {
     fmtCtx = NULL;
@@ -34,6 +35,13 @@ StreamContext::StreamContext() {
 }
 
 StreamContext::~StreamContext() {
+    if (fmtCtx) {
+        if (fmtCtx->iformat)
+            AVInputFormatContextDeleter()(fmtCtx);
+        else
+            AVOutputFormatContextDeleter()(fmtCtx);
+        fmtCtx = NULL;
+    }
     if (videoCodecCtx) {
         avcodec_free_context(&videoCodecCtx);
         videoCodecCtx = NULL;
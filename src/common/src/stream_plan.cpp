@@ -0,0 +1,202 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/stream_plan.h"
+#include "../include/av_resource.h"
+#include "../include/encode_parameter.h"
+#include "../include/info.h"
+
+#include <sstream>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+namespace {
+
+std::string codec_name(AVCodecID id) {
+    const char *name = avcodec_get_name(id);
+    return name ? name : "unknown";
+}
+
+// Encoder the transcoders pick for "auto", by container and file name
+std::string default_encoder(const AVOutputFormat *format, const std::string &dst,
+                            AVMediaType type) {
+    AVCodecID id = av_guess_codec(format, NULL, dst.c_str(), NULL, type);
+    const AVCodec *codec = avcodec_find_encoder(id);
+    return codec ? codec->name : "auto";
+}
+
+// Why a video stream left to "auto" has to be encoded, empty if it need not
+std::string video_encode_reason(EncodeParameter *param, const AVCodecParameters *par) {
+    if (param->get_algo_mode() == AlgoMode::Upscale)
+        return "AI upscaling";
+    if ((param->get_width() > 0 && param->get_width() != par->width) ||
+        (param->get_height() > 0 && param->get_height() != par->height))
+        return "scaling to " + std::to_string(param->get_width()) + "x" +
+               std::to_string(param->get_height());
+    std::string pixelFormat = param->get_pixel_format();
+    if (!pixelFormat.empty() && av_get_pix_fmt(pixelFormat.c_str()) != par->format)
+        return "converting to " + pixelFormat;
+    int64_t bitRate = param->get_video_bit_rate();
+    if (bitRate > 0 && (par->bit_rate <= 0 || par->bit_rate > bitRate))
+        return "bit rate of " + std::to_string(bitRate / 1000) + " kb/s requested";
+    if (param->get_qscale() != -1)
+        return "quality requested";
+    if (!param->get_preset().empty())
+        return "preset requested";
+    // A copied cut can only start at a keyframe
+    if (param->get_start_time() > 0.0 || param->get_end_time() > 0.0)
+        return "frame-accurate cut";
+    if (param->get_checkpoint_interval() > 0.0 || !param->get_distribute_dir().empty() ||
+        param->has_segment_window())
+        return "segmented encoding";
+    return "";
+}
+
+std::string audio_encode_reason(EncodeParameter *param, const AVCodecParameters *par) {
+    int64_t bitRate = param->get_audio_bit_rate();
+    if (bitRate > 0 && (par->bit_rate <= 0 || par->bit_rate > bitRate))
+        return "bit rate of " + std::to_string(bitRate / 1000) + " kb/s requested";
+    return "";
+}
+
+StreamPlan::Stream plan_stream(AVFormatContext *fmtCtx, AVMediaType type,
+                               const AVOutputFormat *format, const std::string &dst,
+                               EncodeParameter *param) {
+    StreamPlan::Stream stream;
+    // The transcoders convert the last stream of each type
+    const AVCodecParameters *par = NULL;
+    for (unsigned i = 0; i < fmtCtx->nb_streams; i++) {
+        if (fmtCtx->streams[i]->codecpar->codec_type == type)
+            par = fmtCtx->streams[i]->codecpar;
+    }
+    if (!par) {
+        stream.reason = "no input stream";
+        return stream;
+    }
+    stream.sourceCodec = codec_name(par->codec_id);
+
+    AVCodecID containerDefault = type == AVMEDIA_TYPE_VIDEO ? format->video_codec
+                                                           : format->audio_codec;
+    if (containerDefault == AV_CODEC_ID_NONE) {
+        stream.reason = std::string(format->name) + " takes no " +
+                        (type == AVMEDIA_TYPE_VIDEO ? "video" : "audio");
+        return stream;
+    }
+
+    std::string requestedCodec = type == AVMEDIA_TYPE_VIDEO ? param->get_video_codec_name()
+                                                            : param->get_audio_codec_name();
+    if (requestedCodec == "copy") {
+        stream.action = StreamPlan::Action::Copy;
+        stream.targetCodec = "copy";
+        stream.reason = "copy requested";
+        return stream;
+    }
+    if (!requestedCodec.empty()) {
+        stream.action = StreamPlan::Action::Encode;
+        stream.targetCodec = requestedCodec;
+        stream.reason = requestedCodec + " requested";
+        return stream;
+    }
+
+    stream.action = StreamPlan::Action::Encode;
+    stream.targetCodec = default_encoder(format, dst, type);
+    std::string settingsReason = type == AVMEDIA_TYPE_VIDEO ? video_encode_reason(param, par)
+                                                            : audio_encode_reason(param, par);
+    if (!settingsReason.empty()) {
+        stream.reason = settingsReason;
+    } else if (avformat_query_codec(format, par->codec_id, FF_COMPLIANCE_NORMAL) != 1) {
+        // < 0 means the muxer cannot tell, encode to be safe
+        stream.reason = std::string(format->name) + " does not take " + stream.sourceCodec;
+    } else {
+        stream.action = StreamPlan::Action::Copy;
+        stream.targetCodec = "copy";
+        stream.reason = std::string(format->name) + " takes " + stream.sourceCodec + " as is";
+    }
+    return stream;
+}
+
+const char *action_name(StreamPlan::Action action) {
+    switch (action) {
+    case StreamPlan::Action::Copy:
+        return "copy";
+    case StreamPlan::Action::Encode:
+        return "encode";
+    case StreamPlan::Action::Drop:
+        break;
+    }
+    return "drop";
+}
+
+void describe_stream(std::ostringstream &out, const char *kind, const StreamPlan::Stream &stream) {
+    out << kind << ": " << action_name(stream.action);
+    if (!stream.sourceCodec.empty())
+        out << " " << stream.sourceCodec;
+    if (stream.action == StreamPlan::Action::Encode)
+        out << " -> " << stream.targetCodec;
+    out << " (" << stream.reason << ")\n";
+}
+
+} // namespace
+
+bool StreamPlan::build(const std::string &src, const std::string &dst,
+                       EncodeParameter *encodeParameter, StreamPlan &plan,
+                       std::string &error) {
+    const AVOutputFormat *format = av_guess_format(NULL, dst.c_str(), NULL);
+    if (!format) {
+        error = "no muxer for the output file " + dst;
+        return false;
+    }
+
+    AVFormatContext *raw = NULL;
+    int ret = Info::open_input(&raw, src.c_str(), true);
+    if (!raw) {
+        error = "cannot open " + src;
+        return false;
+    }
+    AVInputFormatContextPtr fmtCtx(raw);
+    if (ret < 0) {
+        error = "cannot read the streams of " + src;
+        return false;
+    }
+
+    plan.container = format->name;
+    plan.video = plan_stream(fmtCtx.get(), AVMEDIA_TYPE_VIDEO, format, dst, encodeParameter);
+    plan.audio = plan_stream(fmtCtx.get(), AVMEDIA_TYPE_AUDIO, format, dst, encodeParameter);
+    return true;
+}
+
+bool StreamPlan::apply(EncodeParameter *encodeParameter) const {
+    bool changed = false;
+    if (video.action == Action::Copy && encodeParameter->get_video_codec_name().empty()) {
+        encodeParameter->set_video_codec_name("copy");
+        changed = true;
+    }
+    if (audio.action == Action::Copy && encodeParameter->get_audio_codec_name().empty()) {
+        encodeParameter->set_audio_codec_name("copy");
+        changed = true;
+    }
+    return changed;
+}
+
+std::string StreamPlan::describe() const {
+    std::ostringstream out;
+    describe_stream(out, "video", video);
+    describe_stream(out, "audio", audio);
+    return out.str();
+}
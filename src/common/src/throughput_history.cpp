@@ -0,0 +1,318 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/throughput_history.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/file.h>
+    #include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// Rewrite the file once it holds this many raw samples
+static const size_t MAX_HISTORY_LINES = 2000;
+
+namespace {
+
+// Exclusive lock on "<history>.lock" across processes, held while a
+// sample is appended or the file is compacted; best effort, an
+// unlockable file only loses the cross-process guarantee
+class HistoryFileLock {
+public:
+    explicit HistoryFileLock(const std::string &historyPath) {
+        std::string lockPath = historyPath + ".lock";
+#if defined(_WIN32)
+        handle = CreateFileA(lockPath.c_str(), GENERIC_READ | GENERIC_WRITE,
+                             FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_ALWAYS,
+                             FILE_ATTRIBUTE_NORMAL, NULL);
+        if (handle != INVALID_HANDLE_VALUE) {
+            OVERLAPPED overlapped = {};
+            LockFileEx(handle, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped);
+        }
+#else
+        fd = open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd >= 0)
+            flock(fd, LOCK_EX);
+#endif
+    }
+
+    ~HistoryFileLock() {
+#if defined(_WIN32)
+        if (handle != INVALID_HANDLE_VALUE) {
+            OVERLAPPED overlapped = {};
+            UnlockFileEx(handle, 0, MAXDWORD, MAXDWORD, &overlapped);
+            CloseHandle(handle);
+        }
+#else
+        if (fd >= 0) {
+            flock(fd, LOCK_UN);
+            close(fd);
+        }
+#endif
+    }
+
+private:
+#if defined(_WIN32)
+    HANDLE handle = INVALID_HANDLE_VALUE;
+#else
+    int fd = -1;
+#endif
+};
+
+std::string unique_tmp_path(const std::string &path) {
+    static std::atomic<unsigned> counter(0);
+    std::ostringstream tmp;
+    tmp << path << ".tmp." << std::hex
+        << std::chrono::steady_clock::now().time_since_epoch().count() << "."
+        << counter++;
+    return tmp.str();
+}
+
+} // namespace
+
+ThroughputHistory::ThroughputHistory(const std::string &historyPath)
+    : path(historyPath) {
+    load();
+}
+
+ThroughputHistory &ThroughputHistory::shared() {
+    static ThroughputHistory history(default_path());
+    return history;
+}
+
+std::string ThroughputHistory::default_path() {
+    if (const char *env = std::getenv("OC_THROUGHPUT_HISTORY"))
+        return env;
+
+    fs::path dir;
+#if defined(_WIN32)
+    if (const char *appData = std::getenv("APPDATA"))
+        dir = fs::path(appData) / "OpenConverter";
+#elif defined(__APPLE__)
+    if (const char *home = std::getenv("HOME"))
+        dir = fs::path(home) / "Library" / "Application Support" / "OpenConverter";
+#else
+    if (const char *dataHome = std::getenv("XDG_DATA_HOME"))
+        dir = fs::path(dataHome) / "OpenConverter";
+    else if (const char *home = std::getenv("HOME"))
+        dir = fs::path(home) / ".local" / "share" / "OpenConverter";
+#endif
+    if (dir.empty())
+        dir = fs::temp_directory_path() / "OpenConverter";
+    return (dir / "throughput_history.txt").string();
+}
+
+std::string ThroughputHistory::job_key(const std::string &operation,
+                                       const std::string &videoCodec,
+                                       const std::string &preset, int height) {
+    // Bucket the source height so 1072p and 1080p share their history
+    int bucket = 2160;
+    if (height <= 0)
+        bucket = 0;
+    else if (height <= 480)
+        bucket = 480;
+    else if (height <= 720)
+        bucket = 720;
+    else if (height <= 1080)
+        bucket = 1080;
+    else if (height <= 1440)
+        bucket = 1440;
+
+    return operation + "/" + (videoCodec.empty() ? "auto" : videoCodec) + "/" +
+           (preset.empty() ? "default" : preset) + "/" + std::to_string(bucket);
+}
+
+void ThroughputHistory::load() {
+    lineCount = read_file(entries);
+}
+
+size_t ThroughputHistory::read_file(std::map<std::string, Entry> &into) {
+    std::ifstream file(path);
+    std::string line;
+    size_t lines = 0;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        ThroughputSample sample;
+        int samples = 0;
+        if (!std::getline(fields, sample.transcoder, '\t') ||
+            !std::getline(fields, sample.jobKey, '\t') ||
+            !(fields >> sample.mediaSeconds >> sample.elapsedSeconds >>
+              sample.frames >> samples))
+            continue; // skip truncated or foreign lines
+        add(into, sample, samples);
+        lines++;
+    }
+    return lines;
+}
+
+void ThroughputHistory::add(std::map<std::string, Entry> &into,
+                            const ThroughputSample &sample, int samples) {
+    if (sample.mediaSeconds <= 0.0 || sample.elapsedSeconds <= 0.0 || samples <= 0)
+        return;
+    Entry &entry = into[sample.jobKey + "\t" + sample.transcoder];
+    entry.mediaSeconds += sample.mediaSeconds;
+    entry.elapsedSeconds += sample.elapsedSeconds;
+    entry.frames += sample.frames;
+    entry.samples += samples;
+}
+
+void ThroughputHistory::compact() {
+    // The file, not this process's view: other processes appended to it
+    // since it was loaded. The caller holds the file lock, so no sample
+    // lands between reading and replacing it.
+    std::map<std::string, Entry> merged;
+    read_file(merged);
+
+    std::string tmpPath = unique_tmp_path(path);
+    {
+        std::ofstream file(tmpPath, std::ios::trunc);
+        if (!file)
+            return;
+        for (const auto &it : merged) {
+            const Entry &entry = it.second;
+            size_t tab = it.first.find('\t');
+            file << it.first.substr(tab + 1) << '\t' << it.first.substr(0, tab)
+                 << '\t' << entry.mediaSeconds << '\t' << entry.elapsedSeconds
+                 << '\t' << entry.frames << '\t' << entry.samples << '\n';
+        }
+        if (!file) {
+            file.close();
+            std::error_code ec;
+            fs::remove(tmpPath, ec);
+            return;
+        }
+    }
+    std::error_code ec;
+    fs::rename(tmpPath, path, ec);
+    if (ec) {
+        fs::remove(tmpPath, ec);
+        return;
+    }
+    entries.swap(merged);
+    lineCount = entries.size();
+}
+
+void ThroughputHistory::record(const ThroughputSample &sample) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (sample.mediaSeconds <= 0.0 || sample.elapsedSeconds <= 0.0)
+        return;
+    add(entries, sample, 1);
+
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    HistoryFileLock fileLock(path);
+    {
+        std::ofstream file(path, std::ios::app);
+        if (!file)
+            return;
+        file << sample.transcoder << '\t' << sample.jobKey << '\t'
+             << sample.mediaSeconds << '\t' << sample.elapsedSeconds << '\t'
+             << sample.frames << "\t1\n";
+    }
+    if (++lineCount >= MAX_HISTORY_LINES)
+        compact();
+}
+
+double ThroughputHistory::speed_of(const std::string &jobKey,
+                                   const std::string &transcoder) {
+    auto it = entries.find(jobKey + "\t" + transcoder);
+    if (it == entries.end() || it->second.elapsedSeconds <= 0.0)
+        return -1.0;
+    return it->second.mediaSeconds / it->second.elapsedSeconds;
+}
+
+double ThroughputHistory::get_speed(const std::string &jobKey,
+                                    const std::string &transcoder) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return speed_of(jobKey, transcoder);
+}
+
+double ThroughputHistory::get_fps(const std::string &jobKey,
+                                  const std::string &transcoder) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(jobKey + "\t" + transcoder);
+    if (it == entries.end() || it->second.elapsedSeconds <= 0.0 ||
+        it->second.frames <= 0)
+        return -1.0;
+    return it->second.frames / it->second.elapsedSeconds;
+}
+
+double ThroughputHistory::predict_seconds(const std::string &jobKey,
+                                          const std::string &transcoder,
+                                          double mediaSeconds) {
+    if (mediaSeconds <= 0.0)
+        return -1.0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    double speed = speed_of(jobKey, transcoder);
+
+    // Same job shape measured on another transcoder
+    if (speed <= 0.0) {
+        for (const auto &it : entries) {
+            size_t tab = it.first.find('\t');
+            if (it.first.compare(0, tab, jobKey) == 0) {
+                speed = speed_of(jobKey, it.first.substr(tab + 1));
+                if (speed > 0.0)
+                    break;
+            }
+        }
+    }
+
+    // Nearest resolution bucket, assuming speed scales with pixel count
+    size_t slash = jobKey.rfind('/');
+    if (speed <= 0.0 && slash != std::string::npos) {
+        std::string prefix = jobKey.substr(0, slash + 1);
+        double height = std::atof(jobKey.c_str() + slash + 1);
+        double bestDistance = -1.0;
+        for (const auto &it : entries) {
+            if (it.first.compare(0, prefix.size(), prefix) != 0 ||
+                it.second.elapsedSeconds <= 0.0)
+                continue;
+            double otherHeight = std::atof(it.first.c_str() + prefix.size());
+            if (height <= 0.0 || otherHeight <= 0.0)
+                continue;
+            double distance = height > otherHeight ? height / otherHeight
+                                                   : otherHeight / height;
+            if (bestDistance < 0.0 || distance < bestDistance) {
+                bestDistance = distance;
+                double ratio = otherHeight / height;
+                speed = it.second.mediaSeconds / it.second.elapsedSeconds *
+                        ratio * ratio;
+            }
+        }
+    }
+
+    return speed > 0.0 ? mediaSeconds / speed : -1.0;
+}
+
+int ThroughputHistory::get_sample_count(const std::string &jobKey,
+                                        const std::string &transcoder) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(jobKey + "\t" + transcoder);
+    return it == entries.end() ? 0 : it->second.samples;
+}
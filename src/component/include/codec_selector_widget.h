@@ -27,7 +27,8 @@
  * @brief Reusable widget for codec selection with "auto" option
  *
  * Features:
- * - ComboBox with common codecs
+ * - ComboBox with the common codecs the linked FFmpeg provides, followed
+ *   by its other encoders
  * - "auto" option (default)
  * - Separate presets for video and audio codecs
  * - Optional label: "Codec:"
@@ -27,7 +27,7 @@
  * @brief Reusable widget for output format selection
  *
  * Features:
- * - ComboBox with common formats
+ * - ComboBox with the common formats the linked FFmpeg can mux
  * - Optional "auto" option
  * - Separate presets for video, audio, and image formats
  * - Optional label: "Output Format:"
@@ -22,6 +22,12 @@
 #include <QString>
 #include <QThread>
 #include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QQueue>
+#include <QSize>
+#include <atomic>
+#include <memory>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -31,7 +37,23 @@ extern "C" {
 #include <libswscale/swscale.h>
 }
 
-// Simple FFmpeg-based video player widge
+class KeyframeIndex;
+class QResizeEvent;
+
+/*
+ * Simple FFmpeg-based video player widget
+ *
+ * Demuxing, decoding and color conversion run on a decode thread, which
+ * scales each frame straight to the size it is shown at and queues it in
+ * a small ring of ready frames. The GUI thread only takes frames off the
+ * ring when their pts is due against a wall clock, dropping frames that
+ * are already late, so a slow decode never blocks the event loop.
+ *
+ * A KeyframeIndex of the file is loaded (or built by a packet scan) in the
+ * background. Once it is there a seek jumps to the keyframe that starts
+ * the target's GOP, or decodes on without seeking when the target lies
+ * ahead in the GOP being decoded.
+ */
 class SimpleVideoPlayer : public QLabel {
     Q_OBJECT
 
@@ -53,40 +75,85 @@ public:
     qint64 GetPosition() const { return currentPositionMs; }
     qint64 GetDuration() const { return durationMs; }
 
+    // Keyframe a stream copy cut at positionMs starts from, -1 until the
+    // file is indexed
+    qint64 KeyframeAtOrBefore(qint64 positionMs);
+
 signals:
     void PositionChanged(qint64 position);
     void DurationChanged(qint64 duration);
+    void KeyframeIndexReady();
+
+protected:
+    void resizeEvent(QResizeEvent *event) override;
 
 private slots:
     void OnPlaybackTimer();
 
 private:
+    struct DecodedFrame {
+        QImage image;
+        qint64 ptsMs;
+    };
+
+    // Frames decoded ahead of presentation
+    static const int RING_SIZE = 4;
+
     void CloseVideo();
+    void StartDecodeThread();
+    void StopDecodeThread();
+    void StartIndexThread(const QString &filePath);
+    void StopIndexThread();
+
+    // Decode thread
+    void DecodeLoop();
     bool DecodeNextFrame();
-    void DisplayFrame(AVFrame *frame);
-    QImage ConvertFrameToQImage(AVFrame *frame);
+    void SeekStream(qint64 positionMs);
+    QImage ConvertFrameToQImage(AVFrame *frame, const QSize &targetSize);
+
+    // Size the video is shown at in the current widget size
+    QSize DisplaySize() const;
+    void DisplayImage(const QImage &image);
 
-    // FFmpeg components
+    // FFmpeg components, only used by the decode thread while it runs
     AVFormatContext *formatCtx;
     AVCodecContext *codecCtx;
     AVFrame *frame;
-    AVFrame *frameRGB;
     AVPacket *packet;
     SwsContext *swsCtx;
-    uint8_t *buffer;
+    bool draining;
+    qint64 lastDecodedMs;    // pts of the last decoded frame, -1 after a seek
 
     int videoStreamIndex;
     qint64 durationMs;
     qint64 currentPositionMs;
     double timeBase;
+    int videoWidth;
+    int videoHeight;
+    AVRational sampleAspectRatio;
 
     // Playback state
     bool isPlaying;
     bool isLoaded;
     QTimer *playbackTimer;
+    QElapsedTimer playbackClock;
+    qint64 clockOriginMs;    // pts shown when playbackClock started
+    bool resyncClock;        // re-anchor the clock on the next frame
+    bool presentNext;        // show the next frame even while paused
+
+    QThread *decodeThread;
+    QThread *indexThread;
+    std::atomic<bool> cancelIndexScan;
 
-    // Thread safety
+    // Guards everything below, shared with the decode thread
     QMutex mutex;
+    QWaitCondition ringNotFull;
+    QQueue<DecodedFrame> ring;
+    QSize targetSize;
+    qint64 seekTargetMs;     // -1 when no seek is pending
+    bool endOfStream;
+    bool stopDecoding;
+    std::shared_ptr<const KeyframeIndex> keyframeIndex;
 };
 
 #endif // SIMPLE_VIDEO_PLAYER_H
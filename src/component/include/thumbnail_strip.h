@@ -0,0 +1,106 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef THUMBNAIL_STRIP_H
+#define THUMBNAIL_STRIP_H
+
+#include <QImage>
+#include <QList>
+#include <QString>
+#include <QVector>
+#include <QWidget>
+#include <atomic>
+
+class QThread;
+
+/**
+ * @brief Row of thumbnails across the timeline of a video
+ *
+ * The thumbnails are generated in the background by a few worker threads,
+ * each with its own demuxer and decoder, that decode keyframes only
+ * (skip_frame = AVDISCARD_NONKEY) and scale them straight to thumbnail
+ * size. A finished strip is cached per file (path, size and modification
+ * time) as one JPEG, so a file opened again shows its strip at once.
+ *
+ * Clicking or dragging on the strip emits PositionClicked. The cut range
+ * is shaded and the playback position drawn as a line.
+ *
+ * Usage:
+ * @code
+ * ThumbnailStrip *strip = new ThumbnailStrip(this);
+ * connect(strip, &ThumbnailStrip::PositionClicked, player, &SimpleVideoPlayer::Seek);
+ * strip->LoadVideo(filePath);
+ * @endcode
+ */
+class ThumbnailStrip : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit ThumbnailStrip(QWidget *parent = nullptr);
+    ~ThumbnailStrip() override;
+
+    // Show the cached strip of the file or start generating it
+    void LoadVideo(const QString &filePath);
+    void Clear();
+
+    void SetDuration(qint64 durationMs);
+    void SetPosition(qint64 positionMs);
+    void SetSelection(qint64 startMs, qint64 endMs);
+
+    // <cache dir>/OpenConverter/thumbnails
+    static QString CacheDir();
+
+    static const int THUMBNAIL_COUNT = 24;
+    static const int THUMBNAIL_HEIGHT = 54;
+
+    QSize sizeHint() const override;
+
+signals:
+    void PositionClicked(qint64 positionMs);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+private:
+    void StartWorkers();
+    void StopWorkers();
+    void OnThumbnailReady(int generation, int index, const QImage &image);
+    bool LoadCache();
+    void SaveCache();
+    qint64 PositionAt(int x) const;
+
+    // Decode the thumbnails whose index is worker modulo workerCount
+    void GenerateThumbnails(const QString &path, int worker, int workerCount, int generation);
+
+    QString filePath;
+    QString cachePath;
+    QVector<QImage> thumbnails;
+    int readyCount;
+    int generation;  // bumped per file, results of older files are ignored
+
+    qint64 durationMs;
+    qint64 positionMs;
+    qint64 selectionStartMs;
+    qint64 selectionEndMs;
+
+    QList<QThread*> workers;
+    std::atomic<bool> cancel;
+};
+
+#endif // THUMBNAIL_STRIP_H
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WAVEFORM_WIDGET_H
+#define WAVEFORM_WIDGET_H
+
+#include <QString>
+#include <QVector>
+#include <QWidget>
+#include <atomic>
+#include <vector>
+#include "../../common/include/audio_peaks.h"
+
+class QThread;
+
+/**
+ * @brief Audio waveform overview of a file's timeline
+ *
+ * AudioPeaks scans the audio on a worker thread. The part of the waveform
+ * decoded so far is drawn while the scan runs. Finished peaks are cached
+ * per file (path, size and modification time), so reopening a file draws
+ * the waveform at once.
+ *
+ * Clicking or dragging emits PositionClicked. The cut range is shaded and
+ * the playback position drawn as a line, like on the ThumbnailStrip.
+ */
+class WaveformWidget : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit WaveformWidget(QWidget *parent = nullptr);
+    ~WaveformWidget() override;
+
+    // Show the cached waveform of the file or start scanning it
+    void LoadAudio(const QString &filePath);
+    void Clear();
+
+    void SetDuration(qint64 durationMs);
+    void SetPosition(qint64 positionMs);
+    void SetSelection(qint64 startMs, qint64 endMs);
+
+    // <cache dir>/OpenConverter/waveforms
+    static QString CacheDir();
+
+    static const int BUCKET_COUNT = 2048;
+
+    QSize sizeHint() const override;
+
+signals:
+    void PositionClicked(qint64 positionMs);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+private:
+    void StopWorker();
+    void OnPeaksUpdated(int generation, const std::vector<AudioPeaks::Bucket> &peaks, int filled);
+    void OnScanFinished(int generation, bool success);
+    bool LoadCache();
+    void SaveCache();
+    qint64 PositionAt(int x) const;
+
+    QString cachePath;
+    std::vector<AudioPeaks::Bucket> peaks;
+    int filled;      // peaks [0, filled) are final
+    int generation;  // bumped per file, results of older files are ignored
+
+    qint64 durationMs;
+    qint64 positionMs;
+    qint64 selectionStartMs;
+    qint64 selectionEndMs;
+
+    QThread *worker;
+    std::atomic<bool> cancel;
+};
+
+#endif // WAVEFORM_WIDGET_H
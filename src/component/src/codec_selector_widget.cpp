@@ -16,6 +16,7 @@
  */
 
 #include "codec_selector_widget.h"
+#include "../../common/include/codec_capabilities.h"
 #include <QHBoxLayout>
 
 CodecSelectorWidget::CodecSelectorWidget(CodecType type, QWidget *parent)
@@ -50,25 +51,38 @@ void CodecSelectorWidget::Initialize(CodecType type) {
 void CodecSelectorWidget::PopulateCodecs(CodecType type) {
     codecComboBox->clear();
 
+    QStringList commonCodecs;
+    AVMediaType mediaType;
     if (type == VideoCodec) {
-        codecComboBox->addItems({
-            "auto",
-            "libx264",
-            "libx265",
-            "libvpx",
-            "libvpx-vp9",
-            "mpeg4",
-            "copy"
-        });
+        commonCodecs = {"libx264", "libx265", "libvpx", "libvpx-vp9", "mpeg4"};
+        mediaType = AVMEDIA_TYPE_VIDEO;
     } else {  // AudioCodec
-        codecComboBox->addItems({
-            "auto",
-            "aac",
-            "libmp3lame",
-            "libvorbis",
-            "libopus",
-            "copy"
-        });
+        commonCodecs = {"aac", "libmp3lame", "libvorbis", "libopus"};
+        mediaType = AVMEDIA_TYPE_AUDIO;
+    }
+
+    // Only offer encoders the linked FFmpeg was built with
+    const CodecCapabilities &capabilities = CodecCapabilities::shared();
+    QStringList codecs = {"auto"};
+    for (const QString &codec : commonCodecs) {
+        if (capabilities.has_encoder(codec.toStdString(), mediaType)) {
+            codecs << codec;
+        }
+    }
+    codecs << "copy";
+    codecComboBox->addItems(codecs);
+
+    // Every other stable encoder of this type, after a separator
+    QStringList otherCodecs;
+    for (const std::string &name : capabilities.encoder_names(mediaType)) {
+        QString codec = QString::fromStdString(name);
+        if (!codecs.contains(codec) && !capabilities.find_encoder(name)->experimental) {
+            otherCodecs << codec;
+        }
+    }
+    if (!otherCodecs.isEmpty()) {
+        codecComboBox->insertSeparator(codecComboBox->count());
+        codecComboBox->addItems(otherCodecs);
     }
 
     codecComboBox->setCurrentText("auto");
@@ -16,6 +16,7 @@
  */
 
 #include "format_selector_widget.h"
+#include "../../common/include/codec_capabilities.h"
 #include <QHBoxLayout>
 
 FormatSelectorWidget::FormatSelectorWidget(FormatType type, bool includeAuto, QWidget *parent)
@@ -56,12 +57,21 @@ void FormatSelectorWidget::PopulateFormats(FormatType type, bool includeAuto) {
         formats << "auto";
     }
 
+    QStringList candidates;
     if (type == Video) {
-        formats << "mp4" << "mkv" << "avi" << "mov" << "flv" << "webm" << "ts";
+        candidates << "mp4" << "mkv" << "avi" << "mov" << "flv" << "webm" << "ts";
     } else if (type == Audio) {
-        formats << "mp3" << "aac" << "wav" << "flac" << "ogg" << "m4a";
+        candidates << "mp3" << "aac" << "wav" << "flac" << "ogg" << "m4a";
     } else {  // Image
-        formats << "jpg" << "png" << "bmp" << "webp" << "tiff" << "gif";
+        candidates << "jpg" << "png" << "bmp" << "webp" << "tiff" << "gif";
+    }
+
+    // Only offer formats the linked FFmpeg can mux
+    const CodecCapabilities &capabilities = CodecCapabilities::shared();
+    for (const QString &format : candidates) {
+        if (capabilities.muxer_for_file(format.toStdString())) {
+            formats << format;
+        }
     }
 
     formatComboBox->addItems(formats);
@@ -14,30 +14,50 @@
  */
 
 #include "simple_video_player.h"
+#include "../../common/include/info.h"
+#include "../../common/include/keyframe_index.h"
 #include <QDebug>
+#include <QMetaObject>
+#include <QPixmap>
+#include <QResizeEvent>
 
 SimpleVideoPlayer::SimpleVideoPlayer(QWidget *parent)
     : QLabel(parent),
       formatCtx(nullptr),
       codecCtx(nullptr),
       frame(nullptr),
-      frameRGB(nullptr),
       packet(nullptr),
       swsCtx(nullptr),
-      buffer(nullptr),
+      draining(false),
+      lastDecodedMs(-1),
       videoStreamIndex(-1),
       durationMs(0),
       currentPositionMs(0),
       timeBase(0.0),
+      videoWidth(0),
+      videoHeight(0),
+      sampleAspectRatio(AVRational{0, 1}),
       isPlaying(false),
-      isLoaded(false) {
+      isLoaded(false),
+      clockOriginMs(0),
+      resyncClock(false),
+      presentNext(false),
+      decodeThread(nullptr),
+      indexThread(nullptr),
+      cancelIndexScan(false),
+      seekTargetMs(-1),
+      endOfStream(false),
+      stopDecoding(false) {
 
     setAlignment(Qt::AlignCenter);
     setStyleSheet("background-color: black;");
     setMinimumSize(640, 360);
     setText("No video loaded");
 
+    // Rescheduled for the pts of the next frame each time it fires
     playbackTimer = new QTimer(this);
+    playbackTimer->setSingleShot(true);
+    playbackTimer->setTimerType(Qt::PreciseTimer);
     connect(playbackTimer, &QTimer::timeout, this, &SimpleVideoPlayer::OnPlaybackTimer);
 }
 
@@ -46,20 +66,15 @@ SimpleVideoPlayer::~SimpleVideoPlayer() {
 }
 
 bool SimpleVideoPlayer::LoadVideo(const QString &filePath) {
-    QMutexLocker locker(&mutex);
-
     CloseVideo();
 
-    // Open video file
-    if (avformat_open_input(&formatCtx, filePath.toStdString().c_str(), nullptr, nullptr) < 0) {
+    // Open video file, reading the headers and at most a short probe
+    int ret = Info::open_input(&formatCtx, filePath.toStdString().c_str(), true);
+    if (!formatCtx) {
         qDebug() << "Failed to open video file:" << filePath;
         return false;
     }
-
-    // Retrieve stream information (limit analysis to avoid blocking)
-    // Set max_analyze_duration to reduce blocking time
-    formatCtx->max_analyze_duration = 5 * AV_TIME_BASE; // 5 seconds max
-    if (avformat_find_stream_info(formatCtx, nullptr) < 0) {
+    if (ret < 0) {
         qDebug() << "Failed to find stream info";
         CloseVideo();
         return false;
@@ -114,41 +129,29 @@ bool SimpleVideoPlayer::LoadVideo(const QString &filePath) {
         return false;
     }
 
-    // Allocate frames
+    // Allocate frame and packet
     frame = av_frame_alloc();
-    frameRGB = av_frame_alloc();
     packet = av_packet_alloc();
 
-    if (!frame || !frameRGB || !packet) {
-        qDebug() << "Failed to allocate frames/packet";
+    if (!frame || !packet) {
+        qDebug() << "Failed to allocate frame/packet";
         CloseVideo();
         return false;
     }
 
-    // Allocate buffer for RGB frame
-    int numBytes = av_image_get_buffer_size(AV_PIX_FMT_RGB24, codecCtx->width, codecCtx->height, 1);
-    buffer = (uint8_t *)av_malloc(numBytes * sizeof(uint8_t));
-    av_image_fill_arrays(frameRGB->data, frameRGB->linesize, buffer, AV_PIX_FMT_RGB24,
-                        codecCtx->width, codecCtx->height, 1);
-
-    // Initialize SWS context for color conversion
-    swsCtx = sws_getContext(codecCtx->width, codecCtx->height, codecCtx->pix_fmt,
-                           codecCtx->width, codecCtx->height, AV_PIX_FMT_RGB24,
-                           SWS_BILINEAR, nullptr, nullptr, nullptr);
-
-    if (!swsCtx) {
-        qDebug() << "Failed to initialize SWS context";
-        CloseVideo();
-        return false;
-    }
+    // The GUI thread sizes the display from these, never from codecCtx
+    videoWidth = codecCtx->width;
+    videoHeight = codecCtx->height;
+    sampleAspectRatio = av_guess_sample_aspect_ratio(formatCtx, videoStream, nullptr);
 
     isLoaded = true;
     currentPositionMs = 0;
 
-    // Decode and display first frame in a deferred manner to avoid blocking
-    QTimer::singleShot(0, this, [this]() {
-        DecodeNextFrame();
-    });
+    // The first frame is shown as soon as the decode thread has it
+    presentNext = true;
+    StartDecodeThread();
+    StartIndexThread(filePath);
+    playbackTimer->start(0);
 
     return true;
 }
@@ -159,7 +162,8 @@ void SimpleVideoPlayer::Play() {
     }
 
     isPlaying = true;
-    playbackTimer->start(33); // ~30 fps
+    resyncClock = true;
+    playbackTimer->start(0);
 }
 
 void SimpleVideoPlayer::Pause() {
@@ -181,125 +185,353 @@ void SimpleVideoPlayer::Seek(qint64 positionMs) {
         return;
     }
 
+    // The decode thread seeks, frames queued before the seek are stale
+    {
+        QMutexLocker locker(&mutex);
+        seekTargetMs = qMax<qint64>(0, positionMs);
+        ring.clear();
+        endOfStream = false;
+        ringNotFull.wakeOne();
+    }
+
+    currentPositionMs = positionMs;
+    presentNext = true;
+    resyncClock = true;
+    playbackTimer->start(0);
+    emit PositionChanged(currentPositionMs);
+}
+
+qint64 SimpleVideoPlayer::KeyframeAtOrBefore(qint64 positionMs) {
     QMutexLocker locker(&mutex);
+    if (!keyframeIndex) {
+        return -1;
+    }
+    const KeyframeIndex::Keyframe *keyframe = keyframeIndex->at_or_before(positionMs * 1000);
+    return keyframe ? keyframeIndex->time_of(*keyframe) / 1000 : -1;
+}
 
-    // Convert position to stream time base
-    AVStream *videoStream = formatCtx->streams[videoStreamIndex];
-    int64_t timestamp = av_rescale_q(positionMs, AVRational{1, 1000}, videoStream->time_base);
+void SimpleVideoPlayer::resizeEvent(QResizeEvent *event) {
+    QLabel::resizeEvent(event);
 
-    // Seek to position (use stream index for more accurate seeking)
-    if (av_seek_frame(formatCtx, videoStreamIndex, timestamp, AVSEEK_FLAG_BACKWARD) < 0) {
-        qDebug() << "Seek failed to position:" << positionMs;
+    if (!isLoaded) {
         return;
     }
 
-    // Flush codec buffers
-    avcodec_flush_buffers(codecCtx);
+    // Frames decoded from now on are converted at the new size
+    QMutexLocker locker(&mutex);
+    targetSize = DisplaySize();
+}
 
-    // Decode frames until we reach the target position
-    bool foundFrame = false;
-    while (av_read_frame(formatCtx, packet) >= 0) {
-        if (packet->stream_index == videoStreamIndex) {
-            // Send packet to decoder
-            if (avcodec_send_packet(codecCtx, packet) >= 0) {
-                // Receive frame from decoder
-                int ret = avcodec_receive_frame(codecCtx, frame);
-                if (ret == 0) {
-                    // Successfully decoded frame
-                    if (frame->pts != AV_NOPTS_VALUE) {
-                        currentPositionMs = (int64_t)(frame->pts * timeBase * 1000);
-
-                        // Display this frame if it's close to target position
-                        if (currentPositionMs >= positionMs - 1000) { // Within 1 second
-                            DisplayFrame(frame);
-                            foundFrame = true;
-                            av_packet_unref(packet);
-                            break;
-                        }
-                    }
-                }
+void SimpleVideoPlayer::OnPlaybackTimer() {
+    if (!isLoaded) {
+        return;
+    }
+
+    DecodedFrame next;
+    bool haveFrame = false;
+    bool finished = false;
+    int waitMs = 10;    // poll interval while the ring is empty
+
+    {
+        QMutexLocker locker(&mutex);
+
+        // Decoding after a seek (or before playing) takes a while; start
+        // the clock at the first frame instead of dropping the ones that
+        // arrive late because of it
+        if (isPlaying && resyncClock && !ring.isEmpty()) {
+            clockOriginMs = ring.head().ptsMs;
+            playbackClock.start();
+            resyncClock = false;
+        }
+
+        if (isPlaying && !resyncClock) {
+            qint64 clockMs = clockOriginMs + playbackClock.elapsed();
+
+            // Drop frames that are overtaken by a later due frame
+            while (ring.size() > 1 && ring.at(1).ptsMs <= clockMs) {
+                ring.dequeue();
             }
+            if (!ring.isEmpty() && ring.head().ptsMs <= clockMs) {
+                next = ring.dequeue();
+                haveFrame = true;
+            }
+            if (!ring.isEmpty()) {
+                waitMs = static_cast<int>(qBound<qint64>(1, ring.head().ptsMs - clockMs, 100));
+            }
+        } else if (presentNext && !ring.isEmpty()) {
+            next = ring.dequeue();
+            haveFrame = true;
+        }
+
+        finished = endOfStream && ring.isEmpty() && seekTargetMs < 0;
+        if (haveFrame) {
+            ringNotFull.wakeOne();
         }
-        av_packet_unref(packet);
     }
 
-    if (foundFrame) {
-        emit PositionChanged(currentPositionMs);
-    } else {
-        // If we couldn't find a frame, just update position
-        currentPositionMs = positionMs;
+    if (haveFrame) {
+        presentNext = false;
+        DisplayImage(next.image);
+        currentPositionMs = next.ptsMs;
         emit PositionChanged(currentPositionMs);
     }
+
+    if (isPlaying && finished && !haveFrame) {
+        // End of video
+        Pause();
+        Seek(0);
+        return;
+    }
+
+    if (isPlaying || (presentNext && !finished)) {
+        playbackTimer->start(waitMs);
+    }
 }
 
-void SimpleVideoPlayer::OnPlaybackTimer() {
-    if (!isPlaying || !isLoaded) {
+QSize SimpleVideoPlayer::DisplaySize() const {
+    if (videoWidth <= 0 || videoHeight <= 0) {
+        return QSize();
+    }
+
+    // Fit the display aspect ratio into the widget
+    QSize source(videoWidth, videoHeight);
+    if (sampleAspectRatio.num > 0 && sampleAspectRatio.den > 0) {
+        source.setWidth(static_cast<int>(videoWidth * av_q2d(sampleAspectRatio) + 0.5));
+    }
+    QSize fitted = source.scaled(size(), Qt::KeepAspectRatio);
+    return fitted.expandedTo(QSize(1, 1));
+}
+
+void SimpleVideoPlayer::DisplayImage(const QImage &image) {
+    if (image.isNull()) {
         return;
     }
 
-    if (DecodeNextFrame()) {
-        emit PositionChanged(currentPositionMs);
+    // Only frames decoded before a resize need scaling here
+    QSize displaySize = DisplaySize();
+    if (image.size() == displaySize) {
+        setPixmap(QPixmap::fromImage(image));
     } else {
-        // End of video
-        Pause();
-        Seek(0);
+        setPixmap(QPixmap::fromImage(image.scaled(displaySize, Qt::IgnoreAspectRatio,
+                                                  Qt::FastTransformation)));
     }
 }
 
-bool SimpleVideoPlayer::DecodeNextFrame() {
+void SimpleVideoPlayer::StartDecodeThread() {
+    {
+        QMutexLocker locker(&mutex);
+        ring.clear();
+        targetSize = DisplaySize();
+        seekTargetMs = -1;
+        endOfStream = false;
+        stopDecoding = false;
+    }
+
+    decodeThread = QThread::create([this]() { DecodeLoop(); });
+    decodeThread->start();
+}
+
+void SimpleVideoPlayer::StopDecodeThread() {
+    if (!decodeThread) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&mutex);
+        stopDecoding = true;
+        ringNotFull.wakeAll();
+    }
+
+    decodeThread->wait();
+    delete decodeThread;
+    decodeThread = nullptr;
+
     QMutexLocker locker(&mutex);
+    ring.clear();
+}
 
-    if (!isLoaded) {
-        return false;
+void SimpleVideoPlayer::StartIndexThread(const QString &filePath) {
+    cancelIndexScan = false;
+    std::string path = filePath.toStdString();
+
+    // A cached index loads at once, otherwise the scan reads the whole
+    // file; either way playback does not wait for it
+    indexThread = QThread::create([this, path]() {
+        std::shared_ptr<const KeyframeIndex> index = KeyframeIndex::load(path, &cancelIndexScan);
+        if (!index) {
+            return;
+        }
+        {
+            QMutexLocker locker(&mutex);
+            keyframeIndex = index;
+        }
+        QMetaObject::invokeMethod(this, [this]() { emit KeyframeIndexReady(); },
+                                  Qt::QueuedConnection);
+    });
+    indexThread->start();
+}
+
+void SimpleVideoPlayer::StopIndexThread() {
+    if (indexThread) {
+        cancelIndexScan = true;
+        indexThread->wait();
+        delete indexThread;
+        indexThread = nullptr;
     }
 
-    while (av_read_frame(formatCtx, packet) >= 0) {
-        if (packet->stream_index == videoStreamIndex) {
-            // Send packet to decoder
-            if (avcodec_send_packet(codecCtx, packet) < 0) {
-                av_packet_unref(packet);
-                continue;
+    QMutexLocker locker(&mutex);
+    keyframeIndex.reset();
+}
+
+void SimpleVideoPlayer::DecodeLoop() {
+    qint64 skipUntilMs = -1;
+
+    for (;;) {
+        qint64 seekTo = -1;
+        QSize size;
+        {
+            QMutexLocker locker(&mutex);
+            while (!stopDecoding && seekTargetMs < 0 &&
+                   (endOfStream || ring.size() >= RING_SIZE)) {
+                ringNotFull.wait(&mutex);
             }
+            if (stopDecoding) {
+                return;
+            }
+            seekTo = seekTargetMs;
+            seekTargetMs = -1;
+            size = targetSize;
+        }
 
-            // Receive frame from decoder
-            int ret = avcodec_receive_frame(codecCtx, frame);
-            av_packet_unref(packet);
+        if (seekTo >= 0) {
+            SeekStream(seekTo);
+            // Decode from the keyframe but only show frames from the target on
+            skipUntilMs = seekTo;
+        }
 
-            if (ret == 0) {
-                // Successfully decoded frame
-                DisplayFrame(frame);
+        if (!DecodeNextFrame()) {
+            QMutexLocker locker(&mutex);
+            endOfStream = true;
+            continue;
+        }
 
-                // Update position
-                if (frame->pts != AV_NOPTS_VALUE) {
-                    currentPositionMs = (int64_t)(frame->pts * timeBase * 1000);
-                }
+        qint64 ptsMs = 0;
+        int64_t pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp
+                                                                     : frame->pts;
+        if (pts != AV_NOPTS_VALUE) {
+            ptsMs = static_cast<qint64>(pts * timeBase * 1000);
+        }
+        lastDecodedMs = ptsMs;
 
-                return true;
-            }
-        } else {
-            av_packet_unref(packet);
+        // Frames before the seek target are decoded but never converted
+        if (skipUntilMs >= 0 && ptsMs < skipUntilMs) {
+            av_frame_unref(frame);
+            continue;
+        }
+        skipUntilMs = -1;
+
+        QImage image = ConvertFrameToQImage(frame, size);
+        av_frame_unref(frame);
+
+        QMutexLocker locker(&mutex);
+        // A seek that came in while converting makes this frame stale
+        if (seekTargetMs < 0 && !image.isNull()) {
+            ring.enqueue({image, ptsMs});
         }
     }
+}
+
+bool SimpleVideoPlayer::DecodeNextFrame() {
+    for (;;) {
+        int ret = avcodec_receive_frame(codecCtx, frame);
+        if (ret == 0) {
+            return true;
+        }
+        if (ret != AVERROR(EAGAIN)) {
+            // AVERROR_EOF once drained, or a decoder error
+            return false;
+        }
+
+        ret = av_read_frame(formatCtx, packet);
+        if (ret < 0) {
+            if (draining) {
+                return false;
+            }
+            // Flush the frames the decoder still holds
+            draining = true;
+            avcodec_send_packet(codecCtx, nullptr);
+            continue;
+        }
 
-    return false;
+        if (packet->stream_index == videoStreamIndex) {
+            avcodec_send_packet(codecCtx, packet);
+        }
+        av_packet_unref(packet);
+    }
 }
 
-void SimpleVideoPlayer::DisplayFrame(AVFrame *frame) {
-    // Convert frame to RGB
-    sws_scale(swsCtx, frame->data, frame->linesize, 0, codecCtx->height,
-             frameRGB->data, frameRGB->linesize);
+void SimpleVideoPlayer::SeekStream(qint64 positionMs) {
+    std::shared_ptr<const KeyframeIndex> index;
+    {
+        QMutexLocker locker(&mutex);
+        index = keyframeIndex;
+    }
+
+    bool seeked = false;
+    if (index && index->get_stream_index() == videoStreamIndex) {
+        const KeyframeIndex::Keyframe *keyframe = index->at_or_before(positionMs * 1000);
+        // The target is ahead in the GOP being decoded, a seek would only
+        // decode the same frames again
+        if (keyframe && !draining && lastDecodedMs >= 0 && lastDecodedMs < positionMs &&
+            index->time_of(*keyframe) <= lastDecodedMs * 1000) {
+            return;
+        }
+        seeked = keyframe && index->seek(formatCtx, positionMs * 1000) != AV_NOPTS_VALUE;
+    }
+
+    if (!seeked) {
+        // Convert position to stream time base
+        AVStream *videoStream = formatCtx->streams[videoStreamIndex];
+        int64_t timestamp = av_rescale_q(positionMs, AVRational{1, 1000}, videoStream->time_base);
 
-    // Convert to QImage and display
-    QImage img = ConvertFrameToQImage(frameRGB);
-    if (!img.isNull()) {
-        setPixmap(QPixmap::fromImage(img).scaled(size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+        // Seek to position (use stream index for more accurate seeking)
+        if (av_seek_frame(formatCtx, videoStreamIndex, timestamp, AVSEEK_FLAG_BACKWARD) < 0) {
+            qDebug() << "Seek failed to position:" << positionMs;
+        }
     }
+
+    // Flush codec buffers, this also ends a drain
+    avcodec_flush_buffers(codecCtx);
+    draining = false;
+    lastDecodedMs = -1;
 }
 
-QImage SimpleVideoPlayer::ConvertFrameToQImage(AVFrame *frame) {
-    QImage img(frame->data[0], codecCtx->width, codecCtx->height,
-              frame->linesize[0], QImage::Format_RGB888);
-    return img.copy(); // Deep copy to avoid data corruption
+QImage SimpleVideoPlayer::ConvertFrameToQImage(AVFrame *frame, const QSize &targetSize) {
+    if (!targetSize.isValid()) {
+        return QImage();
+    }
+
+    // Scale straight to the display size, the context is only rebuilt when
+    // the source or display size changes
+    swsCtx = sws_getCachedContext(swsCtx, frame->width, frame->height,
+                                  static_cast<AVPixelFormat>(frame->format),
+                                  targetSize.width(), targetSize.height(), AV_PIX_FMT_RGB32,
+                                  SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!swsCtx) {
+        qDebug() << "Failed to initialize SWS context";
+        return QImage();
+    }
+
+    // AV_PIX_FMT_RGB32 matches QImage::Format_RGB32 on either endianness,
+    // so sws writes into the image without another copy
+    QImage img(targetSize, QImage::Format_RGB32);
+    if (img.isNull()) {
+        return img;
+    }
+    uint8_t *dst[4] = {img.bits(), nullptr, nullptr, nullptr};
+    int dstLinesize[4] = {static_cast<int>(img.bytesPerLine()), 0, 0, 0};
+    sws_scale(swsCtx, frame->data, frame->linesize, 0, frame->height, dst, dstLinesize);
+    return img;
 }
 
 void SimpleVideoPlayer::CloseVideo() {
@@ -307,23 +539,20 @@ void SimpleVideoPlayer::CloseVideo() {
         playbackTimer->stop();
     }
 
+    StopDecodeThread();
+    StopIndexThread();
+
     isPlaying = false;
     isLoaded = false;
+    presentNext = false;
+    draining = false;
+    lastDecodedMs = -1;
 
     if (swsCtx) {
         sws_freeContext(swsCtx);
         swsCtx = nullptr;
     }
 
-    if (buffer) {
-        av_free(buffer);
-        buffer = nullptr;
-    }
-
-    if (frameRGB) {
-        av_frame_free(&frameRGB);
-    }
-
     if (frame) {
         av_frame_free(&frame);
     }
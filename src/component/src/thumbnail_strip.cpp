@@ -0,0 +1,389 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "thumbnail_strip.h"
+#include "../../common/include/av_resource.h"
+#include "../../common/include/keyframe_index.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
+}
+
+namespace {
+
+// Video packets read after a seek before a thumbnail is given up
+const int MAX_PACKETS_PER_THUMBNAIL = 300;
+
+} // namespace
+
+ThumbnailStrip::ThumbnailStrip(QWidget *parent)
+    : QWidget(parent),
+      readyCount(0),
+      generation(0),
+      durationMs(0),
+      positionMs(0),
+      selectionStartMs(0),
+      selectionEndMs(0),
+      cancel(false) {
+    setMinimumHeight(THUMBNAIL_HEIGHT);
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+    setCursor(Qt::PointingHandCursor);
+}
+
+ThumbnailStrip::~ThumbnailStrip() {
+    StopWorkers();
+}
+
+QSize ThumbnailStrip::sizeHint() const {
+    return QSize(THUMBNAIL_COUNT * THUMBNAIL_HEIGHT, THUMBNAIL_HEIGHT);
+}
+
+QString ThumbnailStrip::CacheDir() {
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+    if (dir.isEmpty()) {
+        dir = QDir::tempPath();
+    }
+    return dir + "/OpenConverter/thumbnails";
+}
+
+void ThumbnailStrip::LoadVideo(const QString &filePath) {
+    Clear();
+    this->filePath = filePath;
+
+    // Keyed like the keyframe index, a changed file gets a new strip
+    QFileInfo info(filePath);
+    QByteArray identity = QString("%1|%2|%3")
+                              .arg(info.absoluteFilePath())
+                              .arg(info.size())
+                              .arg(info.lastModified().toMSecsSinceEpoch())
+                              .toUtf8();
+    cachePath = CacheDir() + "/" +
+                QString::fromLatin1(QCryptographicHash::hash(identity, QCryptographicHash::Md5).toHex()) +
+                ".jpg";
+
+    if (!LoadCache()) {
+        StartWorkers();
+    }
+    update();
+}
+
+void ThumbnailStrip::Clear() {
+    StopWorkers();
+    generation++;
+    filePath.clear();
+    cachePath.clear();
+    thumbnails = QVector<QImage>(THUMBNAIL_COUNT);
+    readyCount = 0;
+    update();
+}
+
+void ThumbnailStrip::SetDuration(qint64 durationMs) {
+    this->durationMs = durationMs;
+    update();
+}
+
+void ThumbnailStrip::SetPosition(qint64 positionMs) {
+    this->positionMs = positionMs;
+    update();
+}
+
+void ThumbnailStrip::SetSelection(qint64 startMs, qint64 endMs) {
+    selectionStartMs = startMs;
+    selectionEndMs = endMs;
+    update();
+}
+
+void ThumbnailStrip::StartWorkers() {
+    cancel = false;
+
+    // Each worker decodes with one thread, so a few of them share the
+    // cores without starving the player
+    int workerCount = qBound(1, QThread::idealThreadCount() / 2, 4);
+    QString path = filePath;
+    int gen = generation;
+    for (int worker = 0; worker < workerCount; worker++) {
+        QThread *thread = QThread::create([this, path, worker, workerCount, gen]() {
+            GenerateThumbnails(path, worker, workerCount, gen);
+        });
+        workers.append(thread);
+        thread->start(QThread::LowPriority);
+    }
+}
+
+void ThumbnailStrip::StopWorkers() {
+    cancel = true;
+    for (QThread *thread : workers) {
+        thread->wait();
+        delete thread;
+    }
+    workers.clear();
+}
+
+void ThumbnailStrip::OnThumbnailReady(int generation, int index, const QImage &image) {
+    // A thumbnail of a file that was replaced in the meantime
+    if (generation != this->generation || index < 0 || index >= thumbnails.size()) {
+        return;
+    }
+
+    thumbnails[index] = image;
+    readyCount++;
+    update();
+
+    if (readyCount == THUMBNAIL_COUNT) {
+        SaveCache();
+    }
+}
+
+bool ThumbnailStrip::LoadCache() {
+    QImage strip(cachePath);
+    if (strip.isNull() || strip.width() % THUMBNAIL_COUNT != 0) {
+        return false;
+    }
+
+    int width = strip.width() / THUMBNAIL_COUNT;
+    for (int i = 0; i < THUMBNAIL_COUNT; i++) {
+        thumbnails[i] = strip.copy(i * width, 0, width, strip.height());
+    }
+    readyCount = THUMBNAIL_COUNT;
+    return true;
+}
+
+void ThumbnailStrip::SaveCache() {
+    if (cachePath.isEmpty() || thumbnails.isEmpty() || thumbnails[0].isNull()) {
+        return;
+    }
+
+    // One image per file, the thumbnails share the first one's size
+    QSize size = thumbnails[0].size();
+    QImage strip(size.width() * THUMBNAIL_COUNT, size.height(), QImage::Format_RGB32);
+    strip.fill(Qt::black);
+    QPainter painter(&strip);
+    for (int i = 0; i < THUMBNAIL_COUNT; i++) {
+        painter.drawImage(QRect(QPoint(i * size.width(), 0), size), thumbnails[i]);
+    }
+    painter.end();
+
+    QDir().mkpath(QFileInfo(cachePath).absolutePath());
+    // QSaveFile writes to a temporary file of its own and replaces the
+    // cache on commit, a reader never loads a partial strip
+    QSaveFile file(cachePath);
+    if (!file.open(QIODevice::WriteOnly) || !strip.save(&file, "JPG", 85)) {
+        file.cancelWriting();
+        return;
+    }
+    file.commit();
+}
+
+qint64 ThumbnailStrip::PositionAt(int x) const {
+    if (width() <= 0) {
+        return 0;
+    }
+    return qBound<qint64>(0, durationMs * x / width(), durationMs);
+}
+
+void ThumbnailStrip::paintEvent(QPaintEvent *event) {
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::black);
+
+    int w = width();
+    int h = height();
+    for (int i = 0; i < THUMBNAIL_COUNT; i++) {
+        int left = i * w / THUMBNAIL_COUNT;
+        QRect slot(left, 0, (i + 1) * w / THUMBNAIL_COUNT - left, h);
+        const QImage &image = thumbnails.value(i);
+        if (image.isNull() || slot.width() <= 0) {
+            painter.fillRect(slot.adjusted(0, 0, -1, 0), QColor(40, 40, 40));
+            continue;
+        }
+
+        // Fill the slot, cropping the thumbnail's center
+        QRectF source(image.rect());
+        double slotAspect = static_cast<double>(slot.width()) / slot.height();
+        double imageAspect = static_cast<double>(image.width()) / image.height();
+        if (imageAspect > slotAspect) {
+            double cropped = image.height() * slotAspect;
+            source = QRectF((image.width() - cropped) / 2, 0, cropped, image.height());
+        } else {
+            double cropped = image.width() / slotAspect;
+            source = QRectF(0, (image.height() - cropped) / 2, image.width(), cropped);
+        }
+        painter.drawImage(slot, image, source);
+    }
+
+    if (durationMs <= 0) {
+        return;
+    }
+
+    // Shade what the cut leaves out
+    if (selectionEndMs > selectionStartMs) {
+        int startX = static_cast<int>(selectionStartMs * w / durationMs);
+        int endX = static_cast<int>(qMin(selectionEndMs, durationMs) * w / durationMs);
+        painter.fillRect(QRect(0, 0, startX, h), QColor(0, 0, 0, 160));
+        painter.fillRect(QRect(endX, 0, w - endX, h), QColor(0, 0, 0, 160));
+        painter.setPen(QPen(QColor(255, 200, 0), 2));
+        painter.drawRect(QRect(startX, 0, endX - startX, h).adjusted(1, 1, -1, -1));
+    }
+
+    int positionX = static_cast<int>(qBound<qint64>(0, positionMs, durationMs) * w / durationMs);
+    painter.setPen(QPen(Qt::white, 2));
+    painter.drawLine(positionX, 0, positionX, h);
+}
+
+void ThumbnailStrip::mousePressEvent(QMouseEvent *event) {
+    if (event->button() == Qt::LeftButton && durationMs > 0) {
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        emit PositionClicked(PositionAt(static_cast<int>(event->position().x())));
+#else
+        emit PositionClicked(PositionAt(event->pos().x()));
+#endif
+    }
+}
+
+void ThumbnailStrip::mouseMoveEvent(QMouseEvent *event) {
+    if ((event->buttons() & Qt::LeftButton) && durationMs > 0) {
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        emit PositionClicked(PositionAt(static_cast<int>(event->position().x())));
+#else
+        emit PositionClicked(PositionAt(event->pos().x()));
+#endif
+    }
+}
+
+void ThumbnailStrip::GenerateThumbnails(const QString &path, int worker, int workerCount,
+                                        int generation) {
+    AVFormatContext *raw = nullptr;
+    if (avformat_open_input(&raw, path.toUtf8().constData(), nullptr, nullptr) < 0) {
+        return;
+    }
+    AVInputFormatContextPtr formatCtx(raw);
+    if (avformat_find_stream_info(formatCtx.get(), nullptr) < 0) {
+        return;
+    }
+
+    const AVCodec *codec = nullptr;
+    int videoStreamIndex = av_find_best_stream(formatCtx.get(), AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    if (videoStreamIndex < 0 || !codec) {
+        return;
+    }
+    AVStream *videoStream = formatCtx->streams[videoStreamIndex];
+    for (unsigned i = 0; i < formatCtx->nb_streams; i++) {
+        formatCtx->streams[i]->discard =
+            static_cast<int>(i) == videoStreamIndex ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    }
+
+    int64_t start = formatCtx->start_time != AV_NOPTS_VALUE ? formatCtx->start_time : 0;
+    int64_t duration = formatCtx->duration;
+    if (duration == AV_NOPTS_VALUE || duration <= 0) {
+        return;
+    }
+
+    AVCodecContextPtr codecCtx(avcodec_alloc_context3(codec));
+    if (!codecCtx || avcodec_parameters_to_context(codecCtx.get(), videoStream->codecpar) < 0) {
+        return;
+    }
+    // Keyframes only, and the cheapest decode the codec offers; the
+    // workers are the parallelism
+    codecCtx->skip_frame = AVDISCARD_NONKEY;
+    codecCtx->skip_loop_filter = AVDISCARD_ALL;
+    codecCtx->flags2 |= AV_CODEC_FLAG2_FAST;
+    codecCtx->thread_count = 1;
+    if (avcodec_open2(codecCtx.get(), codec, nullptr) < 0) {
+        return;
+    }
+
+    AVPacketPtr packet(av_packet_alloc());
+    AVFramePtr frame(av_frame_alloc());
+    if (!packet || !frame) {
+        return;
+    }
+
+    // A file the player indexed already seeks straight to its keyframes
+    std::shared_ptr<const KeyframeIndex> index = KeyframeIndex::find(path.toStdString());
+    if (index && index->get_stream_index() != videoStreamIndex) {
+        index.reset();
+    }
+
+    // Thumbnail size from the display aspect ratio
+    AVRational sar = av_guess_sample_aspect_ratio(formatCtx.get(), videoStream, nullptr);
+    double aspect = videoStream->codecpar->height > 0
+                        ? static_cast<double>(videoStream->codecpar->width) / videoStream->codecpar->height
+                        : 16.0 / 9.0;
+    if (sar.num > 0 && sar.den > 0) {
+        aspect *= av_q2d(sar);
+    }
+    QSize thumbnailSize(qBound(1, static_cast<int>(THUMBNAIL_HEIGHT * aspect + 0.5), 4 * THUMBNAIL_HEIGHT),
+                        THUMBNAIL_HEIGHT);
+
+    SwsContext *swsCtx = nullptr;
+    for (int i = worker; i < THUMBNAIL_COUNT && !cancel; i += workerCount) {
+        // The middle of each slot of the timeline
+        int64_t target = start + duration * (2 * i + 1) / (2 * THUMBNAIL_COUNT);
+        if (!index || index->seek(formatCtx.get(), target) == AV_NOPTS_VALUE) {
+            int64_t timestamp = av_rescale_q(target, AVRational{1, AV_TIME_BASE}, videoStream->time_base);
+            av_seek_frame(formatCtx.get(), videoStreamIndex, timestamp, AVSEEK_FLAG_BACKWARD);
+        }
+        avcodec_flush_buffers(codecCtx.get());
+
+        bool decoded = false;
+        for (int read = 0; !decoded && read < MAX_PACKETS_PER_THUMBNAIL && !cancel;) {
+            if (av_read_frame(formatCtx.get(), packet.get()) < 0) {
+                avcodec_send_packet(codecCtx.get(), nullptr);
+                decoded = avcodec_receive_frame(codecCtx.get(), frame.get()) == 0;
+                break;
+            }
+            if (packet->stream_index == videoStreamIndex) {
+                read++;
+                if (avcodec_send_packet(codecCtx.get(), packet.get()) >= 0) {
+                    decoded = avcodec_receive_frame(codecCtx.get(), frame.get()) == 0;
+                }
+            }
+            av_packet_unref(packet.get());
+        }
+        if (!decoded) {
+            continue;
+        }
+
+        swsCtx = sws_getCachedContext(swsCtx, frame->width, frame->height,
+                                      static_cast<AVPixelFormat>(frame->format),
+                                      thumbnailSize.width(), thumbnailSize.height(), AV_PIX_FMT_RGB32,
+                                      SWS_BILINEAR, nullptr, nullptr, nullptr);
+        QImage image(thumbnailSize, QImage::Format_RGB32);
+        if (swsCtx && !image.isNull()) {
+            uint8_t *dst[4] = {image.bits(), nullptr, nullptr, nullptr};
+            int dstLinesize[4] = {static_cast<int>(image.bytesPerLine()), 0, 0, 0};
+            sws_scale(swsCtx, frame->data, frame->linesize, 0, frame->height, dst, dstLinesize);
+            QMetaObject::invokeMethod(this, [this, generation, i, image]() {
+                OnThumbnailReady(generation, i, image);
+            }, Qt::QueuedConnection);
+        }
+        av_frame_unref(frame.get());
+    }
+    sws_freeContext(swsCtx);
+}
@@ -0,0 +1,294 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "waveform_widget.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+
+namespace {
+
+const quint32 CACHE_MAGIC = 0x4f435746;  // "OCWF"
+const quint32 CACHE_VERSION = 1;
+
+} // namespace
+
+WaveformWidget::WaveformWidget(QWidget *parent)
+    : QWidget(parent),
+      filled(0),
+      generation(0),
+      durationMs(0),
+      positionMs(0),
+      selectionStartMs(0),
+      selectionEndMs(0),
+      worker(nullptr),
+      cancel(false) {
+    setMinimumHeight(48);
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+    setCursor(Qt::PointingHandCursor);
+}
+
+WaveformWidget::~WaveformWidget() {
+    StopWorker();
+}
+
+QSize WaveformWidget::sizeHint() const {
+    return QSize(640, 64);
+}
+
+QString WaveformWidget::CacheDir() {
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+    if (dir.isEmpty()) {
+        dir = QDir::tempPath();
+    }
+    return dir + "/OpenConverter/waveforms";
+}
+
+void WaveformWidget::LoadAudio(const QString &filePath) {
+    Clear();
+    setVisible(true);
+
+    // Keyed like the thumbnail strip, a changed file gets new peaks
+    QFileInfo info(filePath);
+    QByteArray identity = QString("%1|%2|%3")
+                              .arg(info.absoluteFilePath())
+                              .arg(info.size())
+                              .arg(info.lastModified().toMSecsSinceEpoch())
+                              .toUtf8();
+    cachePath = CacheDir() + "/" +
+                QString::fromLatin1(QCryptographicHash::hash(identity, QCryptographicHash::Md5).toHex()) +
+                ".peaks";
+
+    if (LoadCache()) {
+        update();
+        return;
+    }
+
+    cancel = false;
+    std::string path = filePath.toStdString();
+    int gen = generation;
+    worker = QThread::create([this, path, gen]() {
+        std::vector<AudioPeaks::Bucket> result;
+        bool success = AudioPeaks::compute(path, BUCKET_COUNT, result,
+            [this, gen](const std::vector<AudioPeaks::Bucket> &buckets, int done) {
+                std::vector<AudioPeaks::Bucket> partial(buckets.begin(), buckets.begin() + done);
+                QMetaObject::invokeMethod(this, [this, gen, partial, done]() {
+                    OnPeaksUpdated(gen, partial, done);
+                }, Qt::QueuedConnection);
+            },
+            &cancel);
+        QMetaObject::invokeMethod(this, [this, gen, success]() {
+            OnScanFinished(gen, success);
+        }, Qt::QueuedConnection);
+    });
+    worker->start(QThread::LowPriority);
+}
+
+void WaveformWidget::Clear() {
+    StopWorker();
+    generation++;
+    cachePath.clear();
+    peaks.clear();
+    filled = 0;
+    update();
+}
+
+void WaveformWidget::SetDuration(qint64 durationMs) {
+    this->durationMs = durationMs;
+    update();
+}
+
+void WaveformWidget::SetPosition(qint64 positionMs) {
+    this->positionMs = positionMs;
+    update();
+}
+
+void WaveformWidget::SetSelection(qint64 startMs, qint64 endMs) {
+    selectionStartMs = startMs;
+    selectionEndMs = endMs;
+    update();
+}
+
+void WaveformWidget::StopWorker() {
+    if (worker) {
+        cancel = true;
+        worker->wait();
+        delete worker;
+        worker = nullptr;
+    }
+}
+
+void WaveformWidget::OnPeaksUpdated(int generation, const std::vector<AudioPeaks::Bucket> &peaks,
+                                    int filled) {
+    // Peaks of a file that was replaced in the meantime
+    if (generation != this->generation) {
+        return;
+    }
+
+    this->peaks = peaks;
+    this->filled = filled;
+    update();
+}
+
+void WaveformWidget::OnScanFinished(int generation, bool success) {
+    if (generation != this->generation) {
+        return;
+    }
+
+    if (success && filled == BUCKET_COUNT) {
+        SaveCache();
+    } else if (!success && filled == 0) {
+        // No audio stream, nothing to draw
+        setVisible(false);
+    }
+}
+
+bool WaveformWidget::LoadCache() {
+    QFile file(cachePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    quint32 magic = 0, version = 0;
+    qint32 count = 0;
+    in >> magic >> version >> count;
+    if (magic != CACHE_MAGIC || version != CACHE_VERSION || count != BUCKET_COUNT) {
+        return false;
+    }
+
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    std::vector<AudioPeaks::Bucket> loaded(count);
+    for (AudioPeaks::Bucket &bucket : loaded) {
+        in >> bucket.min >> bucket.max >> bucket.rms;
+    }
+    if (in.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    peaks = std::move(loaded);
+    filled = count;
+    return true;
+}
+
+void WaveformWidget::SaveCache() {
+    if (cachePath.isEmpty()) {
+        return;
+    }
+
+    QDir().mkpath(QFileInfo(cachePath).absolutePath());
+    // QSaveFile replaces the cache atomically on commit
+    QSaveFile file(cachePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    QDataStream out(&file);
+    out << CACHE_MAGIC << CACHE_VERSION << static_cast<qint32>(peaks.size());
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    for (const AudioPeaks::Bucket &bucket : peaks) {
+        out << bucket.min << bucket.max << bucket.rms;
+    }
+    file.commit();
+}
+
+qint64 WaveformWidget::PositionAt(int x) const {
+    if (width() <= 0) {
+        return 0;
+    }
+    return qBound<qint64>(0, durationMs * x / width(), durationMs);
+}
+
+void WaveformWidget::paintEvent(QPaintEvent *event) {
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor(24, 24, 24));
+
+    int w = width();
+    int h = height();
+    double mid = h / 2.0;
+    painter.setPen(QColor(70, 70, 70));
+    painter.drawLine(0, static_cast<int>(mid), w, static_cast<int>(mid));
+
+    // One column per pixel, folding the buckets that fall on it
+    QColor peakColor(90, 160, 230);
+    QColor rmsColor(170, 215, 255);
+    for (int x = 0; x < w && BUCKET_COUNT > 0; x++) {
+        int first = static_cast<int>(static_cast<qint64>(x) * BUCKET_COUNT / w);
+        int last = qMax(first + 1, static_cast<int>(static_cast<qint64>(x + 1) * BUCKET_COUNT / w));
+        if (first >= filled) {
+            break;
+        }
+        last = qMin(last, filled);
+
+        float low = 0.0f, high = 0.0f, rms = 0.0f;
+        for (int i = first; i < last; i++) {
+            low = qMin(low, peaks[i].min);
+            high = qMax(high, peaks[i].max);
+            rms = qMax(rms, peaks[i].rms);
+        }
+        painter.setPen(peakColor);
+        painter.drawLine(x, static_cast<int>(mid - high * mid), x, static_cast<int>(mid - low * mid));
+        painter.setPen(rmsColor);
+        painter.drawLine(x, static_cast<int>(mid - rms * mid), x, static_cast<int>(mid + rms * mid));
+    }
+
+    if (durationMs <= 0) {
+        return;
+    }
+
+    // Shade what the cut leaves out
+    if (selectionEndMs > selectionStartMs) {
+        int startX = static_cast<int>(selectionStartMs * w / durationMs);
+        int endX = static_cast<int>(qMin(selectionEndMs, durationMs) * w / durationMs);
+        painter.fillRect(QRect(0, 0, startX, h), QColor(0, 0, 0, 160));
+        painter.fillRect(QRect(endX, 0, w - endX, h), QColor(0, 0, 0, 160));
+    }
+
+    int positionX = static_cast<int>(qBound<qint64>(0, positionMs, durationMs) * w / durationMs);
+    painter.setPen(QPen(Qt::white, 2));
+    painter.drawLine(positionX, 0, positionX, h);
+}
+
+void WaveformWidget::mousePressEvent(QMouseEvent *event) {
+    if (event->button() == Qt::LeftButton && durationMs > 0) {
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        emit PositionClicked(PositionAt(static_cast<int>(event->position().x())));
+#else
+        emit PositionClicked(PositionAt(event->pos().x()));
+#endif
+    }
+}
+
+void WaveformWidget::mouseMoveEvent(QMouseEvent *event) {
+    if ((event->buttons() & Qt::LeftButton) && durationMs > 0) {
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        emit PositionClicked(PositionAt(static_cast<int>(event->position().x())));
+#else
+        emit PositionClicked(PositionAt(event->pos().x()));
+#endif
+    }
+}
@@ -22,6 +22,17 @@
 #include "../../transcoder/include/transcoder.h"
 #include <functional>
 #include <string>
+#include <vector>
+
+// Probed shape of a job, used for backend selection and the throughput history
+struct JobProfile {
+    std::string jobKey;
+    int width = 0;
+    int height = 0;
+    double mediaSeconds = 0.0; // length of the range that is converted
+    double frameRate = 0.0;
+    double duration = 0.0;     // length of the whole input, 0 if unknown
+};
 
 class Converter {
 public:
@@ -30,11 +41,60 @@ public:
               EncodeParameter *encodeParamter);
     ~Converter();
 
+    // FFMPEG, BMF, FFTOOL, or AUTO to pick a backend for every job
     bool set_transcoder(std::string transcoderName);
     bool convert_format(const std::string &src, const std::string &dst);
+    // Stop the running job, convert_format() then returns false. Safe to
+    // call from any thread; the FFMPEG and FFTOOL backends stop within
+    // milliseconds, BMF finishes its graph.
+    void cancel();
+
+    // backend that runs the current (or ran the last) job
+    std::string get_transcoder_name();
+    // length of the media processed by the last job, 0 if unknown
+    double get_media_seconds();
+    // throughput history shape of the last job, empty before the first
+    std::string get_job_key();
+    // backends compiled into this build
+    static std::vector<std::string> get_available_transcoders();
+
+    // probe the input to learn the shape of the job
+    static JobProfile probe_job(const std::string &src,
+                                EncodeParameter *encodeParameter);
+    // shape of the job on an input probed before, e.g. with other
+    // parameters; the input is not opened
+    static JobProfile shape_job(const JobProfile &probed,
+                                EncodeParameter *encodeParameter);
+    // The next job's input was probed already (e.g. by the batch
+    // scheduler), convert_format() does not probe it again
+    void set_probed_input(const JobProfile &probed);
+
+    // wall-clock seconds the job is expected to take, -1 if unknown
+    static double predict_seconds(const std::string &src,
+                                  EncodeParameter *encodeParameter,
+                                  const std::string &transcoderName);
+    static double predict_seconds(const JobProfile &job,
+                                  EncodeParameter *encodeParameter,
+                                  const std::string &transcoderName);
 
 private:
+    bool create_transcoder(const std::string &name);
+    // convert_format() once the codecs are validated and planned
+    bool run_job(const std::string &src, const std::string &dst);
+    // Encode the video segments as spool jobs, then join them and convert
+    // the audio here; see EncodeParameter::set_distribute_dir()
+    bool convert_distributed(const std::string &src, const std::string &dst);
+    // reason, if not null, receives why the backend was picked
+    static std::string select_transcoder(EncodeParameter *encodeParameter,
+                                         const JobProfile &job,
+                                         std::string *reason);
+
     Transcoder *transcoder = NULL;
+    std::string transcoderName;
+    bool autoSelect = false;
+    JobProfile job;
+    JobProfile probedInput;
+    bool inputProbed = false;
     bool copyVideo;
     bool copyAudio;
 
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SPOOL_WORKER_H
+#define SPOOL_WORKER_H
+
+#include "../../common/include/encode_parameter.h"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+class Converter;
+class ProcessParameter;
+
+/*
+ * Worker that takes jobs from a spool directory shared by several nodes
+ * (e.g. over NFS), with no broker between them.
+ *
+ *   jobs/NAME.job       waiting jobs, "key=value" lines
+ *   claimed/NAME.job    jobs being converted
+ *   claimed/NAME.lease  owner and heartbeat counter of a claimed job
+ *   done/NAME.job       finished jobs, with NAME.stats next to them
+ *   failed/NAME.job     failed jobs, with NAME.stats next to them
+ *
+ * A node claims a job by renaming it from jobs/ to claimed/; rename is
+ * atomic on one filesystem, so only one node wins. While converting, the
+ * node rewrites the lease with an increasing counter. Other nodes watch
+ * the counter with their own clock (so clock skew between hosts does not
+ * matter) and put a job whose lease has not changed for the timeout the
+ * owner recorded in it back to jobs/. A node that finds the lease gone or
+ * naming another node cancels its job. The output is written next to
+ * the destination as NAME.spool-NODE.EXT and renamed into place only
+ * while the node still holds the lease, so a stalled node never
+ * overwrites the output of the node that took its job over.
+ *
+ * Paths in job files are absolute, all nodes must see the volume at the
+ * same path.
+ */
+class SpoolWorker {
+public:
+    explicit SpoolWorker(const std::string &spoolDir);
+
+    /*
+     * Add a job to the spool. Returns the job name, or an empty string if
+     * the job file could not be written.
+     */
+    static std::string submit(const std::string &spoolDir,
+                              const std::string &src, const std::string &dst,
+                              const std::string &transcoderName,
+                              EncodeParameter *encodeParameter);
+
+    /*
+     * Convert jobs until stop() is called. With drain set, return once
+     * no job is waiting or claimed by any node. Returns the number of
+     * jobs that failed.
+     */
+    int run(bool drain);
+
+    /*
+     * Wait for the named jobs to finish, converting them on this node as
+     * well, e.g. the segments of a distributed encode. The owner's cancel
+     * flag is honoured and its progress follows the finished jobs. Returns
+     * the number of jobs that failed, or -1 if cancelled; the jobs not
+     * started yet are then withdrawn from the spool.
+     */
+    int run_jobs(const std::vector<std::string> &names, ProcessParameter *owner);
+
+    // Drop the named jobs and their stats from done/ and failed/, once
+    // their owner has no use for them
+    static void remove_jobs(const std::string &spoolDir,
+                            const std::vector<std::string> &names);
+
+    // async-signal-safe, the running job goes back to jobs/
+    static void stop();
+
+    // seconds without a heartbeat before a claimed job is taken back
+    void set_lease_timeout(int seconds);
+    std::string get_node_id();
+
+private:
+    struct LeaseState {
+        std::string content;
+        std::chrono::steady_clock::time_point changed;
+    };
+
+    bool prepare();
+    // With only set, claim just those jobs
+    bool claim_next(std::string &name, const std::set<std::string> *only = nullptr);
+    bool should_cancel();
+    // The job is claimed and its lease names this node
+    bool owns_lease(const std::string &name);
+    bool process(const std::string &name);
+    void heartbeat(const std::string &name, Converter *converter,
+                   std::atomic<bool> &finished, std::atomic<bool> &leaseLost);
+    bool write_lease(const std::string &name, int64_t beat);
+    void reclaim_expired();
+    bool is_idle();
+
+    std::string spoolDir;
+    std::string nodeId;
+    int leaseTimeout = 30;
+    std::map<std::string, LeaseState> leases; // claimed jobs of other nodes
+    ProcessParameter *owner = nullptr;         // set during run_jobs()
+
+    static std::atomic<bool> stopRequested;
+};
+
+#endif // SPOOL_WORKER_H
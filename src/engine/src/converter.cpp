@@ -16,6 +16,18 @@
  */
 
 #include "../include/converter.h"
+#include "../../common/include/codec_capabilities.h"
+#include "../../common/include/info.h"
+#include "../../common/include/output_cache.h"
+#include "../../common/include/stream_plan.h"
+#include "../../common/include/throughput_history.h"
+#include "../include/spool_worker.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
 
 #if defined(ENABLE_BMF)
     #include "../../transcoder/include/transcoder_bmf.h"
@@ -27,6 +39,12 @@
     #include "../../transcoder/include/transcoder_fftool.h"
 #endif
 
+// AUTO measures a candidate this often per job shape before it trusts its
+// average, as long as the candidate is not clearly slower than the best
+static const int AUTO_MIN_SAMPLES = 3;
+// Candidates below this fraction of the best speed count as clearly slower
+static const double AUTO_EXPLORE_MARGIN = 0.75;
+
 Converter::Converter() {}
 /* Receive pointers from widget */
 Converter::Converter(ProcessParameter *processParamter,
@@ -47,49 +65,413 @@ Converter::Converter(ProcessParameter *processParamter,
 #if defined(ENABLE_FFMPEG)
     transcoder =
         new TranscoderFFmpeg(this->processParameter, this->encodeParameter);
+    transcoderName = "FFMPEG";
 #endif
 
     this->encodeParameter = encodeParamter;
 }
 
-bool Converter::set_transcoder(std::string transcoderName) {
+std::vector<std::string> Converter::get_available_transcoders() {
+    std::vector<std::string> names;
+#if defined(ENABLE_FFMPEG)
+    names.push_back("FFMPEG");
+#endif
+#if defined(ENABLE_FFTOOL)
+    names.push_back("FFTOOL");
+#endif
+#if defined(ENABLE_BMF)
+    names.push_back("BMF");
+#endif
+    return names;
+}
+
+bool Converter::create_transcoder(const std::string &name) {
     if (transcoder) {
         delete transcoder;
         transcoder = NULL;
     }
 
-    if (transcoder == NULL) {
-        if (transcoderName == "FFMPEG") {
+    if (name == "FFMPEG") {
 #if defined(ENABLE_FFMPEG)
-            transcoder = new TranscoderFFmpeg(this->processParameter,
-                                              this->encodeParameter);
+        transcoder = new TranscoderFFmpeg(this->processParameter,
+                                          this->encodeParameter);
+        std::cout << "Set FFmpeg Transcoder!" << std::endl;
 #endif
-            std::cout << "Set FFmpeg Transcoder!" << std::endl;
-        } else if (transcoderName == "BMF") {
+    } else if (name == "BMF") {
 #if defined(ENABLE_BMF)
-            transcoder = new TranscoderBMF(this->processParameter,
-                                           this->encodeParameter);
-            std::cout << "Set BMF Transcoder!" << std::endl;
+        transcoder = new TranscoderBMF(this->processParameter,
+                                       this->encodeParameter);
+        std::cout << "Set BMF Transcoder!" << std::endl;
 #endif
-        } else if (transcoderName == "FFTOOL") {
+    } else if (name == "FFTOOL") {
 #if defined(ENABLE_FFTOOL)
-            transcoder = new TranscoderFFTool(this->processParameter,
-                                              this->encodeParameter);
-            std::cout << "Set FFTool Transcoder!" << std::endl;
+        transcoder = new TranscoderFFTool(this->processParameter,
+                                          this->encodeParameter);
+        std::cout << "Set FFTool Transcoder!" << std::endl;
 #endif
-        } else {
-            std::cout << "Wrong Transcoder Name!" << std::endl;
-            return false;
-        }
     } else {
-        std::cout << "Init transcoder failed!" << std::endl;
+        std::cout << "Wrong Transcoder Name!" << std::endl;
+        return false;
+    }
+
+    if (transcoder == NULL) {
+        std::cout << "Init transcoder failed! " << name
+                  << " is not enabled in this build" << std::endl;
         return false;
     }
+    transcoderName = name;
     return true;
 }
 
+bool Converter::set_transcoder(std::string transcoderName) {
+    if (transcoderName == "AUTO") {
+        // The backend is created per job in convert_format()
+        if (transcoder) {
+            delete transcoder;
+            transcoder = NULL;
+        }
+        this->transcoderName.clear();
+        autoSelect = true;
+        std::cout << "Set Auto Transcoder!" << std::endl;
+        return !get_available_transcoders().empty();
+    }
+
+    autoSelect = false;
+    return create_transcoder(transcoderName);
+}
+
+std::string Converter::get_transcoder_name() { return transcoderName; }
+
+double Converter::get_media_seconds() { return job.mediaSeconds; }
+
+std::string Converter::get_job_key() { return job.jobKey; }
+
+JobProfile Converter::probe_job(const std::string &src,
+                                EncodeParameter *encodeParameter) {
+    // Info raises the global log level, keep the transcode output unchanged
+    int logLevel = av_log_get_level();
+    Info info;
+    info.set_fast_probe(true);
+    info.send_info(const_cast<char *>(src.c_str()));
+    av_log_set_level(logLevel);
+    QuickInfo *quickInfo = info.get_quick_info();
+
+    JobProfile probed;
+    probed.width = quickInfo->width;
+    probed.height = quickInfo->height;
+    probed.frameRate = quickInfo->frameRate;
+    probed.duration = quickInfo->duration;
+    return shape_job(probed, encodeParameter);
+}
+
+JobProfile Converter::shape_job(const JobProfile &probed,
+                                EncodeParameter *encodeParameter) {
+    std::string operation = "encode";
+    std::string videoCodec = encodeParameter->get_video_codec_name();
+    if (encodeParameter->get_algo_mode() == AlgoMode::Upscale) {
+        operation = "upscale";
+    } else if (videoCodec == "copy") {
+        operation = "copy";
+    } else if (encodeParameter->get_width() > 0 ||
+               encodeParameter->get_height() > 0) {
+        operation = "scale";
+    }
+
+    JobProfile job = probed;
+    job.jobKey = ThroughputHistory::job_key(
+        operation, videoCodec, encodeParameter->get_preset(), job.height);
+
+    // Only the selected range is processed when cutting
+    double start = std::max(encodeParameter->get_start_time(), 0.0);
+    double end = probed.duration;
+    if (encodeParameter->get_end_time() > 0)
+        end = end > 0 ? std::min(end, encodeParameter->get_end_time())
+                      : encodeParameter->get_end_time();
+    job.mediaSeconds = std::max(end - start, 0.0);
+    return job;
+}
+
+void Converter::set_probed_input(const JobProfile &probed) {
+    probedInput = probed;
+    inputProbed = true;
+}
+
+/*
+ * Pick the backend for the probed job. Measured history wins; without it
+ * stream copies stay in-process (no process start-up cost) while filtered
+ * re-encodes of HD sources go to the ffmpeg binary, whose multithreaded
+ * filter graph outpaces the in-process path there.
+ */
+std::string Converter::select_transcoder(EncodeParameter *encodeParameter,
+                                         const JobProfile &job,
+                                         std::string *reason) {
+    std::ostringstream why;
+    std::vector<std::string> available = get_available_transcoders();
+    auto enabled = [&available](const std::string &name) {
+        return std::find(available.begin(), available.end(), name) !=
+               available.end();
+    };
+
+    // AI upscaling is only implemented by BMF
+    if (encodeParameter->get_algo_mode() == AlgoMode::Upscale) {
+        if (reason)
+            *reason = "upscaling";
+        return enabled("BMF") ? "BMF" : available.front();
+    }
+
+    // FFTOOL needs explicit codecs, it does not guess them from the output
+    std::vector<std::string> candidates;
+    if (enabled("FFMPEG"))
+        candidates.push_back("FFMPEG");
+    if (enabled("FFTOOL") && !encodeParameter->get_video_codec_name().empty() &&
+        !encodeParameter->get_audio_codec_name().empty())
+        candidates.push_back("FFTOOL");
+    if (candidates.empty()) {
+        if (reason)
+            *reason = "no candidate for the parameters";
+        return available.front();
+    }
+
+    ThroughputHistory &history = ThroughputHistory::shared();
+    std::string best;
+    double bestSpeed = 0.0;
+    for (const std::string &name : candidates) {
+        double speed = history.get_speed(job.jobKey, name);
+        if (speed > bestSpeed) {
+            bestSpeed = speed;
+            best = name;
+        }
+    }
+    if (!best.empty()) {
+        // Measure the other candidates too, so one slow early sample
+        // cannot pin the choice; a candidate already measured clearly
+        // slower gets no more jobs
+        std::string explore;
+        int fewestSamples = AUTO_MIN_SAMPLES;
+        for (const std::string &name : candidates) {
+            int samples = history.get_sample_count(job.jobKey, name);
+            bool close = samples == 0 ||
+                         history.get_speed(job.jobKey, name) >= bestSpeed * AUTO_EXPLORE_MARGIN;
+            if (name != best && close && samples < fewestSamples) {
+                fewestSamples = samples;
+                explore = name;
+            }
+        }
+        if (!explore.empty()) {
+            why << "sample " << fewestSamples + 1 << " of " << AUTO_MIN_SAMPLES
+                << " for " << job.jobKey;
+            if (reason)
+                *reason = why.str();
+            return explore;
+        }
+        why << bestSpeed << "x realtime for " << job.jobKey;
+        if (reason)
+            *reason = why.str();
+        return best;
+    }
+
+    bool filtered = encodeParameter->get_width() > 0 ||
+                    encodeParameter->get_height() > 0 ||
+                    !encodeParameter->get_pixel_format().empty();
+    bool highResolution = job.height > 720;
+    if (filtered && highResolution && candidates.back() == "FFTOOL")
+        best = "FFTOOL";
+    else
+        best = candidates.front();
+    if (reason)
+        *reason = "no history for " + job.jobKey;
+    return best;
+}
+
+double Converter::predict_seconds(const std::string &src,
+                                  EncodeParameter *encodeParameter,
+                                  const std::string &transcoderName) {
+    if (!encodeParameter)
+        return -1.0;
+    return predict_seconds(probe_job(src, encodeParameter), encodeParameter,
+                           transcoderName);
+}
+
+double Converter::predict_seconds(const JobProfile &job,
+                                  EncodeParameter *encodeParameter,
+                                  const std::string &transcoderName) {
+    if (!encodeParameter || get_available_transcoders().empty())
+        return -1.0;
+    std::string name = transcoderName == "AUTO"
+                           ? select_transcoder(encodeParameter, job, nullptr)
+                           : transcoderName;
+    return ThroughputHistory::shared().predict_seconds(job.jobKey, name,
+                                                       job.mediaSeconds);
+}
+
 bool Converter::convert_format(const std::string &src, const std::string &dst) {
+    // Reject encoders and formats this FFmpeg lacks before opening the input
+    std::string error;
+    if (!CodecCapabilities::shared().validate(encodeParameter, dst, error)) {
+        std::cout << "Invalid encode parameters: " << error << std::endl;
+        return false;
+    }
+
+    // Copy the streams the output takes unchanged instead of encoding
+    // them. The plan goes into a copy the job owns; the caller's
+    // parameters may be read by other threads meanwhile (a BatchItem is
+    // journaled while it runs) and are never written.
+    EncodeParameter planned = *encodeParameter;
+    StreamPlan plan;
+    if (StreamPlan::build(src, dst, &planned, plan, error) && plan.apply(&planned))
+        std::cout << "Stream plan for " << dst << ":\n" << plan.describe();
+
+    EncodeParameter *requested = encodeParameter;
+    encodeParameter = &planned;
+    if (transcoder)
+        transcoder->encode_parameter = &planned;
+    bool result = run_job(src, dst);
+    encodeParameter = requested;
+    if (transcoder)
+        transcoder->encode_parameter = requested;
+    return result;
+}
+
+bool Converter::run_job(const std::string &src, const std::string &dst) {
+    // The input is opened once per job, not at all if it was probed before
+    job = inputProbed ? shape_job(probedInput, encodeParameter)
+                      : probe_job(src, encodeParameter);
+    inputProbed = false;
+    if (autoSelect) {
+        std::string reason;
+        std::string name = select_transcoder(encodeParameter, job, &reason);
+        std::cout << "Auto transcoder: " << name << " (" << reason << ")" << std::endl;
+        if (!create_transcoder(name))
+            return false;
+    }
+    if (!transcoder)
+        return false;
+
+    // Same input bytes and settings converted before, by any job
+    OutputCache *cache = OutputCache::shared();
+    std::string cacheKey;
+    if (cache) {
+        cacheKey = cache->key(src, dst, transcoderName, encodeParameter);
+        if (cache->fetch(cacheKey, dst)) {
+            std::cout << "Output cache hit, " << dst << " was not converted again" << std::endl;
+            if (processParameter)
+                processParameter->set_process_number(100);
+            return true;
+        }
+        // dst may be a hard link into the cache from an earlier hit, it
+        // must be replaced instead of rewritten in place
+        OutputCache::detach(dst);
+    }
+
+    // A failed or cancelled job must not leave a partial output behind,
+    // but a dst it never got to write stays as it was
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    bool dstExisted = fs::exists(dst, ec);
+    fs::file_time_type dstTime =
+        dstExisted ? fs::last_write_time(dst, ec) : fs::file_time_type{};
+
+    ThroughputHistory &history = ThroughputHistory::shared();
+    transcoder->reset_progress(
+        history.predict_seconds(job.jobKey, transcoderName, job.mediaSeconds));
+
+    auto start = std::chrono::steady_clock::now();
+    bool result = encodeParameter->get_distribute_dir().empty()
+                      ? transcoder->transcode(src, dst)
+                      : convert_distributed(src, dst);
+    double elapsed = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    if (!result && fs::exists(dst, ec) &&
+        (!dstExisted || fs::last_write_time(dst, ec) != dstTime))
+        fs::remove(dst, ec);
+    if (result && cache)
+        cache->store(cacheKey, dst);
+    if (result && job.mediaSeconds > 0.0)
+        history.record({transcoderName, job.jobKey, job.mediaSeconds, elapsed,
+                        static_cast<int64_t>(job.mediaSeconds * job.frameRate)});
+    return result;
+}
+
+bool Converter::convert_distributed(const std::string &src, const std::string &dst) {
+#if defined(ENABLE_FFMPEG)
+    namespace fs = std::filesystem;
+    std::string spoolDir = encodeParameter->get_distribute_dir();
+    if (transcoderName != "FFMPEG" || encodeParameter->get_checkpoint_interval() <= 0) {
+        std::cout << "Distributed encoding needs the FFMPEG transcoder and a "
+                     "segment length, converting locally" << std::endl;
+        return transcoder->transcode(src, dst);
+    }
+
+    TranscoderFFmpeg planner(processParameter, encodeParameter);
+    std::vector<std::pair<int64_t, int64_t>> windows;
+    if (!planner.plan_segments(src, dst, windows))
+        return transcoder->transcode(src, dst);
+
+    // Segments go to the shared volume, every node must reach them
+    std::error_code ec;
+    fs::path partsDir = fs::absolute(fs::path(spoolDir) / "parts" /
+                                     (fs::path(dst).filename().string() + "-" +
+                                      std::to_string(std::chrono::system_clock::now()
+                                                         .time_since_epoch()
+                                                         .count())),
+                                     ec);
+    fs::create_directories(partsDir, ec);
+    if (ec) {
+        std::cerr << "Cannot create " << partsDir.string() << ": " << ec.message() << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> parts;
+    std::vector<std::string> names;
+    for (size_t i = 0; i < windows.size(); i++) {
+        char partName[32];
+        snprintf(partName, sizeof(partName), "part-%05zu.mkv", i);
+        parts.push_back((partsDir / partName).string());
+
+        // Segment jobs carry the video settings only, the audio is
+        // converted once in the join
+        EncodeParameter segment = *encodeParameter;
+        segment.set_distribute_dir("");
+        segment.set_checkpoint_interval(0.0);
+        segment.set_segment_window(windows[i].first, windows[i].second);
+        std::string name = SpoolWorker::submit(spoolDir, src, parts.back(), "FFMPEG", &segment);
+        if (name.empty()) {
+            std::cerr << "Cannot write segment job to " << spoolDir << std::endl;
+            return false;
+        }
+        names.push_back(name);
+    }
+    std::cout << "Distributed " << names.size() << " segments to " << spoolDir << std::endl;
+
+    SpoolWorker worker(spoolDir);
+    int failed = worker.run_jobs(names, processParameter);
+    if (failed != 0) {
+        std::cerr << (failed < 0 ? "Distributed encode cancelled"
+                                 : "Segments failed, see the spool's failed/")
+                  << std::endl;
+        fs::remove_all(partsDir, ec);
+        return false;
+    }
+
+    TranscoderFFmpeg stitch(processParameter, encodeParameter);
+    stitch.reset_progress(-1);
+    stitch.set_stitch_parts(parts);
+    bool result = stitch.transcode(src, dst);
+    fs::remove_all(partsDir, ec);
+    // Failed segments stay in failed/ to be looked at
+    if (result)
+        SpoolWorker::remove_jobs(spoolDir, names);
+    return result;
+#else
     return transcoder->transcode(src, dst);
+#endif
+}
+
+void Converter::cancel() {
+    if (processParameter)
+        processParameter->request_cancel();
 }
 
 Converter::~Converter() {
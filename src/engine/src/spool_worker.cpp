@@ -0,0 +1,564 @@
+/*
+ * Copyright 2025 Jack Lau
+ * Email: jacklau1222gm@gmail.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/spool_worker.h"
+#include "../../common/include/process_parameter.h"
+#include "../include/converter.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+    #include <process.h>
+    #define getpid _getpid
+#else
+    #include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+#define JOB_EXT ".job"
+#define LEASE_EXT ".lease"
+#define STATS_EXT ".stats"
+// Idle nodes look for new jobs this often
+#define POLL_INTERVAL_MS 1000
+
+std::atomic<bool> SpoolWorker::stopRequested(false);
+
+namespace {
+
+typedef std::map<std::string, std::string> KeyValues;
+
+KeyValues read_key_values(const fs::path &path) {
+    KeyValues values;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t eq = line.find('=');
+        if (eq != std::string::npos)
+            values[line.substr(0, eq)] = line.substr(eq + 1);
+    }
+    return values;
+}
+
+// Write next to the target and rename, readers never see a partial file
+bool write_key_values(const fs::path &path, const KeyValues &values,
+                      const std::string &writer) {
+    fs::path tmpPath = path;
+    tmpPath += ".tmp." + writer;
+    {
+        std::ofstream file(tmpPath, std::ios::trunc);
+        if (!file)
+            return false;
+        for (const auto &kv : values)
+            file << kv.first << "=" << kv.second << "\n";
+        if (!file.good())
+            return false;
+    }
+    std::error_code ec;
+    fs::rename(tmpPath, path, ec);
+    if (ec) {
+        fs::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
+
+std::string read_file(const fs::path &path) {
+    std::ifstream file(path);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+std::vector<std::string> list_jobs(const fs::path &dir) {
+    std::vector<std::string> names;
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, ec), end; !ec && it != end;
+         it.increment(ec)) {
+        if (it->path().extension() == JOB_EXT)
+            names.push_back(it->path().stem().string());
+    }
+    // Job names start with the submit time, so this is FIFO
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+bool try_rename(const fs::path &from, const fs::path &to) {
+    std::error_code ec;
+    fs::rename(from, to, ec);
+    return !ec;
+}
+
+std::string to_string(double value) {
+    std::ostringstream out;
+    out << value;
+    return out.str();
+}
+
+KeyValues job_from_parameters(const std::string &src, const std::string &dst,
+                              const std::string &transcoderName,
+                              EncodeParameter *param) {
+    KeyValues job;
+    job["input"] = src;
+    job["output"] = dst;
+    job["transcoder"] = transcoderName;
+    job["video_codec"] = param->get_video_codec_name();
+    job["video_bit_rate"] = std::to_string(param->get_video_bit_rate());
+    job["audio_codec"] = param->get_audio_codec_name();
+    job["audio_bit_rate"] = std::to_string(param->get_audio_bit_rate());
+    job["qscale"] = std::to_string(param->get_qscale());
+    job["pixel_format"] = param->get_pixel_format();
+    job["width"] = std::to_string(param->get_width());
+    job["height"] = std::to_string(param->get_height());
+    job["preset"] = param->get_preset();
+    job["start_time"] = to_string(param->get_start_time());
+    job["end_time"] = to_string(param->get_end_time());
+    job["algo_mode"] = std::to_string(static_cast<int>(param->get_algo_mode()));
+    job["upscale_factor"] = std::to_string(param->get_upscale_factor());
+    job["checkpoint_interval"] = to_string(param->get_checkpoint_interval());
+    if (param->has_segment_window()) {
+        job["segment_begin"] = std::to_string(param->get_segment_begin());
+        job["segment_end"] = std::to_string(param->get_segment_end());
+    }
+    return job;
+}
+
+// Only set what differs from the defaults, the setters mark the
+// parameters as available
+void parameters_from_job(const KeyValues &job, EncodeParameter *param) {
+    EncodeParameter defaults;
+    auto text = [&job](const char *key) {
+        auto it = job.find(key);
+        return it == job.end() ? std::string() : it->second;
+    };
+    auto number = [&text](const char *key, double fallback) {
+        std::string value = text(key);
+        return value.empty() ? fallback : std::atof(value.c_str());
+    };
+
+    if (!text("video_codec").empty())
+        param->set_video_codec_name(text("video_codec"));
+    int64_t videoBitRate = static_cast<int64_t>(
+        number("video_bit_rate", defaults.get_video_bit_rate()));
+    if (videoBitRate != defaults.get_video_bit_rate())
+        param->set_video_bit_rate(videoBitRate);
+    if (!text("audio_codec").empty())
+        param->set_audio_codec_name(text("audio_codec"));
+    int64_t audioBitRate = static_cast<int64_t>(
+        number("audio_bit_rate", defaults.get_audio_bit_rate()));
+    if (audioBitRate != defaults.get_audio_bit_rate())
+        param->set_audio_bit_rate(audioBitRate);
+    int qscale = static_cast<int>(number("qscale", defaults.get_qscale()));
+    if (qscale != defaults.get_qscale())
+        param->set_qscale(qscale);
+    if (!text("pixel_format").empty())
+        param->set_pixel_format(text("pixel_format"));
+    int width = static_cast<int>(number("width", defaults.get_width()));
+    if (width != defaults.get_width())
+        param->set_width(static_cast<uint16_t>(width));
+    int height = static_cast<int>(number("height", defaults.get_height()));
+    if (height != defaults.get_height())
+        param->set_height(static_cast<uint16_t>(height));
+    if (!text("preset").empty())
+        param->set_preset(text("preset"));
+    double startTime = number("start_time", defaults.get_start_time());
+    if (startTime != defaults.get_start_time())
+        param->set_start_time(startTime);
+    double endTime = number("end_time", defaults.get_end_time());
+    if (endTime != defaults.get_end_time())
+        param->set_end_time(endTime);
+    AlgoMode algoMode = static_cast<AlgoMode>(
+        static_cast<int>(number("algo_mode", 0)));
+    if (algoMode != defaults.get_algo_mode())
+        param->set_algo_mode(algoMode);
+    int upscaleFactor = static_cast<int>(
+        number("upscale_factor", defaults.get_upscale_factor()));
+    if (upscaleFactor != defaults.get_upscale_factor())
+        param->set_upscale_factor(upscaleFactor);
+    double checkpointInterval = number("checkpoint_interval", 0.0);
+    if (checkpointInterval > 0.0)
+        param->set_checkpoint_interval(checkpointInterval);
+    if (!text("segment_begin").empty() && !text("segment_end").empty())
+        param->set_segment_window(std::strtoll(text("segment_begin").c_str(), NULL, 10),
+                                  std::strtoll(text("segment_end").c_str(), NULL, 10));
+}
+
+std::string host_name() {
+#if defined(_WIN32)
+    const char *name = std::getenv("COMPUTERNAME");
+    return name ? name : "localhost";
+#else
+    char name[256] = {0};
+    if (gethostname(name, sizeof(name) - 1) != 0)
+        return "localhost";
+    return name;
+#endif
+}
+
+int64_t epoch_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace
+
+SpoolWorker::SpoolWorker(const std::string &spoolDir) : spoolDir(spoolDir) {
+    // Unique per worker, several may run in one process
+    static std::atomic<int> instances(0);
+    nodeId = host_name() + "-" + std::to_string(getpid()) + "-" +
+             std::to_string(instances++);
+}
+
+std::string SpoolWorker::submit(const std::string &spoolDir,
+                                const std::string &src, const std::string &dst,
+                                const std::string &transcoderName,
+                                EncodeParameter *encodeParameter) {
+    std::error_code ec;
+    fs::path jobsDir = fs::path(spoolDir) / "jobs";
+    fs::create_directories(jobsDir, ec);
+
+    static std::atomic<int> counter(0);
+    std::ostringstream name;
+    name << epoch_ms() << "-" << host_name() << "-" << getpid() << "-"
+         << counter++;
+
+    KeyValues job = job_from_parameters(fs::absolute(src, ec).string(),
+                                        fs::absolute(dst, ec).string(),
+                                        transcoderName, encodeParameter);
+    // Not named *.job until complete, so no node claims a partial file
+    if (!write_key_values(jobsDir / (name.str() + JOB_EXT), job, "submit"))
+        return std::string();
+    return name.str();
+}
+
+void SpoolWorker::stop() { stopRequested = true; }
+
+void SpoolWorker::set_lease_timeout(int seconds) {
+    leaseTimeout = std::max(2, seconds);
+}
+
+std::string SpoolWorker::get_node_id() { return nodeId; }
+
+bool SpoolWorker::prepare() {
+    std::error_code ec;
+    for (const char *dir : {"jobs", "claimed", "done", "failed"}) {
+        fs::create_directories(fs::path(spoolDir) / dir, ec);
+        if (ec) {
+            std::cerr << "Cannot create " << (fs::path(spoolDir) / dir).string()
+                      << ": " << ec.message() << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+int SpoolWorker::run(bool drain) {
+    if (!prepare())
+        return 1;
+    std::cout << "Spool worker " << nodeId << " on " << spoolDir << "\n";
+
+    int failed = 0;
+    while (!stopRequested) {
+        std::string name;
+        if (claim_next(name)) {
+            if (!process(name))
+                failed++;
+            continue;
+        }
+
+        reclaim_expired();
+        if (drain && is_idle())
+            break;
+        for (int waited = 0; waited < POLL_INTERVAL_MS && !stopRequested;
+             waited += 100)
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return failed;
+}
+
+int SpoolWorker::run_jobs(const std::vector<std::string> &names,
+                          ProcessParameter *owner) {
+    if (!prepare())
+        return static_cast<int>(names.size());
+    this->owner = owner;
+    std::set<std::string> pending(names.begin(), names.end());
+    fs::path jobsDir = fs::path(spoolDir) / "jobs";
+    int failed = 0;
+
+    while (!pending.empty()) {
+        if (should_cancel()) {
+            // Jobs other nodes already run finish there and are ignored
+            std::error_code ec;
+            for (const std::string &name : pending)
+                fs::remove(jobsDir / (name + JOB_EXT), ec);
+            this->owner = nullptr;
+            return -1;
+        }
+
+        for (auto it = pending.begin(); it != pending.end();) {
+            std::error_code ec;
+            if (fs::exists(fs::path(spoolDir) / "done" / (*it + JOB_EXT), ec)) {
+                it = pending.erase(it);
+            } else if (fs::exists(fs::path(spoolDir) / "failed" / (*it + JOB_EXT), ec)) {
+                failed++;
+                it = pending.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (owner && !names.empty())
+            owner->set_process_number(static_cast<int64_t>(names.size() - pending.size()),
+                                      static_cast<int64_t>(names.size()));
+        if (pending.empty())
+            break;
+
+        std::string name;
+        if (claim_next(name, &pending)) {
+            process(name);
+            continue;
+        }
+        reclaim_expired();
+        for (int waited = 0; waited < POLL_INTERVAL_MS && !should_cancel();
+             waited += 100)
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    this->owner = nullptr;
+    return failed;
+}
+
+void SpoolWorker::remove_jobs(const std::string &spoolDir,
+                              const std::vector<std::string> &names) {
+    std::error_code ec;
+    for (const char *dir : {"done", "failed"}) {
+        for (const std::string &name : names) {
+            fs::remove(fs::path(spoolDir) / dir / (name + JOB_EXT), ec);
+            fs::remove(fs::path(spoolDir) / dir / (name + STATS_EXT), ec);
+        }
+    }
+}
+
+bool SpoolWorker::should_cancel() {
+    return stopRequested || (owner && owner->is_cancel_requested());
+}
+
+bool SpoolWorker::claim_next(std::string &name, const std::set<std::string> *only) {
+    fs::path jobsDir = fs::path(spoolDir) / "jobs";
+    fs::path claimedDir = fs::path(spoolDir) / "claimed";
+    for (const std::string &candidate : list_jobs(jobsDir)) {
+        if (only && !only->count(candidate))
+            continue;
+        // Loses to any other node renaming the same file first
+        if (!try_rename(jobsDir / (candidate + JOB_EXT),
+                        claimedDir / (candidate + JOB_EXT)))
+            continue;
+        write_lease(candidate, 0);
+        name = candidate;
+        return true;
+    }
+    return false;
+}
+
+bool SpoolWorker::write_lease(const std::string &name, int64_t beat) {
+    KeyValues lease;
+    lease["node"] = nodeId;
+    lease["beat"] = std::to_string(beat);
+    // Other nodes time the lease out after the owner's timeout, not theirs
+    lease["timeout"] = std::to_string(leaseTimeout);
+    return write_key_values(fs::path(spoolDir) / "claimed" / (name + LEASE_EXT),
+                            lease, nodeId);
+}
+
+bool SpoolWorker::owns_lease(const std::string &name) {
+    fs::path claimedDir = fs::path(spoolDir) / "claimed";
+    std::error_code ec;
+    if (!fs::exists(claimedDir / (name + JOB_EXT), ec))
+        return false;
+    // The job file alone is not enough: after a reclaim another node may
+    // have claimed it again
+    return read_key_values(claimedDir / (name + LEASE_EXT))["node"] == nodeId;
+}
+
+void SpoolWorker::heartbeat(const std::string &name, Converter *converter,
+                            std::atomic<bool> &finished,
+                            std::atomic<bool> &leaseLost) {
+    auto interval = std::chrono::milliseconds(leaseTimeout * 1000 / 4);
+    auto nextBeat = std::chrono::steady_clock::now() + interval;
+    int64_t beat = 1;
+
+    while (!finished) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (should_cancel()) {
+            converter->cancel();
+            continue;
+        }
+        if (std::chrono::steady_clock::now() < nextBeat)
+            continue;
+        nextBeat += interval;
+
+        if (!owns_lease(name)) {
+            // Another node took the job back, its result would be discarded
+            leaseLost = true;
+            converter->cancel();
+            continue;
+        }
+        write_lease(name, beat++);
+    }
+}
+
+bool SpoolWorker::process(const std::string &name) {
+    fs::path claimedDir = fs::path(spoolDir) / "claimed";
+    fs::path claimedJob = claimedDir / (name + JOB_EXT);
+    fs::path leasePath = claimedDir / (name + LEASE_EXT);
+    KeyValues job = read_key_values(claimedJob);
+
+    std::string src = job["input"];
+    std::string dst = job["output"];
+    std::string transcoderName =
+        job["transcoder"].empty() ? "FFMPEG" : job["transcoder"];
+    std::cout << "[" << name << "] " << src << " -> " << dst << "\n";
+
+    // Convert into a file of this node and move it into place only while
+    // still owning the job, so a node that lost its lease never writes
+    // over the output of the node that took the job over
+    fs::path partPath;
+    if (!dst.empty()) {
+        fs::path target(dst);
+        partPath = target.parent_path() /
+                   (target.stem().string() + ".spool-" + nodeId +
+                    target.extension().string());
+    }
+
+    ProcessParameter processParam;
+    EncodeParameter encodeParam;
+    parameters_from_job(job, &encodeParam);
+    Converter converter(&processParam, &encodeParam);
+
+    std::atomic<bool> finished(false);
+    std::atomic<bool> leaseLost(false);
+    std::thread beater(&SpoolWorker::heartbeat, this, name, &converter,
+                       std::ref(finished), std::ref(leaseLost));
+
+    int64_t startedMs = epoch_ms();
+    auto started = std::chrono::steady_clock::now();
+    bool success = !src.empty() && !dst.empty() &&
+                   converter.set_transcoder(transcoderName) &&
+                   converter.convert_format(src, partPath.string());
+    double elapsed = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - started)
+                         .count();
+
+    finished = true;
+    beater.join();
+
+    std::error_code ec;
+    if (leaseLost || !owns_lease(name)) {
+        if (!partPath.empty())
+            fs::remove(partPath, ec);
+        std::cerr << "[" << name << "] lease lost, result discarded\n";
+        return false;
+    }
+    if (success) {
+        fs::rename(partPath, dst, ec);
+        success = !ec;
+    }
+    if (!success && !partPath.empty())
+        fs::remove(partPath, ec);
+    if (!success && should_cancel()) {
+        // Stopped, not failed: another node converts it from the start
+        fs::remove(leasePath, ec);
+        try_rename(claimedJob, fs::path(spoolDir) / "jobs" / (name + JOB_EXT));
+        std::cout << "[" << name << "] returned to the spool\n";
+        return true;
+    }
+
+    fs::path resultDir = fs::path(spoolDir) / (success ? "done" : "failed");
+    KeyValues stats;
+    stats["node"] = nodeId;
+    stats["success"] = success ? "1" : "0";
+    stats["transcoder"] = converter.get_transcoder_name();
+    stats["started_ms"] = std::to_string(startedMs);
+    stats["elapsed_seconds"] = to_string(elapsed);
+    stats["media_seconds"] = to_string(converter.get_media_seconds());
+    if (success) {
+        uintmax_t outputSize = fs::file_size(dst, ec);
+        stats["output_bytes"] = std::to_string(ec ? 0 : outputSize);
+    } else {
+        stats["error"] = src.empty() || dst.empty() ? "Invalid job file"
+                                                    : "Conversion failed";
+    }
+    // Stats first, so a job in done/ or failed/ always has them
+    write_key_values(resultDir / (name + STATS_EXT), stats, nodeId);
+    try_rename(claimedJob, resultDir / (name + JOB_EXT));
+    fs::remove(leasePath, ec);
+
+    std::cout << "[" << name << "] " << (success ? "done" : "failed")
+              << " in " << elapsed << " s\n";
+    return success;
+}
+
+void SpoolWorker::reclaim_expired() {
+    fs::path claimedDir = fs::path(spoolDir) / "claimed";
+    auto now = std::chrono::steady_clock::now();
+    std::map<std::string, LeaseState> seen;
+
+    for (const std::string &name : list_jobs(claimedDir)) {
+        fs::path leasePath = claimedDir / (name + LEASE_EXT);
+        // A node that died between claiming and writing its lease leaves
+        // no lease, which times out like a lease that stopped changing
+        std::string content = read_file(leasePath);
+        int timeout = leaseTimeout;
+        std::string recorded = read_key_values(leasePath)["timeout"];
+        if (!recorded.empty())
+            timeout = std::max(2, std::atoi(recorded.c_str()));
+
+        auto it = leases.find(name);
+        LeaseState state = {content, now};
+        if (it != leases.end() && it->second.content == content)
+            state.changed = it->second.changed;
+
+        if (now - state.changed < std::chrono::seconds(timeout)) {
+            seen[name] = state;
+            continue;
+        }
+
+        // Only one node wins this rename, the others skip the job
+        fs::path reclaiming = claimedDir / (name + ".reclaim." + nodeId);
+        if (!try_rename(claimedDir / (name + JOB_EXT), reclaiming))
+            continue;
+        std::error_code ec;
+        fs::remove(leasePath, ec);
+        try_rename(reclaiming, fs::path(spoolDir) / "jobs" / (name + JOB_EXT));
+        std::cout << "[" << name << "] lease expired, returned to the spool\n";
+    }
+    // Forget jobs that finished or were reclaimed
+    leases.swap(seen);
+}
+
+bool SpoolWorker::is_idle() {
+    return list_jobs(fs::path(spoolDir) / "jobs").empty() &&
+           list_jobs(fs::path(spoolDir) / "claimed").empty();
+}
@@ -1,14 +1,28 @@
+#include "common/include/codec_capabilities.h"
 #include "common/include/encode_parameter.h"
+#include "common/include/output_cache.h"
 #include "common/include/process_parameter.h"
+#include "common/include/stream_plan.h"
 #include "engine/include/converter.h"
+#include "engine/include/spool_worker.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
 #include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <filesystem>
+#include <vector>
 
 #if defined(ENABLE_GUI)
+    #include "builder/include/folder_watcher.h"
+    #include "builder/include/job_server.h"
     #include "builder/include/open_converter.h"
     #include <QApplication>
+    #include <QTimer>
 #endif
 
 namespace fs = std::filesystem;
@@ -38,7 +52,11 @@ void printUsage(const char *programName) {
               << " [options] input_file output_file\n"
               << "Options:\n"
               << "  --transcoder TYPE        Set transcoder type (FFMPEG, BMF, "
-                 "FFTOOL)\n"
+                 "FFTOOL, AUTO)\n"
+              << "  --compare                Run the job on every enabled transcoder and\n"
+              << "                           report speed and size (writes OUTPUT.<transcoder>.EXT)\n"
+              << "  --dry-run                Print which streams would be copied or encoded\n"
+              << "                           and the predicted time, without converting\n"
               << "  -v, --video-codec CODEC  Set video codec (could set copy)\n"
               << "  -q, --qscale QSCALE      Set qscale for video codec\n"
               << "  -a, --audio-codec CODEC  Set audio codec (could set copy)\n"
@@ -50,7 +68,33 @@ void printUsage(const char *programName) {
               << "  -ss START_TIME           Set start time for cutting (format: HH:MM:SS or seconds)\n"
               << "  -to END_TIME             Set end time for cutting (format: HH:MM:SS or seconds)\n"
               << "  -t DURATION              Set duration for cutting (format: HH:MM:SS or seconds)\n"
+              << "  --checkpoint SECONDS     Encode in segments of SECONDS and resume an\n"
+              << "                           interrupted job from its last segment [FFMPEG]\n"
+              << "  --distribute DIR         Encode the video in segments (--checkpoint length,\n"
+              << "                           default 60) as jobs in spool directory DIR, so\n"
+              << "                           --spool workers share them; audio and the join\n"
+              << "                           run here [FFMPEG]\n"
+              << "  --cache DIR              Reuse results of identical earlier conversions\n"
+              << "                           stored in DIR, and store this one there\n"
+              << "  --cache-size MB          Bound of the cache directory (default 20480)\n"
+              << "  --spool-submit DIR       Add the job to the spool directory DIR instead\n"
+              << "                           of converting it\n"
               << "  -h, --help               Show this help message\n"
+              << "\n"
+              << "Spool worker: " << programName << " --spool DIR [--drain] [--lease SECONDS]\n"
+              << "  Convert jobs from a spool directory shared with other nodes;\n"
+              << "  --drain exits once no job is left, --lease sets the heartbeat\n"
+              << "  timeout after which a dead node's job is taken back (default 30)\n"
+#if defined(ENABLE_GUI)
+              << "\n"
+              << "Server mode: " << programName << " --serve [NAME]\n"
+              << "  Run jobs submitted as JSON lines over the local socket NAME\n"
+              << "  (default " << JobServer::DEFAULT_NAME << ")\n"
+              << "\n"
+              << "Watch mode: " << programName << " --watch DIR [DIR...]\n"
+              << "  Convert files as they are dropped into the folders, with the\n"
+              << "  settings in each folder's " << FolderWatcher::PRESET_FILE_NAME << "\n"
+#endif
               << "\n"
               << "Note: Use either -to or -t, not both. If both are specified, -to takes precedence.\n";
 }
@@ -153,6 +197,99 @@ static bool confirm_overwrite(const fs::path &p) {
     }
 }
 
+// Run the same job on every enabled backend and print a comparison table
+static bool compareTranscoders(const std::string &inputFile,
+                               const std::string &outputFile,
+                               ProcessParameter *processParam,
+                               EncodeParameter *encodeParam) {
+    struct CompareResult {
+        std::string transcoder;
+        bool success;
+        double seconds;
+        double mediaSeconds;
+        uintmax_t size;
+    };
+    std::vector<CompareResult> results;
+
+    fs::path output(outputFile);
+    for (const std::string &name : Converter::get_available_transcoders()) {
+        std::string suffix = name;
+        std::transform(suffix.begin(), suffix.end(), suffix.begin(), ::tolower);
+        fs::path target = output.parent_path() /
+                          (output.stem().string() + "." + suffix +
+                           output.extension().string());
+
+        std::cout << "Comparing " << name << " -> " << target.string() << "\n";
+        Converter converter(processParam, encodeParam);
+        CompareResult result = {name, false, 0.0, 0.0, 0};
+        if (converter.set_transcoder(name)) {
+            auto start = std::chrono::steady_clock::now();
+            result.success = converter.convert_format(inputFile, target.string());
+            result.seconds = std::chrono::duration<double>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+            result.mediaSeconds = converter.get_media_seconds();
+        }
+        std::error_code ec;
+        if (result.success)
+            result.size = fs::file_size(target, ec);
+        results.push_back(result);
+    }
+
+    std::cout << "\n"
+              << std::left << std::setw(12) << "Transcoder" << std::right
+              << std::setw(10) << "Time(s)" << std::setw(10) << "Speed"
+              << std::setw(14) << "Size(KB)" << "\n";
+    bool anySuccess = false;
+    for (const CompareResult &r : results) {
+        std::cout << std::left << std::setw(12) << r.transcoder << std::right;
+        if (!r.success) {
+            std::cout << std::setw(10) << "failed" << "\n";
+            continue;
+        }
+        anySuccess = true;
+        std::ostringstream speed;
+        if (r.mediaSeconds > 0.0 && r.seconds > 0.0)
+            speed << std::fixed << std::setprecision(2)
+                  << r.mediaSeconds / r.seconds << "x";
+        else
+            speed << "-";
+        std::cout << std::fixed << std::setprecision(2) << std::setw(10)
+                  << r.seconds << std::setw(10) << speed.str() << std::setw(14)
+                  << r.size / 1024 << "\n";
+    }
+    return anySuccess;
+}
+
+// Print the per-stream plan of the job and its predicted time
+static bool printPlan(const std::string &inputFile,
+                      const std::string &outputFile,
+                      const std::string &transcoderType,
+                      EncodeParameter *encodeParam) {
+    std::string error;
+    StreamPlan plan;
+    if (!CodecCapabilities::shared().validate(encodeParam, outputFile, error) ||
+        !StreamPlan::build(inputFile, outputFile, encodeParam, plan, error)) {
+        std::cerr << "Error: " << error << "\n";
+        return false;
+    }
+
+    EncodeParameter planned = *encodeParam;
+    plan.apply(&planned);
+    std::cout << "Stream plan for " << outputFile << " (" << plan.container
+              << "):\n"
+              << plan.describe();
+
+    double seconds =
+        Converter::predict_seconds(inputFile, &planned, transcoderType);
+    std::cout << "Predicted time: ";
+    if (seconds < 0)
+        std::cout << "unknown (no earlier job of this kind)\n";
+    else
+        std::cout << std::fixed << std::setprecision(1) << seconds << "s\n";
+    return true;
+}
+
 bool handleCLI(int argc, char *argv[]) {
     if (argc < 3) {
         printUsage(argv[0]);
@@ -174,6 +311,13 @@ bool handleCLI(int argc, char *argv[]) {
     double endTime = -1.0;
     double duration = -1.0;
     int upscaleFactor = -1;
+    double checkpointInterval = -1.0;
+    bool compare = false;
+    bool dryRun = false;
+    std::string spoolDir;
+    std::string distributeDir;
+    std::string cacheDir;
+    uint64_t cacheSizeMB = 20480;
 
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -184,6 +328,26 @@ bool handleCLI(int argc, char *argv[]) {
             if (i + 1 < argc) {
                 transcoderType = argv[++i];
             }
+        } else if (strcmp(argv[i], "--compare") == 0) {
+            compare = true;
+        } else if (strcmp(argv[i], "--dry-run") == 0) {
+            dryRun = true;
+        } else if (strcmp(argv[i], "--cache") == 0) {
+            if (i + 1 < argc) {
+                cacheDir = argv[++i];
+            }
+        } else if (strcmp(argv[i], "--cache-size") == 0) {
+            if (i + 1 < argc) {
+                cacheSizeMB = std::strtoull(argv[++i], NULL, 10);
+            }
+        } else if (strcmp(argv[i], "--distribute") == 0) {
+            if (i + 1 < argc) {
+                distributeDir = argv[++i];
+            }
+        } else if (strcmp(argv[i], "--spool-submit") == 0) {
+            if (i + 1 < argc) {
+                spoolDir = argv[++i];
+            }
         } else if (strcmp(argv[i], "-v") == 0 ||
                    strcmp(argv[i], "--video-codec") == 0) {
             if (i + 1 < argc) {
@@ -252,6 +416,13 @@ bool handleCLI(int argc, char *argv[]) {
                     return false;
                 }
             }
+        } else if (strcmp(argv[i], "--checkpoint") == 0) {
+            if (i + 1 < argc) {
+                if (!parseTime(argv[++i], checkpointInterval) || checkpointInterval <= 0.0) {
+                    std::cerr << "Error: Invalid checkpoint interval\n";
+                    return false;
+                }
+            }
         } else if (strcmp(argv[i], "-upscale") == 0) {
             if (i + 1 < argc) {
                 upscaleFactor = std::stoi(argv[++i]);
@@ -267,7 +438,7 @@ bool handleCLI(int argc, char *argv[]) {
             if (inputFile.empty() && (is_existing_regular_file(p))) {
                 inputFile = p.string();
             } else if (outputFile.empty() && is_valid_output_candidate(p) && !inputFile.empty()) {
-                if (fs::exists(p))
+                if (fs::exists(p) && !dryRun)
                     if (!confirm_overwrite(p))
                         return false;
                 outputFile = p.string();
@@ -286,6 +457,10 @@ bool handleCLI(int argc, char *argv[]) {
         return false;
     }
 
+    if (!cacheDir.empty()) {
+        OutputCache::configure_shared(cacheDir, cacheSizeMB << 20);
+    }
+
     // Create parameters
     ProcessParameter *processParam = new ProcessParameter();
     EncodeParameter *encodeParam = new EncodeParameter();
@@ -331,6 +506,17 @@ bool handleCLI(int argc, char *argv[]) {
         }
     }
 
+    if (checkpointInterval > 0.0) {
+        encodeParam->set_checkpoint_interval(checkpointInterval);
+    }
+
+    if (!distributeDir.empty()) {
+        encodeParam->set_distribute_dir(distributeDir);
+        if (checkpointInterval <= 0.0) {
+            encodeParam->set_checkpoint_interval(60.0);
+        }
+    }
+
     // Handle time parameters with validation
     if (startTime >= 0.0) {
         encodeParam->set_start_time(startTime);
@@ -358,6 +544,28 @@ bool handleCLI(int argc, char *argv[]) {
         }
     }
 
+    if (dryRun) {
+        result = printPlan(inputFile, outputFile, transcoderType, encodeParam);
+        goto end;
+    }
+
+    if (!spoolDir.empty()) {
+        std::string name = SpoolWorker::submit(spoolDir, inputFile, outputFile,
+                                               transcoderType, encodeParam);
+        result = !name.empty();
+        if (result) {
+            std::cout << "Submitted " << name << " to " << spoolDir << "\n";
+        } else {
+            std::cerr << "Error: Failed to write the job to " << spoolDir << "\n";
+        }
+        goto end;
+    }
+
+    if (compare) {
+        result = compareTranscoders(inputFile, outputFile, processParam, encodeParam);
+        goto end;
+    }
+
     // Set transcoder
     if (!converter.set_transcoder(transcoderType)) {
         std::cerr << "Error: Failed to set transcoder\n";
@@ -380,7 +588,99 @@ end:
     return result;
 }
 
+#if defined(ENABLE_GUI)
+static int runJobServer(int argc, char *argv[]) {
+    // Needs an event loop but no display
+    QCoreApplication app(argc, argv);
+    JobServer server;
+    QString name = argc > 2 ? QString::fromLocal8Bit(argv[2]) : QString();
+    if (!server.Listen(name)) {
+        std::cerr << "Error: Failed to listen: "
+                  << server.GetErrorString().toStdString() << "\n";
+        return 1;
+    }
+    std::cout << "Listening on " << server.GetServerPath().toStdString() << "\n";
+    return app.exec();
+}
+#endif
+
+static void stopSpoolWorker(int) {
+    SpoolWorker::stop();
+}
+
+static int runSpoolWorker(int argc, char *argv[]) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    SpoolWorker worker(argv[2]);
+    bool drain = false;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--drain") == 0) {
+            drain = true;
+        } else if (strcmp(argv[i], "--lease") == 0 && i + 1 < argc) {
+            worker.set_lease_timeout(std::atoi(argv[++i]));
+        } else {
+            std::cerr << "Invalid or unexpected argument: '" << argv[i] << "'\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // The running job goes back to the spool instead of being lost
+    std::signal(SIGINT, stopSpoolWorker);
+    std::signal(SIGTERM, stopSpoolWorker);
+    return worker.run(drain) == 0 ? 0 : 1;
+}
+
+#if defined(ENABLE_GUI)
+static int runFolderWatch(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    BatchQueue *queue = BatchQueue::Instance();
+    BatchScheduler scheduler(queue);
+    BatchRunner runner(queue, &scheduler);
+    FolderWatcher watcher(queue);
+
+    for (int i = 2; i < argc; i++) {
+        if (!watcher.AddFolder(QString::fromLocal8Bit(argv[i]))) {
+            std::cerr << "Error: Cannot watch " << argv[i] << "\n";
+            return 1;
+        }
+        std::cout << "Watching " << argv[i] << "\n";
+    }
+    if (!watcher.IsWatching()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    QObject::connect(&watcher, &FolderWatcher::ItemEnqueued, [&runner](BatchItem *item) {
+        std::cout << "Queued " << item->GetInputPath().toStdString() << "\n";
+        runner.Start();
+    });
+    QObject::connect(&runner, &BatchRunner::ItemFinished, [queue](BatchItem *item, bool success) {
+        std::cout << (success ? "Finished " : "Failed ") << item->GetOutputPath().toStdString();
+        if (!success) {
+            std::cout << ": " << item->GetErrorMessage().toStdString();
+        }
+        std::cout << "\n";
+        // Keep the queue bounded while watching indefinitely
+        if (item->GetStatus() != BatchItemStatus::Waiting) {
+            queue->RemoveItem(queue->GetItemIndex(item));
+        }
+    });
+    return app.exec();
+}
+#endif
+
 int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--spool") == 0)
+        return runSpoolWorker(argc, argv);
+#if defined(ENABLE_GUI)
+    if (argc > 1 && strcmp(argv[1], "--serve") == 0)
+        return runJobServer(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--watch") == 0)
+        return runFolderWatch(argc, argv);
+#endif
     if (argc > 1)
         return handleCLI(argc, argv) ? 0 : 1;
 
@@ -388,6 +688,9 @@ int main(int argc, char *argv[]) {
     QApplication app(argc, argv);
     OpenConverter w;
     w.show();
+    // Used by the oc_startup benchmark: quit once the window is up
+    if (qEnvironmentVariableIsSet("OC_EXIT_AFTER_STARTUP"))
+        QTimer::singleShot(0, &app, &QApplication::quit);
     return app.exec();
 #endif
     printUsage(argv[0]);
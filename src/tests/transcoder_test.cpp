@@ -1,11 +1,50 @@
+#include "../common/include/audio_peaks.h"
+#include "../common/include/codec_capabilities.h"
 #include "../common/include/encode_parameter.h"
+#include "../common/include/info.h"
+#include "../common/include/keyframe_index.h"
+#include "../common/include/output_cache.h"
+#include "../common/include/stream_plan.h"
+#include "../common/include/throughput_history.h"
 #include "../engine/include/converter.h"
+#include "../engine/include/spool_worker.h"
+#include <chrono>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <gtest/gtest.h>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
+
+// An empty value unsets the variable
+static void set_environment(const char *name, const std::string &value) {
+#if defined(_WIN32)
+    _putenv_s(name, value.c_str());
+#else
+    if (value.empty())
+        unsetenv(name);
+    else
+        setenv(name, value.c_str(), 1);
+#endif
+}
+
+// Record the jobs of the tests into a history of their own, not into the
+// user's; set before anything uses ThroughputHistory::shared()
+class HistoryEnvironment : public ::testing::Environment {
+public:
+    void SetUp() override {
+        std::string path =
+            (std::filesystem::temp_directory_path() / "transcoder_test_history.txt").string();
+        std::filesystem::remove(path);
+        set_environment("OC_THROUGHPUT_HISTORY", path);
+    }
+};
+
+static ::testing::Environment *const historyEnvironment =
+    ::testing::AddGlobalTestEnvironment(new HistoryEnvironment);
 
 // Test fixture for transcoder tests
 class TranscoderTest : public ::testing::Test {
@@ -400,3 +439,506 @@ TEST_F(TranscoderTest, AudioVideoStreamOrder) {
     EXPECT_TRUE(std::filesystem::exists(outputFile));
     EXPECT_GT(std::filesystem::file_size(outputFile), 0);
 }
+
+// Test for automatic backend selection on a stream copy job
+TEST_F(TranscoderTest, AutoTranscoderRemux) {
+    std::string inputFile = (test_dir_ / "test.mp4").string();
+    std::string outputFile = (test_dir_ / "output_auto.mkv").string();
+
+    EncodeParameter encodeParams;
+    ProcessParameter processParams;
+
+    encodeParams.set_video_codec_name("copy");
+    encodeParams.set_audio_codec_name("copy");
+
+    auto converter = std::make_unique<Converter>(&processParams, &encodeParams);
+    ASSERT_TRUE(converter->set_transcoder("AUTO"));
+    bool result = converter->convert_format(inputFile, outputFile);
+
+    EXPECT_TRUE(result);
+    EXPECT_FALSE(converter->get_transcoder_name().empty());
+    EXPECT_GT(converter->get_media_seconds(), 0.0);
+    EXPECT_TRUE(std::filesystem::exists(outputFile));
+    EXPECT_GT(std::filesystem::file_size(outputFile), 0);
+}
+
+// Test that a cancelled job stops and reports failure
+TEST_F(TranscoderTest, CancelledTranscode) {
+    std::string inputFile = (test_dir_ / "test.mp4").string();
+    std::string outputFile = (test_dir_ / "output_cancelled.mp4").string();
+
+    EncodeParameter encodeParams;
+    ProcessParameter processParams;
+
+    encodeParams.set_video_codec_name("libx264");
+
+    auto converter = std::make_unique<Converter>(&processParams, &encodeParams);
+    converter->set_transcoder("FFMPEG");
+    converter->cancel();
+    bool result = converter->convert_format(inputFile, outputFile);
+
+    EXPECT_FALSE(result);
+    EXPECT_TRUE(processParams.is_cancel_requested());
+}
+
+// Cancels the job at its first progress report
+class CancelOnProgress : public ProcessObserver {
+public:
+    explicit CancelOnProgress(ProcessParameter *processParameter)
+        : processParameter(processParameter) {}
+    void on_process_update(double progress) override {
+        if (progress < 100.0)
+            processParameter->request_cancel();
+    }
+    void on_time_update(double) override {}
+
+private:
+    ProcessParameter *processParameter;
+};
+
+// Test that a job cancelled while it runs leaves no partial output
+TEST_F(TranscoderTest, CancelledMidTranscode) {
+    std::string inputFile = (test_dir_ / "test.mp4").string();
+    std::string outputFile = (test_dir_ / "output_cancelled_mid.mp4").string();
+
+    EncodeParameter encodeParams;
+    ProcessParameter processParams;
+    CancelOnProgress canceller(&processParams);
+    processParams.add_observer(&canceller);
+
+    // Upscaled, so the encode runs long enough to report progress
+    encodeParams.set_video_codec_name("libx264");
+    encodeParams.set_width(3840);
+    encodeParams.set_height(2160);
+
+    auto converter = std::make_unique<Converter>(&processParams, &encodeParams);
+    converter->set_transcoder("FFMPEG");
+    bool result = converter->convert_format(inputFile, outputFile);
+    processParams.remove_observer(&canceller);
+
+    EXPECT_FALSE(result);
+    EXPECT_TRUE(processParams.is_cancel_requested());
+    EXPECT_FALSE(std::filesystem::exists(outputFile));
+}
+
+// Test that a keyframe index is built once and then found in the cache
+TEST_F(TranscoderTest, KeyframeIndexCached) {
+    std::string inputFile = (test_dir_ / "test.mp4").string();
+    set_environment("OC_KEYFRAME_INDEX_DIR", (test_dir_ / "keyframes").string());
+
+    EXPECT_EQ(KeyframeIndex::find(inputFile), nullptr);
+    std::shared_ptr<const KeyframeIndex> index = KeyframeIndex::load(inputFile);
+    ASSERT_NE(index, nullptr);
+    ASSERT_FALSE(index->get_keyframes().empty());
+    EXPECT_GE(index->get_packet_count(), static_cast<int64_t>(index->get_keyframes().size()));
+
+    // The first keyframe is found from its own time and from any later one
+    const KeyframeIndex::Keyframe &first = index->get_keyframes().front();
+    int64_t firstTime = index->time_of(first);
+    EXPECT_EQ(index->at_or_before(firstTime), &first);
+    EXPECT_EQ(index->at_or_before(firstTime - 1), nullptr);
+
+    std::shared_ptr<const KeyframeIndex> cached = KeyframeIndex::find(inputFile);
+    ASSERT_NE(cached, nullptr);
+    EXPECT_EQ(cached->get_keyframes().size(), index->get_keyframes().size());
+
+    set_environment("OC_KEYFRAME_INDEX_DIR", "");
+}
+
+// Test that the waveform peaks cover the audio and stay in range
+TEST_F(TranscoderTest, AudioPeaksOverview) {
+    std::string inputFile = (test_dir_ / "test.mp4").string();
+
+    std::vector<AudioPeaks::Bucket> peaks;
+    int lastFilled = 0;
+    bool result = AudioPeaks::compute(inputFile, 64, peaks,
+        [&lastFilled](const std::vector<AudioPeaks::Bucket> &, int filled) {
+            EXPECT_GE(filled, lastFilled);
+            lastFilled = filled;
+        });
+
+    ASSERT_TRUE(result);
+    ASSERT_EQ(peaks.size(), 64u);
+    EXPECT_EQ(lastFilled, 64);
+    for (const AudioPeaks::Bucket &bucket : peaks) {
+        EXPECT_LE(bucket.min, bucket.max);
+        EXPECT_GE(bucket.min, -1.0f);
+        EXPECT_LE(bucket.max, 1.0f);
+        EXPECT_GE(bucket.rms, 0.0f);
+    }
+}
+
+// Test that a job with an encoder FFmpeg lacks fails before converting
+TEST_F(TranscoderTest, CodecCapabilitiesRejectMissingEncoder) {
+    std::string inputFile = (test_dir_ / "test.mp4").string();
+    std::string outputFile = (test_dir_ / "output_missing_encoder.mp4").string();
+
+    const CodecCapabilities &capabilities = CodecCapabilities::shared();
+    EXPECT_TRUE(capabilities.has_encoder("aac", AVMEDIA_TYPE_AUDIO));
+    EXPECT_FALSE(capabilities.has_encoder("aac", AVMEDIA_TYPE_VIDEO));
+    ASSERT_NE(capabilities.muxer_for_file(outputFile), nullptr);
+    EXPECT_EQ(capabilities.muxer_for_file("output.no_such_format"), nullptr);
+
+    EncodeParameter encodeParams;
+    ProcessParameter processParams;
+    encodeParams.set_video_codec_name("no_such_encoder");
+
+    std::string error;
+    EXPECT_FALSE(capabilities.validate(&encodeParams, outputFile, error));
+    EXPECT_NE(error.find("no_such_encoder"), std::string::npos);
+
+    auto converter = std::make_unique<Converter>(&processParams, &encodeParams);
+    converter->set_transcoder("FFMPEG");
+    EXPECT_FALSE(converter->convert_format(inputFile, outputFile));
+    EXPECT_FALSE(std::filesystem::exists(outputFile));
+}
+
+// Streams the output container takes as they are are copied, a requested
+// change makes the stream encode
+TEST_F(TranscoderTest, StreamPlanCopiesCompatibleStreams) {
+    std::string inputFile = (test_dir_ / "test.mp4").string();
+    std::string outputFile = (test_dir_ / "output_plan.mkv").string();
+
+    EncodeParameter encodeParams;
+    StreamPlan plan;
+    std::string error;
+    ASSERT_TRUE(StreamPlan::build(inputFile, outputFile, &encodeParams, plan, error)) << error;
+    EXPECT_EQ(plan.container, "matroska");
+    EXPECT_EQ(plan.video.action, StreamPlan::Action::Copy);
+    EXPECT_FALSE(plan.video.sourceCodec.empty());
+
+    EXPECT_TRUE(plan.apply(&encodeParams));
+    EXPECT_EQ(encodeParams.get_video_codec_name(), "copy");
+
+    EncodeParameter scaled;
+    scaled.set_width(208);
+    scaled.set_height(120);
+    ASSERT_TRUE(StreamPlan::build(inputFile, outputFile, &scaled, plan, error)) << error;
+    EXPECT_EQ(plan.video.action, StreamPlan::Action::Encode);
+
+    ProcessParameter processParams;
+    EncodeParameter defaults;
+    auto converter = std::make_unique<Converter>(&processParams, &defaults);
+    converter->set_transcoder("FFMPEG");
+    EXPECT_TRUE(converter->convert_format(inputFile, outputFile));
+    EXPECT_TRUE(std::filesystem::exists(outputFile));
+    // The caller's parameters are left as they were
+    EXPECT_EQ(defaults.get_video_codec_name(), "");
+}
+
+// The fast probe reports the same stream parameters as the full one
+TEST_F(TranscoderTest, InfoFastProbeMatchesFullProbe) {
+    std::string inputFile = (test_dir_ / "test.mp4").string();
+
+    Info full;
+    full.send_info(const_cast<char *>(inputFile.c_str()));
+    Info fast;
+    fast.set_fast_probe(true);
+    fast.send_info(const_cast<char *>(inputFile.c_str()));
+
+    QuickInfo *expected = full.get_quick_info();
+    QuickInfo *actual = fast.get_quick_info();
+    ASSERT_GE(expected->videoIdx, 0);
+    EXPECT_EQ(actual->videoIdx, expected->videoIdx);
+    EXPECT_EQ(actual->videoCodec, expected->videoCodec);
+    EXPECT_EQ(actual->width, expected->width);
+    EXPECT_EQ(actual->height, expected->height);
+    EXPECT_EQ(actual->pixelFormat, expected->pixelFormat);
+    EXPECT_EQ(actual->audioIdx, expected->audioIdx);
+    EXPECT_EQ(actual->audioCodec, expected->audioCodec);
+    EXPECT_EQ(actual->sampleRate, expected->sampleRate);
+    EXPECT_DOUBLE_EQ(actual->duration, expected->duration);
+
+    AVFormatContext *fmtCtx = NULL;
+    EXPECT_LT(Info::open_input(&fmtCtx, (test_dir_ / "missing.mp4").string().c_str(), true), 0);
+    EXPECT_EQ(fmtCtx, nullptr);
+}
+
+// Two workers share the spool: every job runs once, and a job claimed by a
+// node that died is taken back after the timeout recorded in its lease
+TEST_F(TranscoderTest, SpoolWorkersShareAndReclaimJobs) {
+    namespace fs = std::filesystem;
+    std::string inputFile = (test_dir_ / "test.mp4").string();
+    fs::path spoolDir = test_dir_ / "spool";
+
+    EncodeParameter encodeParams;
+    encodeParams.set_video_codec_name("copy");
+    encodeParams.set_audio_codec_name("copy");
+    std::vector<std::string> names;
+    std::vector<fs::path> outputs;
+    for (int i = 0; i < 5; i++) {
+        fs::path output = test_dir_ / ("output_spool_" + std::to_string(i) + ".mkv");
+        std::string name = SpoolWorker::submit(spoolDir.string(), inputFile, output.string(),
+                                               "FFMPEG", &encodeParams);
+        ASSERT_FALSE(name.empty());
+        names.push_back(name);
+        outputs.push_back(output);
+    }
+
+    // The last job was claimed by a dead node with a 2 s lease; the
+    // workers' own 30 s timeout must not apply to it
+    fs::create_directories(spoolDir / "claimed");
+    fs::rename(spoolDir / "jobs" / (names.back() + ".job"),
+               spoolDir / "claimed" / (names.back() + ".job"));
+    {
+        std::ofstream lease(spoolDir / "claimed" / (names.back() + ".lease"));
+        lease << "beat=3\nnode=dead-node\ntimeout=2\n";
+    }
+
+    SpoolWorker first(spoolDir.string());
+    SpoolWorker second(spoolDir.string());
+    EXPECT_NE(first.get_node_id(), second.get_node_id());
+    int firstFailed = -1;
+    int secondFailed = -1;
+    std::thread firstThread([&]() { firstFailed = first.run(true); });
+    std::thread secondThread([&]() { secondFailed = second.run(true); });
+    firstThread.join();
+    secondThread.join();
+
+    EXPECT_EQ(firstFailed, 0);
+    EXPECT_EQ(secondFailed, 0);
+    for (size_t i = 0; i < names.size(); i++) {
+        EXPECT_TRUE(fs::exists(spoolDir / "done" / (names[i] + ".job"))) << names[i];
+        EXPECT_TRUE(fs::exists(spoolDir / "done" / (names[i] + ".stats"))) << names[i];
+        EXPECT_TRUE(fs::exists(outputs[i])) << outputs[i];
+    }
+    EXPECT_TRUE(fs::is_empty(spoolDir / "jobs"));
+    EXPECT_TRUE(fs::is_empty(spoolDir / "claimed"));
+    EXPECT_TRUE(fs::is_empty(spoolDir / "failed"));
+    // No node left its private output behind
+    for (const fs::directory_entry &entry : fs::directory_iterator(test_dir_)) {
+        EXPECT_EQ(entry.path().filename().string().find(".spool-"), std::string::npos)
+            << entry.path();
+    }
+}
+
+// A distributed encode splits the input into segment jobs, stitches them
+// back to the full length and leaves nothing of them in the spool
+TEST_F(TranscoderTest, DistributedEncodeStitchesSegments) {
+    namespace fs = std::filesystem;
+    std::string inputFile = (test_dir_ / "test.mp4").string();
+    std::string outputFile = (test_dir_ / "output_distributed.mp4").string();
+    fs::path spoolDir = test_dir_ / "spool";
+
+    Info input;
+    input.send_info(const_cast<char *>(inputFile.c_str()));
+    double inputDuration = input.get_quick_info()->duration;
+    ASSERT_GT(inputDuration, 0.0);
+
+    // Three segments, whatever the length of the test media
+    EncodeParameter encodeParams;
+    ProcessParameter processParams;
+    encodeParams.set_video_codec_name("libx264");
+    encodeParams.set_distribute_dir(spoolDir.string());
+    encodeParams.set_checkpoint_interval(inputDuration / 3);
+
+    auto converter = std::make_unique<Converter>(&processParams, &encodeParams);
+    converter->set_transcoder("FFMPEG");
+    ASSERT_TRUE(converter->convert_format(inputFile, outputFile));
+
+    Info output;
+    output.send_info(const_cast<char *>(outputFile.c_str()));
+    EXPECT_NEAR(output.get_quick_info()->duration, inputDuration, 0.2);
+
+    // The segments went through the spool and were removed after the join
+    ASSERT_TRUE(fs::exists(spoolDir / "done"));
+    for (const char *dir : {"jobs", "claimed", "done", "failed"})
+        EXPECT_TRUE(fs::is_empty(spoolDir / dir)) << dir;
+    EXPECT_TRUE(fs::is_empty(spoolDir / "parts"));
+}
+
+// Video packets in a file, -1 if it cannot be read
+static int64_t count_video_packets(const std::string &path) {
+    AVFormatContext *ctx = nullptr;
+    if (avformat_open_input(&ctx, path.c_str(), nullptr, nullptr) < 0)
+        return -1;
+    int64_t count = -1;
+    int video = avformat_find_stream_info(ctx, nullptr) < 0
+                    ? -1
+                    : av_find_best_stream(ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    AVPacket *pkt = av_packet_alloc();
+    if (video >= 0 && pkt) {
+        count = 0;
+        while (av_read_frame(ctx, pkt) >= 0) {
+            if (pkt->stream_index == video)
+                count++;
+            av_packet_unref(pkt);
+        }
+    }
+    av_packet_free(&pkt);
+    avformat_close_input(&ctx);
+    return count;
+}
+
+// Notes the modification time of a checkpoint segment the first time it
+// exists during a job, and optionally cancels the job right then
+class SegmentWatcher : public ProcessObserver {
+public:
+    SegmentWatcher(ProcessParameter *processParameter, const std::string &segment,
+                   bool cancel)
+        : seen(false), processParameter(processParameter), segment(segment),
+          cancel(cancel) {}
+    void on_process_update(double) override { check(); }
+    void on_time_update(double) override { check(); }
+
+    bool seen;
+    std::filesystem::file_time_type modified;
+
+private:
+    void check() {
+        std::error_code ec;
+        if (seen || !std::filesystem::exists(segment, ec))
+            return;
+        modified = std::filesystem::last_write_time(segment, ec);
+        seen = true;
+        if (cancel)
+            processParameter->request_cancel();
+    }
+
+    ProcessParameter *processParameter;
+    std::string segment;
+    bool cancel;
+};
+
+// A checkpointed job stopped after its first segment resumes from the
+// record: the segment is not encoded again and the joined output has the
+// length and frames of the input
+TEST_F(TranscoderTest, CheckpointResumeSkipsCompletedSegments) {
+    namespace fs = std::filesystem;
+    std::string inputFile = (test_dir_ / "test.mp4").string();
+    std::string outputFile = (test_dir_ / "output_checkpointed.mp4").string();
+    fs::path partsDir = outputFile + ".ocparts";
+    std::string firstSegment = (partsDir / "part-00000.mkv").string();
+
+    Info input;
+    input.send_info(const_cast<char *>(inputFile.c_str()));
+    double inputDuration = input.get_quick_info()->duration;
+    ASSERT_GT(inputDuration, 0.0);
+    int64_t inputFrames = count_video_packets(inputFile);
+    ASSERT_GT(inputFrames, 0);
+
+    // Three segments, whatever the length of the test media
+    EncodeParameter encodeParams;
+    encodeParams.set_video_codec_name("libx264");
+    encodeParams.set_checkpoint_interval(inputDuration / 3);
+
+    // First run: cancelled as soon as segment 0 is complete
+    ProcessParameter firstRun;
+    SegmentWatcher stopper(&firstRun, firstSegment, true);
+    firstRun.add_observer(&stopper);
+    auto converter = std::make_unique<Converter>(&firstRun, &encodeParams);
+    converter->set_transcoder("FFMPEG");
+    bool result = converter->convert_format(inputFile, outputFile);
+    firstRun.remove_observer(&stopper);
+    ASSERT_FALSE(result);
+    ASSERT_TRUE(stopper.seen);
+    EXPECT_FALSE(fs::exists(outputFile));
+
+    // Segment 0 is recorded under the job's signature, segment 1 is not
+    ASSERT_TRUE(fs::exists(firstSegment));
+    EXPECT_FALSE(fs::exists(partsDir / "part-00001.mkv"));
+    fs::file_time_type encoded = fs::last_write_time(firstSegment);
+    std::ifstream record(partsDir / "checkpoint.txt");
+    std::string magic, signature, entry, extra;
+    ASSERT_TRUE(std::getline(record, magic));
+    EXPECT_EQ(magic, "openconverter-checkpoint 1");
+    ASSERT_TRUE(std::getline(record, signature));
+    EXPECT_NE(signature.find(fs::absolute(inputFile).string()), std::string::npos);
+    ASSERT_TRUE(std::getline(record, entry));
+    EXPECT_EQ(entry.rfind("0\t", 0), 0u) << entry;
+    EXPECT_FALSE(std::getline(record, extra)) << extra;
+    record.close();
+
+    // Second run: segment 0 is still the file of the first run while the
+    // remaining segments encode
+    ProcessParameter secondRun;
+    SegmentWatcher watcher(&secondRun, firstSegment, false);
+    secondRun.add_observer(&watcher);
+    converter = std::make_unique<Converter>(&secondRun, &encodeParams);
+    converter->set_transcoder("FFMPEG");
+    result = converter->convert_format(inputFile, outputFile);
+    secondRun.remove_observer(&watcher);
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(watcher.seen);
+    EXPECT_EQ(watcher.modified, encoded);
+
+    // The join leaves no segments behind and loses no frames
+    EXPECT_FALSE(fs::exists(partsDir));
+    Info output;
+    output.send_info(const_cast<char *>(outputFile.c_str()));
+    EXPECT_NEAR(output.get_quick_info()->duration, inputDuration, 0.2);
+    EXPECT_EQ(count_video_packets(outputFile), inputFrames);
+}
+
+// Misses, hits and least recently used eviction; a hit leaves the outputs
+// delivered before it untouched
+TEST_F(TranscoderTest, OutputCacheHitMissAndEviction) {
+    namespace fs = std::filesystem;
+    std::string inputFile = (test_dir_ / "test.mp4").string();
+    uintmax_t objectSize = fs::file_size(inputFile);
+    // Room for two objects, not three
+    OutputCache cache((test_dir_ / "cache").string(), objectSize * 5 / 2);
+
+    // The stored "outputs" are copies of the input, only the keys differ
+    std::vector<std::string> keys;
+    for (int64_t bitRate : {1000000, 2000000, 3000000}) {
+        EncodeParameter encodeParams;
+        encodeParams.set_video_bit_rate(bitRate);
+        keys.push_back(cache.key(inputFile, "out.mp4", "FFMPEG", &encodeParams));
+        ASSERT_FALSE(keys.back().empty());
+    }
+    EXPECT_NE(keys[0], keys[1]);
+
+    std::string first = (test_dir_ / "cached_first.mp4").string();
+    EXPECT_FALSE(cache.fetch(keys[0], first));
+    EXPECT_FALSE(fs::exists(first));
+
+    auto pause = []() { std::this_thread::sleep_for(std::chrono::milliseconds(20)); };
+    cache.store(keys[0], inputFile);
+    pause();
+    cache.store(keys[1], inputFile);
+    pause();
+    ASSERT_TRUE(cache.fetch(keys[0], first));
+    EXPECT_EQ(fs::file_size(first), objectSize);
+    fs::file_time_type delivered = fs::last_write_time(first);
+    pause();
+
+    // keys[0] was used last, so keys[1] goes
+    cache.store(keys[2], inputFile);
+    std::string second = (test_dir_ / "cached_second.mp4").string();
+    EXPECT_TRUE(cache.fetch(keys[0], second));
+    EXPECT_FALSE(cache.fetch(keys[1], (test_dir_ / "cached_evicted.mp4").string()));
+    EXPECT_TRUE(cache.fetch(keys[2], (test_dir_ / "cached_third.mp4").string()));
+    EXPECT_EQ(fs::last_write_time(first), delivered);
+
+    // A delivered hard link is replaced, not written through, by the
+    // next conversion; a file of its own is left alone
+    OutputCache::detach(first);
+    EXPECT_TRUE(!fs::exists(first) ||
+                (fs::status(first).permissions() & fs::perms::owner_write) != fs::perms::none);
+    OutputCache::detach(inputFile);
+    EXPECT_TRUE(fs::exists(inputFile));
+}
+
+// Compacting keeps the samples other processes appended meanwhile
+TEST_F(TranscoderTest, ThroughputHistoryCompactionKeepsOtherWriters) {
+    std::string path = (test_dir_ / "history.txt").string();
+    ThroughputHistory first(path);
+    ThroughputHistory second(path);
+
+    second.record({"FFTOOL", "encode/libx264/default/720", 10.0, 5.0, 250});
+    // Enough samples for this instance to compact the file
+    for (int i = 0; i < 2100; i++)
+        first.record({"FFMPEG", "copy/copy/default/720", 10.0, 1.0, 250});
+
+    ThroughputHistory reloaded(path);
+    EXPECT_EQ(reloaded.get_sample_count("encode/libx264/default/720", "FFTOOL"), 1);
+    EXPECT_EQ(reloaded.get_sample_count("copy/copy/default/720", "FFMPEG"), 2100);
+    EXPECT_DOUBLE_EQ(reloaded.get_speed("copy/copy/default/720", "FFMPEG"), 10.0);
+    EXPECT_EQ(first.get_sample_count("encode/libx264/default/720", "FFTOOL"), 1);
+    // No temporary file is left behind
+    for (const std::filesystem::directory_entry &entry :
+         std::filesystem::directory_iterator(test_dir_)) {
+        EXPECT_EQ(entry.path().filename().string().find(".tmp"), std::string::npos);
+    }
+}
@@ -16,6 +16,7 @@
 #ifndef TRANSCODER_H
 #define TRANSCODER_H
 
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <numeric>
@@ -37,6 +38,26 @@ public:
 
     virtual bool transcode(std::string input_path, std::string output_path) = 0;
 
+    // Start a new job; predicted is the expected duration in seconds from
+    // the throughput history, or <= 0 if unknown
+    void reset_progress(double predicted) {
+        predicted_seconds = predicted;
+        first_frame_time = std::chrono::system_clock::time_point{};
+        last_ui_update = std::chrono::system_clock::now();
+        rate_sample_time = std::chrono::system_clock::time_point{};
+        rate_sample_fraction = 0.0;
+        smoothed_rate = 0.0;
+        process_number = 0;
+        remain_seconds = predicted > 0 ? predicted : 0;
+        if (process_parameter)
+            process_parameter->touch();
+    }
+
+    // The job was cancelled or its watchdog expired
+    bool should_stop() const {
+        return process_parameter && process_parameter->should_stop();
+    }
+
     void send_process_parameter(int64_t frame_number, int64_t frame_total_number) {
         if (first_frame_time == std::chrono::system_clock::time_point{}) {
             first_frame_time = std::chrono::system_clock::now();
@@ -56,9 +77,9 @@ public:
                             now - first_frame_time)
                             .count();
 
+        update_rate(fraction, now, elapsed_ms);
         if (frame_number > 0 && frame_total_number > 0) {
-            double elapsed_ms_d = static_cast<double>(elapsed_ms);
-            remain_seconds = (elapsed_ms / fraction - elapsed_ms_d) / 1000.0;
+            remain_seconds = estimate_remaining(fraction, elapsed_ms);
         }
 
         // Only update UI if enough time has passed (100ms)
@@ -92,6 +113,65 @@ public:
     std::chrono::system_clock::time_point
         last_ui_update; // Track last UI update time
 
+    // Expected job duration from the throughput history, <= 0 if unknown
+    double predicted_seconds = 0;
+
+private:
+    // Encoders buffer frames for lookahead, so early progress is not
+    // representative; the live rate is only sampled after this warmup
+    static constexpr int64_t RATE_WARMUP_MS = 2000;
+    static constexpr int64_t RATE_SAMPLE_MS = 500;
+    static constexpr double RATE_SMOOTHING = 0.3;
+
+    // Exponentially smoothed progress rate (fraction per second)
+    void update_rate(double fraction, std::chrono::system_clock::time_point now,
+                     int64_t elapsed_ms) {
+        if (elapsed_ms < RATE_WARMUP_MS)
+            return;
+        if (rate_sample_time == std::chrono::system_clock::time_point{}) {
+            rate_sample_time = now;
+            rate_sample_fraction = fraction;
+            return;
+        }
+        auto interval_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                               now - rate_sample_time)
+                               .count();
+        if (interval_ms < RATE_SAMPLE_MS)
+            return;
+
+        double rate = (fraction - rate_sample_fraction) * 1000.0 / interval_ms;
+        if (rate > 0) {
+            smoothed_rate = smoothed_rate > 0
+                                ? RATE_SMOOTHING * rate + (1 - RATE_SMOOTHING) * smoothed_rate
+                                : rate;
+        }
+        rate_sample_time = now;
+        rate_sample_fraction = fraction;
+    }
+
+    // Blend the historical prediction with the live rate, trusting the live
+    // rate fully once a quarter of the job is done
+    double estimate_remaining(double fraction, int64_t elapsed_ms) const {
+        double remaining = 1.0 - fraction;
+        double prior = predicted_seconds > 0 ? predicted_seconds * remaining : -1;
+
+        if (smoothed_rate <= 0) {
+            if (prior >= 0)
+                return prior;
+            // no history and still warming up: linear extrapolation
+            return fraction > 0 ? elapsed_ms / 1000.0 * remaining / fraction : 0;
+        }
+
+        double live = remaining / smoothed_rate;
+        if (prior < 0)
+            return live;
+        double weight = std::min(1.0, fraction * 4.0);
+        return weight * live + (1.0 - weight) * prior;
+    }
+
+    std::chrono::system_clock::time_point rate_sample_time;
+    double rate_sample_fraction = 0;
+    double smoothed_rate = 0;
 };
 
 #endif
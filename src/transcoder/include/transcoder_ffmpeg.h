@@ -17,6 +17,12 @@
 #define TRANSCODERFFMPEG_H
 
 #include "transcoder.h"
+#include "../../common/include/av_resource.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -29,11 +35,12 @@ extern "C" {
 
 #define ENCODE_BIT_RATE 5000000
 
-typedef struct FilteringContext {
-    AVFilterContext *buffersrc_ctx;
-    AVFilterContext *buffersink_ctx;
-    AVFilterGraph *filter_graph;
-} FilteringContext;
+// Filter graph of one input stream, the filter contexts belong to the graph
+struct FilteringContext {
+    AVFilterContext *buffersrc_ctx = nullptr;
+    AVFilterContext *buffersink_ctx = nullptr;
+    AVFilterGraphPtr filter_graph;
+};
 
 class TranscoderFFmpeg : public Transcoder {
 public:
@@ -43,6 +50,29 @@ public:
 
     bool transcode(std::string input_path, std::string output_path);
 
+    /*
+     * Checkpointed mode, used when the checkpoint interval is set: the
+     * video is encoded in independent segments written next to the output
+     * (OUTPUT.ocparts/), each completed segment is appended to a progress
+     * record there, and a final pass stream-copies the segments into the
+     * output while the audio is converted. A restarted job skips the
+     * segments already recorded.
+     */
+    bool transcode_checkpointed(std::string input_path, std::string output_path);
+
+    // Segment pass: convert only the video frames with timestamps in
+    // [begin, end) (AV_TIME_BASE, absolute), without audio
+    void set_segment_window(int64_t begin, int64_t end);
+
+    // Stitch pass: copy the video packets from these segment files
+    void set_stitch_parts(const std::vector<std::string> &parts);
+
+    // Split the input into segment windows of the checkpoint interval,
+    // starting on input keyframes; false if segmenting does not apply to
+    // this job
+    bool plan_segments(const std::string &input_path, const std::string &output_path,
+                       std::vector<std::pair<int64_t, int64_t>> &windows);
+
     int open_media();
 
     int init_filter(AVCodecContext *dec_ctx, FilteringContext *filter_ctx, const char *filters_descr);
@@ -76,23 +106,58 @@ public:
               AVStream *outStream);
 
 private:
+    bool transcode_pass(std::string input_path, std::string output_path);
+    // AVIOInterruptCB: abort blocking I/O once the job should stop
+    static int interrupt_callback(void *opaque);
+    // Keep the watchdog alive while bytes move; probing, the trailer and
+    // the segment stitch report no frames
+    void touch_on_io();
+    // Log why the job stopped and return AVERROR_EXIT
+    int stop_job();
+    // Timestamp (AV_TIME_BASE) of the last video keyframe at or before
+    // ts, AV_NOPTS_VALUE if there is none
+    static int64_t keyframe_at_or_before(AVFormatContext *fmtCtx, int video_idx,
+                                         int64_t ts);
+    std::string checkpoint_signature(const std::string &input_path,
+                                     const std::string &output_path);
+    bool in_window(int64_t ts, AVRational time_base) const;
+    int open_part(size_t index);
+    // Write segment packets up to the given input time (AV_TIME_BASE)
+    int write_parts_until(int64_t limit);
+
     char error_msg[128];
     // encoder's parameters
     bool copy_video;
     bool copy_audio;
 
-    // Decoder and encoder contexts
-    StreamContext *decoder;
-    StreamContext *encoder;
+    // Decoder and encoder contexts, alive for one pass
+    std::unique_ptr<StreamContext> decoder;
+    std::unique_ptr<StreamContext> encoder;
 
     int64_t start_time;
 
-    FilteringContext *filters_ctx;
+    // Indexed by input stream
+    std::vector<FilteringContext> filters_ctx;
 
     // Progress tracking
     int64_t total_duration;   // Total duration in microseconds
     int64_t current_duration; // Current processed duration in microseconds
 
+    // Segment pass window
+    bool windowed;
+    int64_t window_begin;
+    int64_t window_end;
+
+    // Stitch pass input
+    std::vector<std::string> stitch_parts;
+    size_t part_index;
+    AVInputFormatContextPtr part_ctx;
+    AVPacketPtr part_pkt;
+    bool part_pending;
+
+    // Bytes read and written when the watchdog was last touched
+    int64_t io_mark;
+
     // Helper function to update progress
     void update_progress(int64_t current_pts, AVRational time_base);
     void print_error(const char *msg, int ret);
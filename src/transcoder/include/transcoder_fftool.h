@@ -18,6 +18,18 @@
 
 #include "transcoder.h"
 
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/*
+ * Runs the ffmpeg binary (FFTOOL_PATH) as a child process. The arguments
+ * are passed as an argv array, no shell is involved, and the child
+ * reports its position on a pipe (-progress pipe:1) which is forwarded to
+ * send_process_parameter(). All state is per instance, so several jobs
+ * can run their own child at the same time.
+ */
 class TranscoderFFTool : public Transcoder {
 public:
     TranscoderFFTool(ProcessParameter *process_parameter,
@@ -29,6 +41,30 @@ public:
     bool transcode(std::string input_path, std::string output_path);
 
 private:
+    // ffmpeg arguments without the program name, false if the job cannot
+    // be expressed (missing codec)
+    bool build_arguments(const std::string &input_path,
+                         const std::string &output_path,
+                         std::vector<std::string> &args);
+
+    // Length of the converted range in microseconds, 0 if unknown
+    int64_t probe_range(const std::string &input_path);
+
+    // Feed one "key=value" line of the -progress output
+    void parse_progress_line(const std::string &line);
+
+    // ffmpeg reports nothing while it probes the input and writes the
+    // trailer; keep the watchdog alive until the first report and while
+    // the output keeps changing
+    void touch_while_silent();
+
+    /*
+     * Run ffmpeg and wait for it, forwarding its progress and polling the
+     * job's cancel flag and watchdog; a stopped job kills the child.
+     * Returns the exit code, -1 if it did not run to completion.
+     */
+    int run_process(const std::vector<std::string> &args);
+
     // encoder's parameters
     bool copy_video;
     bool copy_audio;
@@ -43,14 +79,19 @@ private:
     uint16_t height;
     int qscale;
     std::string pixel_format;
+    int thread_count;
 
     // Time range parameters
     double start_time;  // in seconds
     double end_time;    // in seconds
 
-    static int frame_number;
+    std::string progress_buffer;  // incomplete progress line
 
-    int64_t frame_total_number;
+    // Output of the running child, watched by touch_while_silent()
+    std::string output_file;
+    bool progress_seen;
+    uintmax_t output_size;
+    std::filesystem::file_time_type output_time;
 };
 
 #endif // TRANSCODERFFTOOL_H
@@ -14,10 +14,23 @@
  */
 
 #include "../include/transcoder_ffmpeg.h"
+#include "../../common/include/keyframe_index.h"
 extern "C" {
 #include <libavutil/pixdesc.h>
 }
 #include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+// Segment passes start decoding this long before their window, so frames
+// reordered around the boundary have their reference frames
+#define SEGMENT_SEEK_MARGIN (1 * AV_TIME_BASE)
+#define CHECKPOINT_FILE "checkpoint.txt"
+#define CHECKPOINT_MAGIC "openconverter-checkpoint 1"
 
 /* Receive pointers from converter */
 TranscoderFFmpeg::TranscoderFFmpeg(ProcessParameter *process_parameter,
@@ -27,9 +40,13 @@ TranscoderFFmpeg::TranscoderFFmpeg(ProcessParameter *process_parameter,
     frame_total_number = 0;
     total_duration = 0;
     current_duration = 0;
-    decoder = nullptr;
-    encoder = nullptr;
-    filters_ctx = nullptr;
+    start_time = 0;
+    windowed = false;
+    window_begin = INT64_MIN;
+    window_end = INT64_MAX;
+    part_index = 0;
+    part_pending = false;
+    io_mark = 0;
 }
 
 void TranscoderFFmpeg::print_error(const char *msg, int ret) {
@@ -62,7 +79,7 @@ int TranscoderFFmpeg::init_filter(AVCodecContext *dec_ctx, FilteringContext *fil
     AVFilterInOut *inputs  = avfilter_inout_alloc();
     AVFilterContext *buffersink_ctx = NULL;
     AVFilterContext *buffersrc_ctx = NULL;
-    AVFilterGraph *filter_graph = avfilter_graph_alloc();
+    AVFilterGraphPtr filter_graph(avfilter_graph_alloc());
     if (!outputs || !inputs || !filter_graph) {
         ret = AVERROR(ENOMEM);
         goto end;
@@ -101,7 +118,7 @@ int TranscoderFFmpeg::init_filter(AVCodecContext *dec_ctx, FilteringContext *fil
 
 
     ret = avfilter_graph_create_filter(&buffersrc_ctx, buffersrc, "in",
-                                       args, NULL, filter_graph);
+                                       args, NULL, filter_graph.get());
     if (ret < 0) {
         av_log(NULL, AV_LOG_ERROR, "Cannot create buffer source\n");
         goto end;
@@ -109,7 +126,7 @@ int TranscoderFFmpeg::init_filter(AVCodecContext *dec_ctx, FilteringContext *fil
 
     /* buffer video sink: to terminate the filter chain. */
     ret = avfilter_graph_create_filter(&buffersink_ctx, buffersink, "out",
-                                       NULL, NULL, filter_graph);
+                                       NULL, NULL, filter_graph.get());
     if (ret < 0) {
         av_log(NULL, AV_LOG_ERROR, "Cannot create buffer sink\n");
         goto end;
@@ -176,16 +193,16 @@ int TranscoderFFmpeg::init_filter(AVCodecContext *dec_ctx, FilteringContext *fil
     inputs->pad_idx    = 0;
     inputs->next       = NULL;
 
-    if ((ret = avfilter_graph_parse_ptr(filter_graph, filters_descr,
+    if ((ret = avfilter_graph_parse_ptr(filter_graph.get(), filters_descr,
                                     &inputs, &outputs, NULL)) < 0)
         goto end;
 
-    if ((ret = avfilter_graph_config(filter_graph, NULL)) < 0)
+    if ((ret = avfilter_graph_config(filter_graph.get(), NULL)) < 0)
         goto end;
 
     filter_ctx->buffersink_ctx = buffersink_ctx;
     filter_ctx->buffersrc_ctx = buffersrc_ctx;
-    filter_ctx->filter_graph = filter_graph;
+    filter_ctx->filter_graph = std::move(filter_graph);
     if (dec_ctx->codec_type == AVMEDIA_TYPE_AUDIO && encoder->audioCodecCtx) {
         if (!(encoder->audioCodec->capabilities & AV_CODEC_CAP_VARIABLE_FRAME_SIZE))
             av_buffersink_set_frame_size(filters_ctx[decoder->audioIdx].buffersink_ctx,
@@ -204,14 +221,10 @@ int TranscoderFFmpeg::init_filters_wrapper()
 {
     int i, ret = -1;
     AVCodecContext *dec_ctx = NULL;
-    filters_ctx = reinterpret_cast<FilteringContext *>(av_malloc_array(decoder->fmtCtx->nb_streams, sizeof(*filters_ctx)));
-    if (!filters_ctx)
-        return AVERROR(ENOMEM);
+    filters_ctx.clear();
+    filters_ctx.resize(decoder->fmtCtx->nb_streams);
 
     for (i = 0; i < decoder->fmtCtx->nb_streams; i++) {
-        filters_ctx[i].buffersrc_ctx  = NULL;
-        filters_ctx[i].buffersink_ctx = NULL;
-        filters_ctx[i].filter_graph   = NULL;
         if (!(decoder->fmtCtx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO ||
             decoder->fmtCtx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO))
             continue;
@@ -248,21 +261,41 @@ int TranscoderFFmpeg::init_filters_wrapper()
 
 bool TranscoderFFmpeg::transcode(std::string input_path,
                                  std::string output_path) {
+    // segment job of a distributed encode
+    if (encode_parameter->has_segment_window() && !windowed)
+        set_segment_window(encode_parameter->get_segment_begin(),
+                           encode_parameter->get_segment_end());
+    if (encode_parameter->get_checkpoint_interval() > 0 && !windowed &&
+        stitch_parts.empty())
+        return transcode_checkpointed(input_path, output_path);
+    return transcode_pass(input_path, output_path);
+}
+
+bool TranscoderFFmpeg::transcode_pass(std::string input_path,
+                                      std::string output_path) {
     bool flag = false;
     int ret = -1;
     // deal with arguments
 
     // Initialize member variables
-    decoder = new StreamContext;
-    encoder = new StreamContext;
+    decoder.reset(new StreamContext);
+    encoder.reset(new StreamContext);
+    io_mark = 0;
 
     // Declare variables before any goto statements
     double start_time_sec = encode_parameter->get_start_time();
     double end_time_sec = encode_parameter->get_end_time();
     int64_t end_pts = -1;
+    AVIOInterruptCB interrupt_cb = {interrupt_callback, this};
 
     av_log_set_level(AV_LOG_DEBUG);
 
+    encoder->pkt = av_packet_alloc();
+    if (!encoder->pkt) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
     decoder->filename = input_path.c_str();
     encoder->filename = output_path.c_str();
 
@@ -278,6 +311,10 @@ bool TranscoderFFmpeg::transcode(std::string input_path,
         copy_audio = false;
     }
 
+    // the stitch pass copies the already encoded video
+    if (!stitch_parts.empty())
+        copy_video = true;
+
     if ((ret = open_media()) < 0)
         goto end;
 
@@ -348,7 +385,17 @@ bool TranscoderFFmpeg::transcode(std::string input_path,
             if (encoder->fmtCtx->oformat->video_codec == AV_CODEC_ID_NONE) {
                 continue;
             }
-            if (!copy_video) {
+            if (!stitch_parts.empty()) {
+                if ((ret = open_part(0)) < 0)
+                    goto end;
+                ret = prepare_copy(encoder->fmtCtx, &encoder->videoStream,
+                                   part_ctx->streams[0]->codecpar);
+                if (ret < 0)
+                    goto end;
+                // the segment container's tag may not fit the output
+                encoder->videoStream->codecpar->codec_tag = 0;
+                encoder->videoStream->time_base = part_ctx->streams[0]->time_base;
+            } else if (!copy_video) {
                 if ((ret = prepare_encoder_video()) < 0)
                     goto end;
             } else {
@@ -359,8 +406,8 @@ bool TranscoderFFmpeg::transcode(std::string input_path,
             }
         } else if (decoder->fmtCtx->streams[i]->codecpar->codec_type ==
                    AVMEDIA_TYPE_AUDIO) {
-            // skip audio streams
-            if (encoder->fmtCtx->oformat->audio_codec == AV_CODEC_ID_NONE) {
+            // skip audio streams, segment passes leave them to the stitch pass
+            if (encoder->fmtCtx->oformat->audio_codec == AV_CODEC_ID_NONE || windowed) {
                 continue;
             }
             if (!copy_audio) {
@@ -379,8 +426,9 @@ bool TranscoderFFmpeg::transcode(std::string input_path,
         goto end;
 
     // binding
+    encoder->fmtCtx->interrupt_callback = interrupt_cb;
     ret = avio_open2(&encoder->fmtCtx->pb, encoder->filename, AVIO_FLAG_WRITE,
-                     NULL, NULL);
+                     &interrupt_cb, NULL);
     if (ret < 0) {
         print_error("Failed to open output file", ret);
         goto end;
@@ -391,10 +439,21 @@ bool TranscoderFFmpeg::transcode(std::string input_path,
         goto end;
     }
 
+    // Output timestamps start at the start time, also in segment passes
+    if (start_time_sec > 0)
+        start_time = static_cast<int64_t>(start_time_sec * AV_TIME_BASE);
+
     // Handle start time seeking if specified
-    if (start_time_sec > 0) {
-        int64_t seek_target = static_cast<int64_t>(start_time_sec * AV_TIME_BASE);
-        start_time = seek_target;
+    if (windowed ? window_begin != INT64_MIN : start_time_sec > 0) {
+        int64_t seek_target = windowed ? window_begin - SEGMENT_SEEK_MARGIN : start_time;
+        // A file indexed before (e.g. previewed on the cut page) is cut
+        // from the keyframe that starts the GOP holding the start time
+        std::shared_ptr<const KeyframeIndex> index =
+            windowed ? nullptr : KeyframeIndex::find(input_path);
+        if (index && index->get_stream_index() == decoder->videoIdx) {
+            if (const KeyframeIndex::Keyframe *keyframe = index->at_or_before(start_time))
+                seek_target = index->time_of(*keyframe);
+        }
         if ((ret = avformat_seek_file(decoder->fmtCtx, -1, INT64_MIN, seek_target, seek_target, 0)) < 0) {
             av_log(NULL, AV_LOG_WARNING, "Could not seek to start time\n");
         }
@@ -408,12 +467,29 @@ bool TranscoderFFmpeg::transcode(std::string input_path,
     }
 
     // Calculate end time in stream time base for comparison
-    if (end_time_sec > 0 && decoder->videoIdx >= 0) {
+    if (end_time_sec > 0 && decoder->videoIdx >= 0 && !windowed) {
         end_pts = static_cast<int64_t>(end_time_sec / av_q2d(decoder->videoStream->time_base));
     }
 
     // read video data from multimedia files to write into destination file
     while (av_read_frame(decoder->fmtCtx, decoder->pkt) >= 0) {
+        if (should_stop()) {
+            av_packet_unref(decoder->pkt);
+            ret = stop_job();
+            goto end;
+        }
+
+        // A segment pass is done at the first video packet decoded at or
+        // after its window: every later packet is presented after it too
+        if (windowed && decoder->pkt->stream_index == decoder->videoIdx) {
+            int64_t ts = decoder->pkt->dts != AV_NOPTS_VALUE ? decoder->pkt->dts : decoder->pkt->pts;
+            if (ts != AV_NOPTS_VALUE &&
+                av_rescale_q(ts, decoder->videoStream->time_base, {1, AV_TIME_BASE}) >= window_end) {
+                av_packet_unref(decoder->pkt);
+                break;
+            }
+        }
+
         // Check if we've reached the end time
         if (end_pts > 0 && decoder->pkt->stream_index == decoder->videoIdx) {
             if (decoder->pkt->pts >= end_pts) {
@@ -426,10 +502,16 @@ bool TranscoderFFmpeg::transcode(std::string input_path,
             if (encoder->fmtCtx->oformat->video_codec == AV_CODEC_ID_NONE) {
                 continue;
             }
+            // the stitch pass takes the video from the segments
+            if (!stitch_parts.empty()) {
+                av_packet_unref(decoder->pkt);
+                continue;
+            }
 
             // Calculate frame PTS in seconds
             double frame_pts = decoder->pkt->pts * av_q2d(decoder->videoStream->time_base);
-            bool should_skip_frame = (start_time_sec > 0 && frame_pts < start_time_sec);
+            // segment passes select frames by their window after decoding
+            bool should_skip_frame = (start_time_sec > 0 && frame_pts < start_time_sec && !windowed);
 
             // Update progress based on video stream (only for frames we're keeping)
             if (!should_skip_frame) {
@@ -463,11 +545,28 @@ bool TranscoderFFmpeg::transcode(std::string input_path,
             if (encoder->fmtCtx->oformat->audio_codec == AV_CODEC_ID_NONE) {
                 continue;
             }
+            if (windowed) {
+                av_packet_unref(decoder->pkt);
+                continue;
+            }
 
             // Calculate frame PTS in seconds
             double frame_pts = decoder->pkt->pts * av_q2d(decoder->audioStream->time_base);
             bool should_skip_frame = (start_time_sec > 0 && frame_pts < start_time_sec);
 
+            // Interleave the segment video written so far with the audio
+            if (!stitch_parts.empty()) {
+                if (end_time_sec > 0 && frame_pts >= end_time_sec) {
+                    av_packet_unref(decoder->pkt);
+                    break;
+                }
+                if (decoder->pkt->pts != AV_NOPTS_VALUE &&
+                    (ret = write_parts_until(av_rescale_q(decoder->pkt->pts,
+                                                          decoder->audioStream->time_base,
+                                                          {1, AV_TIME_BASE}))) < 0)
+                    goto end;
+            }
+
             // Update progress based on audio stream if no video stream (only for frames we're keeping)
             if (decoder->videoIdx < 0 && !should_skip_frame) {
                 update_progress(decoder->pkt->pts,
@@ -499,6 +598,27 @@ bool TranscoderFFmpeg::transcode(std::string input_path,
             }
         }
     }
+    // An interrupted read ends the loop like the end of the file
+    if (should_stop()) {
+        ret = stop_job();
+        goto end;
+    }
+
+    // Drain the decoder, its last frames may still be inside the window
+    if (windowed && !copy_video && decoder->videoCodecCtx && encoder->videoStream) {
+        av_packet_unref(decoder->pkt);
+        if ((ret = transcode_video()) < 0) {
+            av_log(NULL, AV_LOG_ERROR, "Failed to flush video decoder\n");
+            goto end;
+        }
+    }
+    if (!stitch_parts.empty() && encoder->videoStream) {
+        if ((ret = write_parts_until(INT64_MAX)) < 0) {
+            av_log(NULL, AV_LOG_ERROR, "Failed to copy video segments\n");
+            goto end;
+        }
+    }
+
     if (!copy_video && encoder->videoStream) {
         encoder->frame = NULL;
         // write the buffered frame
@@ -525,28 +645,57 @@ bool TranscoderFFmpeg::transcode(std::string input_path,
     flag = true;
 // free memory
 end:
-    if (decoder && decoder->fmtCtx) {
-        avformat_close_input(&decoder->fmtCtx);
-        decoder->fmtCtx = NULL;
-    }
-    if (decoder) {
-        delete decoder;
-        decoder = nullptr;
-    }
+    // The owners release the filter graphs, the segment input, and the
+    // codec and format contexts of both sides
+    filters_ctx.clear();
+    part_ctx.reset();
+    part_pkt.reset();
+    decoder.reset();
+    encoder.reset();
 
-    if (encoder && encoder->fmtCtx && !(encoder->fmtCtx->oformat->flags & AVFMT_NOFILE)) {
-        avio_closep(&encoder->fmtCtx->pb);
-    }
-    if (encoder) {
-        delete encoder;
-        encoder = nullptr;
+    return flag;
+}
+
+int TranscoderFFmpeg::interrupt_callback(void *opaque) {
+    TranscoderFFmpeg *transcoder = static_cast<TranscoderFFmpeg *>(opaque);
+    transcoder->touch_on_io();
+    return transcoder->should_stop() ? 1 : 0;
+}
+
+void TranscoderFFmpeg::touch_on_io() {
+    // A stalled input moves no bytes and still trips the watchdog
+    int64_t io = 0;
+    if (decoder && decoder->fmtCtx && decoder->fmtCtx->pb)
+        io += decoder->fmtCtx->pb->bytes_read;
+    if (part_ctx && part_ctx->pb)
+        io += part_ctx->pb->bytes_read;
+    if (encoder && encoder->fmtCtx && encoder->fmtCtx->pb)
+        io += encoder->fmtCtx->pb->pos;
+    if (io != io_mark) {
+        io_mark = io;
+        process_parameter->touch();
     }
+}
 
-    return flag;
+int TranscoderFFmpeg::stop_job() {
+    if (process_parameter->is_cancel_requested())
+        av_log(NULL, AV_LOG_WARNING, "Conversion cancelled\n");
+    else
+        av_log(NULL, AV_LOG_ERROR, "No progress for %.0f seconds, aborting\n",
+               process_parameter->get_stall_timeout());
+    return AVERROR_EXIT;
 }
 
 int TranscoderFFmpeg::open_media() {
     int ret = -1;
+    // a cancel or the watchdog interrupts blocking reads, e.g. on a
+    // stalled network input
+    decoder->fmtCtx = avformat_alloc_context();
+    if (!decoder->fmtCtx)
+        return AVERROR(ENOMEM);
+    decoder->fmtCtx->interrupt_callback.callback = interrupt_callback;
+    decoder->fmtCtx->interrupt_callback.opaque = this;
+
     // open the multimedia file
     if ((ret = avformat_open_input(&decoder->fmtCtx, decoder->filename, NULL,
                                    NULL)) < 0) {
@@ -593,6 +742,10 @@ int TranscoderFFmpeg::encode_video(AVStream *inStream, AVFrame *frame) {
         av_log(NULL, AV_LOG_ERROR, "Error while feeding the filtergraph\n");
         goto end;
     }
+    // The filter keeps its own reference. The sink moves each filtered
+    // frame into this one without releasing what it holds, so it must
+    // be empty before every pull
+    av_frame_unref(frame);
     /* pull filtered frames from the filtergraph */
     while (1) {
         if ((ret = av_buffersink_get_frame(fc->buffersink_ctx, frame)) == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
@@ -602,6 +755,7 @@ int TranscoderFFmpeg::encode_video(AVStream *inStream, AVFrame *frame) {
         if (ret < 0)
             goto end;
         ret = encode_write_video(frame);
+        av_frame_unref(frame);
         if (ret < 0)
             goto end;
     }
@@ -611,7 +765,8 @@ end:
 
 int TranscoderFFmpeg::encode_write_video(AVFrame *frame) {
     int ret = -1;
-    AVPacket *output_packet = av_packet_alloc();
+    // one packet per pass, reused for every encoded frame
+    AVPacket *output_packet = encoder->pkt;
 
     if (encode_parameter->get_qscale() != -1 && frame) {
         frame->quality = encoder->videoCodecCtx->global_quality;
@@ -643,7 +798,7 @@ int TranscoderFFmpeg::encode_write_video(AVFrame *frame) {
         av_packet_unref(output_packet);
     }
 end:
-    av_packet_free(&output_packet);
+    av_packet_unref(output_packet);
     return ret;
 }
 
@@ -659,6 +814,10 @@ int TranscoderFFmpeg::encode_audio(AVStream *in_stream, AVFrame *frame) {
         av_log(NULL, AV_LOG_ERROR, "Error while feeding the filtergraph\n");
         goto end;
     }
+    // The filter keeps its own reference. The sink moves each filtered
+    // frame into this one without releasing what it holds, so it must
+    // be empty before every pull
+    av_frame_unref(frame);
     /* pull filtered frames from the filtergraph */
     while (1) {
         if ((ret = av_buffersink_get_frame(fc->buffersink_ctx, frame)) == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
@@ -668,6 +827,7 @@ int TranscoderFFmpeg::encode_audio(AVStream *in_stream, AVFrame *frame) {
         if (ret < 0)
             goto end;
         ret = encode_write_audio(frame);
+        av_frame_unref(frame);
         if (ret < 0)
             goto end;
     }
@@ -677,7 +837,7 @@ end:
 
 int TranscoderFFmpeg::encode_write_audio(AVFrame *frame) {
     int ret = -1;
-    AVPacket *output_packet = av_packet_alloc();
+    AVPacket *output_packet = encoder->pkt;
     // send frame to encoder
     if ((ret = avcodec_send_frame(encoder->audioCodecCtx, frame)) < 0) {
         print_error("Failed to send frame to encoder", ret);
@@ -699,7 +859,7 @@ int TranscoderFFmpeg::encode_write_audio(AVFrame *frame) {
         av_packet_unref(output_packet);
     }
 end:
-    av_packet_free(&output_packet);
+    av_packet_unref(output_packet);
     return ret;
 }
 
@@ -721,7 +881,10 @@ int TranscoderFFmpeg::transcode_video(bool skip_encode) {
         }
 
         // Only encode if we're not skipping this frame
-        if (!skip_encode) {
+        if (!skip_encode &&
+            in_window(decoder->frame->pts != AV_NOPTS_VALUE ? decoder->frame->pts
+                                                            : decoder->frame->best_effort_timestamp,
+                      decoder->videoCodecCtx->time_base)) {
             if ((ret = encode_video(decoder->videoStream, decoder->frame)) < 0) {
                 goto end;
             }
@@ -805,6 +968,9 @@ int TranscoderFFmpeg::prepare_decoder() {
         avcodec_parameters_to_context(decoder->videoCodecCtx,
                                     decoder->videoStream->codecpar);
         decoder->videoCodecCtx->framerate = av_guess_frame_rate(decoder->fmtCtx, decoder->videoStream, NULL);
+        // stay within the cores the scheduler gave this job
+        if (encode_parameter->get_thread_count() > 0)
+            decoder->videoCodecCtx->thread_count = encode_parameter->get_thread_count();
         // bind decoder and decoder context
         if ((ret = avcodec_open2(decoder->videoCodecCtx, decoder->videoCodec, NULL)) < 0) {
             print_error("Couldn't open the codec", ret);
@@ -880,6 +1046,8 @@ int TranscoderFFmpeg::prepare_encoder_video() {
         av_log(NULL, AV_LOG_ERROR, "No memory!\n");
         return AVERROR(ENOMEM);
     }
+    if (encode_parameter->get_thread_count() > 0)
+        encoder->videoCodecCtx->thread_count = encode_parameter->get_thread_count();
 
     std::string preset = encode_parameter->get_preset();
     if (!preset.empty())
@@ -1042,6 +1210,12 @@ int TranscoderFFmpeg::prepare_copy(AVFormatContext *avCtx, AVStream **stream,
     // issues. we will improve this method in the future.
     if (codecParam->codec_type == AVMEDIA_TYPE_AUDIO) {
         (*stream)->codecpar->codec_tag = 0;
+    } else if (avCtx->oformat->codec_tag &&
+               av_codec_get_id(avCtx->oformat->codec_tag, codecParam->codec_tag) !=
+                   codecParam->codec_id) {
+        // a video tag of the input container the output does not know,
+        // let the muxer pick its own
+        (*stream)->codecpar->codec_tag = 0;
     }
     return 0;
 }
@@ -1059,7 +1233,308 @@ int TranscoderFFmpeg::remux(AVPacket *pkt, AVFormatContext *avCtx,
     return 0;
 }
 
+void TranscoderFFmpeg::set_segment_window(int64_t begin, int64_t end) {
+    windowed = true;
+    window_begin = begin;
+    window_end = end;
+}
+
+void TranscoderFFmpeg::set_stitch_parts(const std::vector<std::string> &parts) {
+    stitch_parts = parts;
+}
+
+bool TranscoderFFmpeg::in_window(int64_t ts, AVRational time_base) const {
+    if (!windowed)
+        return true;
+    if (ts == AV_NOPTS_VALUE)
+        return false;
+    int64_t t = av_rescale_q(ts, time_base, {1, AV_TIME_BASE});
+    return t >= window_begin && t < window_end;
+}
+
+bool TranscoderFFmpeg::plan_segments(const std::string &input_path,
+                                     const std::string &output_path,
+                                     std::vector<std::pair<int64_t, int64_t>> &windows) {
+    double interval = encode_parameter->get_checkpoint_interval();
+    double start_time_sec = encode_parameter->get_start_time();
+    double end_time_sec = encode_parameter->get_end_time();
+
+    // nothing to checkpoint for stream copies and audio-only outputs
+    if (encode_parameter->get_video_codec_name() == "copy")
+        return false;
+    const AVOutputFormat *ofmt = av_guess_format(NULL, output_path.c_str(), NULL);
+    if (!ofmt || ofmt->video_codec == AV_CODEC_ID_NONE)
+        return false;
+
+    AVFormatContext *raw = NULL;
+    if (avformat_open_input(&raw, input_path.c_str(), NULL, NULL) < 0)
+        return false;
+    AVInputFormatContextPtr fmtCtx(raw);
+    int video_idx = -1;
+    int64_t first = 0;
+    int64_t duration = AV_NOPTS_VALUE;
+    if (avformat_find_stream_info(fmtCtx.get(), NULL) >= 0) {
+        video_idx = av_find_best_stream(fmtCtx.get(), AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+        if (fmtCtx->start_time != AV_NOPTS_VALUE)
+            first = fmtCtx->start_time;
+        duration = fmtCtx->duration;
+    }
+    if (video_idx < 0 || duration == AV_NOPTS_VALUE || duration <= 0)
+        return false;
+
+    // an indexed file needs no probing seek per boundary
+    std::shared_ptr<const KeyframeIndex> index = KeyframeIndex::find(input_path);
+    if (index && index->get_stream_index() != video_idx)
+        index.reset();
+
+    // input timestamps are absolute, like the -ss/-to handling above
+    int64_t step = static_cast<int64_t>(interval * AV_TIME_BASE);
+    int64_t range_begin = start_time_sec > 0 ? static_cast<int64_t>(start_time_sec * AV_TIME_BASE) : first;
+    int64_t range_end = first + duration;
+    if (end_time_sec > 0)
+        range_end = std::min(range_end, static_cast<int64_t>(end_time_sec * AV_TIME_BASE));
+    if (step <= 0 || range_end - range_begin < 2 * step)
+        return false;
+
+    // the outer windows are open so no frame falls outside of them
+    int64_t begin = start_time_sec > 0 ? range_begin : INT64_MIN;
+    for (int64_t t = range_begin + step; t < range_end - step / 2; t += step) {
+        // start segments on an input keyframe, so a segment pass decodes
+        // from its seek point without discarding a partial GOP
+        int64_t boundary = AV_NOPTS_VALUE;
+        if (index) {
+            if (const KeyframeIndex::Keyframe *keyframe = index->at_or_before(t))
+                boundary = index->time_of(*keyframe);
+        } else {
+            boundary = keyframe_at_or_before(fmtCtx.get(), video_idx, t);
+        }
+        if (boundary <= (begin == INT64_MIN ? range_begin : begin))
+            boundary = t;
+        windows.emplace_back(begin, boundary);
+        begin = boundary;
+    }
+    windows.emplace_back(begin, end_time_sec > 0 ? range_end : INT64_MAX);
+    return true;
+}
+
+int64_t TranscoderFFmpeg::keyframe_at_or_before(AVFormatContext *fmtCtx, int video_idx,
+                                                int64_t ts) {
+    AVStream *stream = fmtCtx->streams[video_idx];
+    int64_t found = AV_NOPTS_VALUE;
+    AVPacketPtr pkt(av_packet_alloc());
+    if (!pkt || av_seek_frame(fmtCtx, -1, ts, AVSEEK_FLAG_BACKWARD) < 0)
+        return AV_NOPTS_VALUE;
+
+    // the seek lands on a keyframe; the first one read is the boundary
+    for (int read = 0; read < 1000 && av_read_frame(fmtCtx, pkt.get()) >= 0; read++) {
+        bool key = pkt->stream_index == video_idx && (pkt->flags & AV_PKT_FLAG_KEY) &&
+                   pkt->pts != AV_NOPTS_VALUE;
+        if (key)
+            found = av_rescale_q(pkt->pts, stream->time_base, {1, AV_TIME_BASE});
+        av_packet_unref(pkt.get());
+        if (key)
+            break;
+    }
+    if (found == AV_NOPTS_VALUE || found > ts)
+        return AV_NOPTS_VALUE;
+    return found;
+}
+
+std::string TranscoderFFmpeg::checkpoint_signature(const std::string &input_path,
+                                                   const std::string &output_path) {
+    // Everything the encoded segments depend on; the audio is converted in
+    // the stitch pass, so its settings may change between runs
+    std::error_code ec;
+    std::ostringstream signature;
+    signature << fs::absolute(input_path, ec).string() << '|'
+              << fs::file_size(input_path, ec) << '|'
+              << fs::last_write_time(input_path, ec).time_since_epoch().count() << '|'
+              << fs::path(output_path).extension().string() << '|'
+              << encode_parameter->get_video_codec_name() << '|'
+              << encode_parameter->get_video_bit_rate() << '|'
+              << encode_parameter->get_qscale() << '|'
+              << encode_parameter->get_preset() << '|'
+              << encode_parameter->get_pixel_format() << '|'
+              << encode_parameter->get_width() << 'x' << encode_parameter->get_height() << '|'
+              << encode_parameter->get_start_time() << '|'
+              << encode_parameter->get_end_time() << '|'
+              << encode_parameter->get_checkpoint_interval();
+    return signature.str();
+}
+
+bool TranscoderFFmpeg::transcode_checkpointed(std::string input_path,
+                                              std::string output_path) {
+    std::vector<std::pair<int64_t, int64_t>> windows;
+    if (!plan_segments(input_path, output_path, windows))
+        return transcode_pass(input_path, output_path);
+
+    fs::path dir = output_path + ".ocparts";
+    fs::path record = dir / CHECKPOINT_FILE;
+    std::string signature = checkpoint_signature(input_path, output_path);
+    std::error_code ec;
+
+    auto part_path = [&dir](size_t index, bool partial) {
+        char name[32];
+        snprintf(name, sizeof(name), partial ? "part-%05zu.tmp.mkv" : "part-%05zu.mkv", index);
+        return (dir / name).string();
+    };
+
+    // Segments recorded by an earlier run of the same job; a record torn
+    // by a crash does not parse and its segment is encoded again
+    std::vector<bool> done(windows.size(), false);
+    bool resumable = false;
+    {
+        std::ifstream in(record);
+        std::string magic, recorded_signature, line;
+        if (std::getline(in, magic) && std::getline(in, recorded_signature) &&
+            magic == CHECKPOINT_MAGIC && recorded_signature == signature) {
+            resumable = true;
+            while (std::getline(in, line)) {
+                std::istringstream fields(line);
+                size_t index;
+                int64_t begin, end;
+                if (fields >> index >> begin >> end && index < windows.size() &&
+                    windows[index].first == begin && windows[index].second == end &&
+                    fs::exists(part_path(index, false), ec))
+                    done[index] = true;
+            }
+        }
+    }
+    if (!resumable) {
+        fs::remove_all(dir, ec);
+        fs::create_directories(dir, ec);
+    }
+
+    // Rewrite the record with the valid entries only, then append to it
+    {
+        std::ofstream out(record, std::ios::trunc);
+        out << CHECKPOINT_MAGIC << "\n" << signature << "\n";
+        for (size_t i = 0; i < windows.size(); i++) {
+            if (done[i])
+                out << i << "\t" << windows[i].first << "\t" << windows[i].second << "\n";
+        }
+        if (!out) {
+            av_log(NULL, AV_LOG_WARNING, "Cannot write %s, converting without checkpoints\n",
+                   record.string().c_str());
+            return transcode_pass(input_path, output_path);
+        }
+    }
+
+    std::vector<std::string> parts;
+    for (size_t i = 0; i < windows.size(); i++) {
+        std::string part = part_path(i, false);
+        parts.push_back(part);
+        if (done[i]) {
+            std::cout << "Checkpoint: segment " << i + 1 << "/" << windows.size()
+                      << " already encoded" << std::endl;
+            continue;
+        }
+
+        if (should_stop()) {
+            stop_job();
+            return false;
+        }
+
+        std::string partial = part_path(i, true);
+        TranscoderFFmpeg pass(process_parameter, encode_parameter);
+        pass.reset_progress(predicted_seconds);
+        pass.set_segment_window(windows[i].first, windows[i].second);
+        if (!pass.transcode_pass(input_path, partial)) {
+            av_log(NULL, AV_LOG_ERROR, "Segment %zu failed, completed segments are kept in %s\n",
+                   i + 1, dir.string().c_str());
+            return false;
+        }
+        fs::rename(partial, part, ec);
+        if (ec) {
+            av_log(NULL, AV_LOG_ERROR, "Cannot rename segment %s\n", partial.c_str());
+            return false;
+        }
+
+        std::ofstream out(record, std::ios::app);
+        out << i << "\t" << windows[i].first << "\t" << windows[i].second << "\n";
+        out.flush();
+    }
+
+    TranscoderFFmpeg stitch(process_parameter, encode_parameter);
+    stitch.set_stitch_parts(parts);
+    if (!stitch.transcode_pass(input_path, output_path)) {
+        av_log(NULL, AV_LOG_ERROR, "Failed to join the segments in %s\n", dir.string().c_str());
+        return false;
+    }
+    fs::remove_all(dir, ec);
+    return true;
+}
+
+int TranscoderFFmpeg::open_part(size_t index) {
+    int ret = 0;
+    AVFormatContext *ctx = NULL;
+    part_ctx.reset();
+    part_pending = false;
+    part_index = index;
+    if (index >= stitch_parts.size())
+        return 0;
+
+    if (!part_pkt)
+        part_pkt.reset(av_packet_alloc());
+    if (!part_pkt)
+        return AVERROR(ENOMEM);
+    // segments sit on a shared volume, a stalled one must not hang the join
+    ctx = avformat_alloc_context();
+    if (!ctx)
+        return AVERROR(ENOMEM);
+    ctx->interrupt_callback.callback = interrupt_callback;
+    ctx->interrupt_callback.opaque = this;
+    if ((ret = avformat_open_input(&ctx, stitch_parts[index].c_str(), NULL, NULL)) < 0) {
+        print_error("Failed to open segment", ret);
+        return ret;
+    }
+    part_ctx.reset(ctx);
+    if ((ret = avformat_find_stream_info(part_ctx.get(), NULL)) < 0) {
+        print_error("Failed to find segment stream info", ret);
+        return ret;
+    }
+    if (part_ctx->nb_streams < 1) {
+        av_log(NULL, AV_LOG_ERROR, "Segment %s has no stream\n", stitch_parts[index].c_str());
+        return AVERROR_INVALIDDATA;
+    }
+    return 0;
+}
+
+int TranscoderFFmpeg::write_parts_until(int64_t limit) {
+    int ret = 0;
+    while (part_ctx) {
+        if (!part_pending) {
+            ret = av_read_frame(part_ctx.get(), part_pkt.get());
+            if (ret == AVERROR_EOF) {
+                if ((ret = open_part(part_index + 1)) < 0)
+                    return ret;
+                continue;
+            }
+            if (ret < 0)
+                return ret;
+            if (part_pkt->stream_index != 0) {
+                av_packet_unref(part_pkt.get());
+                continue;
+            }
+            part_pending = true;
+        }
+
+        // segment timestamps are shifted by the start time, the limit is
+        // an input timestamp
+        AVStream *stream = part_ctx->streams[0];
+        int64_t ts = part_pkt->dts != AV_NOPTS_VALUE ? part_pkt->dts : part_pkt->pts;
+        if (limit != INT64_MAX && ts != AV_NOPTS_VALUE &&
+            av_rescale_q(ts, stream->time_base, {1, AV_TIME_BASE}) + start_time > limit)
+            return 0;
+
+        part_pending = false;
+        if ((ret = remux(part_pkt.get(), encoder->fmtCtx, stream, encoder->videoStream)) < 0)
+            return ret;
+    }
+    return 0;
+}
+
 TranscoderFFmpeg::~TranscoderFFmpeg() {
-    // Cleanup is handled in transcode() function's end label
-    // decoder and encoder are deleted there
+    // Every libav object is held by an owner member, released at the end
+    // of each pass or here
 }
@@ -13,44 +13,81 @@
  * Lesser General Public License for more details.
  */
 
+#include <cerrno>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
-#include <fstream>
 #include <iostream>
-#include <regex>
 #include <sstream>
-#include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 #ifdef _WIN32
     #include <windows.h>
 #else
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <signal.h>
+    #include <spawn.h>
+    #include <sys/wait.h>
     #include <unistd.h>
+extern char **environ;
 #endif
 
 #include "../include/transcoder_fftool.h"
+#include "../../common/include/av_resource.h"
+
+namespace {
+
+const auto POLL_INTERVAL = std::chrono::milliseconds(50);
+// Time a stopped child gets to finish its output before it is killed
+const auto KILL_GRACE = std::chrono::seconds(2);
+
+std::string format_seconds(double seconds) {
+    std::ostringstream out;
+    out << seconds;
+    return out.str();
+}
+
+#ifdef _WIN32
+// Quote one argument for CreateProcess, following the MSVC runtime rules
+std::string quote_windows_argument(const std::string &arg) {
+    if (!arg.empty() && arg.find_first_of(" \t\n\v\"") == std::string::npos)
+        return arg;
+    std::string quoted = "\"";
+    size_t backslashes = 0;
+    for (char c : arg) {
+        if (c == '\\') {
+            backslashes++;
+            continue;
+        }
+        if (c == '"')
+            quoted.append(backslashes * 2 + 1, '\\');
+        else
+            quoted.append(backslashes, '\\');
+        backslashes = 0;
+        quoted.push_back(c);
+    }
+    quoted.append(backslashes * 2, '\\');
+    quoted.push_back('"');
+    return quoted;
+}
+#endif
+
+} // namespace
 
 TranscoderFFTool::TranscoderFFTool(ProcessParameter *process_parameter,
                                    EncodeParameter *encode_parameter)
     : Transcoder(process_parameter, encode_parameter), copy_video(false),
-      copy_audio(false), frame_total_number(0) {}
+      copy_audio(false), video_bit_rate(0), audio_bit_rate(0), width(0),
+      height(0), qscale(-1), thread_count(0), start_time(-1.0),
+      end_time(-1.0), progress_seen(false), output_size(0) {}
 
 TranscoderFFTool::~TranscoderFFTool() {
     // Destructor implementation
 }
 
-// Helper function to escape file paths for Windows
-std::string escape_windows_path(const std::string &path) {
-    std::string escaped = path;
-    size_t pos = 0;
-    while ((pos = escaped.find("\\", pos)) != std::string::npos) {
-        escaped.replace(pos, 1, "\\\\");
-        pos += 2;
-    }
-    return escaped;
-}
-
 bool TranscoderFFTool::prepared_opt() {
 
     if (encode_parameter->get_video_codec_name() == "copy") {
@@ -76,6 +113,7 @@ bool TranscoderFFTool::prepared_opt() {
         height = encode_parameter->get_height();
         qscale = encode_parameter->get_qscale();
         pixel_format = encode_parameter->get_pixel_format();
+        thread_count = encode_parameter->get_thread_count();
 
         // Get time range parameters
         start_time = encode_parameter->get_start_time();
@@ -85,129 +123,199 @@ bool TranscoderFFTool::prepared_opt() {
     return true;
 }
 
-bool TranscoderFFTool::transcode(std::string input_path,
-                                 std::string output_path) {
-    if (!prepared_opt()) {
-        std::cerr << "Failed to prepare options for transcoding." << std::endl;
-        return false;
-    }
-
-// Convert paths for Windows (escape backslashes)
-#ifdef _WIN32
-    input_path = escape_windows_path(input_path);
-    output_path = escape_windows_path(output_path);
-#endif
-
-    // Build the FFmpeg command
-    std::stringstream cmd;
-
-// Check if FFMPEG_PATH is defined (ensure it's set by CMake)
-#ifdef FFTOOL_PATH
-    cmd << "\"" << FFTOOL_PATH << "\"";
+bool TranscoderFFTool::build_arguments(const std::string &input_path,
+                                       const std::string &output_path,
+                                       std::vector<std::string> &args) {
+    // No prompts on stdin, progress goes to the pipe instead of stderr
+    args = {"-hide_banner", "-nostdin", "-nostats"};
 
     // Add start time seeking if specified (before -i for faster seeking)
     if (start_time > 0) {
-        cmd << " -ss " << start_time;
+        args.insert(args.end(), {"-ss", format_seconds(start_time)});
     }
 
-    cmd << " -i \"" << input_path << "\"";
-#else
-    std::cerr << "FFmpeg path is not defined! Ensure CMake sets FFMPEG_PATH."
-              << std::endl;
-    return false;
-#endif
+    args.insert(args.end(), {"-i", input_path});
 
-    // Add the -y flag to overwrite output file without prompting
-    cmd << " -y";
+    // Overwrite output file without prompting
+    args.push_back("-y");
 
     // Add end time or duration if specified
     if (end_time > 0) {
         if (start_time > 0) {
             // If both start and end are specified, use duration
-            double cut_duration = end_time - start_time;
-            cmd << " -t " << cut_duration;
+            args.insert(args.end(), {"-t", format_seconds(end_time - start_time)});
         } else {
             // If only end time is specified, use -to
-            cmd << " -to " << end_time;
+            args.insert(args.end(), {"-to", format_seconds(end_time)});
         }
     }
 
     // Video codec options
     if (copy_video) {
-        cmd << " -c:v copy"; // Copy video stream without re-encoding
+        args.insert(args.end(), {"-c:v", "copy"});
     } else {
-        if (!video_codec.empty()) {
-            cmd << " -c:v " << video_codec; // Use specified video codec
-        } else {
+        if (video_codec.empty()) {
             std::cerr << "Video codec is not specified!" << std::endl;
             return false;
         }
+        args.insert(args.end(), {"-c:v", video_codec});
         if (video_bit_rate > 0) {
-            cmd << " -b:v " << video_bit_rate; // Set video bitrate if specified
+            args.insert(args.end(), {"-b:v", std::to_string(video_bit_rate)});
         }
 
         // Add qscale (quality) if specified (qscale >= 0)
         if (qscale >= 0) {
-            cmd << " -qscale:v " << qscale;
+            args.insert(args.end(), {"-qscale:v", std::to_string(qscale)});
         }
 
         // Add pixel format if specified
         if (!pixel_format.empty()) {
-            cmd << " -pix_fmt " << pixel_format;
+            args.insert(args.end(), {"-pix_fmt", pixel_format});
         }
 
-        // Add scale filter if width or height is specified
+        // Add scale filter if width or height is specified, -1 keeps the
+        // aspect ratio
         if (width > 0 || height > 0) {
             std::string scale_filter = "scale=";
-            if (width > 0) {
-                scale_filter += std::to_string(width);
-            } else {
-                scale_filter += "-1";  // Keep aspect ratio
-            }
+            scale_filter += width > 0 ? std::to_string(width) : "-1";
             scale_filter += ":";
-            if (height > 0) {
-                scale_filter += std::to_string(height);
-            } else {
-                scale_filter += "-1";  // Keep aspect ratio
-            }
-            cmd << " -vf " << scale_filter;
+            scale_filter += height > 0 ? std::to_string(height) : "-1";
+            args.insert(args.end(), {"-vf", scale_filter});
+        }
+
+        // Stay within the cores the scheduler gave this job
+        if (thread_count > 0) {
+            args.insert(args.end(), {"-threads", std::to_string(thread_count),
+                                     "-filter_threads", std::to_string(thread_count)});
         }
     }
 
     // Audio codec options
     if (copy_audio) {
-        cmd << " -c:a copy"; // Copy audio stream without re-encoding
+        args.insert(args.end(), {"-c:a", "copy"});
     } else {
-        if (!audio_codec.empty()) {
-            cmd << " -c:a " << audio_codec; // Use specified audio codec
-        } else {
+        if (audio_codec.empty()) {
             std::cerr << "Audio codec is not specified!" << std::endl;
             return false;
         }
+        args.insert(args.end(), {"-c:a", audio_codec});
         if (audio_bit_rate > 0) {
-            cmd << " -b:a " << audio_bit_rate; // Set audio bitrate if specified
+            args.insert(args.end(), {"-b:a", std::to_string(audio_bit_rate)});
         }
     }
 
-    // Output file path
-    cmd << " \"" << output_path << "\"";
+    args.insert(args.end(), {"-progress", "pipe:1", output_path});
+    return true;
+}
 
-    std::string raw_cmd = cmd.str();
-    std::string final_cmd = "\"" + raw_cmd;
+int64_t TranscoderFFTool::probe_range(const std::string &input_path) {
+    AVFormatContext *raw = NULL;
+    if (avformat_open_input(&raw, input_path.c_str(), NULL, NULL) < 0)
+        return 0;
+    AVInputFormatContextPtr fmt_ctx(raw);
+    // Most containers store the duration in the header
+    if (fmt_ctx->duration == AV_NOPTS_VALUE)
+        avformat_find_stream_info(fmt_ctx.get(), NULL);
+    int64_t duration = fmt_ctx->duration;
+    fmt_ctx.reset();
+    if (duration == AV_NOPTS_VALUE || duration <= 0)
+        return 0;
+
+    double begin = start_time > 0 ? start_time : 0.0;
+    double end = duration / static_cast<double>(AV_TIME_BASE);
+    if (end_time > 0 && end_time < end)
+        end = end_time;
+    return end > begin ? static_cast<int64_t>((end - begin) * AV_TIME_BASE) : 0;
+}
 
-    // Execute the command
-    std::cout << "Executing: " << final_cmd << std::endl;
+void TranscoderFFTool::parse_progress_line(const std::string &line) {
+    size_t separator = line.find('=');
+    if (separator == std::string::npos)
+        return;
+    std::string key = line.substr(0, separator);
+    std::string value = line.substr(separator + 1);
+
+    // out_time_ms is in microseconds as well, older ffmpeg only has it
+    if (key == "out_time_us" || key == "out_time_ms") {
+        char *end = nullptr;
+        long long position = std::strtoll(value.c_str(), &end, 10);
+        if (end == value.c_str() || position < 0)
+            return;
+        frame_number = position;
+        if (frame_total_number > 0)
+            send_process_parameter(frame_number, frame_total_number);
+        else
+            process_parameter->touch();
+    } else if (key == "progress") {
+        // one block per update, "end" after the last one
+        progress_seen = true;
+        process_parameter->touch();
+    }
+}
 
-    int ret = 0;
+void TranscoderFFTool::touch_while_silent() {
+    if (!progress_seen) {
+        process_parameter->touch();
+        return;
+    }
+    std::error_code ec;
+    uintmax_t size = std::filesystem::file_size(output_file, ec);
+    if (ec)
+        return;
+    std::filesystem::file_time_type time =
+        std::filesystem::last_write_time(output_file, ec);
+    if (ec)
+        return;
+    if (size != output_size || time != output_time) {
+        output_size = size;
+        output_time = time;
+        process_parameter->touch();
+    }
+}
 
-#ifdef _WIN32
-    // Windows-specific command execution (use cmd /c for shell commands)
-    std::string full_cmd = "cmd /c " + final_cmd;
-    ret = system(full_cmd.c_str());
+bool TranscoderFFTool::transcode(std::string input_path,
+                                 std::string output_path) {
+    if (!prepared_opt()) {
+        std::cerr << "Failed to prepare options for transcoding." << std::endl;
+        return false;
+    }
+
+#ifndef FFTOOL_PATH
+    std::cerr << "FFmpeg path is not defined! Ensure CMake sets FFTOOL_PATH."
+              << std::endl;
+    return false;
 #else
-    // Unix-like systems (Linux/macOS) can directly use system()
-    ret = system(cmd.str().c_str());
-#endif
+    std::vector<std::string> args;
+    if (!build_arguments(input_path, output_path, args)) {
+        return false;
+    }
+    args.insert(args.begin(), FFTOOL_PATH);
+
+    frame_number = 0;
+    frame_total_number = probe_range(input_path);
+    progress_buffer.clear();
+    output_file = output_path;
+    progress_seen = false;
+    output_size = 0;
+    output_time = std::filesystem::file_time_type{};
+
+    std::cout << "Executing:";
+    for (const std::string &arg : args) {
+        std::cout << " " << arg;
+    }
+    std::cout << std::endl;
+
+    int ret = run_process(args);
+
+    if (should_stop()) {
+        if (process_parameter->is_cancel_requested())
+            std::cerr << "FFmpeg transcoding cancelled" << std::endl;
+        else
+            std::cerr << "FFmpeg made no progress for "
+                      << process_parameter->get_stall_timeout()
+                      << " seconds, stopped" << std::endl;
+        return false;
+    }
 
     if (ret != 0) {
         std::cerr << "FFmpeg transcoding failed with exit code: " << ret
@@ -215,6 +323,202 @@ bool TranscoderFFTool::transcode(std::string input_path,
         return false;
     }
 
+    process_parameter->set_process_number(1, 1);
     std::cout << "Transcoding completed successfully." << std::endl;
     return true;
+#endif
+}
+
+int TranscoderFFTool::run_process(const std::vector<std::string> &args) {
+    // Split the progress output into lines
+    auto consume = [this](const char *data, size_t size) {
+        progress_buffer.append(data, size);
+        size_t newline;
+        while ((newline = progress_buffer.find('\n')) != std::string::npos) {
+            std::string line = progress_buffer.substr(0, newline);
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            progress_buffer.erase(0, newline + 1);
+            parse_progress_line(line);
+        }
+    };
+    char buffer[4096];
+
+#ifdef _WIN32
+    SECURITY_ATTRIBUTES sa;
+    sa.nLength = sizeof(sa);
+    sa.lpSecurityDescriptor = NULL;
+    sa.bInheritHandle = TRUE;
+    HANDLE read_pipe = NULL;
+    HANDLE write_pipe = NULL;
+    if (!CreatePipe(&read_pipe, &write_pipe, &sa, 0)) {
+        std::cerr << "Failed to create pipe, error " << GetLastError()
+                  << std::endl;
+        return -1;
+    }
+    SetHandleInformation(read_pipe, HANDLE_FLAG_INHERIT, 0);
+
+    std::string command_line;
+    for (const std::string &arg : args) {
+        if (!command_line.empty())
+            command_line += " ";
+        command_line += quote_windows_argument(arg);
+    }
+    std::vector<char> command(command_line.begin(), command_line.end());
+    command.push_back('\0');
+
+    STARTUPINFOA si;
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESTDHANDLES;
+    si.hStdInput = NULL;
+    si.hStdOutput = write_pipe;
+    si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    ZeroMemory(&pi, sizeof(pi));
+    BOOL started = CreateProcessA(args[0].c_str(), command.data(), NULL, NULL,
+                                  TRUE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi);
+    CloseHandle(write_pipe);
+    if (!started) {
+        std::cerr << "Failed to start FFmpeg, error " << GetLastError()
+                  << std::endl;
+        CloseHandle(read_pipe);
+        return -1;
+    }
+
+    bool stopped = false;
+    while (true) {
+        DWORD available = 0;
+        while (PeekNamedPipe(read_pipe, NULL, 0, NULL, &available, NULL) &&
+               available > 0) {
+            DWORD bytes = 0;
+            if (!ReadFile(read_pipe, buffer, sizeof(buffer), &bytes, NULL) ||
+                bytes == 0)
+                break;
+            consume(buffer, bytes);
+        }
+        if (WaitForSingleObject(pi.hProcess,
+                                static_cast<DWORD>(POLL_INTERVAL.count())) !=
+            WAIT_TIMEOUT)
+            break;
+        touch_while_silent();
+        if (should_stop()) {
+            TerminateProcess(pi.hProcess, 1);
+            WaitForSingleObject(pi.hProcess, INFINITE);
+            stopped = true;
+            break;
+        }
+    }
+
+    DWORD exit_code = 1;
+    GetExitCodeProcess(pi.hProcess, &exit_code);
+    CloseHandle(pi.hThread);
+    CloseHandle(pi.hProcess);
+    CloseHandle(read_pipe);
+    return stopped ? -1 : static_cast<int>(exit_code);
+#else
+    // Children of concurrent jobs must not inherit each other's pipes, so
+    // the fds are close-on-exec from the start
+    int fds[2];
+#ifdef __APPLE__
+    // No pipe2; the flags are set right away, but a spawn on another
+    // thread can still slip in between
+    int ret = pipe(fds);
+    if (ret == 0) {
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    }
+#else
+    int ret = pipe2(fds, O_CLOEXEC);
+#endif
+    if (ret < 0) {
+        std::cerr << "Failed to create pipe: " << strerror(errno) << std::endl;
+        return -1;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null",
+                                     O_RDONLY, 0);
+
+    // Own process group, so a stop reaches everything ffmpeg started
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
+
+    std::vector<char *> argv;
+    for (const std::string &arg : args) {
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid = -1;
+    int spawn_error = posix_spawn(&pid, args[0].c_str(), &actions, &attr,
+                                  argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    close(fds[1]);
+    if (spawn_error != 0) {
+        std::cerr << "Failed to start FFmpeg: " << strerror(spawn_error)
+                  << std::endl;
+        close(fds[0]);
+        return -1;
+    }
+
+    int status = 0;
+    bool exited = false;
+    bool stopping = false;
+    bool pipe_open = true;
+    auto stop_time = std::chrono::steady_clock::now();
+    while (!exited || pipe_open) {
+        if (pipe_open) {
+            struct pollfd pfd = {fds[0], POLLIN, 0};
+            int ready = poll(&pfd, 1, static_cast<int>(POLL_INTERVAL.count()));
+            if (ready > 0) {
+                ssize_t bytes = read(fds[0], buffer, sizeof(buffer));
+                if (bytes > 0)
+                    consume(buffer, static_cast<size_t>(bytes));
+                else if (bytes == 0 || errno != EINTR)
+                    pipe_open = false;
+            } else if (ready < 0 && errno != EINTR) {
+                pipe_open = false;
+            }
+        } else {
+            std::this_thread::sleep_for(POLL_INTERVAL);
+        }
+
+        if (!exited) {
+            pid_t done = waitpid(pid, &status, WNOHANG);
+            if (done == pid || (done < 0 && errno != EINTR))
+                exited = true;
+        }
+        // A grandchild may keep the pipe open, the exit of ffmpeg is what
+        // counts
+        if (exited && pipe_open && !stopping) {
+            struct pollfd pfd = {fds[0], POLLIN, 0};
+            if (poll(&pfd, 1, 0) <= 0)
+                pipe_open = false;
+        }
+
+        touch_while_silent();
+        if (!exited && !stopping && should_stop()) {
+            // SIGTERM lets ffmpeg close the output cleanly
+            kill(-pid, SIGTERM);
+            stopping = true;
+            stop_time = std::chrono::steady_clock::now();
+        } else if (!exited && stopping &&
+                   std::chrono::steady_clock::now() - stop_time > KILL_GRACE) {
+            kill(-pid, SIGKILL);
+        }
+        if (exited && stopping)
+            break;
+    }
+    close(fds[0]);
+
+    if (stopping || !WIFEXITED(status))
+        return -1;
+    return WEXITSTATUS(status);
+#endif
 }